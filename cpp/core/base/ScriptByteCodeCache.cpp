@@ -0,0 +1,477 @@
+//---------------------------------------------------------------------------
+/*
+        TVP2 ( T Visual Presenter 2 )  A script authoring tool
+        Copyright (C) 2000 W.Dee <dee@kikyou.info> and contributors
+
+        See details of license at "license.txt"
+*/
+//---------------------------------------------------------------------------
+// On-disk cache of compiled TJS2 bytecode
+//---------------------------------------------------------------------------
+#include "tjsCommHead.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "ScriptByteCodeCache.h"
+#include "tjsInterCodeGen.h"
+#include "MsgIntf.h"
+#include "StorageIntf.h"
+#include "SysInitIntf.h"
+#include "UtilStreams.h"
+#include "ThreadIntf.h"
+#include "Platform.h"
+
+//---------------------------------------------------------------------------
+// increase this when the compiler output changes while the engine version
+// stays the same; bytecode cached by older builds is then ignored.
+#define TVP_BYTECODE_CACHE_FORMAT 2
+
+//---------------------------------------------------------------------------
+// cache file layout : tTVPByteCodeCacheHeader, then the bytecode.
+// the files are written in the native byte order; they never leave the
+// machine.
+//---------------------------------------------------------------------------
+static const char TVPByteCodeCacheTag[8] = { 'T', 'J', 'S', '2',
+                                             'B', 'C', 'C', 0 };
+
+struct tTVPByteCodeCacheHeader {
+    char Tag[8];
+    tjs_uint64 EngineHash; // engine version and VM code set
+    tjs_uint64 SourceHash; // script text
+    tjs_uint64 ByteCodeHash; // bytecode following this header
+    tjs_uint32 SourceLength; // in characters
+    tjs_uint32 ByteCodeSize; // in bytes
+};
+
+//---------------------------------------------------------------------------
+#define TVP_BYTECODE_CACHE_HASH_BASIS 14695981039346656037ULL
+static tjs_uint64
+TVPByteCodeCacheHash(const void *data, size_t size,
+                     tjs_uint64 hash = TVP_BYTECODE_CACHE_HASH_BASIS) {
+    // FNV-1a
+    const auto *p = static_cast<const tjs_uint8 *>(data);
+    for(size_t i = 0; i < size; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+//---------------------------------------------------------------------------
+static tjs_uint64
+TVPByteCodeCacheHash(const ttstr &str,
+                     tjs_uint64 hash = TVP_BYTECODE_CACHE_HASH_BASIS) {
+    return TVPByteCodeCacheHash(str.c_str(), str.GetLen() * sizeof(tjs_char),
+                                hash);
+}
+//---------------------------------------------------------------------------
+static bool TVPIsByteCodeCacheEnabled() {
+    static int enabled = -1;
+    if(enabled == -1) {
+        enabled = 1;
+        tTJSVariant val;
+        if(TVPGetCommandLine(TJS_W("-bytecodecache"), &val)) {
+            ttstr str(val);
+            if(str == TJS_W("no"))
+                enabled = 0;
+        }
+    }
+    return enabled == 1;
+}
+//---------------------------------------------------------------------------
+static tjs_uint64 TVPGetByteCodeCacheEngineHash() {
+    // the same script compiles to different bytecode on other engine
+    // versions, or when the VM codes are renumbered
+    static tjs_uint64 hash = 0;
+    if(!hash) {
+        ttstr sig = TVPGetVersionString() + TJS_W("/") +
+            ttstr(TJS::TJSVersionMajor) + TJS_W(".") +
+            ttstr(TJS::TJSVersionMinor) + TJS_W(".") +
+            ttstr(TJS::TJSVersionRelease) + TJS_W("/") +
+            ttstr((tjs_int)TJS::__VM_LAST) + TJS_W("/") +
+            ttstr((tjs_int)TVP_BYTECODE_CACHE_FORMAT);
+        hash = TVPByteCodeCacheHash(sig);
+    }
+    return hash;
+}
+//---------------------------------------------------------------------------
+static bool TVPUsesPreProcessor(const tjs_char *p) {
+    // the result of "@if" depends on the values "@set" by the scripts run
+    // before, and a cached "@set" would not set anything. the lexer takes
+    // any "@if..." or "@set..." as a directive, and so does this check.
+    for(; *p; p++) {
+        if(*p == TJS_W('@') &&
+           (!TJS_strncmp(p + 1, TJS_W("if"), 2) ||
+            !TJS_strncmp(p + 1, TJS_W("set"), 3)))
+            return true;
+    }
+    return false;
+}
+//---------------------------------------------------------------------------
+static std::string TVPGetByteCodeCacheFolder() {
+    return TVPGetInternalPreferencePath() + "bytecode/";
+}
+//---------------------------------------------------------------------------
+static bool TVPReadByteCodeCache(const std::string &filename,
+                                 const tTVPByteCodeCacheHeader &expected,
+                                 std::vector<tjs_uint8> &bytecode) {
+    FILE *fp = fopen(filename.c_str(), "rb");
+    if(!fp)
+        return false;
+
+    tTVPByteCodeCacheHeader header;
+    bool ok = fread(&header, sizeof(header), 1, fp) == 1 &&
+        !memcmp(header.Tag, expected.Tag, sizeof(header.Tag)) &&
+        header.EngineHash == expected.EngineHash &&
+        header.SourceHash == expected.SourceHash &&
+        header.SourceLength == expected.SourceLength &&
+        header.ByteCodeSize != 0;
+    if(ok) {
+        // a damaged file must not reach the bytecode loader
+        bytecode.resize(header.ByteCodeSize);
+        ok = fread(bytecode.data(), 1, bytecode.size(), fp) ==
+                bytecode.size() &&
+            TVPByteCodeCacheHash(bytecode.data(), bytecode.size()) ==
+                header.ByteCodeHash;
+    }
+    fclose(fp);
+    return ok;
+}
+//---------------------------------------------------------------------------
+static void TVPWriteByteCodeCache(const std::string &filename,
+                                  const tTVPByteCodeCacheHeader &header,
+                                  const std::vector<tjs_uint8> &bytecode) {
+    // write to a temporary file and rename it, so that a cache file is
+    // always complete even if the engine stops while writing
+    std::string temp = filename + ".tmp";
+    FILE *fp = fopen(temp.c_str(), "wb");
+    if(!fp) { // make dirs
+        TVPCreateFolders(TVPGetByteCodeCacheFolder());
+        fp = fopen(temp.c_str(), "wb");
+        if(!fp)
+            return;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+        fwrite(bytecode.data(), 1, bytecode.size(), fp) == bytecode.size();
+    ok = fclose(fp) == 0 && ok;
+    if(ok) {
+        remove(filename.c_str()); // rename does not overwrite on Windows
+        ok = rename(temp.c_str(), filename.c_str()) == 0;
+    }
+    if(!ok)
+        remove(temp.c_str());
+}
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// cache entries
+//---------------------------------------------------------------------------
+struct tTVPByteCodeCacheEntry {
+    ttstr Script;
+    ttstr Name;
+    tjs_int LineOffset = 0;
+    bool IsExpression = false;
+    bool IsResultNeeded = false;
+    tjs_uint64 Slot = 0;
+    std::string FileName;
+    tTVPByteCodeCacheHeader Header{};
+    std::vector<tjs_uint8> ByteCode;
+};
+//---------------------------------------------------------------------------
+static void TVPSetByteCodeCacheSlot(tTVPByteCodeCacheEntry &entry,
+                                    const ttstr &storage) {
+    // one cache slot per storage; the other conditions only select
+    // a different slot
+    tjs_int32 flags[3] = { entry.LineOffset, entry.IsExpression,
+                           entry.IsResultNeeded };
+    entry.Slot = TVPByteCodeCacheHash(flags, sizeof(flags),
+                                      TVPByteCodeCacheHash(storage));
+    char slotname[32];
+    snprintf(slotname, sizeof(slotname), "%016llx.tjb",
+             (unsigned long long)entry.Slot);
+    entry.FileName = TVPGetByteCodeCacheFolder() + slotname;
+
+    memcpy(entry.Header.Tag, TVPByteCodeCacheTag, sizeof(entry.Header.Tag));
+    entry.Header.EngineHash = TVPGetByteCodeCacheEngineHash();
+    entry.Header.SourceHash = TVPByteCodeCacheHash(entry.Script);
+    entry.Header.SourceLength = entry.Script.GetLen();
+}
+//---------------------------------------------------------------------------
+// cache slots written in this session. a slot whose script keeps changing
+// ( a script generated at run time under a fixed name ) is written only
+// once, not every time it runs.
+static std::mutex TVPByteCodeCacheWrittenMutex;
+static std::set<tjs_uint64> TVPByteCodeCacheWritten;
+//---------------------------------------------------------------------------
+static void TVPFillByteCodeCacheEntry(tTJS *tjs, tTVPByteCodeCacheEntry &entry,
+                                      bool background) {
+    if(TVPReadByteCodeCache(entry.FileName, entry.Header, entry.ByteCode))
+        return;
+
+    // compile, with the source positions to have line numbers in error
+    // messages
+    tTVPMemoryStream stream;
+    if(background)
+        tjs->CompileScriptInBackground(
+            entry.Script.c_str(), &stream, entry.IsResultNeeded, true,
+            entry.IsExpression, entry.Name.c_str(), entry.LineOffset);
+    else
+        tjs->CompileScript(entry.Script.c_str(), &stream,
+                           entry.IsResultNeeded, true, entry.IsExpression,
+                           entry.Name.c_str(), entry.LineOffset);
+    const auto *p = static_cast<const tjs_uint8 *>(stream.GetInternalBuffer());
+    entry.ByteCode.assign(p, p + stream.GetSize());
+
+    bool write;
+    {
+        std::lock_guard<std::mutex> lock(TVPByteCodeCacheWrittenMutex);
+        write = TVPByteCodeCacheWritten.insert(entry.Slot).second;
+    }
+    if(write) {
+        entry.Header.ByteCodeSize = (tjs_uint32)entry.ByteCode.size();
+        entry.Header.ByteCodeHash =
+            TVPByteCodeCacheHash(entry.ByteCode.data(), entry.ByteCode.size());
+        TVPWriteByteCodeCache(entry.FileName, entry.Header, entry.ByteCode);
+    }
+}
+//---------------------------------------------------------------------------
+static bool TVPIsByteCodeCacheable(tTJS *tjs, const ttstr &script) {
+    return tjs && !script.IsEmpty() && !TJS::TJSEnableDebugMode &&
+        TVPIsByteCodeCacheEnabled() && !TVPUsesPreProcessor(script.c_str());
+}
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// precompiling threads
+//---------------------------------------------------------------------------
+// the threads compile the scripts to bytecode ( or read it from the cache
+// files ) while the main thread goes on; only the bytecode, which is plain
+// bytes, is handed back to the main thread. the scripts are compiled with
+// tTJS::CompileScriptInBackground, which keeps off the objects of the main
+// thread. a script it can not compile there is compiled again when it runs,
+// and reports its errors then.
+//---------------------------------------------------------------------------
+// upper limit of the thread count
+static const tjs_int TVPMaxPrecompileThread = 4;
+//---------------------------------------------------------------------------
+struct tTVPPrecompileJob : tTVPByteCodeCacheEntry {
+    enum tState { jsQueued, jsCompiling, jsDone, jsFailed };
+    tState State = jsQueued;
+    tTJS *Engine = nullptr;
+
+    ~tTVPPrecompileJob() {
+        if(Engine)
+            Engine->Release();
+    }
+};
+//---------------------------------------------------------------------------
+static std::mutex TVPPrecompileMutex;
+// signaled when a job is queued or finished
+static std::condition_variable TVPPrecompileCond;
+// jobs by the hash of their storage, until the storage is executed
+static std::map<tjs_uint64, tTVPPrecompileJob *> TVPPrecompileJobs;
+static std::deque<tTVPPrecompileJob *> TVPPrecompileQueue;
+static std::vector<std::thread> TVPPrecompileThreads;
+static bool TVPPrecompileTerminated = false;
+//---------------------------------------------------------------------------
+static void TVPPrecompileThread() {
+    std::unique_lock<std::mutex> lock(TVPPrecompileMutex);
+    while(true) {
+        TVPPrecompileCond.wait(lock, [] {
+            return TVPPrecompileTerminated || !TVPPrecompileQueue.empty();
+        });
+        if(TVPPrecompileTerminated)
+            break;
+        tTVPPrecompileJob *job = TVPPrecompileQueue.front();
+        TVPPrecompileQueue.pop_front();
+        job->State = tTVPPrecompileJob::jsCompiling;
+        lock.unlock();
+
+        bool done = true;
+        try {
+            TVPFillByteCodeCacheEntry(job->Engine, *job, true);
+        } catch(...) {
+            done = false;
+        }
+
+        lock.lock();
+        job->State =
+            done ? tTVPPrecompileJob::jsDone : tTVPPrecompileJob::jsFailed;
+        TVPPrecompileCond.notify_all();
+    }
+}
+//---------------------------------------------------------------------------
+void TVPPrecompileScript(tTJS *tjs, const ttstr &script, const ttstr &storage,
+                         const ttstr &name) {
+    if(!TVPIsByteCodeCacheable(tjs, script))
+        return;
+
+    tjs_uint64 key = TVPByteCodeCacheHash(storage);
+    std::lock_guard<std::mutex> lock(TVPPrecompileMutex);
+    if(TVPPrecompileJobs.count(key))
+        return;
+
+    auto *job = new tTVPPrecompileJob();
+    job->Script = script;
+    job->Name = name;
+    TVPSetByteCodeCacheSlot(*job, storage);
+    job->Engine = tjs;
+    tjs->AddRef();
+    TVPPrecompileJobs[key] = job;
+    TVPPrecompileQueue.push_back(job);
+
+    if(TVPPrecompileThreads.empty()) {
+        // leave a processor to the main thread
+        tjs_int num = std::max<tjs_int>(1, TVPGetProcessorNum() - 1);
+        num = std::min(num, TVPMaxPrecompileThread);
+        for(tjs_int i = 0; i < num; i++) {
+            TVPPrecompileThreads.emplace_back([] {
+                TVPPrecompileThread();
+                TVPOnThreadExited();
+            });
+        }
+    }
+    TVPPrecompileCond.notify_all();
+}
+//---------------------------------------------------------------------------
+static bool TVPTakePrecompiledByteCode(tTVPByteCodeCacheEntry &entry,
+                                       const ttstr &storage) {
+    tjs_uint64 key = TVPByteCodeCacheHash(storage);
+    tTVPPrecompileJob *job;
+    {
+        std::unique_lock<std::mutex> lock(TVPPrecompileMutex);
+        auto i = TVPPrecompileJobs.find(key);
+        if(i == TVPPrecompileJobs.end())
+            return false;
+        job = i->second;
+        TVPPrecompileJobs.erase(i);
+        if(job->State == tTVPPrecompileJob::jsQueued) {
+            // not started yet; compiling here is faster than waiting
+            TVPPrecompileQueue.erase(std::find(TVPPrecompileQueue.begin(),
+                                               TVPPrecompileQueue.end(), job));
+        } else {
+            TVPPrecompileCond.wait(lock, [job] {
+                return job->State == tTVPPrecompileJob::jsDone ||
+                    job->State == tTVPPrecompileJob::jsFailed;
+            });
+        }
+    }
+
+    // the storage may have been read in another mode, or executed with
+    // other conditions
+    bool taken = job->State == tTVPPrecompileJob::jsDone &&
+        job->Slot == entry.Slot &&
+        job->Header.SourceHash == entry.Header.SourceHash &&
+        job->Header.SourceLength == entry.Header.SourceLength;
+    if(taken)
+        entry.ByteCode.swap(job->ByteCode);
+    delete job;
+    return taken;
+}
+//---------------------------------------------------------------------------
+void TVPStopScriptPrecompile() {
+    {
+        std::lock_guard<std::mutex> lock(TVPPrecompileMutex);
+        TVPPrecompileTerminated = true;
+    }
+    TVPPrecompileCond.notify_all();
+    for(std::thread &thread : TVPPrecompileThreads)
+        thread.join();
+    TVPPrecompileThreads.clear();
+
+    for(auto &job : TVPPrecompileJobs)
+        delete job.second;
+    TVPPrecompileJobs.clear();
+    TVPPrecompileQueue.clear();
+    TVPPrecompileTerminated = false;
+}
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// TVPExecuteScriptWithByteCodeCache
+//---------------------------------------------------------------------------
+bool TVPExecuteScriptWithByteCodeCache(tTJS *tjs, const ttstr &script,
+                                       const ttstr &storage, const ttstr &name,
+                                       tjs_int lineofs, iTJSDispatch2 *context,
+                                       tTJSVariant *result, bool isexpression) {
+    if(!TVPIsByteCodeCacheable(tjs, script))
+        return false;
+
+    tTVPByteCodeCacheEntry entry;
+    entry.Script = script;
+    entry.Name = name;
+    entry.LineOffset = lineofs;
+    entry.IsExpression = isexpression;
+    entry.IsResultNeeded = result != nullptr;
+    TVPSetByteCodeCacheSlot(entry, storage);
+
+    if(!TVPTakePrecompiledByteCode(entry, storage))
+        TVPFillByteCodeCacheEntry(tjs, entry, false);
+
+    // the first run executes the freshly compiled bytecode too, so that
+    // every run goes through the same code
+    tjs->LoadByteCode(entry.ByteCode.data(), entry.ByteCode.size(), result,
+                      context, name.c_str(), script.c_str(), lineofs);
+    return true;
+}
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// TVPReadCompiledCache / TVPWriteCompiledCache
+//---------------------------------------------------------------------------
+static void TVPSetCompiledCacheSlot(const ttstr &storage, const char *kind,
+                                    tjs_uint32 format, const ttstr &source,
+                                    std::string &filename,
+                                    tTVPByteCodeCacheHeader &header) {
+    // the same header as the bytecode, with the kind in the tag and the
+    // format in the engine hash
+    memset(&header, 0, sizeof(header));
+    memcpy(header.Tag, "TVPC", 4);
+    strncpy(header.Tag + 4, kind, 3);
+    header.EngineHash = TVPByteCodeCacheHash(
+        &format, sizeof(format), TVPGetByteCodeCacheEngineHash());
+    header.SourceHash = TVPByteCodeCacheHash(source);
+    header.SourceLength = source.GetLen();
+
+    char slotname[32];
+    snprintf(slotname, sizeof(slotname), "%016llx.%s",
+             (unsigned long long)TVPByteCodeCacheHash(
+                 kind, strlen(kind), TVPByteCodeCacheHash(storage)),
+             kind);
+    filename = TVPGetByteCodeCacheFolder() + slotname;
+}
+//---------------------------------------------------------------------------
+bool TVPReadCompiledCache(const ttstr &storage, const char *kind,
+                          tjs_uint32 format, const ttstr &source,
+                          std::vector<tjs_uint8> &data) {
+    if(source.IsEmpty() || !TVPIsByteCodeCacheEnabled())
+        return false;
+
+    std::string filename;
+    tTVPByteCodeCacheHeader header;
+    TVPSetCompiledCacheSlot(storage, kind, format, source, filename, header);
+    return TVPReadByteCodeCache(filename, header, data);
+}
+//---------------------------------------------------------------------------
+void TVPWriteCompiledCache(const ttstr &storage, const char *kind,
+                           tjs_uint32 format, const ttstr &source,
+                           const std::vector<tjs_uint8> &data) {
+    if(source.IsEmpty() || data.empty() || !TVPIsByteCodeCacheEnabled())
+        return;
+
+    std::string filename;
+    tTVPByteCodeCacheHeader header;
+    TVPSetCompiledCacheSlot(storage, kind, format, source, filename, header);
+    header.ByteCodeSize = (tjs_uint32)data.size();
+    header.ByteCodeHash = TVPByteCodeCacheHash(data.data(), data.size());
+    TVPWriteByteCodeCache(filename, header, data);
+}
+//---------------------------------------------------------------------------
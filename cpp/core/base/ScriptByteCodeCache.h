@@ -0,0 +1,66 @@
+//---------------------------------------------------------------------------
+/*
+        TVP2 ( T Visual Presenter 2 )  A script authoring tool
+        Copyright (C) 2000 W.Dee <dee@kikyou.info> and contributors
+
+        See details of license at "license.txt"
+*/
+//---------------------------------------------------------------------------
+// On-disk cache of compiled TJS2 bytecode
+//---------------------------------------------------------------------------
+#ifndef ScriptByteCodeCacheH
+#define ScriptByteCodeCacheH
+
+#include <vector>
+
+#include "tjs.h"
+
+//---------------------------------------------------------------------------
+// TVPExecuteScriptWithByteCodeCache
+//---------------------------------------------------------------------------
+// executes "script" like tTJS::ExecScript ( or tTJS::EvalExpression if
+// "isexpression" is true ). the bytecode is cached in the user's cache
+// directory, keyed by "storage"; later runs load it instead of compiling the
+// script again, as long as the script text and the engine are the same.
+// returns false without executing anything when the script can not be
+// cached ( it uses the pre-processor, the cache is disabled, ... ); the
+// caller then executes the script as usual.
+extern bool TVPExecuteScriptWithByteCodeCache(
+    tTJS *tjs, const ttstr &script, const ttstr &storage, const ttstr &name,
+    tjs_int lineofs, iTJSDispatch2 *context, tTJSVariant *result,
+    bool isexpression);
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// TVPPrecompileScript
+//---------------------------------------------------------------------------
+// starts compiling "script", the content of "storage", to bytecode on
+// a worker thread. the bytecode is kept until
+// TVPExecuteScriptWithByteCodeCache runs the storage, which then only loads
+// it, waiting for the thread if it is still compiling. the bytecode goes to
+// the cache files as well. scripts which can not be cached are ignored.
+extern void TVPPrecompileScript(tTJS *tjs, const ttstr &script,
+                                const ttstr &storage, const ttstr &name);
+
+// stops the worker threads and drops the bytecode which has not run;
+// called before the script engine is released
+extern void TVPStopScriptPrecompile();
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// TVPReadCompiledCache / TVPWriteCompiledCache
+//---------------------------------------------------------------------------
+// other compiled forms of storages ( such as tokenized KAG scenarios ), kept
+// in the same directory as the bytecode. "kind" is a name of up to three
+// characters, used as the extension of the cache file; "format" is the
+// version of the data layout. the data read back is the one written for the
+// same storage, kind, format and source text on the same engine.
+extern bool TVPReadCompiledCache(const ttstr &storage, const char *kind,
+                                 tjs_uint32 format, const ttstr &source,
+                                 std::vector<tjs_uint8> &data);
+extern void TVPWriteCompiledCache(const ttstr &storage, const char *kind,
+                                  tjs_uint32 format, const ttstr &source,
+                                  const std::vector<tjs_uint8> &data);
+//---------------------------------------------------------------------------
+
+#endif
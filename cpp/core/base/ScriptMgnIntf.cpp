@@ -15,6 +15,7 @@
 #include "tjsDebug.h"
 #include "tjsArray.h"
 #include "ScriptMgnIntf.h"
+#include "ScriptByteCodeCache.h"
 #include "StorageIntf.h"
 #include "DebugIntf.h"
 #include "WindowIntf.h"
@@ -393,6 +394,7 @@ class tTVPTJSGCCallback : public tTVPCompactEventCallbackIntf {
 // TVPInitScriptEngine
 //---------------------------------------------------------------------------
 static bool TVPScriptEngineInit = false;
+static ttstr TVPScriptProfilePath; // written on uninitialization
 
 void TVPInitScriptEngine() {
     if(TVPScriptEngineInit)
@@ -436,6 +438,13 @@ void TVPInitScriptEngine() {
         }
     }
 
+    // Start script profiler
+    if(TVPGetCommandLine(TJS_W("-profile"), &val)) {
+        TVPScriptProfilePath = val;
+        if(!TVPScriptProfilePath.IsEmpty())
+            TJSStartProfiler();
+    }
+
 #ifdef TVP_START_UP_SCRIPT_NAME
     TVPStartupScriptName = TVP_START_UP_SCRIPT_NAME;
 #else
@@ -560,6 +569,17 @@ void TVPUninitScriptEngine() {
         return;
     TVPScriptEngineUninit = true;
 
+    TVPStopScriptPrecompile();
+
+    if(TJSProfilerEnabled() && !TVPScriptProfilePath.IsEmpty()) {
+        TJSStopProfiler();
+        try {
+            TVPWriteScriptProfile(TVPScriptProfilePath);
+        } catch(...) {
+            // ignore errors
+        }
+    }
+
     // TVPScriptEngine->Shutdown();
     TVPScriptEngine->Release();
     /*
@@ -803,6 +823,10 @@ void TVPExecuteStorage(const ttstr &name, iTJSDispatch2 *context,
     // end
 
     if(TVPScriptEngine) {
+        if(TVPExecuteScriptWithByteCodeCache(TVPScriptEngine, buffer, place,
+                                             shortname, 0, context, result,
+                                             isexpression))
+            return;
 
         if(!isexpression)
             TVPScriptEngine->ExecScript(buffer, result, context, &shortname);
@@ -848,6 +872,41 @@ void TVPCompileStorage(const ttstr &name, bool isrequestresult,
 }
 //---------------------------------------------------------------------------
 
+//---------------------------------------------------------------------------
+void TVPPrecompileStorage(const ttstr &name) {
+    // start compiling the script in the storage on a worker thread; see
+    // TVPPrecompileScript. the text is read here, as the storage system
+    // and the text decoders may call into the scripts.
+    if(!TVPScriptEngine)
+        TVPThrowInternalError;
+
+    ttstr place(TVPSearchPlacedPath(name));
+    ttstr shortname(TVPExtractStorageName(place));
+    std::unique_ptr<iTJSTextReadStream> stream{ TVPCreateTextStreamForRead(
+        place, TJS_W("")) };
+    ttstr buffer;
+    stream->Read(buffer, 0);
+
+    TVPPrecompileScript(TVPScriptEngine, buffer, place, shortname);
+}
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+void TVPWriteScriptProfile(const ttstr &path) {
+    // Chrome trace event JSON if the name ends with ".json", folded stacks
+    // for flame graphs otherwise
+    ttstr ext(TVPExtractStorageExt(path));
+    ext.ToLowerCase();
+
+    std::unique_ptr<tTJSBinaryStream> stream{ TVPCreateStream(path,
+                                                              TJS_BS_WRITE) };
+    if(ext == TJS_W(".json"))
+        TJSWriteProfileChromeTrace(stream.get());
+    else
+        TJSWriteProfileFoldedStacks(stream.get());
+}
+//---------------------------------------------------------------------------
+
 //---------------------------------------------------------------------------
 // TVPCreateMessageMapFile
 //---------------------------------------------------------------------------
@@ -1388,6 +1447,31 @@ TJS_BEGIN_NATIVE_METHOD_DECL(
 }
 TJS_END_NATIVE_STATIC_METHOD_DECL(/*func. name*/ compileStorage)
 //----------------------------------------------------------------------
+TJS_BEGIN_NATIVE_METHOD_DECL(/*func. name*/ precompile) {
+    // compile the scripts in the storages in background; execStorage runs
+    // them without compiling
+    if(numparams < 1)
+        return TJS_E_BADPARAMCOUNT;
+
+    tTJSVariantClosure array = param[0]->AsObjectClosureNoAddRef();
+    if(!array.Object)
+        return TJS_E_INVALIDPARAM;
+
+    tTJSVariant val;
+    array.PropGet(0, TJS_W("count"), nullptr, &val, nullptr);
+    tjs_int count = val;
+    for(tjs_int i = 0; i < count; i++) {
+        // void elements are skipped
+        val.Clear();
+        array.PropGetByNum(0, i, &val, nullptr);
+        if(val.Type() != tvtVoid)
+            TVPPrecompileStorage(val);
+    }
+
+    return TJS_S_OK;
+}
+TJS_END_NATIVE_STATIC_METHOD_DECL(/*func. name*/ precompile)
+//----------------------------------------------------------------------
 TJS_BEGIN_NATIVE_METHOD_DECL(/*func. name*/ exec) {
     // execute given string as a script
     if(numparams < 1)
@@ -1406,11 +1490,20 @@ TJS_BEGIN_NATIVE_METHOD_DECL(/*func. name*/ exec) {
         ? param[3]->AsObjectNoAddRef()
         : nullptr;
 
-    if(TVPScriptEngine)
-        TVPScriptEngine->ExecScript(content, result, context, &name, lineofs);
-    else
+    if(!TVPScriptEngine)
         TVPThrowInternalError;
 
+    // scripts embedded in a scenario ( [iscript] ) come here with the name of
+    // the scenario and their line; those are cached as well. the cache is
+    // shared by all the games, so the name is qualified with the game's path.
+    if(!name.IsEmpty() &&
+       TVPExecuteScriptWithByteCodeCache(TVPScriptEngine, content,
+                                         TVPGetAppPath() + name, name, lineofs,
+                                         context, result, false))
+        return TJS_S_OK;
+
+    TVPScriptEngine->ExecScript(content, result, context, &name, lineofs);
+
     return TJS_S_OK;
 }
 TJS_END_NATIVE_STATIC_METHOD_DECL(/*func. name*/ exec)
@@ -27,6 +27,9 @@ extern void TVPUninitScriptEngine();
 
 extern void TVPRestartScriptEngine();
 
+// writes the samples of the script profiler to the storage
+extern void TVPWriteScriptProfile(const ttstr &path);
+
 extern tTJS *TVPGetScriptEngine();
 
 TJS_EXP_FUNC_DEF(iTJSDispatch2 *, TVPGetScriptDispatch, ());
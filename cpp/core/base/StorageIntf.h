@@ -284,6 +284,7 @@ TJS_EXP_FUNC_DEF(void, TVPClearStorageCaches, ());
 void TVPRemoveFromStorageCache(const ttstr &name);
 
 extern tjs_uint TVPSegmentCacheLimit; // XP3 segment cache limit, in bytes.
+extern tjs_int TVPSegmentPrefetchCount; // XP3 segments to decompress ahead
 
 //---------------------------------------------------------------------------
 
@@ -379,6 +380,12 @@ public:
     }
 
     virtual tjs_uint64 GetSize() { return DataLength; }
+
+    virtual const void *BorrowBuffer(tjs_uint size) {
+        if(size > DataLength - CurrentPos)
+            return nullptr;
+        return _instr->BorrowBuffer(size);
+    }
 };
 
 #endif
@@ -22,6 +22,7 @@
 #include "Random.h"
 #include "ScriptMgnIntf.h"
 #include "DebugIntf.h"
+#include "tjsDebug.h"
 #include "ConfigManager/LocaleConfigManager.h"
 #include "Platform.h"
 
@@ -317,6 +318,32 @@ tTJSNC_System::tTJSNC_System() : inherited(TJS_W("System")) {
     }
     TJS_END_NATIVE_STATIC_METHOD_DECL(/*func. name*/ doCompact)
     //----------------------------------------------------------------------
+    TJS_BEGIN_NATIVE_METHOD_DECL(/*func. name*/ startProfile) {
+        // start sampling profiler of the scripts
+
+        tjs_int interval = 1000; // in microseconds
+
+        if(numparams >= 1 && param[0]->Type() != tvtVoid)
+            interval = (tjs_int)*param[0];
+
+        TJSStartProfiler(interval);
+
+        return TJS_S_OK;
+    }
+    TJS_END_NATIVE_STATIC_METHOD_DECL(/*func. name*/ startProfile)
+    //----------------------------------------------------------------------
+    TJS_BEGIN_NATIVE_METHOD_DECL(/*func. name*/ stopProfile) {
+        // stop the profiler and write the samples to the storage, if given
+
+        TJSStopProfiler();
+
+        if(numparams >= 1 && param[0]->Type() != tvtVoid)
+            TVPWriteScriptProfile(*param[0]);
+
+        return TJS_S_OK;
+    }
+    TJS_END_NATIVE_STATIC_METHOD_DECL(/*func. name*/ stopProfile)
+    //----------------------------------------------------------------------
 
     //--properties
 
@@ -152,6 +152,13 @@ tjs_uint tTVPMemoryStream::Read(void *buffer, tjs_uint read_size) {
     return read_size;
 }
 
+//---------------------------------------------------------------------------
+const void *tTVPMemoryStream::BorrowBuffer(tjs_uint size) {
+    if(size > Size - CurrentPos)
+        return nullptr;
+    return (tjs_uint8 *)Block + CurrentPos;
+}
+
 //---------------------------------------------------------------------------
 tjs_uint tTVPMemoryStream::Write(const void *buffer, tjs_uint write_size) {
     // writing may increase the internal buffer size.
@@ -337,6 +344,13 @@ tjs_uint tTVPPartialStream::Write(const void *buffer, tjs_uint write_size) {
 
 //---------------------------------------------------------------------------
 tjs_uint64 tTVPPartialStream::GetSize() { return Size; }
+
+//---------------------------------------------------------------------------
+const void *tTVPPartialStream::BorrowBuffer(tjs_uint size) {
+    if(size > Size - CurrentPos)
+        return nullptr;
+    return Stream->BorrowBuffer(size);
+}
 //---------------------------------------------------------------------------
 
 extern "C" {
@@ -103,6 +103,8 @@ public:
 
     tjs_uint64 GetSize() override { return Size; }
 
+    const void *BorrowBuffer(tjs_uint size) override;
+
     // non-tTJSBinaryStream based methods
     void *GetInternalBuffer() const { return Block; }
 
@@ -153,6 +155,8 @@ public:
     // void SetEndOfStorage(); // use default behavior
 
     tjs_uint64 GetSize() override;
+
+    const void *BorrowBuffer(tjs_uint size) override;
 };
 
 //---------------------------------------------------------------------------
@@ -17,9 +17,13 @@
 #include "EventIntf.h"
 #include "UtilStreams.h"
 #include "SysInitIntf.h"
+#include "ThreadIntf.h"
 
 #include <zlib.h>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 
 bool TVPAllowExtractProtectedStorage = true;
 
@@ -97,10 +101,11 @@ tTJSBinaryStream *TVPGetCachedArchiveHandle(void *pointer, const ttstr &name) {
 /*static*/ void TVPReleaseCachedArchiveHandle(void *pointer,
                                               tTJSBinaryStream *stream) {
     // release archive file handle
-    if(TVPArchiveHandleCacheShutdown)
-        return;
-    if(!TVPArchiveHandleCacheInit)
+    if(TVPArchiveHandleCacheShutdown || !TVPArchiveHandleCacheInit) {
+        // no pool to keep it in
+        delete stream;
         return;
+    }
 
     tTJSCriticalSectionHolder cs_holder(TVPArchiveHandleCacheCS);
 
@@ -636,8 +641,17 @@ tjs_int64 tTVPXP3Archive::ReadI64FromMem(const tjs_uint8 *mem) {
 // Compressed segment cache related
 //---------------------------------------------------------------------------
 #define TVP_SEGCACHE_ONE_LIMIT (1024 * 1024) // max size limit for each segment
-#define TVP_SEGCACHE_TOTAL_LIMIT (1024 * 1024) // total segment cache size
+#define TVP_SEGCACHE_SHARD_COUNT 16 // must be a power of 2
+#define TVP_SEGCACHE_BUCKET_COUNT 64 // per shard; must be a power of 2
+// total segment cache size; each shard can hold a segment of the largest
+// cacheable size
+#define TVP_SEGCACHE_TOTAL_LIMIT                                               \
+    (TVP_SEGCACHE_ONE_LIMIT * TVP_SEGCACHE_SHARD_COUNT)
+// segments prefetched and not read yet; these are kept out of the budget
+// above, so that prefetching does not evict what it has just prefetched
+#define TVP_SEGCACHE_PREFETCH_LIMIT (8 * 1024 * 1024)
 tjs_uint TVPSegmentCacheLimit = TVP_SEGCACHE_TOTAL_LIMIT;
+tjs_int TVPSegmentPrefetchCount = 1;
 
 //---------------------------------------------------------------------------
 struct tTVPSegmentCacheSearchData {
@@ -665,93 +679,306 @@ public:
 
 //---------------------------------------------------------------------------
 class tTVPSegmentData {
-    tjs_int RefCount;
+    // the data is either ready, or holds the compressed data which is
+    // waiting for (or under) decompression on a pool thread.
+    enum tState { sdReady, sdPending, sdDecompressing, sdFailed };
+
+    std::atomic<tjs_int> RefCount;
     tjs_uint Size;
     tjs_uint8 *Data;
+    tjs_uint8 *InData; // compressed data, while pending
+    tjs_uint InSize;
+    std::atomic<tjs_int> State;
+    std::mutex Mutex;
+    std::condition_variable Done;
 
 public:
-    tTVPSegmentData() {
-        RefCount = 1;
-        Size = 0;
-        Data = nullptr;
-    }
+    tTVPSegmentData() :
+        RefCount(1), Size(0), Data(nullptr), InData(nullptr), InSize(0),
+        State(sdReady) {}
 
     ~tTVPSegmentData() {
         if(Data)
             delete[] Data;
+        if(InData)
+            delete[] InData;
     }
 
     void SetData(unsigned long outsize, tTJSBinaryStream *instream,
                  unsigned long insize) {
-        // uncompress data
-        tjs_uint8 *indata = new tjs_uint8[insize];
+        // read and uncompress data. if the stream can lend its buffer
+        // (eg. a memory mapped file), uncompress from it directly.
+        const void *indata = instream->BorrowBuffer((tjs_uint)insize);
+        if(!indata) {
+            SetCompressedData(outsize, instream, insize);
+            EnsureData();
+            return;
+        }
+        Size = outsize;
+        if(!Uncompress((const tjs_uint8 *)indata, insize))
+            TVPThrowExceptionMessage(TVPUncompressionFailed);
+        instream->Seek(insize, TJS_BS_SEEK_CUR);
+    }
+
+    void SetCompressedData(unsigned long outsize, tTJSBinaryStream *instream,
+                           unsigned long insize) {
+        // read compressed data; uncompressed later by Decompress()
+        InData = new tjs_uint8[insize];
+        InSize = insize;
         try {
-            instream->Read(indata, insize);
-
-            Data = new tjs_uint8[outsize];
-            unsigned long destlen = outsize;
-            int result = uncompress((unsigned char *)Data, &outsize,
-                                    (unsigned char *)indata, insize);
-            if(result != Z_OK || destlen != outsize)
-                TVPThrowExceptionMessage(TVPUncompressionFailed);
-            Size = outsize;
+            instream->Read(InData, insize);
         } catch(...) {
-            delete[] indata;
+            delete[] InData;
+            InData = nullptr;
             throw;
         }
-        delete[] indata;
+        Size = outsize;
+        State = sdPending;
+    }
+
+    bool Decompress() {
+        // uncompress pending data. returns false if the data is not
+        // pending (already done, or under decompression by another
+        // thread)
+        tjs_int expected = sdPending;
+        if(!State.compare_exchange_strong(expected, sdDecompressing))
+            return false;
+
+        tjs_int result = sdFailed;
+        try {
+            if(Uncompress(InData, InSize))
+                result = sdReady;
+        } catch(...) {
+        }
+        delete[] InData;
+        InData = nullptr;
+
+        {
+            std::lock_guard<std::mutex> lock(Mutex);
+            State = result;
+        }
+        Done.notify_all();
+        return true;
+    }
+
+    void EnsureData() {
+        // make the data ready to use; decompresses on this thread unless
+        // a pool thread already has started it
+        if(State == sdReady)
+            return;
+        if(!Decompress()) {
+            std::unique_lock<std::mutex> lock(Mutex);
+            Done.wait(lock, [this] {
+                return State == sdReady || State == sdFailed;
+            });
+        }
+        if(State == sdFailed)
+            TVPThrowExceptionMessage(TVPUncompressionFailed);
     }
 
     const tjs_uint8 *GetData() const { return Data; }
 
     tjs_uint GetSize() const { return Size; }
 
+private:
+    bool Uncompress(const tjs_uint8 *indata, unsigned long insize) {
+        Data = new tjs_uint8[Size];
+        unsigned long destlen = Size;
+        return uncompress((unsigned char *)Data, &destlen,
+                          (const unsigned char *)indata, insize) == Z_OK &&
+            destlen == Size;
+    }
+
+public:
+
     void AddRef() { RefCount++; }
 
     void Release() {
-        if(RefCount == 1) {
+        if(--RefCount == 0)
             delete this;
-        } else {
-            RefCount--;
-        }
     }
 };
 
 //---------------------------------------------------------------------------
-typedef tTJSRefHolder<tTVPSegmentData> tTVPSegmentDataHolder;
+// the cache is split into shards by hash, each with its own byte budget
+// (TVPSegmentCacheLimit / TVP_SEGCACHE_SHARD_COUNT) and LRU list.
+// cache hits take no lock: the entries are linked in the buckets of the
+// shard with atomic pointers, and readers count themselves in the shard
+// while they walk the buckets. entries unlinked by the writers (which hold
+// the shard's mutex) are freed only when no reader is walking. a hit marks
+// the entry as referenced instead of reordering the LRU list; eviction
+// gives referenced entries a second chance.
+// prefetched entries are not evicted until they are read (or the stream
+// which prefetched them is closed), and are counted in
+// TVPSegmentPrefetchBytes instead of the budget of the shard.
+struct tTVPSegmentCacheEntry {
+    tTVPSegmentCacheSearchData Key;
+    tjs_uint32 Hash;
+    tTVPSegmentData *Data; // add-refed
+    std::atomic<tTVPSegmentCacheEntry *> Next{ nullptr }; // in the bucket
+    std::atomic<bool> Referenced{ false }; // hit since the last eviction
+    std::atomic<bool> Prefetched{ false }; // changed under the shard mutex
+    // LRU list; guarded by the shard mutex
+    tTVPSegmentCacheEntry *Newer = nullptr;
+    tTVPSegmentCacheEntry *Older = nullptr;
+};
+
+struct tTVPSegmentCacheShard {
+    std::atomic<tTVPSegmentCacheEntry *> Buckets[TVP_SEGCACHE_BUCKET_COUNT] =
+        {};
+    std::atomic<tjs_int> Readers{ 0 }; // threads walking the buckets
+
+    // the rest is guarded by Mutex
+    std::mutex Mutex;
+    tTVPSegmentCacheEntry *Newest = nullptr;
+    tTVPSegmentCacheEntry *Oldest = nullptr;
+    tjs_int Count = 0;
+    tjs_uint Bytes = 0; // of the entries which are not prefetched
+    std::vector<tTVPSegmentCacheEntry *> Retired; // unlinked, not freed yet
+};
+static tTVPSegmentCacheShard TVPSegmentCacheShards[TVP_SEGCACHE_SHARD_COUNT];
+static std::atomic<tjs_uint> TVPSegmentPrefetchBytes{ 0 };
+
+//---------------------------------------------------------------------------
+static tTVPSegmentCacheShard &TVPGetSegmentCacheShard(tjs_uint32 hash) {
+    return TVPSegmentCacheShards[(hash ^ (hash >> 16)) &
+                                 (TVP_SEGCACHE_SHARD_COUNT - 1)];
+}
+
+static std::atomic<tTVPSegmentCacheEntry *> &
+TVPGetSegmentCacheBucket(tTVPSegmentCacheShard &shard, tjs_uint32 hash) {
+    return shard.Buckets[((hash ^ (hash >> 16)) / TVP_SEGCACHE_SHARD_COUNT) &
+                         (TVP_SEGCACHE_BUCKET_COUNT - 1)];
+}
+
+static tjs_uint TVPGetSegmentCacheShardLimit() {
+    return TVPSegmentCacheLimit / TVP_SEGCACHE_SHARD_COUNT;
+}
+
+//---------------------------------------------------------------------------
+// keeps the entries of a shard alive while the buckets are walked
+class tTVPSegmentCacheReader {
+    tTVPSegmentCacheShard &Shard;
 
-typedef tTJSHashTable<tTVPSegmentCacheSearchData, tTVPSegmentDataHolder,
-                      tTVPSegmentCacheSearchHashFunc>
-    tTVPSegmentCache;
-static tTVPSegmentCache TVPSegmentCache;
-static tjs_uint TVPSegmentCacheTotalBytes = 0;
+public:
+    tTVPSegmentCacheReader(tTVPSegmentCacheShard &shard) : Shard(shard) {
+        Shard.Readers++;
+    }
+    ~tTVPSegmentCacheReader() { Shard.Readers--; }
+};
 
-static tTJSCriticalSection TVPSegmentCacheCS;
+//---------------------------------------------------------------------------
+static tTVPSegmentCacheEntry *
+TVPFindSegmentCacheEntry(tTVPSegmentCacheShard &shard,
+                         const tTVPSegmentCacheSearchData &sdata,
+                         tjs_uint32 hash) {
+    // the caller must be a reader of the shard, or hold its mutex
+    tTVPSegmentCacheEntry *entry = TVPGetSegmentCacheBucket(shard, hash);
+    for(; entry; entry = entry->Next)
+        if(entry->Hash == hash && entry->Key == sdata)
+            return entry;
+    return nullptr;
+}
 
 //---------------------------------------------------------------------------
-static void TVPCheckSegmentCacheLimit() {
-    tTJSCriticalSectionHolder cs_holder(TVPSegmentCacheCS);
+static void TVPReclaimSegmentCache(tTVPSegmentCacheShard &shard) {
+    // shard.Mutex must be locked. the retired entries are unlinked from
+    // the buckets, so readers coming from now on can not find them; if no
+    // reader is walking, nobody is left who could have.
+    if(shard.Retired.empty() || shard.Readers != 0)
+        return;
+    for(tTVPSegmentCacheEntry *entry : shard.Retired) {
+        entry->Data->Release();
+        delete entry;
+    }
+    shard.Retired.clear();
+}
 
-    while(TVPSegmentCacheTotalBytes > TVPSegmentCacheLimit) {
-        // chop last segment
-        tTVPSegmentCache::tIterator i;
-        i = TVPSegmentCache.GetLast();
-        if(!i.IsNull()) {
-            tjs_uint size = i.GetValue().GetObjectNoAddRef()->GetSize();
-            TVPSegmentCacheTotalBytes -= size;
-            TVPSegmentCache.ChopLast(1);
+//---------------------------------------------------------------------------
+static void TVPRemoveFromSegmentCache(tTVPSegmentCacheShard &shard,
+                                      tTVPSegmentCacheEntry *entry) {
+    // shard.Mutex must be locked
+    std::atomic<tTVPSegmentCacheEntry *> *link =
+        &TVPGetSegmentCacheBucket(shard, entry->Hash);
+    while(*link != entry)
+        link = &(*link).load()->Next;
+    *link = entry->Next.load(); // readers on the entry can still go on
+
+    (entry->Newer ? entry->Newer->Older : shard.Newest) = entry->Older;
+    (entry->Older ? entry->Older->Newer : shard.Oldest) = entry->Newer;
+    shard.Count--;
+
+    if(entry->Prefetched) {
+        entry->Prefetched = false;
+        TVPSegmentPrefetchBytes -= entry->Data->GetSize();
+    } else {
+        shard.Bytes -= entry->Data->GetSize();
+    }
+    shard.Retired.push_back(entry);
+}
+
+//---------------------------------------------------------------------------
+static void TVPMoveToNewestSegment(tTVPSegmentCacheShard &shard,
+                                   tTVPSegmentCacheEntry *entry) {
+    // shard.Mutex must be locked
+    if(shard.Newest == entry)
+        return;
+    entry->Newer->Older = entry->Older;
+    (entry->Older ? entry->Older->Newer : shard.Oldest) = entry->Newer;
+    entry->Older = shard.Newest;
+    entry->Newer = nullptr;
+    shard.Newest->Newer = entry;
+    shard.Newest = entry;
+}
+
+//---------------------------------------------------------------------------
+static void TVPEvictSegmentCache(tTVPSegmentCacheShard &shard,
+                                 const tTVPSegmentCacheEntry *keep) {
+    // shard.Mutex must be locked. referenced entries are moved to the
+    // newest end once; they are met again at the end of the walk.
+    tjs_uint limit = TVPGetSegmentCacheShardLimit();
+    tTVPSegmentCacheEntry *entry = shard.Oldest;
+    for(tjs_int n = shard.Count * 2; entry && n > 0 && shard.Bytes > limit;
+        n--) {
+        tTVPSegmentCacheEntry *newer = entry->Newer;
+        if(entry == keep || entry->Prefetched) {
+            // not counted in the budget, or just added
+        } else if(entry->Referenced) {
+            entry->Referenced = false;
+            TVPMoveToNewestSegment(shard, entry);
+            if(!newer)
+                newer = entry; // it was the newest; meet it again
         } else {
-            break;
+            TVPRemoveFromSegmentCache(shard, entry);
         }
+        entry = newer;
     }
+    TVPReclaimSegmentCache(shard);
 }
 
 //---------------------------------------------------------------------------
-void TVPClearXP3SegmentCache() {
-    tTJSCriticalSectionHolder cs_holder(TVPSegmentCacheCS);
+static void TVPAdoptPrefetchedSegment(tTVPSegmentCacheShard &shard,
+                                      tTVPSegmentCacheEntry *entry) {
+    // the prefetched entry is read (or not to be read any more); count it
+    // in the budget of the shard from now on. the caller must be a reader
+    // of the shard.
+    std::lock_guard<std::mutex> lock(shard.Mutex);
+    if(!entry->Prefetched)
+        return; // adopted by another thread, or removed
+    entry->Prefetched = false;
+    TVPSegmentPrefetchBytes -= entry->Data->GetSize();
+    shard.Bytes += entry->Data->GetSize();
+    TVPEvictSegmentCache(shard, entry);
+}
 
-    TVPSegmentCache.Clear();
-    TVPSegmentCacheTotalBytes = 0;
+//---------------------------------------------------------------------------
+void TVPClearXP3SegmentCache() {
+    for(tTVPSegmentCacheShard &shard : TVPSegmentCacheShards) {
+        std::lock_guard<std::mutex> lock(shard.Mutex);
+        while(shard.Newest)
+            TVPRemoveFromSegmentCache(shard, shard.Newest);
+        TVPReclaimSegmentCache(shard);
+    }
 }
 
 //---------------------------------------------------------------------------
@@ -772,33 +999,96 @@ static bool TVPClearSegmentCacheCallbackInit = false;
 static tTVPSegmentData *
 TVPSearchFromSegmentCache(const tTVPSegmentCacheSearchData &sdata,
                           tjs_uint32 hash) {
-    tTJSCriticalSectionHolder cs_holder(TVPSegmentCacheCS);
+    tTVPSegmentCacheShard &shard = TVPGetSegmentCacheShard(hash);
+    tTVPSegmentCacheReader reader(shard);
+
+    tTVPSegmentCacheEntry *entry =
+        TVPFindSegmentCacheEntry(shard, sdata, hash);
+    if(!entry)
+        return nullptr; // not found in cache
+
+    // found in cache
+    tTVPSegmentData *data = entry->Data;
+    data->AddRef();
+    if(!entry->Referenced.load(std::memory_order_relaxed))
+        entry->Referenced = true;
+    if(entry->Prefetched)
+        TVPAdoptPrefetchedSegment(shard, entry);
+    return data;
+}
 
-    tTVPSegmentDataHolder *ptr =
-        TVPSegmentCache.FindAndTouchWithHash(sdata, hash);
-    if(ptr) {
-        // found in cache
-        return ptr->GetObject(); // add-refed
-    }
+//---------------------------------------------------------------------------
+static bool TVPIsInSegmentCache(const tTVPSegmentCacheSearchData &sdata,
+                                tjs_uint32 hash) {
+    tTVPSegmentCacheShard &shard = TVPGetSegmentCacheShard(hash);
+    tTVPSegmentCacheReader reader(shard);
+    return TVPFindSegmentCacheEntry(shard, sdata, hash) != nullptr;
+}
 
-    return nullptr; // not found in cache
+//---------------------------------------------------------------------------
+static void TVPReleasePrefetchedSegment(const tTVPSegmentCacheSearchData &sdata,
+                                        tjs_uint32 hash) {
+    // the segment is not going to be read by the stream which prefetched
+    // it; let it be evicted like the others
+    tTVPSegmentCacheShard &shard = TVPGetSegmentCacheShard(hash);
+    tTVPSegmentCacheReader reader(shard);
+    tTVPSegmentCacheEntry *entry =
+        TVPFindSegmentCacheEntry(shard, sdata, hash);
+    if(entry && entry->Prefetched)
+        TVPAdoptPrefetchedSegment(shard, entry);
 }
 
 //---------------------------------------------------------------------------
-static void TVPPushToSegmentCache(const tTVPSegmentCacheSearchData &sdata,
-                                  tjs_uint32 hash, tTVPSegmentData *data) {
+static bool TVPPushToSegmentCache(const tTVPSegmentCacheSearchData &sdata,
+                                  tjs_uint32 hash, tTVPSegmentData *data,
+                                  bool prefetched = false) {
+    // returns whether the data is added to the cache
     if(!TVPClearSegmentCacheCallbackInit) {
         TVPAddCompactEventHook(&TVPClearSegmentCacheCallback);
         TVPClearSegmentCacheCallbackInit = true;
     }
 
-    tTJSCriticalSectionHolder cs_holder(TVPSegmentCacheCS);
+    tjs_uint size = data->GetSize();
+    if(size > TVPGetSegmentCacheShardLimit())
+        return false; // would be evicted at once
+
+    tTVPSegmentCacheShard &shard = TVPGetSegmentCacheShard(hash);
+    std::lock_guard<std::mutex> lock(shard.Mutex);
 
-    tTVPSegmentDataHolder holder(data);
-    TVPSegmentCache.AddWithHash(sdata, hash, holder);
-    TVPSegmentCacheTotalBytes += data->GetSize();
+    if(TVPFindSegmentCacheEntry(shard, sdata, hash))
+        return false; // another thread has pushed the same segment
 
-    TVPCheckSegmentCacheLimit();
+    if(prefetched) {
+        if(TVPSegmentPrefetchBytes.fetch_add(size) + size >
+           TVP_SEGCACHE_PREFETCH_LIMIT) {
+            // too many segments are prefetched and not read yet
+            TVPSegmentPrefetchBytes -= size;
+            return false;
+        }
+    } else {
+        shard.Bytes += size;
+    }
+
+    tTVPSegmentCacheEntry *entry = new tTVPSegmentCacheEntry;
+    entry->Key = sdata;
+    entry->Hash = hash;
+    entry->Data = data;
+    data->AddRef();
+    entry->Prefetched = prefetched;
+
+    entry->Older = shard.Newest;
+    (shard.Newest ? shard.Newest->Newer : shard.Oldest) = entry;
+    shard.Newest = entry;
+    shard.Count++;
+
+    // publish to the readers
+    std::atomic<tTVPSegmentCacheEntry *> &bucket =
+        TVPGetSegmentCacheBucket(shard, hash);
+    entry->Next = bucket.load();
+    bucket = entry;
+
+    TVPEvictSegmentCache(shard, entry);
+    return true;
 }
 //---------------------------------------------------------------------------
 
@@ -820,6 +1110,7 @@ tTVPXP3ArchiveStream::tTVPXP3ArchiveStream(
     CurPos = 0;
 
     LastOpenedSegmentNum = -1;
+    PrefetchEnd = 0;
 
     Owner = owner;
     Owner->AddRef(); // hook
@@ -829,6 +1120,16 @@ tTVPXP3ArchiveStream::tTVPXP3ArchiveStream(
 
 //---------------------------------------------------------------------------
 tTVPXP3ArchiveStream::~tTVPXP3ArchiveStream() {
+    // the segments prefetched and not read can be evicted now
+    for(tjs_int i = 0; i < PrefetchEnd; i++) {
+        tTVPSegmentCacheSearchData sdata;
+        sdata.Name = Owner->GetName();
+        sdata.StorageIndex = StorageIndex;
+        sdata.SegmentIndex = i;
+        TVPReleasePrefetchedSegment(
+            sdata, tTVPSegmentCacheSearchHashFunc::Make(sdata));
+    }
+
     TVPReleaseCachedArchiveHandle(Owner, Stream);
     Owner->Release(); // unhook
     if(SegmentData)
@@ -872,7 +1173,10 @@ void tTVPXP3ArchiveStream::EnsureSegment() {
             hash = tTVPSegmentCacheSearchHashFunc::Make(sdata);
 
             SegmentData = TVPSearchFromSegmentCache(sdata, hash);
-            if(!SegmentData) {
+            if(SegmentData) {
+                // found in cache; may be still under prefetching
+                SegmentData->EnsureData();
+            } else {
                 // not found in cache
                 Stream->SetPosition(CurSegment->Start);
                 SegmentData = new tTVPSegmentData;
@@ -893,6 +1197,60 @@ void tTVPXP3ArchiveStream::EnsureSegment() {
     LastOpenedSegmentNum = CurSegmentNum;
 }
 
+//---------------------------------------------------------------------------
+void tTVPXP3ArchiveStream::Prefetch(tjs_int count) {
+    // start decompressing the compressed segments which follow the
+    // current segment on the thread pool. the compressed data is read
+    // here, so this does not touch the archive from other threads.
+    if(!TVPSegmentCacheLimit || TVPGetThreadNum() == 1)
+        return;
+
+    tjs_int last = std::min(CurSegmentNum + count,
+                            (tjs_int)Segments->size() - 1);
+    bool moved = false;
+    for(tjs_int i = CurSegmentNum + 1; i <= last; i++) {
+        const tTVPXP3ArchiveSegment &segment = Segments->operator[](i);
+        if(!segment.IsCompressed || segment.OrgSize >= TVP_SEGCACHE_ONE_LIMIT)
+            continue;
+
+        tTVPSegmentCacheSearchData sdata;
+        sdata.Name = Owner->GetName();
+        sdata.StorageIndex = StorageIndex;
+        sdata.SegmentIndex = i;
+        tjs_uint32 hash = tTVPSegmentCacheSearchHashFunc::Make(sdata);
+
+        if(TVPIsInSegmentCache(sdata, hash))
+            continue; // already cached
+
+        tTVPSegmentData *data = new tTVPSegmentData;
+        try {
+            moved = true;
+            Stream->SetPosition(segment.Start);
+            data->SetCompressedData((tjs_uint)segment.OrgSize, Stream,
+                                    (tjs_uint)segment.ArcSize);
+        } catch(...) {
+            data->Release();
+            throw;
+        }
+        if(!TVPPushToSegmentCache(sdata, hash, data, true)) {
+            // the prefetch window is full
+            data->Release();
+            break;
+        }
+        PrefetchEnd = std::max(PrefetchEnd, i + 1);
+        // does nothing if the reader has already taken it over
+        if(!TVPPostThreadTask([data] {
+               data->Decompress();
+               data->Release();
+           }))
+            data->Release(); // the reader decompresses it
+    }
+
+    // restore the position for reading uncompressed segment directly
+    if(moved && SegmentOpened && !CurSegment->IsCompressed)
+        Stream->SetPosition(CurSegment->Start + SegmentPos);
+}
+
 //---------------------------------------------------------------------------
 void tTVPXP3ArchiveStream::SeekToPosition(tjs_uint64 pos) {
     // open segment at 'pos' and seek
@@ -938,6 +1296,9 @@ bool tTVPXP3ArchiveStream::OpenNextSegment() {
     SegmentRemain = CurSegment->OrgSize;
     CurPos = CurSegment->Offset;
     EnsureSegment();
+    // sequential reading; prepare the following segments
+    if(TVPSegmentPrefetchCount)
+        Prefetch(TVPSegmentPrefetchCount);
     return true;
 }
 
@@ -1014,6 +1375,22 @@ tjs_uint tTVPXP3ArchiveStream::Read(void *buffer, tjs_uint read_size) {
     return write_size;
 }
 
+//---------------------------------------------------------------------------
+const void *tTVPXP3ArchiveStream::BorrowBuffer(tjs_uint size) {
+    // the extraction filter rewrites the data being read; such data can
+    // not be lent
+    if(TVPXP3ArchiveExtractionFilter)
+        return nullptr;
+
+    EnsureSegment();
+    if(size > SegmentRemain)
+        return nullptr; // spans over segments
+
+    if(CurSegment->IsCompressed)
+        return SegmentData->GetData() + (tjs_uint)SegmentPos;
+    return Stream->BorrowBuffer(size);
+}
+
 //---------------------------------------------------------------------------
 tjs_uint tTVPXP3ArchiveStream::Write(const void *buffer, tjs_uint write_size) {
     return 0;
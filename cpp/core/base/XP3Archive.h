@@ -171,6 +171,7 @@ class tTVPXP3ArchiveStream : public tTJSBinaryStream {
     // currently opened segment ( nullptr for not opened )
 
     tjs_int LastOpenedSegmentNum;
+    tjs_int PrefetchEnd; // segments below may have been prefetched
 
     tjs_uint64 CurPos; // current position in absolute file position
 
@@ -197,6 +198,9 @@ private:
     bool OpenNextSegment();
 
 public:
+    // decompress the next "count" segments on the thread pool
+    void Prefetch(tjs_int count);
+
     tjs_uint64 Seek(tjs_int64 offset, tjs_int whence);
 
     tjs_uint Read(void *buffer, tjs_uint read_size);
@@ -204,6 +208,8 @@ public:
     tjs_uint Write(const void *buffer, tjs_uint write_size);
 
     tjs_uint64 GetSize();
+
+    const void *BorrowBuffer(tjs_uint size);
 };
 //---------------------------------------------------------------------------
 
@@ -334,8 +334,7 @@ bool TVPSelectFile(iTJSDispatch2 *params) {
     // default extension
     if(TJS_SUCCEEDED(params->PropGet(TJS_MEMBERMUSTEXIST, TJS_W("defaultExt"),
                                      0, &val, params))) {
-        defaultext = tTJSNarrowStringHolder(
-            val.AsStringNoAddRef()->operator const tjs_char *());
+        defaultext = ttstr(val).AsStdString();
     }
 
     // filenames
@@ -365,8 +364,7 @@ bool TVPSelectFile(iTJSDispatch2 *params) {
     // title
     if(TJS_SUCCEEDED(params->PropGet(TJS_MEMBERMUSTEXIST, TJS_W("title"), 0,
                                      &val, params))) {
-        title = tTJSNarrowStringHolder(
-            val.AsStringNoAddRef()->operator const tjs_char *());
+        title = ttstr(val).AsStdString();
     }
 
     // flags
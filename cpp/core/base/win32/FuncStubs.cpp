@@ -972,7 +972,8 @@ static tjs_uint32 *__stdcall TVP_Stub_070ed05259a265cabdd82bfedabdd638(
 
 static const tjs_char *__stdcall TVP_Stub_008b7e3a4c5bb23ee991f684a5064737(
     tTJSVariantString *_this) {
-    return _this->operator const tjs_char *();
+    // plugins may pass nullptr, which is an empty string
+    return _this ? _this->operator const tjs_char *() : nullptr;
 }
 
 static tjs_int __stdcall TVP_Stub_b64741dc4544ed43c44ddb6d0eb838ea(
@@ -14,6 +14,9 @@
 #include <fcntl.h>
 #include <filesystem>
 #include <sys/stat.h> 
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 
 #include "MsgIntf.h"
 
@@ -709,11 +712,35 @@ tTVPLocalFileStream::tTVPLocalFileStream(const ttstr &origname,
             TVPThrowExceptionMessage(TVPCannotOpenStorage, origname);
     }
 #endif
+    if(access == TJS_BS_READ)
+        MapFile();
+
     // push current tick as an environment noise
     uint32_t tick = TVPGetRoughTickCount32();
     TVPPushEnvironNoise(&tick, sizeof(tick));
 }
 
+//---------------------------------------------------------------------------
+// files smaller than this are cheaper to read() than to map
+static const tjs_uint64 TVPLocalFileMapThreshold = 64 * 1024;
+
+void tTVPLocalFileStream::MapFile() {
+#ifndef _WIN32
+    struct stat st;
+    if(fstat(Handle, &st) != 0 || !S_ISREG(st.st_mode))
+        return;
+    tjs_uint64 size = st.st_size;
+    if(size < TVPLocalFileMapThreshold || size != (tjs_uint64)(size_t)size)
+        return;
+    void *p = mmap(nullptr, (size_t)size, PROT_READ, MAP_SHARED, Handle, 0);
+    if(p == MAP_FAILED)
+        return; // fall back to read()
+    MappedData = (tjs_uint8 *)p;
+    MappedSize = size;
+    MappedPos = 0;
+#endif
+}
+
 //---------------------------------------------------------------------------
 bool TVPWriteDataToFile(const ttstr &filepath, const void *data,
                         unsigned int len);
@@ -730,6 +757,11 @@ tTVPLocalFileStream::~tTVPLocalFileStream() {
         }
         delete MemBuffer;
     }
+#ifndef _WIN32
+    if(MappedData) {
+        munmap(MappedData, (size_t)MappedSize);
+    }
+#endif
     if(Handle >= 0) {
         close(Handle);
     }
@@ -745,6 +777,27 @@ tjs_uint64 tTVPLocalFileStream::Seek(tjs_int64 offset, tjs_int whence) {
     if(MemBuffer) {
         return MemBuffer->Seek(offset, whence);
     }
+    if(MappedData) {
+        tjs_int64 newpos;
+        switch(whence) {
+            case TJS_BS_SEEK_SET:
+                newpos = offset;
+                break;
+            case TJS_BS_SEEK_CUR:
+                newpos = (tjs_int64)MappedPos + offset;
+                break;
+            case TJS_BS_SEEK_END:
+                newpos = (tjs_int64)MappedSize + offset;
+                break;
+            default:
+                return MappedPos;
+        }
+        if(newpos < 0)
+            return MappedPos; // seek failed; keep the position
+        // seeking beyond the end is allowed, as lseek does
+        MappedPos = newpos;
+        return MappedPos;
+    }
     return lseek64(Handle, offset, whence);
 }
 
@@ -753,9 +806,30 @@ tjs_uint tTVPLocalFileStream::Read(void *buffer, tjs_uint read_size) {
     if(MemBuffer) {
         return MemBuffer->Read(buffer, read_size);
     }
+    if(MappedData) {
+        if(MappedPos >= MappedSize)
+            return 0;
+        if(read_size > MappedSize - MappedPos)
+            read_size = (tjs_uint)(MappedSize - MappedPos);
+        memcpy(buffer, MappedData + MappedPos, read_size);
+        MappedPos += read_size;
+        return read_size;
+    }
     return read(Handle, buffer, read_size);
 }
 
+//---------------------------------------------------------------------------
+const void *tTVPLocalFileStream::BorrowBuffer(tjs_uint size) {
+    if(MemBuffer) {
+        return MemBuffer->BorrowBuffer(size);
+    }
+    if(MappedData && MappedPos <= MappedSize &&
+       size <= MappedSize - MappedPos) {
+        return MappedData + MappedPos;
+    }
+    return nullptr;
+}
+
 //---------------------------------------------------------------------------
 tjs_uint tTVPLocalFileStream::Write(const void *buffer, tjs_uint write_size) {
     if(MemBuffer) {
@@ -769,6 +843,10 @@ void tTVPLocalFileStream::SetEndOfStorage() {
     if(MemBuffer) {
         return MemBuffer->SetEndOfStorage();
     }
+    if(MappedData) {
+        MappedPos = MappedSize;
+        return;
+    }
     lseek64(Handle, 0, SEEK_END);
 }
 
@@ -777,6 +855,9 @@ tjs_uint64 tTVPLocalFileStream::GetSize() {
     if(MemBuffer) {
         return MemBuffer->GetSize();
     }
+    if(MappedData) {
+        return MappedSize;
+    }
 
     tjs_int64 curpos = lseek64(Handle, 0, SEEK_CUR);
     tjs_uint64 ret = lseek64(Handle, 0, SEEK_END);
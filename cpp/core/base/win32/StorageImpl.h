@@ -41,6 +41,14 @@ class tTVPLocalFileStream : public tTJSBinaryStream {
     tTVPMemoryStream *MemBuffer = nullptr;
     ttstr FileName;
 
+    // read-only files are mapped into memory when possible; reads are
+    // served from the mapping and can be borrowed without copying
+    tjs_uint8 *MappedData = nullptr;
+    tjs_uint64 MappedSize = 0;
+    tjs_uint64 MappedPos = 0;
+
+    void MapFile();
+
 public:
     tTVPLocalFileStream(const ttstr &origname, const ttstr &localname,
                         tjs_uint32 flag);
@@ -57,6 +65,8 @@ public:
 
     tjs_uint64 GetSize() override;
 
+    const void *BorrowBuffer(tjs_uint size) override;
+
     int GetHandle() const { return Handle; }
 };
 //---------------------------------------------------------------------------
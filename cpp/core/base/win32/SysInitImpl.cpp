@@ -316,6 +316,8 @@ void TVPAfterSystemInit() {
                 TVPGraphicSplitOperationType = gsotSimple;
             else if(str == TJS_W("bidi"))
                 TVPGraphicSplitOperationType = gsotBiDirection;
+            else if(str == TJS_W("parallel"))
+                TVPGraphicSplitOperationType = gsotParallel;
         }
     }
 
@@ -351,7 +353,11 @@ void TVPAfterSystemInit() {
 #endif
     TVPGL_SSE2_Init();
 #endif
-    //	TVPGL_ASM_Init();
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) ||               \
+    defined(__x86_64__)
+    // SSE2/AVX2 versions replace the C routines set by TVPInitTVPGL
+    TVPGL_ASM_Init();
+#endif
 
     // timer precision
     uint32_t prectick = 1;
@@ -290,7 +290,10 @@ tTVPApplication::~tTVPApplication() {
     // のデストラクタ内でリストから削除されるはず
     // 	}
     // 	windows_list_.clear();
-    delete image_load_thread_;
+    // pending requests release their bitmaps, which may try to cancel
+    tTVPAsyncImageLoader *loader = image_load_thread_;
+    image_load_thread_ = nullptr;
+    delete loader;
 }
 
 extern void tvpLoadPlugins();
@@ -347,8 +350,8 @@ bool tTVPApplication::StartApplication(ttstr path) {
         // Check digitizer
         CheckDigitizer();
 
-        // start image load thread
-        image_load_thread_->Resume();
+        // start image load threads
+        image_load_thread_->Start();
 
         TVPInitializeStartupScript();
         _project_startup = true;
@@ -819,9 +822,14 @@ void tTVPApplication::ModalFinished() {
 #endif
 void tTVPApplication::LoadImageRequest(class iTJSDispatch2 *owner,
                                        class tTJSNI_Bitmap *bmp,
-                                       const ttstr &name) {
+                                       const ttstr &name, tjs_int priority) {
     if(image_load_thread_) {
-        image_load_thread_->LoadRequest(owner, bmp, name);
+        image_load_thread_->LoadRequest(owner, bmp, name, priority);
+    }
+}
+void tTVPApplication::CancelLoadImageRequest(class iTJSDispatch2 *owner) {
+    if(image_load_thread_) {
+        image_load_thread_->CancelRequest(owner);
     }
 }
 
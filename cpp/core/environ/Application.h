@@ -188,7 +188,11 @@ public:
      * 画像の非同期読込み要求
      */
     void LoadImageRequest(class iTJSDispatch2 *owner, class tTJSNI_Bitmap *bmp,
-                          const ttstr &name);
+                          const ttstr &name, tjs_int priority = 0);
+    /**
+     * owner の非同期読込み要求の取り消し
+     */
+    void CancelLoadImageRequest(class iTJSDispatch2 *owner);
     tTVPAsyncImageLoader *GetAsyncImageLoader() { return image_load_thread_; }
 
     void RegisterActiveEvent(void *host,
@@ -18,6 +18,16 @@
 #include "ThreadIntf.h"
 #include "Exception.h"
 
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) ||               \
+    defined(__x86_64__)
+#define TVP_CPU_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
 /*
         Note: CPU clock measuring routine is in EmergencyExit.cpp,
    reusing hot-key watching thread.
@@ -32,6 +42,86 @@ tjs_uint32 TVPCPUFeatures = 0;
 static bool TVPCPUChecked = false;
 //---------------------------------------------------------------------------
 
+#ifdef TVP_CPU_X86
+//---------------------------------------------------------------------------
+// TVPCheckCPU : x86/x64 feature detection through CPUID
+//---------------------------------------------------------------------------
+static void TVPCPUID(tjs_uint32 leaf, tjs_uint32 subleaf, tjs_uint32 regs[4]) {
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, (int)leaf, (int)subleaf);
+    for(int i = 0; i < 4; i++)
+        regs[i] = (tjs_uint32)r[i];
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static tjs_uint64 TVPGetXCR0() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    tjs_uint32 eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((tjs_uint64)edx << 32) | eax;
+#endif
+}
+
+static void TVPCheckCPU() {
+    tjs_uint32 regs[4];
+    TVPCPUID(0, 0, regs);
+    tjs_uint32 maxleaf = regs[0];
+
+#if defined(_M_X64) || defined(__x86_64__)
+    TVPCPUFeatures |= TVP_CPU_FAMILY_X64;
+#else
+    TVPCPUFeatures |= TVP_CPU_FAMILY_X86;
+#endif
+    if(regs[1] == 0x756e6547) // "Genu"ineIntel
+        TVPCPUFeatures |= TVP_CPU_IS_INTEL;
+    else if(regs[1] == 0x68747541) // "Auth"enticAMD
+        TVPCPUFeatures |= TVP_CPU_IS_AMD;
+
+    if(maxleaf < 1)
+        return;
+    TVPCPUID(1, 0, regs);
+    tjs_uint32 ecx = regs[2], edx = regs[3];
+    if(edx & (1 << 0))
+        TVPCPUFeatures |= TVP_CPU_HAS_FPU;
+    if(edx & (1 << 4))
+        TVPCPUFeatures |= TVP_CPU_HAS_TSC;
+    if(edx & (1 << 15))
+        TVPCPUFeatures |= TVP_CPU_HAS_CMOV;
+    if(edx & (1 << 23))
+        TVPCPUFeatures |= TVP_CPU_HAS_MMX;
+    if(edx & (1 << 25))
+        TVPCPUFeatures |= TVP_CPU_HAS_SSE | TVP_CPU_HAS_EMMX;
+    if(edx & (1 << 26))
+        TVPCPUFeatures |= TVP_CPU_HAS_SSE2;
+    if(ecx & (1 << 0))
+        TVPCPUFeatures |= TVP_CPU_HAS_SSE3;
+    if(ecx & (1 << 9))
+        TVPCPUFeatures |= TVP_CPU_HAS_SSSE3;
+    if(ecx & (1 << 19))
+        TVPCPUFeatures |= TVP_CPU_HAS_SSE41;
+    if(ecx & (1 << 20))
+        TVPCPUFeatures |= TVP_CPU_HAS_SSE42;
+
+    // AVX needs the OS to save the YMM state (OSXSAVE + XCR0 bits 1,2)
+    bool ymm_enabled =
+        (ecx & (1 << 27)) && ((TVPGetXCR0() & 0x6) == 0x6);
+    if(ymm_enabled && (ecx & (1 << 28)))
+        TVPCPUFeatures |= TVP_CPU_HAS_AVX;
+
+    if(maxleaf < 7)
+        return;
+    TVPCPUID(7, 0, regs);
+    if((TVPCPUFeatures & TVP_CPU_HAS_AVX) && (regs[1] & (1 << 5)))
+        TVPCPUFeatures |= TVP_CPU_HAS_AVX2;
+}
+#endif
+//---------------------------------------------------------------------------
+
 //---------------------------------------------------------------------------
 // TVPGetCPUTypeForOne
 //---------------------------------------------------------------------------
@@ -39,7 +129,9 @@ static void TVPGetCPUTypeForOne() {
     try {
         TVPCPUFeatures = 0;
 
-        // TVPCheckCPU(); // in detect_cpu.nas
+#ifdef TVP_CPU_X86
+        TVPCheckCPU();
+#endif
     } catch(... /*EXCEPTION_EXECUTE_HANDLER*/) {
         // exception had been ocured
         throw Exception("CPU check failure.");
@@ -133,7 +225,16 @@ static ttstr TVPDumpCPUInfo(tjs_int cpu_num) {
 //---------------------------------------------------------------------------
 // TVPDetectCPU
 //---------------------------------------------------------------------------
-static void TVPDisableCPU(tjs_uint32 featurebit, const tjs_char *name) {}
+static void TVPDisableCPU(tjs_uint32 featurebit, const tjs_char *name) {
+    tTJSVariant val;
+    if(TVPGetCommandLine(name, &val)) {
+        ttstr str = val;
+        if(str == TJS_W("no"))
+            TVPCPUType &= ~featurebit;
+        else if(str == TJS_W("force"))
+            TVPCPUType |= featurebit;
+    }
+}
 
 void TVPDetectCPU() {
     if(TVPCPUChecked)
@@ -144,13 +245,21 @@ void TVPDetectCPU() {
     // must be iOS
     TVPCPUFeatures |= TVP_CPU_FAMILY_ARM | TVP_CPU_HAS_NEON;
 #endif
+#ifdef TVP_CPU_X86
+    TVPGetCPUTypeForOne();
+#endif
 
     tjs_uint32 features = 0;
     features = (TVPCPUFeatures & TVP_CPU_FEATURE_MASK);
-    TVPCPUType &= ~TVP_CPU_FEATURE_MASK;
+    TVPCPUType = TVPCPUFeatures & ~TVP_CPU_FEATURE_MASK;
     TVPCPUType |= features;
 
     TVPDisableCPU(TVP_CPU_HAS_NEON, TJS_W("-cpuneon"));
+#ifdef TVP_CPU_X86
+    TVPDisableCPU(TVP_CPU_HAS_SSE2, TJS_W("-cpusse2"));
+    TVPDisableCPU(TVP_CPU_HAS_SSSE3, TJS_W("-cpussse3"));
+    TVPDisableCPU(TVP_CPU_HAS_AVX2, TJS_W("-cpuavx2"));
+#endif
 }
 //---------------------------------------------------------------------------
 
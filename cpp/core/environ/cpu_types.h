@@ -21,6 +21,12 @@
 #define TVP_CPU_HAS_SSE2 0x00800000
 #define TVP_CPU_HAS_TSC 0x01000000
 #define TVP_CPU_HAS_NEON 0x02000000
+#define TVP_CPU_HAS_SSE3 0x04000000
+#define TVP_CPU_HAS_SSSE3 0x08000000
+#define TVP_CPU_HAS_SSE41 0x10000000
+#define TVP_CPU_HAS_SSE42 0x20000000
+#define TVP_CPU_HAS_AVX 0x40000000
+#define TVP_CPU_HAS_AVX2 0x80000000
 
 #define TVP_CPU_FEATURE_MASK 0xffff0000
 
@@ -0,0 +1,24 @@
+//---------------------------------------------------------------------------
+/*
+        TVP2 ( T Visual Presenter 2 )  A script authoring tool
+        Copyright (C) 2000 W.Dee <dee@kikyou.info> and contributors
+
+        See details of license at "license.txt"
+*/
+//---------------------------------------------------------------------------
+// AVX2 software mixer
+//---------------------------------------------------------------------------
+// compiled with -mavx2 (/arch:AVX2); call only when TVPCPUType has
+// TVP_CPU_HAS_AVX2
+//---------------------------------------------------------------------------
+#include "wavemixer_ia32_intf.h"
+#include "wavemixer_simd.h"
+
+#if defined(__AVX2__)
+void TVPWaveMixer_AVX2_Init(FAudioMix **func16, FAudioMix **func32) {
+    TVPWaveMixer_SIMD_Setup<tTVPMixAVX2>(func16, func32);
+}
+#else
+// not compiled for AVX2; keep the SSE2 routines
+void TVPWaveMixer_AVX2_Init(FAudioMix **func16, FAudioMix **func32) {}
+#endif
@@ -0,0 +1,28 @@
+//---------------------------------------------------------------------------
+/*
+        TVP2 ( T Visual Presenter 2 )  A script authoring tool
+        Copyright (C) 2000 W.Dee <dee@kikyou.info> and contributors
+
+        See details of license at "license.txt"
+*/
+//---------------------------------------------------------------------------
+// x86/x64 software mixer selection
+//---------------------------------------------------------------------------
+#include "tjsCommHead.h"
+
+#include "DetectCPU.h"
+#include "cpu_types.h"
+#include "wavemixer_ia32_intf.h"
+
+//---------------------------------------------------------------------------
+void TVPWaveMixer_ASM_Init(FAudioMix **func16, FAudioMix **func32) {
+    tjs_uint32 family = TVPCPUType & TVP_CPU_FAMILY_MASK;
+    if(family != TVP_CPU_FAMILY_X86 && family != TVP_CPU_FAMILY_X64)
+        return;
+
+    if(TVPCPUType & TVP_CPU_HAS_SSE2)
+        TVPWaveMixer_SSE2_Init(func16, func32);
+    if(TVPCPUType & TVP_CPU_HAS_AVX2)
+        TVPWaveMixer_AVX2_Init(func16, func32);
+}
+//---------------------------------------------------------------------------
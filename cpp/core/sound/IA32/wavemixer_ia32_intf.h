@@ -0,0 +1,20 @@
+//---------------------------------------------------------------------------
+/*
+        TVP2 ( T Visual Presenter 2 )  A script authoring tool
+        Copyright (C) 2000 W.Dee <dee@kikyou.info> and contributors
+
+        See details of license at "license.txt"
+*/
+//---------------------------------------------------------------------------
+// x86/x64 software mixer interface
+//---------------------------------------------------------------------------
+#ifndef WaveMixerIA32IntfH
+#define WaveMixerIA32IntfH
+
+#include "WaveMixer.h"
+
+// each overwrites the tables with its own routines
+extern void TVPWaveMixer_SSE2_Init(FAudioMix **func16, FAudioMix **func32);
+extern void TVPWaveMixer_AVX2_Init(FAudioMix **func16, FAudioMix **func32);
+
+#endif
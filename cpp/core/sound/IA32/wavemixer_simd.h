@@ -0,0 +1,314 @@
+//---------------------------------------------------------------------------
+/*
+        TVP2 ( T Visual Presenter 2 )  A script authoring tool
+        Copyright (C) 2000 W.Dee <dee@kikyou.info> and contributors
+
+        See details of license at "license.txt"
+*/
+//---------------------------------------------------------------------------
+// SSE2/AVX2 software mixer kernels
+//---------------------------------------------------------------------------
+// Each kernel gives the same result as the C version in WaveMixerFunc.h bit
+// by bit. The soft clipping branches become masks; the per-channel gains are
+// laid out as a repeating pattern of lcm(ch, lanes) / lanes vectors so any
+// channel count up to 7.1 stays in the vector loop. Frames that do not fill a
+// whole pattern are handed to the C version.
+//
+// The translation units including this header are compiled for different
+// instruction sets, so everything here has internal linkage.
+//---------------------------------------------------------------------------
+#ifndef WaveMixerSIMDH
+#define WaveMixerSIMDH
+
+#include <stdint.h>
+#include <SDL2/SDL.h>
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include "WaveMixer.h"
+
+// the C versions are instantiated with internal linkage, so that the linker
+// never picks a copy compiled for AVX2 for the C table in WaveMixer.cpp
+namespace {
+#include "WaveMixerFunc.h"
+} // namespace
+
+namespace {
+
+    //-----------------------------------------------------------------------
+    struct tTVPMixSSE2 {
+        typedef __m128i Vi;
+        typedef __m128 Vf;
+        enum { N16 = 8, NF = 4 };
+
+        static inline Vi loadi(const void *p) {
+            return _mm_loadu_si128((const __m128i *)p);
+        }
+        static inline void storei(void *p, Vi v) {
+            _mm_storeu_si128((__m128i *)p, v);
+        }
+        static inline Vi zeroi() { return _mm_setzero_si128(); }
+        static inline Vi set1_32(int v) { return _mm_set1_epi32(v); }
+        static inline Vi and_(Vi a, Vi b) { return _mm_and_si128(a, b); }
+        static inline Vi or_(Vi a, Vi b) { return _mm_or_si128(a, b); }
+        static inline Vi add16(Vi a, Vi b) { return _mm_add_epi16(a, b); }
+        static inline Vi sub16(Vi a, Vi b) { return _mm_sub_epi16(a, b); }
+        static inline Vi mullo16(Vi a, Vi b) { return _mm_mullo_epi16(a, b); }
+        static inline Vi mulhi16(Vi a, Vi b) { return _mm_mulhi_epi16(a, b); }
+        static inline Vi cmpgt16(Vi a, Vi b) { return _mm_cmpgt_epi16(a, b); }
+        template <int n>
+        static inline Vi srli16(Vi a) {
+            return _mm_srli_epi16(a, n);
+        }
+        template <int n>
+        static inline Vi slli16(Vi a) {
+            return _mm_slli_epi16(a, n);
+        }
+        static inline Vi unpacklo16(Vi a, Vi b) {
+            return _mm_unpacklo_epi16(a, b);
+        }
+        static inline Vi unpackhi16(Vi a, Vi b) {
+            return _mm_unpackhi_epi16(a, b);
+        }
+        static inline Vi add32(Vi a, Vi b) { return _mm_add_epi32(a, b); }
+        template <int n>
+        static inline Vi srai32(Vi a) {
+            return _mm_srai_epi32(a, n);
+        }
+        template <int n>
+        static inline Vi slli32(Vi a) {
+            return _mm_slli_epi32(a, n);
+        }
+        // undoes unpacklo16/unpackhi16 (saturating, so truncate first)
+        static inline Vi packs32(Vi a, Vi b) { return _mm_packs_epi32(a, b); }
+
+        static inline Vf loadf(const void *p) {
+            return _mm_loadu_ps((const float *)p);
+        }
+        static inline void storef(void *p, Vf v) {
+            _mm_storeu_ps((float *)p, v);
+        }
+        static inline Vf zerof() { return _mm_setzero_ps(); }
+        static inline Vf addf(Vf a, Vf b) { return _mm_add_ps(a, b); }
+        static inline Vf subf(Vf a, Vf b) { return _mm_sub_ps(a, b); }
+        static inline Vf mulf(Vf a, Vf b) { return _mm_mul_ps(a, b); }
+        static inline Vf cmpgtf(Vf a, Vf b) { return _mm_cmpgt_ps(a, b); }
+        static inline Vf andf(Vf a, Vf b) { return _mm_and_ps(a, b); }
+        // mask ? a : b
+        static inline Vf selectf(Vf mask, Vf a, Vf b) {
+            return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+        }
+    };
+
+#if defined(__AVX2__)
+    //-----------------------------------------------------------------------
+    struct tTVPMixAVX2 {
+        typedef __m256i Vi;
+        typedef __m256 Vf;
+        enum { N16 = 16, NF = 8 };
+
+        static inline Vi loadi(const void *p) {
+            return _mm256_loadu_si256((const __m256i *)p);
+        }
+        static inline void storei(void *p, Vi v) {
+            _mm256_storeu_si256((__m256i *)p, v);
+        }
+        static inline Vi zeroi() { return _mm256_setzero_si256(); }
+        static inline Vi set1_32(int v) { return _mm256_set1_epi32(v); }
+        static inline Vi and_(Vi a, Vi b) { return _mm256_and_si256(a, b); }
+        static inline Vi or_(Vi a, Vi b) { return _mm256_or_si256(a, b); }
+        static inline Vi add16(Vi a, Vi b) { return _mm256_add_epi16(a, b); }
+        static inline Vi sub16(Vi a, Vi b) { return _mm256_sub_epi16(a, b); }
+        static inline Vi mullo16(Vi a, Vi b) {
+            return _mm256_mullo_epi16(a, b);
+        }
+        static inline Vi mulhi16(Vi a, Vi b) {
+            return _mm256_mulhi_epi16(a, b);
+        }
+        static inline Vi cmpgt16(Vi a, Vi b) {
+            return _mm256_cmpgt_epi16(a, b);
+        }
+        template <int n>
+        static inline Vi srli16(Vi a) {
+            return _mm256_srli_epi16(a, n);
+        }
+        template <int n>
+        static inline Vi slli16(Vi a) {
+            return _mm256_slli_epi16(a, n);
+        }
+        // unpack and pack both work within 128bit lanes, so packs32 still
+        // restores the original order
+        static inline Vi unpacklo16(Vi a, Vi b) {
+            return _mm256_unpacklo_epi16(a, b);
+        }
+        static inline Vi unpackhi16(Vi a, Vi b) {
+            return _mm256_unpackhi_epi16(a, b);
+        }
+        static inline Vi add32(Vi a, Vi b) { return _mm256_add_epi32(a, b); }
+        template <int n>
+        static inline Vi srai32(Vi a) {
+            return _mm256_srai_epi32(a, n);
+        }
+        template <int n>
+        static inline Vi slli32(Vi a) {
+            return _mm256_slli_epi32(a, n);
+        }
+        static inline Vi packs32(Vi a, Vi b) {
+            return _mm256_packs_epi32(a, b);
+        }
+
+        static inline Vf loadf(const void *p) {
+            return _mm256_loadu_ps((const float *)p);
+        }
+        static inline void storef(void *p, Vf v) {
+            _mm256_storeu_ps((float *)p, v);
+        }
+        static inline Vf zerof() { return _mm256_setzero_ps(); }
+        static inline Vf addf(Vf a, Vf b) { return _mm256_add_ps(a, b); }
+        static inline Vf subf(Vf a, Vf b) { return _mm256_sub_ps(a, b); }
+        static inline Vf mulf(Vf a, Vf b) { return _mm256_mul_ps(a, b); }
+        static inline Vf cmpgtf(Vf a, Vf b) {
+            return _mm256_cmp_ps(a, b, _CMP_GT_OQ);
+        }
+        static inline Vf andf(Vf a, Vf b) { return _mm256_and_ps(a, b); }
+        static inline Vf selectf(Vf mask, Vf a, Vf b) {
+            return _mm256_blendv_ps(b, a, mask);
+        }
+    };
+#endif
+
+    //-----------------------------------------------------------------------
+    constexpr int TVPMixGCD(int a, int b) {
+        return b == 0 ? a : TVPMixGCD(b, a % b);
+    }
+    // number of vectors after which the per-channel gains repeat
+    constexpr int TVPMixPeriod(int ch, int lanes) {
+        return ch / TVPMixGCD(ch, lanes);
+    }
+
+    //-----------------------------------------------------------------------
+    // low 16 bits of each 32bit word, packed back in unpack order
+    template <class T>
+    static inline typename T::Vi TVPMixTrunc32(typename T::Vi lo,
+                                               typename T::Vi hi) {
+        lo = T::template srai32<16>(T::template slli32<16>(lo));
+        hi = T::template srai32<16>(T::template slli32<16>(hi));
+        return T::packs32(lo, hi);
+    }
+
+    template <class T, int ch>
+    void MixAudioS16SIMD(void *dst, const void *src, int samples,
+                         int16_t *volume) {
+        typedef typename T::Vi V;
+        const int lanes = T::N16;
+        const int period = TVPMixPeriod(ch, lanes);
+        const int block_frames = lanes * period / ch;
+
+        int16_t pattern[lanes * period];
+        for(int i = 0; i < lanes * period; i++)
+            pattern[i] = volume[i % ch];
+        V vol[period];
+        for(int p = 0; p < period; p++)
+            vol[p] = T::loadi(pattern + p * lanes);
+
+        int16_t *dst16 = (int16_t *)dst;
+        const int16_t *src16 = (const int16_t *)src;
+        const V zero = T::zeroi();
+        const V round = T::set1_32(0x8000);
+        int blocks = samples / block_frames;
+        for(int b = 0; b < blocks; b++) {
+            for(int p = 0; p < period; p++) {
+                V s = T::loadi(src16);
+                V d = T::loadi(dst16);
+                // s = (s * volume) >> 14; fits in 16bit while volume is
+                // within MAX_VOLUME
+                s = T::or_(T::template srli16<14>(T::mullo16(s, vol[p])),
+                           T::template slli16<2>(T::mulhi16(s, vol[p])));
+                // d * s in 32bit
+                V plo = T::mullo16(d, s), phi = T::mulhi16(d, s);
+                V p0 = T::unpacklo16(plo, phi), p1 = T::unpackhi16(plo, phi);
+                V pos_term = TVPMixTrunc32<T>(
+                    T::template srai32<15>(T::add32(p0, round)),
+                    T::template srai32<15>(T::add32(p1, round)));
+                V neg_term = TVPMixTrunc32<T>(T::template srai32<15>(p0),
+                                              T::template srai32<15>(p1));
+                V pos = T::and_(T::cmpgt16(s, zero), T::cmpgt16(d, zero));
+                V neg = T::and_(T::cmpgt16(zero, s), T::cmpgt16(zero, d));
+                // the store keeps the low 16 bits, so the wrapping 16bit
+                // arithmetic gives the same value as the 32bit C version
+                V r = T::add16(s, d);
+                r = T::sub16(r, T::and_(pos, pos_term));
+                r = T::add16(r, T::and_(neg, neg_term));
+                T::storei(dst16, r);
+                src16 += lanes;
+                dst16 += lanes;
+            }
+        }
+        MixAudioS16CPP<ch>(dst16, src16, samples - blocks * block_frames,
+                           volume);
+    }
+
+    template <class T, int ch>
+    void MixAudioF32SIMD(void *dst, const void *src, int samples,
+                         int16_t *volume) {
+        typedef typename T::Vf V;
+        const int lanes = T::NF;
+        const int period = TVPMixPeriod(ch, lanes);
+        const int block_frames = lanes * period / ch;
+
+        const float fmaxvolume = 1.0f / 16384;
+        float pattern[lanes * period];
+        for(int i = 0; i < lanes * period; i++)
+            pattern[i] = volume[i % ch] * fmaxvolume;
+        V vol[period];
+        for(int p = 0; p < period; p++)
+            vol[p] = T::loadf(pattern + p * lanes);
+
+        float *dst32 = (float *)dst;
+        const float *src32 = (const float *)src;
+        const V zero = T::zerof();
+        int blocks = samples / block_frames;
+        for(int b = 0; b < blocks; b++) {
+            for(int p = 0; p < period; p++) {
+                V s = T::mulf(T::loadf(src32), vol[p]);
+                V d = T::loadf(dst32);
+                V sum = T::addf(s, d);
+                V ds = T::mulf(d, s);
+                V pos = T::andf(T::cmpgtf(s, zero), T::cmpgtf(d, zero));
+                V neg = T::andf(T::cmpgtf(zero, s), T::cmpgtf(zero, d));
+                V r = T::selectf(neg, T::addf(sum, ds), sum);
+                r = T::selectf(pos, T::subf(sum, ds), r);
+                T::storef(dst32, r);
+                src32 += lanes;
+                dst32 += lanes;
+            }
+        }
+        MixAudioF32CPP<ch>(dst32, src32, samples - blocks * block_frames,
+                           volume);
+    }
+
+    //-----------------------------------------------------------------------
+    template <class T>
+    void TVPWaveMixer_SIMD_Setup(FAudioMix **func16, FAudioMix **func32) {
+        func16[0] = &MixAudioS16SIMD<T, 1>;
+        func16[1] = &MixAudioS16SIMD<T, 2>;
+        func16[2] = &MixAudioS16SIMD<T, 3>;
+        func16[3] = &MixAudioS16SIMD<T, 4>;
+        func16[4] = &MixAudioS16SIMD<T, 5>;
+        func16[5] = &MixAudioS16SIMD<T, 6>;
+        func16[6] = &MixAudioS16SIMD<T, 7>;
+        func16[7] = &MixAudioS16SIMD<T, 8>;
+        func32[0] = &MixAudioF32SIMD<T, 1>;
+        func32[1] = &MixAudioF32SIMD<T, 2>;
+        func32[2] = &MixAudioF32SIMD<T, 3>;
+        func32[3] = &MixAudioF32SIMD<T, 4>;
+        func32[4] = &MixAudioF32SIMD<T, 5>;
+        func32[5] = &MixAudioF32SIMD<T, 6>;
+        func32[6] = &MixAudioF32SIMD<T, 7>;
+        func32[7] = &MixAudioF32SIMD<T, 8>;
+    }
+
+} // namespace
+
+#endif
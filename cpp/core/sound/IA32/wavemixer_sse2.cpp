@@ -0,0 +1,18 @@
+//---------------------------------------------------------------------------
+/*
+        TVP2 ( T Visual Presenter 2 )  A script authoring tool
+        Copyright (C) 2000 W.Dee <dee@kikyou.info> and contributors
+
+        See details of license at "license.txt"
+*/
+//---------------------------------------------------------------------------
+// SSE2 software mixer
+//---------------------------------------------------------------------------
+// compiled with -msse2; call only when TVPCPUType has TVP_CPU_HAS_SSE2
+//---------------------------------------------------------------------------
+#include "wavemixer_ia32_intf.h"
+#include "wavemixer_simd.h"
+
+void TVPWaveMixer_SSE2_Init(FAudioMix **func16, FAudioMix **func32) {
+    TVPWaveMixer_SIMD_Setup<tTVPMixSSE2>(func16, func32);
+}
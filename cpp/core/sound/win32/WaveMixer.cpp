@@ -20,71 +20,22 @@
 #include "SysInitIntf.h"
 #include "TickCount.h"
 #include "WaveImpl.h"
+#include "WaveMixerFunc.h"
 #include <SDL2/SDL.h>
 #include <algorithm>
 #include <assert.h>
+#include <atomic>
 #include <iomanip>
 #include <math.h>
 #include <sstream>
 #include <string.h>
+#include <thread>
 #include <unordered_set>
 
 class iTVPAudioRenderer;
 
 static iTVPAudioRenderer *TVPAudioRenderer;
 
-template <int ch>
-void MixAudioS16CPP(void *dst, const void *src, int samples, int16_t *volume) {
-    int16_t *dst16 = (int16_t *)dst;
-    const int16_t *src16 = (const int16_t *)src;
-    while(samples--) {
-        for(int i = 0; i < ch; ++i) {
-            int src_sample = *src16++;
-            src_sample = (src_sample * volume[i]) >> 14;
-            int dest_sample = *dst16;
-            if(src_sample > 0 && dest_sample > 0) {
-                dest_sample = src_sample + dest_sample -
-                    ((dest_sample * src_sample + 0x8000) >> 15);
-            } else if(src_sample < 0 && dest_sample < 0) {
-                dest_sample = src_sample + dest_sample +
-                    ((dest_sample * src_sample) >> 15);
-            } else {
-                dest_sample += src_sample;
-            }
-            *dst16++ = dest_sample;
-        }
-    }
-}
-
-template <int ch>
-void MixAudioF32CPP(void *dst, const void *src, int samples, int16_t *volume) {
-    float *dst32 = (float *)dst;
-    const float *src32 = (const float *)src;
-    const float fmaxvolume = 1.0f / 16384 /*tTVPSoundBuffer::MAX_VOLUME*/;
-    float fvolume[ch];
-    for(int i = 0; i < ch; ++i)
-        fvolume[i] = volume[i] * fmaxvolume;
-    while(samples--) {
-        for(int i = 0; i < ch; ++i) {
-            float src_sample = SDL_SwapFloatLE(*src32++) * fvolume[i];
-            float dest_sample = SDL_SwapFloatLE(*dst32);
-            if(src_sample > 0 && dest_sample > 0) {
-                dest_sample =
-                    src_sample + dest_sample - dest_sample * src_sample;
-            } else if(src_sample < 0 && dest_sample < 0) {
-                dest_sample =
-                    src_sample + dest_sample + dest_sample * src_sample;
-            } else {
-                dest_sample += src_sample;
-            }
-            *(dst32++) = SDL_SwapFloatLE(dest_sample);
-        }
-    }
-}
-
-typedef void(FAudioMix)(void *dst, const void *src, int samples,
-                        int16_t *volume);
-
 static FAudioMix *_AudioMixS16[8] = { // 7.1 max
     &MixAudioS16CPP<1>, &MixAudioS16CPP<2>, &MixAudioS16CPP<3>,
     &MixAudioS16CPP<4>, &MixAudioS16CPP<5>, &MixAudioS16CPP<6>,
@@ -96,8 +47,6 @@ static FAudioMix *_AudioMixF32[8] = { // 7.1 max
     &MixAudioF32CPP<7>, &MixAudioF32CPP<8>
 };
 
-extern "C" void TVPWaveMixer_ASM_Init(FAudioMix **func16, FAudioMix **func32);
-
 class tTVPSoundBuffer : public iTVPSoundBuffer {
 public:
     bool _playing = false;
@@ -124,12 +73,21 @@ public:
         _volume_raw[3] = _volume_raw[1];
     }
 
+    // _buffers is a single-producer/single-consumer ring of appended
+    // chunks. the producer side (AppendBuffer, Reset) is serialized by
+    // _buffer_mtx; FillBuffer runs on the audio thread and never locks
+    // nor allocates. the slots keep their capacity across uses.
     std::mutex _buffer_mtx;
-    std::deque<std::vector<uint8_t>> _buffers;
-    tjs_uint _sendedFrontBuffer = 0;
-    tjs_uint _sendedSamples = 0, _inCachedSamples = 0;
-
-    tTVPSoundBuffer(int framesize, SDL_AudioCVT *cvt) :
+    std::vector<std::vector<uint8_t>> _buffers;
+    tjs_uint _bufferMask = 0;
+    std::atomic<tjs_uint> _bufferWrite{ 0 }, _bufferRead{ 0 };
+    tjs_uint _sendedFrontBuffer = 0; // audio thread only
+    std::atomic<tjs_uint> _sendedSamples{ 0 }, _inCachedSamples{ 0 };
+    // Reset waits for a running FillBuffer, which skips while resetting
+    std::atomic<bool> _filling{ false }, _resetting{ false };
+
+    tTVPSoundBuffer(int framesize, SDL_AudioCVT *cvt, int bufcount = 0,
+                    int unitbytes = 0) :
         _frame_size(framesize), _cvt(cvt) {
         RecalcVolume();
         if(cvt) {
@@ -138,6 +96,16 @@ public:
                 _cvt->len_mult); // IEEE f.32 stereo 48000kHz
             _cvt->buf = &_cvtbuf.front();
         }
+        if(bufcount > 0) {
+            // room for twice the units the decoder keeps queued
+            tjs_uint slots = 2;
+            while(slots < (tjs_uint)bufcount * 2)
+                slots <<= 1;
+            _buffers.resize(slots);
+            for(std::vector<uint8_t> &buf : _buffers)
+                buf.reserve(unitbytes);
+            _bufferMask = slots - 1;
+        }
     }
 
     virtual ~tTVPSoundBuffer();
@@ -155,10 +123,15 @@ public:
 
     virtual void Reset() override {
         std::lock_guard<std::mutex> lk(_buffer_mtx);
-        _buffers.clear();
+        _resetting = true;
+        while(_filling)
+            std::this_thread::yield();
+        _bufferWrite = 0;
+        _bufferRead = 0;
         _inCachedSamples = 0;
         _sendedFrontBuffer = 0;
         _sendedSamples = 0;
+        _resetting = false;
     }
 
     virtual bool IsPlaying() override { return _playing; }
@@ -179,8 +152,14 @@ public:
 
     virtual void AppendBuffer(const void *_inbuf,
                               unsigned int inlen /*, int tag = 0*/) override {
+        std::lock_guard<std::mutex> lk(_buffer_mtx);
+        tjs_uint write = _bufferWrite.load(std::memory_order_relaxed);
+        if(write - _bufferRead.load(std::memory_order_acquire) >=
+           _buffers.size())
+            return; // the ring is full; IsBufferValid() returned false
+        std::vector<uint8_t> &buffer = _buffers[write & _bufferMask];
+        buffer.clear();
         if(_cvt) {
-            std::vector<uint8_t> buffer;
             uint8_t *inbuf = (uint8_t *)_inbuf;
             int buflen = _frame_size * 2352;
             _cvt->len = buflen;
@@ -200,22 +179,18 @@ public:
                 buffer.insert(buffer.end(), _cvt->buf,
                               _cvt->buf + _cvt->len_cvt);
             }
-            std::lock_guard<std::mutex> lk(_buffer_mtx);
-            _inCachedSamples += buffer.size() / _frame_size;
-            _buffers.emplace_back();
-            _buffers.back().swap(buffer);
         } else {
-            std::lock_guard<std::mutex> lk(_buffer_mtx);
-            _buffers.emplace_back((uint8_t *)_inbuf,
-                                  ((uint8_t *)_inbuf) + inlen);
-            _inCachedSamples += inlen / _frame_size;
+            buffer.insert(buffer.end(), (uint8_t *)_inbuf,
+                          ((uint8_t *)_inbuf) + inlen);
         }
+        _inCachedSamples += buffer.size() / _frame_size;
+        _bufferWrite.store(write + 1, std::memory_order_release);
     }
 
     virtual bool IsBufferValid() override {
-        return true; // unlimited buffer size
-                     // return !_buffers.empty(); // thread safe if
-                     // read only
+        return _bufferWrite.load(std::memory_order_relaxed) -
+            _bufferRead.load(std::memory_order_acquire) <
+            _buffers.size();
     }
 
     virtual tjs_uint GetLatencySamples() override;
@@ -223,7 +198,10 @@ public:
     // 	virtual void SetSampleOffset(tjs_uint n) override {
     // 		_sendedSamples = n;
     // 	}
-    virtual int GetRemainBuffers() override { return _buffers.size(); }
+    virtual int GetRemainBuffers() override {
+        return _bufferWrite.load(std::memory_order_relaxed) -
+            _bufferRead.load(std::memory_order_acquire);
+    }
 
     virtual tjs_uint GetCurrentPlaySamples() override;
 
@@ -311,8 +289,11 @@ public:
             }
         }
 
-        tTVPSoundBuffer *s =
-            new tTVPSoundBuffer(fmt.BytesPerSample * fmt.Channels, cvt);
+        // one decoder access unit after conversion, with some slack for
+        // the resampler
+        int unitbytes = (_spec.freq / TVP_WSB_ACCESS_FREQ + 16) * _frame_size;
+        tTVPSoundBuffer *s = new tTVPSoundBuffer(
+            fmt.BytesPerSample * fmt.Channels, cvt, bufcount, unitbytes);
         std::lock_guard<std::mutex> lk(_streams_mtx);
         _streams.emplace(s);
         return s;
@@ -368,9 +349,15 @@ float tTVPSoundBuffer::GetLatencySeconds() {
 void tTVPSoundBuffer::FillBuffer(uint8_t *out, int len) {
     if(!_playing)
         return;
-    std::lock_guard<std::mutex> lk(_buffer_mtx);
-    while(len > 0 && !_buffers.empty()) {
-        std::vector<uint8_t> &buf = _buffers.front();
+    _filling = true;
+    if(_resetting) {
+        _filling = false;
+        return;
+    }
+    tjs_uint read = _bufferRead.load(std::memory_order_relaxed);
+    tjs_uint write = _bufferWrite.load(std::memory_order_acquire);
+    while(len > 0 && read != write) {
+        std::vector<uint8_t> &buf = _buffers[read & _bufferMask];
         if(buf.size() > _sendedFrontBuffer) {
             int n = std::min((size_t)len, buf.size() - _sendedFrontBuffer);
             int samples = TVPAudioRenderer->MixAudio(
@@ -383,9 +370,10 @@ void tTVPSoundBuffer::FillBuffer(uint8_t *out, int len) {
         }
         if(_sendedFrontBuffer >= buf.size()) {
             _sendedFrontBuffer = 0;
-            _buffers.pop_front();
+            _bufferRead.store(++read, std::memory_order_release);
         }
     }
+    _filling = false;
 }
 
 class tTVPAudioRendererSDL : public iTVPAudioRenderer {
@@ -786,6 +774,11 @@ static iTVPAudioRenderer *CreateAudioRenderer() {
 
 void TVPInitDirectSound(int freq) {
     if(!TVPAudioRenderer) {
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) ||               \
+    defined(__x86_64__)
+        // SSE2/AVX2 versions replace the C mix routines
+        TVPWaveMixer_ASM_Init(_AudioMixS16, _AudioMixF32);
+#endif
         TVPAudioRenderer = CreateAudioRenderer();
     }
     // TVPInitSoundOptions();
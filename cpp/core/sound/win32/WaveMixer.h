@@ -12,6 +12,15 @@ void TVPInitDirectSound(int freq = 48000);
 
 void TVPUninitDirectSound();
 
+// mixes "samples" frames of interleaved channels from src into dst.
+// volume holds one 2.14 fixed point gain per channel (16384 = 1.0).
+typedef void(FAudioMix)(void *dst, const void *src, int samples,
+                        int16_t *volume);
+
+// replaces the C mix routines (indexed by channel count - 1) with the
+// fastest ones the CPU supports
+extern "C" void TVPWaveMixer_ASM_Init(FAudioMix **func16, FAudioMix **func32);
+
 class iTVPSoundBuffer {
 public:
     virtual ~iTVPSoundBuffer() {}
@@ -0,0 +1,72 @@
+//---------------------------------------------------------------------------
+/*
+        TVP2 ( T Visual Presenter 2 )  A script authoring tool
+        Copyright (C) 2000 W.Dee <dee@kikyou.info> and contributors
+
+        See details of license at "license.txt"
+*/
+//---------------------------------------------------------------------------
+// Software mixer kernels
+//---------------------------------------------------------------------------
+// C versions of the mix routines used by tTVPSoundBuffer::FillBuffer
+// (see FAudioMix in WaveMixer.h). The SIMD versions in IA32/ must give the
+// same result bit by bit, and use these for the samples left over after the
+// vector loop.
+//---------------------------------------------------------------------------
+#ifndef WaveMixerFuncH
+#define WaveMixerFuncH
+
+#include <stdint.h>
+#include <SDL2/SDL.h>
+
+//---------------------------------------------------------------------------
+template <int ch>
+void MixAudioS16CPP(void *dst, const void *src, int samples, int16_t *volume) {
+    int16_t *dst16 = (int16_t *)dst;
+    const int16_t *src16 = (const int16_t *)src;
+    while(samples--) {
+        for(int i = 0; i < ch; ++i) {
+            int src_sample = *src16++;
+            src_sample = (src_sample * volume[i]) >> 14;
+            int dest_sample = *dst16;
+            if(src_sample > 0 && dest_sample > 0) {
+                dest_sample = src_sample + dest_sample -
+                    ((dest_sample * src_sample + 0x8000) >> 15);
+            } else if(src_sample < 0 && dest_sample < 0) {
+                dest_sample = src_sample + dest_sample +
+                    ((dest_sample * src_sample) >> 15);
+            } else {
+                dest_sample += src_sample;
+            }
+            *dst16++ = dest_sample;
+        }
+    }
+}
+//---------------------------------------------------------------------------
+template <int ch>
+void MixAudioF32CPP(void *dst, const void *src, int samples, int16_t *volume) {
+    float *dst32 = (float *)dst;
+    const float *src32 = (const float *)src;
+    const float fmaxvolume = 1.0f / 16384 /*tTVPSoundBuffer::MAX_VOLUME*/;
+    float fvolume[ch];
+    for(int i = 0; i < ch; ++i)
+        fvolume[i] = volume[i] * fmaxvolume;
+    while(samples--) {
+        for(int i = 0; i < ch; ++i) {
+            float src_sample = SDL_SwapFloatLE(*src32++) * fvolume[i];
+            float dest_sample = SDL_SwapFloatLE(*dst32);
+            if(src_sample > 0 && dest_sample > 0) {
+                dest_sample =
+                    src_sample + dest_sample - dest_sample * src_sample;
+            } else if(src_sample < 0 && dest_sample < 0) {
+                dest_sample =
+                    src_sample + dest_sample + dest_sample * src_sample;
+            } else {
+                dest_sample += src_sample;
+            }
+            *(dst32++) = SDL_SwapFloatLE(dest_sample);
+        }
+    }
+}
+//---------------------------------------------------------------------------
+#endif
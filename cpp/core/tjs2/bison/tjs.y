@@ -794,7 +794,9 @@ dic_dummy_elm_opt
 
 /* a constant inline array object */
 const_inline_array
-	: "(" "const" ")" "[" 				{ tTJSExprNode *node =
+	: "(" "const" ")" "[" 				{ if(TJSBackgroundCompiling)
+										      throw eTJSError(ttstr(TJSNotImplemented));
+										  tTJSExprNode *node =
 										  cc->MakeNP0(token::T_CONSTVAL);
 										  iTJSDispatch2 * dsp = TJSCreateArrayObject();
 										  node->SetValue(tTJSVariant(dsp, dsp));
@@ -829,7 +831,9 @@ const_array_elm
 
 /* a constant inline dictionary */
 const_inline_dic
-	: "(" "const" ")" "%" "["			{ tTJSExprNode *node =
+	: "(" "const" ")" "%" "["			{ if(TJSBackgroundCompiling)
+										      throw eTJSError(ttstr(TJSNotImplemented));
+										  tTJSExprNode *node =
 										  cc->MakeNP0(token::T_CONSTVAL);
 										  iTJSDispatch2 * dsp = TJSCreateDictionaryObject();
 										  node->SetValue(tTJSVariant(dsp, dsp));
@@ -233,11 +233,10 @@ namespace TJS {
 
     //---------------------------------------------------------------------------
     void tTJS::Release() {
-        if(RefCount == 1) {
+        // script blocks compiled in background hold references from other
+        // threads
+        if(--RefCount == 0)
             delete this;
-        } else {
-            RefCount--;
-        }
     }
 
     //---------------------------------------------------------------------------
@@ -284,7 +283,7 @@ namespace TJS {
 
     //---------------------------------------------------------------------------
     void tTJS::OutputToConsole(const tjs_char *msg) const {
-        if(ConsoleOutput) {
+        if(ConsoleOutput && !TJSBackgroundCompiling) {
             ConsoleOutput->Print(msg);
         }
     }
@@ -495,8 +494,10 @@ namespace TJS {
 
     //---------------------------------------------------------------------------
     void tTJS::DoGarbageCollection() {
-        // do garbage collection
-        TJSVariantArrayStackCompactNow();
+        // do garbage collection; unused register blocks and stale values
+        // above the frames in use are released
+        if(VariantArrayStack)
+            VariantArrayStack->Compact();
         TJSCompactStringHeap();
     }
 
@@ -504,10 +505,12 @@ namespace TJS {
     // for Bytecode
     void tTJS::LoadByteCode(const tjs_uint8 *buff, size_t len,
                             tTJSVariant *result, iTJSDispatch2 *context,
-                            const tjs_char *name) {
+                            const tjs_char *name, const tjs_char *source,
+                            tjs_int lineofs) {
         TJSSetFPUE();
         if(Cache)
-            Cache->LoadByteCode(buff, len, result, context, name);
+            Cache->LoadByteCode(buff, len, result, context, name, source,
+                                lineofs);
     }
 
     //---------------------------------------------------------------------------
@@ -596,6 +599,21 @@ namespace TJS {
         }
         blk->Release();
     }
+
+    //---------------------------------------------------------------------------
+    void tTJS::CompileScriptInBackground(const tjs_char *script,
+                                         class tTJSBinaryStream *output,
+                                         bool isresultneeded, bool outputdebug,
+                                         bool isexpression,
+                                         const tjs_char *name,
+                                         tjs_int lineofs) {
+        struct tBackgroundScope {
+            tBackgroundScope() { TJSBackgroundCompiling = true; }
+            ~tBackgroundScope() { TJSBackgroundCompiling = false; }
+        } scope;
+        CompileScript(script, output, isresultneeded, outputdebug, isexpression,
+                      name, lineofs);
+    }
     //---------------------------------------------------------------------------
 
     //---------------------------------------------------------------------------
@@ -646,6 +664,11 @@ namespace TJS {
 
     void tTJSBinaryStream::SetEndOfStorage() { TJS_eTJSError(TJSWriteError); }
 
+    //---------------------------------------------------------------------------
+    const void *tTJSBinaryStream::BorrowBuffer(tjs_uint size) {
+        return nullptr;
+    }
+
     //---------------------------------------------------------------------------
     tjs_uint64 tTJSBinaryStream::GetSize() {
         tjs_uint64 orgpos = GetPosition();
@@ -12,6 +12,7 @@
 #ifndef tjsH
 #define tjsH
 
+#include <atomic>
 #include <vector>
 #include "tjsConfig.h"
 #include "tjsVariant.h"
@@ -88,7 +89,7 @@ namespace TJS {
         friend class tTJSScriptBlock;
 
     private:
-        tjs_uint RefCount; // reference count
+        std::atomic<tjs_uint> RefCount; // reference count
 
     public:
         tTJS();
@@ -176,7 +177,9 @@ namespace TJS {
         void LoadByteCode(const tjs_uint8 *buff, size_t len,
                           tTJSVariant *result = nullptr,
                           iTJSDispatch2 *context = nullptr,
-                          const tjs_char *name = nullptr);
+                          const tjs_char *name = nullptr,
+                          const tjs_char *source = nullptr,
+                          tjs_int lineofs = 0);
 
         bool LoadByteCode(class tTJSBinaryStream *stream,
                           tTJSVariant *result = nullptr,
@@ -192,6 +195,19 @@ namespace TJS {
                            bool isresultneeded = false,
                            bool outputdebug = false, bool isexpression = false,
                            const tjs_char *name = nullptr, tjs_int lineofs = 0);
+
+        // the same as CompileScript, but can be called on other threads
+        // than the one running scripts, while scripts run. the script must
+        // not use the pre-processor nor (const) inline arrays/dictionaries;
+        // those fail with an exception. nothing is output to the console,
+        // compile errors are only thrown.
+        void CompileScriptInBackground(const tjs_char *script,
+                                       class tTJSBinaryStream *output,
+                                       bool isresultneeded = false,
+                                       bool outputdebug = false,
+                                       bool isexpression = false,
+                                       const tjs_char *name = nullptr,
+                                       tjs_int lineofs = 0);
     };
     //---------------------------------------------------------------------------
 
@@ -281,6 +297,13 @@ namespace TJS {
 
         virtual ~tTJSBinaryStream() = default;
 
+        //-- optionally to implement
+        virtual const void *BorrowBuffer(tjs_uint size);
+        /* returns a pointer to the next "size" bytes from the current
+           position without copying, or nullptr if the stream cannot.
+           the position is not changed. the pointer is valid until any
+           other method of the stream is called. */
+
         tjs_uint64 GetPosition();
 
         void SetPosition(tjs_uint64 pos);
@@ -316,11 +316,7 @@ namespace TJS {
             tjs_int len = 0;
             if(val) {
                 len = val->GetLength();
-                if(val->LongString) {
-                    data = val->LongString;
-                } else {
-                    data = val->ShortString;
-                }
+                data = *val;
             }
             PutString(stream, data, len);
         }
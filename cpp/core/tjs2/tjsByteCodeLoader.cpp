@@ -12,6 +12,8 @@
 #include "tjsScriptBlock.h"
 #include "tjsByteCodeLoader.h"
 #include "tjsGlobalStringMap.h"
+#include "tjsArray.h"
+#include "tjsDictionary.h"
 
 namespace TJS {
 
@@ -73,6 +75,7 @@ namespace TJS {
 
     void tTJSByteCodeLoader::ReadDataArea(const tjs_uint8 *buff, int offset,
                                           size_t size) {
+        const int offset0 = offset;
         int count = read4byte(&(buff[offset]));
         offset += 4;
         if(count > 0) {
@@ -155,6 +158,90 @@ namespace TJS {
                 offset += ((len + 3) >> 2) << 2;
             }
         }
+        // size はタグとサイズの 8 バイトを含む
+        int end = (int)(offset0 - 8 + size);
+        if(offset < end) {
+            ReadConstObjects(buff, offset, end);
+        }
+    }
+
+    void tTJSByteCodeLoader::ReadConstObjects(const tjs_uint8 *buff,
+                                              int offset, int end) {
+        int count = read4byte(&(buff[offset]));
+        offset += 4;
+        ObjectArray.clear();
+        ObjectArray.reserve(count);
+        for(int i = 0; i < count && offset + 8 <= end; i++) {
+            int kind = read4byte(&(buff[offset]));
+            int len = read4byte(&(buff[offset + 4]));
+            offset += 8;
+            if(len < 0 || offset + len * 4 > end) {
+                break;
+            }
+            iTJSDispatch2 *dsp = kind == OBJECT_DICTIONARY
+                ? TJSCreateDictionaryObject()
+                : TJSCreateArrayObject();
+            tTJSVariant obj(dsp, dsp);
+            dsp->Release();
+            tTJSVariant name;
+            for(int j = 0; j < len; j++) {
+                int type = (tjs_int16)read2byte(&(buff[offset]));
+                int index = (tjs_int16)read2byte(&(buff[offset + 2]));
+                offset += 4;
+                tTJSVariant v;
+                GetConstValue(v, type, index); // 中身は前に読んである
+                if(kind != OBJECT_DICTIONARY) {
+                    dsp->PropSetByNum(TJS_MEMBERENSURE, j, &v, dsp);
+                } else if((j & 1) == 0) {
+                    name = v;
+                } else {
+                    ttstr membername(name);
+                    dsp->PropSet(TJS_MEMBERENSURE, membername.c_str(),
+                                 membername.GetHint(), &v, dsp);
+                }
+            }
+            ObjectArray.push_back(obj);
+        }
+    }
+
+    void tTJSByteCodeLoader::GetConstValue(tTJSVariant &v, int type,
+                                           int index) const {
+        switch(type) {
+            case TYPE_OBJECT:
+                // 0 は nullptr、それ以外は (const) な配列・辞書
+                if(index > 0 && index <= (int)ObjectArray.size()) {
+                    v = ObjectArray[index - 1];
+                } else {
+                    v = (iTJSDispatch2 *)nullptr;
+                }
+                break;
+            case TYPE_STRING:
+                v = StringArray[index].c_str(); // tTJSString
+                break;
+            case TYPE_OCTET:
+                v = OctetArray[index]; // tTJSVariantOctet
+                break;
+            case TYPE_REAL:
+                v = (tjs_real)DoubleArray[index];
+                break;
+            case TYPE_BYTE:
+                v = (tjs_int)ByteArray[index];
+                break;
+            case TYPE_SHORT:
+                v = (tjs_int)ShortArray[index];
+                break;
+            case TYPE_INTEGER:
+                v = (tjs_int)LongArray[index];
+                break;
+            case TYPE_LONG:
+                v = (tjs_int64)LongLongArray[index];
+                break;
+            case TYPE_VOID:
+            case TYPE_UNKNOWN:
+            default:
+                v.Clear();
+                break;
+        }
     }
 
     void tTJSByteCodeLoader::ReadObjects(tTJSScriptBlock *block,
@@ -215,7 +302,9 @@ namespace TJS {
             tTJSInterCodeContext::tSourcePos *srcPos = nullptr;
             tjs_int srcPosArraySize = 0;
             if(count > 0) {
-                srcPos = new tTJSInterCodeContext::tSourcePos[count];
+                // tTJSInterCodeContext frees this with TJS_free
+                srcPos = (tTJSInterCodeContext::tSourcePos *)TJS_malloc(
+                    count * sizeof(tTJSInterCodeContext::tSourcePos));
                 srcPosArraySize = count;
                 for(int i = 0; i < count; i++) {
                     srcPos[i].CodePos = read4byte(&(buff[offset]));
@@ -258,42 +347,14 @@ namespace TJS {
                 int type = data[pos];
                 int index = data[pos + 1];
                 switch(type) {
-                    case TYPE_VOID:
-                        vdata[i].Clear();
-                        break;
-                    case TYPE_OBJECT:
-                        vdata[i] = (iTJSDispatch2 *)nullptr;
-                        break;
                     case TYPE_INTER_OBJECT:
                         work.push_back(VariantRepalace(&(vdata[i]), index));
                         break;
                     case TYPE_INTER_GENERATOR:
                         work.push_back(VariantRepalace(&(vdata[i]), index));
                         break;
-                    case TYPE_STRING:
-                        vdata[i] = StringArray[index].c_str(); // tTJSString
-                        break;
-                    case TYPE_OCTET:
-                        vdata[i] = OctetArray[index]; // tTJSVariantOctet
-                        break;
-                    case TYPE_REAL:
-                        vdata[i] = (tjs_real)DoubleArray[index];
-                        break;
-                    case TYPE_BYTE:
-                        vdata[i] = (tjs_int)ByteArray[index];
-                        break;
-                    case TYPE_SHORT:
-                        vdata[i] = (tjs_int)ShortArray[index];
-                        break;
-                    case TYPE_INTEGER:
-                        vdata[i] = (tjs_int)LongArray[index];
-                        break;
-                    case TYPE_LONG:
-                        vdata[i] = (tjs_int64)LongLongArray[index];
-                        break;
-                    case TYPE_UNKNOWN:
                     default:
-                        vdata[i].Clear();
+                        GetConstValue(vdata[i], type, index);
                         break;
                 }
             }
@@ -83,6 +83,9 @@ namespace TJS {
         static const tjs_int32 TYPE_INTER_GENERATOR = 10; // temporary
         static const tjs_int32 TYPE_UNKNOWN = -1;
 
+        static const tjs_int32 OBJECT_ARRAY = 0;
+        static const tjs_int32 OBJECT_DICTIONARY = 1;
+
         array_wrap<tjs_int8> ByteArray;
         std::vector<tjs_int16> ShortArray;
         std::vector<tjs_int32> LongArray;
@@ -90,6 +93,7 @@ namespace TJS {
         std::vector<double> DoubleArray;
         std::vector<ttstr> StringArray; // typedef tTJSString ttstr
         std::vector<tTJSVariantOctet *> OctetArray;
+        std::vector<tTJSVariant> ObjectArray; // (const) な配列・辞書
 
         const tjs_uint8 *ReadBuffer;
         tjs_uint32 ReadIndex;
@@ -134,6 +138,16 @@ namespace TJS {
     private:
         void ReadDataArea(const tjs_uint8 *buff, int offset, size_t size);
 
+        /**
+         * (const) な配列・辞書を読み込む。古いバイトコードには無い
+         */
+        void ReadConstObjects(const tjs_uint8 *buff, int offset, int end);
+
+        /**
+         * 定数領域の値を得る。InterCodeObject は扱わない
+         */
+        void GetConstValue(tTJSVariant &v, int type, int index) const;
+
         void ReadObjects(tTJSScriptBlock *block, const tjs_uint8 *buff,
                          int offset, int size);
 
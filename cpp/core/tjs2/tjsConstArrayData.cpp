@@ -10,6 +10,8 @@
 
 #include "tjs.h"
 #include "tjsConstArrayData.h"
+#include "tjsArray.h"
+#include "tjsDictionary.h"
 #include <limits.h>
 
 namespace TJS {
@@ -160,7 +162,7 @@ namespace TJS {
                     return TYPE_BYTE;
                 } else if(val >= SHRT_MIN && val <= SHRT_MAX) {
                     return TYPE_SHORT;
-                } else if(val >= LONG_MIN && val <= LONG_MAX) {
+                } else if(val >= INT_MIN && val <= INT_MAX) {
                     return TYPE_INTEGER;
                 } else {
                     return TYPE_LONG;
@@ -184,6 +186,10 @@ namespace TJS {
                 if(obj == nullptr && objthis == nullptr) {
                     return 0; // nullptr の VariantClosure
                               // は受け入れる
+                } else if(obj == objthis) {
+                    // (const) のインライン配列・辞書は 1 から数える
+                    int index = PutObject(obj, block);
+                    return index >= 0 ? index + 1 : -1;
                 } else {
                     return -1; // その他は入れない。
                 }
@@ -192,8 +198,9 @@ namespace TJS {
                 iTJSDispatch2 *obj = v.AsObjectNoAddRef();
                 return block->GetCodeIndex((const tTJSInterCodeContext *)obj);
             }
-            case TYPE_STRING:
-                return PutString(v.GetString());
+            case TYPE_STRING: // an empty string has no tTJSVariantString
+                return PutString(v.AsStringNoAddRef() ? v.GetString()
+                                                      : nullptr);
             case TYPE_OCTET:
                 return PutByteBuffer(v.AsOctet());
             case TYPE_REAL:
@@ -212,6 +219,45 @@ namespace TJS {
         return -1;
     }
 
+    int tjsConstArrayData::PutObject(iTJSDispatch2 *obj,
+                                     tTJSScriptBlock *block) {
+        std::map<iTJSDispatch2 *, int>::iterator found = ObjectHash.find(obj);
+        if(found != ObjectHash.end()) {
+            return found->second;
+        }
+        tObject object;
+        iTJSNativeInstance *ni;
+        if(TJS_SUCCEEDED(obj->NativeInstanceSupport(
+               TJS_NIS_GETINSTANCE, TJSGetArrayClassID(), &ni))) {
+            object.Kind = OBJECT_ARRAY;
+        } else if(TJS_SUCCEEDED(obj->NativeInstanceSupport(
+                      TJS_NIS_GETINSTANCE, TJSGetDictionaryClassID(), &ni))) {
+            object.Kind = OBJECT_DICTIONARY;
+        } else {
+            return -1;
+        }
+        // 辞書は名前と値の並びになる
+        tTJSArrayNI items;
+        items.Assign(obj);
+        // 中の配列・辞書が先に格納されるので、読み込み時は前から作れる
+        for(tTJSVariant &v : items.Items) {
+            int type = GetType(v, block);
+            int index = PutVariant(v, block);
+            if(type == TYPE_INTER_OBJECT || index < 0 || index > SHRT_MAX) {
+                return -1;
+            }
+            object.Items.push_back((tjs_int16)type);
+            object.Items.push_back((tjs_int16)index);
+        }
+        int index = (int)Object.size();
+        if(index >= SHRT_MAX) {
+            return -1;
+        }
+        Object.push_back(object);
+        ObjectHash.insert(std::pair<iTJSDispatch2 *, int>(obj, index));
+        return index;
+    }
+
     std::vector<tjs_uint8> *tjsConstArrayData::ExportBuffer() {
         int size = 0;
         int stralllen = 0;
@@ -255,6 +301,13 @@ namespace TJS {
         // double
         size += (int)(Double.size() * 8 + 4);
 
+        // object
+        count = (int)Object.size();
+        size += 4;
+        for(int i = 0; i < count; i++) {
+            size += (int)(Object[i].Items.size() * 2 + 8);
+        }
+
         std::vector<tjs_uint8> *buf = new std::vector<tjs_uint8>();
         buf->reserve(size);
 
@@ -333,6 +386,20 @@ namespace TJS {
                 buf->push_back(0);
             }
         }
+
+        // object write
+        // 古い読み込み側はデータエリアの末尾を読まないので、最後に置く
+        count = (int)Object.size();
+        Add4ByteToVector(buf, count);
+        for(int i = 0; i < count; i++) {
+            tObject &object = Object[i];
+            int len = (int)object.Items.size();
+            Add4ByteToVector(buf, object.Kind);
+            Add4ByteToVector(buf, len / 2);
+            for(int v = 0; v < len; v++) {
+                Add2ByteToVector(buf, object.Items[v]);
+            }
+        }
         return buf;
     }
 
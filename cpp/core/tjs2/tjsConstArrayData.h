@@ -32,6 +32,16 @@ namespace TJS {
         std::vector<std::basic_string<tjs_char>> String;
         std::vector<std::vector<tjs_uint8> *> ByteBuffer;
 
+        /**
+         * (const) のインライン配列・辞書
+         * 要素は (型, インデックス) の組で、辞書は名前と値を交互に持つ
+         */
+        struct tObject {
+            tjs_int32 Kind;
+            std::vector<tjs_int16> Items;
+        };
+        std::vector<tObject> Object;
+
         // 保持したかどうか判定するためのハッシュ
         std::map<tjs_int8, int> ByteHash;
         std::map<tjs_int16, int> ShortHash;
@@ -40,6 +50,7 @@ namespace TJS {
         std::map<double, int> DoubleHash;
         std::map<std::basic_string<tjs_char>, int> StringHash;
         // オクテット型の時はハッシュを使っていない
+        std::map<iTJSDispatch2 *, int> ObjectHash;
 
         static const tjs_uint8 TYPE_VOID = 0;
         static const tjs_uint8 TYPE_OBJECT = 1;
@@ -53,6 +64,15 @@ namespace TJS {
         static const tjs_uint8 TYPE_LONG = 9;
         static const tjs_uint8 TYPE_UNKNOWN = -1;
 
+        static const tjs_int32 OBJECT_ARRAY = 0;
+        static const tjs_int32 OBJECT_DICTIONARY = 1;
+
+        /**
+         * (const) のインライン配列・辞書を格納する
+         * 格納できない値を含む時は -1 を返す
+         */
+        int PutObject(iTJSDispatch2 *obj, tTJSScriptBlock *block);
+
         /**
          * オクテット型の値を格納する
          */
@@ -11,9 +11,15 @@
 #include "tjsCommHead.h"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <thread>
 #include "tjsDebug.h"
 #include "tjsHashSearch.h"
 #include "tjsInterCodeGen.h"
+#include "tjsScriptBlock.h"
 #include "tjsGlobalStringMap.h"
 
 namespace TJS {
@@ -689,4 +695,283 @@ namespace TJS {
             return ttstr();
     }
 
+    //---------------------------------------------------------------------------
+    // Profiler : sampling profiler of script functions
+    //---------------------------------------------------------------------------
+    // A timer thread advances a tick counter every interval. The script
+    // thread checks the counter whenever a function is entered or left, and
+    // charges the elapsed ticks to the call stack that was current since the
+    // previous check; time spent in native code is thus charged to the
+    // script function that called it.
+    //---------------------------------------------------------------------------
+    tTJSProfiler *TJSProfiler = nullptr; // the running profiler
+    static tTJSProfiler *TJSLastProfile = nullptr; // the stopped profiler
+
+    //---------------------------------------------------------------------------
+    class tTJSProfiler {
+        struct tNode {
+            tjs_int Parent;
+            tTJSInterCodeContext *Context;
+            ttstr Name; // frame name
+            tjs_uint64 Samples; // self samples
+        };
+
+        struct tRecord {
+            tjs_uint64 Begin; // in ticks
+            tjs_uint64 End;
+            tjs_int Node;
+        };
+
+        static const size_t MaxRecords = 1024 * 1024;
+
+        tjs_int Interval; // in microseconds
+        std::atomic<tjs_uint64> Ticks;
+        std::atomic<bool> Terminated;
+        std::thread Timer;
+
+        tjs_uint64 LastTicks;
+        std::vector<tjs_int> Stack; // node indices; empty for the root
+        std::vector<tNode> Nodes; // Nodes[0] is the root ( no script )
+        std::map<std::pair<tjs_int, tTJSInterCodeContext *>, tjs_int> Children;
+        std::vector<tRecord> Records; // timeline
+
+    public:
+        tTJSProfiler(tjs_int interval) : Ticks(0), Terminated(false) {
+            Interval = interval < 1 ? 1 : interval;
+            LastTicks = 0;
+            Nodes.push_back(tNode{ -1, nullptr, ttstr(), 0 });
+            Timer = std::thread([this] { TimerProc(); });
+        }
+
+        ~tTJSProfiler() { Stop(); }
+
+    private:
+        void TimerProc() {
+            auto start = std::chrono::steady_clock::now();
+            auto interval = std::chrono::microseconds(Interval);
+            tjs_uint64 tick = 0;
+            while(!Terminated.load(std::memory_order_relaxed)) {
+                tick++;
+                std::this_thread::sleep_until(start + interval * tick);
+                // catch up if the thread was kept waiting
+                tjs_uint64 now =
+                    (tjs_uint64)((std::chrono::steady_clock::now() - start) /
+                                 interval);
+                if(now > tick)
+                    tick = now;
+                Ticks.store(tick, std::memory_order_relaxed);
+            }
+        }
+
+        void Sample() {
+            tjs_uint64 ticks = Ticks.load(std::memory_order_relaxed);
+            if(ticks == LastTicks)
+                return;
+
+            tjs_int node = Stack.empty() ? 0 : Stack.back();
+            Nodes[node].Samples += ticks - LastTicks;
+
+            if(node != 0) {
+                if(!Records.empty() && Records.back().Node == node &&
+                   Records.back().End == LastTicks)
+                    Records.back().End = ticks;
+                else if(Records.size() < MaxRecords)
+                    Records.push_back(tRecord{ LastTicks, ticks, node });
+            }
+            LastTicks = ticks;
+        }
+
+        static ttstr GetFrameName(tTJSInterCodeContext *context) {
+            ttstr name = context->GetShortDescriptionWithClassName() +
+                TJS_W(" ") +
+                context->GetBlock()->GetLineDescriptionString(
+                    context->CodePosToSrcPos(0));
+            // ';' separates frames in folded stacks
+            tjs_char *p = name.Independ();
+            for(; *p; p++)
+                if(*p == TJS_W(';'))
+                    *p = TJS_W(',');
+            return name;
+        }
+
+    public:
+        void Push(tTJSInterCodeContext *context) {
+            Sample();
+            tjs_int parent = Stack.empty() ? 0 : Stack.back();
+            auto key = std::make_pair(parent, context);
+            auto it = Children.find(key);
+            if(it != Children.end()) {
+                Stack.push_back(it->second);
+                return;
+            }
+            tjs_int node = (tjs_int)Nodes.size();
+            context->AddRef();
+            Nodes.push_back(tNode{ parent, context, GetFrameName(context), 0 });
+            Children.insert(std::make_pair(key, node));
+            Stack.push_back(node);
+        }
+
+        void Pop() {
+            Sample();
+            // the profiler may have been started in the middle of the stack
+            if(!Stack.empty())
+                Stack.pop_back();
+        }
+
+        void Stop() {
+            if(!Timer.joinable())
+                return;
+            Sample();
+            Terminated = true;
+            Timer.join();
+
+            // the names are kept; the contexts are no longer needed
+            Children.clear();
+            Stack.clear();
+            for(auto &node : Nodes)
+                if(node.Context)
+                    node.Context->Release(), node.Context = nullptr;
+        }
+
+    private:
+        void WriteString(tTJSBinaryStream *output, const std::string &str) {
+            output->Write(str.c_str(), (tjs_uint)str.length());
+        }
+
+        void GetPath(tjs_int node, std::vector<tjs_int> &path) const {
+            path.clear();
+            for(; node > 0; node = Nodes[node].Parent)
+                path.push_back(node);
+            std::reverse(path.begin(), path.end());
+        }
+
+        static std::string EscapeJSON(const std::string &str) {
+            std::string ret;
+            for(char c : str) {
+                if(c == '"' || c == '\\') {
+                    ret += '\\';
+                    ret += c;
+                } else if((unsigned char)c < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    ret += buf;
+                } else {
+                    ret += c;
+                }
+            }
+            return ret;
+        }
+
+    public:
+        void WriteFoldedStacks(tTJSBinaryStream *output) {
+            std::vector<tjs_int> path;
+            for(tjs_int i = 1; i < (tjs_int)Nodes.size(); i++) {
+                if(!Nodes[i].Samples)
+                    continue;
+                GetPath(i, path);
+                std::string line;
+                for(tjs_int node : path) {
+                    if(!line.empty())
+                        line += ';';
+                    line += Nodes[node].Name.AsStdString();
+                }
+                line += ' ';
+                line += std::to_string(Nodes[i].Samples);
+                line += '\n';
+                WriteString(output, line);
+            }
+        }
+
+        void WriteChromeTrace(tTJSBinaryStream *output) {
+            // consecutive records are merged into "complete" events of each
+            // frame; a frame stays open while the following records share it
+            struct tOpen {
+                tjs_int Node;
+                tjs_uint64 Begin;
+            };
+            std::vector<tOpen> open;
+            std::vector<tjs_int> path;
+            tjs_uint64 last = 0;
+            bool first = true;
+
+            WriteString(output, "{\"traceEvents\":[\n");
+
+            auto close = [&](size_t depth) {
+                while(open.size() > depth) {
+                    const tOpen &o = open.back();
+                    std::string ev = first ? "" : ",\n";
+                    first = false;
+                    ev += "{\"name\":\"" +
+                        EscapeJSON(Nodes[o.Node].Name.AsStdString()) +
+                        "\",\"cat\":\"tjs\",\"ph\":\"X\",\"ts\":" +
+                        std::to_string(o.Begin * Interval) +
+                        ",\"dur\":" +
+                        std::to_string((last - o.Begin) * Interval) +
+                        ",\"pid\":1,\"tid\":1}";
+                    WriteString(output, ev);
+                    open.pop_back();
+                }
+            };
+
+            for(const tRecord &rec : Records) {
+                if(rec.Begin != last)
+                    close(0); // nothing was running in between
+                GetPath(rec.Node, path);
+                size_t common = 0;
+                while(common < open.size() && common < path.size() &&
+                      open[common].Node == path[common])
+                    common++;
+                close(common);
+                for(size_t i = common; i < path.size(); i++)
+                    open.push_back(tOpen{ path[i], rec.Begin });
+                last = rec.End;
+            }
+            close(0);
+
+            WriteString(output, "\n],\"displayTimeUnit\":\"ms\"}\n");
+        }
+    };
+
+    //---------------------------------------------------------------------------
+    void TJSStartProfiler(tjs_int interval) {
+        if(TJSProfiler)
+            delete TJSProfiler;
+        if(TJSLastProfile)
+            delete TJSLastProfile, TJSLastProfile = nullptr;
+        TJSProfiler = new tTJSProfiler(interval);
+    }
+
+    //---------------------------------------------------------------------------
+    void TJSStopProfiler() {
+        if(!TJSProfiler)
+            return;
+        TJSProfiler->Stop();
+        TJSLastProfile = TJSProfiler;
+        TJSProfiler = nullptr;
+    }
+
+    //---------------------------------------------------------------------------
+    void TJSProfilerPush(tTJSInterCodeContext *context) {
+        if(TJSProfiler)
+            TJSProfiler->Push(context);
+    }
+
+    //---------------------------------------------------------------------------
+    void TJSProfilerPop() {
+        if(TJSProfiler)
+            TJSProfiler->Pop();
+    }
+
+    //---------------------------------------------------------------------------
+    void TJSWriteProfileFoldedStacks(tTJSBinaryStream *output) {
+        if(TJSLastProfile)
+            TJSLastProfile->WriteFoldedStacks(output);
+    }
+
+    //---------------------------------------------------------------------------
+    void TJSWriteProfileChromeTrace(tTJSBinaryStream *output) {
+        if(TJSLastProfile)
+            TJSLastProfile->WriteChromeTrace(output);
+    }
+
 } // namespace TJS
@@ -152,6 +152,35 @@ namespace TJS {
     static inline bool TJSStackTracerEnabled() { return 0 != TJSStackTracer; }
     //---------------------------------------------------------------------------
 
+    //---------------------------------------------------------------------------
+    // Profiler : sampling profiler of script functions
+    //---------------------------------------------------------------------------
+    class tTJSProfiler;
+
+    extern tTJSProfiler *TJSProfiler;
+
+    // starts sampling every "interval" microseconds; the samples of the
+    // previous run are discarded
+    extern void TJSStartProfiler(tjs_int interval = 1000);
+
+    // stops sampling; the samples are kept to be written
+    extern void TJSStopProfiler();
+
+    extern void TJSProfilerPush(tTJSInterCodeContext *context);
+
+    extern void TJSProfilerPop();
+
+    // writes the samples as folded stacks ( "a;b;c count" lines, as taken
+    // by flamegraph.pl and speedscope )
+    extern void TJSWriteProfileFoldedStacks(tTJSBinaryStream *output);
+
+    // writes the samples as Chrome trace event JSON ( chrome://tracing,
+    // Perfetto )
+    extern void TJSWriteProfileChromeTrace(tTJSBinaryStream *output);
+
+    static inline bool TJSProfilerEnabled() { return 0 != TJSProfiler; }
+    //---------------------------------------------------------------------------
+
 } // namespace TJS
 
 #endif
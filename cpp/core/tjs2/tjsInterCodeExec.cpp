@@ -23,6 +23,7 @@
 #include "tjsOctPack.h"
 #include "tjsGlobalStringMap.h"
 #include <csignal>
+#include <typeinfo>
 #include <set>
 #include <mutex>
 
@@ -42,6 +43,12 @@ namespace TJS {
     //---------------------------------------------------------------------------
     static void ThrowInvalidVMCode() { TJS_eTJSError(TJSInvalidOpecode); }
 
+    //---------------------------------------------------------------------------
+    static const tjs_char *GetMemberName(const tTJSVariantString *str) {
+        // an empty string (nullptr) gives nullptr, the default member
+        return str ? str->operator const tjs_char *() : nullptr;
+    }
+
     //---------------------------------------------------------------------------
     static void GetStringProperty(tTJSVariant *result, const tTJSVariant *str,
                                   const tTJSVariant &member) {
@@ -54,19 +61,13 @@ namespace TJS {
             if(!TJS_strcmp(name, TJS_W("length"))) {
                 // get string length
                 const tTJSVariantString *s = str->AsStringNoAddRef();
-#ifdef __CODEGUARD__
-                if(!s)
-                    *result = tTVInteger(0); // tTJSVariantString::GetLength can
-                                             // return zero if 'this' is nullptr
-                else
-#endif
-                    *result = tTVInteger(s->GetLength());
+                *result = tTVInteger(s ? s->GetLength() : 0); // nullptr for ""
                 return;
             } else if(name[0] >= TJS_W('0') && name[0] <= TJS_W('9')) {
                 const tTJSVariantString *valstr = str->AsStringNoAddRef();
                 const tjs_char *s = str->GetString();
                 tjs_int n = TJS_atoi(name);
-                tjs_int len = valstr->GetLength();
+                tjs_int len = valstr ? valstr->GetLength() : 0;
                 if(n == len) {
                     *result = tTJSVariant(TJS_W(""));
                     return;
@@ -87,7 +88,7 @@ namespace TJS {
             const tTJSVariantString *valstr = str->AsStringNoAddRef();
             const tjs_char *s = str->GetString();
             tjs_int n = (tjs_int)member.AsInteger();
-            tjs_int len = valstr->GetLength();
+            tjs_int len = valstr ? valstr->GetLength() : 0;
             if(n == len) {
                 *result = tTJSVariant(TJS_W(""));
                 return;
@@ -226,6 +227,9 @@ namespace TJS {
                 dsp2->AddRef();
         }
 
+        iTJSDispatch2 *GetDispatch1() const { return Dispatch1; }
+        iTJSDispatch2 *GetDispatch2() const { return Dispatch2; }
+
     private:
         iTJSDispatch2 *Dispatch1;
         iTJSDispatch2 *Dispatch2;
@@ -482,11 +486,46 @@ namespace TJS {
 #undef OBJ1
 #undef OBJ2
 
+    //---------------------------------------------------------------------------
+    // member access through the inline cache
+    //---------------------------------------------------------------------------
+    template <typename tCached, typename tUncached>
+    static tjs_error TJSAccessMemberCached(iTJSDispatch2 *dsp,
+                                           iTJSDispatch2 *objthis,
+                                           const tCached &cached,
+                                           const tUncached &uncached) {
+        // cached(obj, objthis) accesses a tTJSCustomObject through the
+        // cache, uncached(dsp, objthis) accesses any other object.
+        // the objthis-proxy is opened here so that the members of "this"
+        // and the globals referred in a method are also cached.
+        tTJSCustomObject *obj = tTJSCustomObject::GetInlineCacheTarget(dsp);
+        if(obj)
+            return cached(obj, objthis ? objthis : obj);
+
+        if(dsp && typeid(*dsp) == typeid(tTJSObjectProxy)) {
+            tTJSObjectProxy *proxy = static_cast<tTJSObjectProxy *>(dsp);
+            iTJSDispatch2 *dsp1 = proxy->GetDispatch1();
+            iTJSDispatch2 *dsp2 = proxy->GetDispatch2();
+            tjs_error hr = TJSAccessMemberCached(
+                dsp1, objthis ? objthis : dsp1, cached, uncached);
+            if(hr == TJS_E_MEMBERNOTFOUND && dsp1 != dsp2)
+                return TJSAccessMemberCached(dsp2, objthis ? objthis : dsp2,
+                                             cached, uncached);
+            return hr;
+        }
+
+        return uncached(dsp, objthis);
+    }
+    //---------------------------------------------------------------------------
+
 //---------------------------------------------------------------------------
 // tTJSVariantArrayStack
 //---------------------------------------------------------------------------
-// TODO: adjust TJS_VA_ONE_ALLOC_MIN
-#define TJS_VA_ONE_ALLOC_MAX 1024
+// a block holds TJS_VA_ONE_ALLOC_MIN variants at first; each further block
+// doubles the last one up to TJS_VA_ONE_ALLOC_MAX, so deep recursion runs
+// on a few large blocks. larger frames get a block of their own size.
+#define TJS_VA_ONE_ALLOC_MIN 1024
+#define TJS_VA_ONE_ALLOC_MAX 65536
 #define TJS_COMPACT_FREQ 10000
     static tjs_int TJSCompactVariantArrayMagic = 0;
     static std::mutex TJSVariantArrayStackMutex;
@@ -494,7 +533,7 @@ namespace TJS {
 
     //---------------------------------------------------------------------------
     tTJSVariantArrayStack::tTJSVariantArrayStack() {
-        NumArraysAllocated = NumArraysUsing = 0;
+        NumArraysCapacity = NumArraysAllocated = NumArraysUsing = 0;
         Arrays = nullptr;
         Current = nullptr;
         OperationDisabledCount = 0;
@@ -517,19 +556,42 @@ namespace TJS {
 
     //---------------------------------------------------------------------------
     void tTJSVariantArrayStack::IncreaseVariantArray(tjs_int num) {
-        // increase array block
-        NumArraysUsing++;
-        if(NumArraysUsing > NumArraysAllocated) {
-            Arrays = (tVariantArray *)TJS_realloc(
-                Arrays, sizeof(tVariantArray) * (NumArraysUsing));
-            NumArraysAllocated = NumArraysUsing;
-            Current = Arrays + NumArraysUsing - 1;
-            Current->Array = new tTJSVariant[num];
-        } else {
-            Current = Arrays + NumArraysUsing - 1;
+        // increase array block; the new block holds at least num variants
+        if(NumArraysUsing == NumArraysAllocated) {
+            if(NumArraysAllocated == NumArraysCapacity) {
+                tjs_int capa = NumArraysCapacity ? NumArraysCapacity * 2 : 4;
+                tVariantArray *arrays = (tVariantArray *)TJS_realloc(
+                    Arrays, sizeof(tVariantArray) * capa);
+                if(!arrays)
+                    TJS_eTJSError(TJSInternalError);
+                Arrays = arrays;
+                NumArraysCapacity = capa;
+            }
+
+            tjs_int size = TJS_VA_ONE_ALLOC_MIN;
+            if(NumArraysAllocated) {
+                size = Arrays[NumArraysAllocated - 1].Allocated * 2;
+                if(size > TJS_VA_ONE_ALLOC_MAX)
+                    size = TJS_VA_ONE_ALLOC_MAX;
+            }
+            if(size < num)
+                size = num;
+
+            tVariantArray *block = Arrays + NumArraysAllocated;
+            block->Array = new tTJSVariant[size];
+            block->Allocated = size;
+            NumArraysAllocated++;
+        } else if(Arrays[NumArraysUsing].Allocated < num) {
+            // reuse the block, but it is too small for this frame
+            tVariantArray *block = Arrays + NumArraysUsing;
+            tTJSVariant *array = new tTJSVariant[num];
+            delete[] block->Array;
+            block->Array = array;
+            block->Allocated = num;
         }
 
-        Current->Allocated = num;
+        NumArraysUsing++;
+        Current = Arrays + NumArraysUsing - 1;
         Current->Using = 0;
     }
 
@@ -562,27 +624,19 @@ namespace TJS {
                 if(Arrays)
                     TJS_free(Arrays), Arrays = nullptr;
                 Current = nullptr;
+                NumArraysCapacity = 0;
             } else {
-                bool availableoffset = false;
-                size_t offset = 0;
-                if(Current != nullptr && Arrays != nullptr) {
-                    offset = (size_t)Current - (size_t)Arrays;
-                    availableoffset = true;
-                }
-
                 tVariantArray *arraytmp = (tVariantArray *)TJS_realloc(
                     Arrays, sizeof(tVariantArray) * (NumArraysUsing));
                 if(arraytmp != nullptr) {
                     Arrays = arraytmp;
-                } else if(NumArraysUsing > 0) {
+                    NumArraysCapacity = NumArraysUsing;
+                } else {
                     TJS_eTJSError(TJSInternalError);
                 }
 
-                if(availableoffset && Arrays != nullptr) {
-                    Current = Arrays + offset;
-                } else {
-                    Current = nullptr;
-                }
+                // the current block is always the last one in use
+                Current = Arrays + NumArraysUsing - 1;
             }
         } catch(...) {
             OperationDisabledCount--;
@@ -595,9 +649,9 @@ namespace TJS {
     inline tTJSVariant *tTJSVariantArrayStack::Allocate(tjs_int num) {
         //		tTJSCSH csh(CS);
 
-        if(!OperationDisabledCount && num < TJS_VA_ONE_ALLOC_MAX) {
+        if(!OperationDisabledCount) {
             if(!Current || Current->Using + num > Current->Allocated) {
-                IncreaseVariantArray(TJS_VA_ONE_ALLOC_MAX);
+                IncreaseVariantArray(num);
             }
             tTJSVariant *ret = Current->Array + Current->Using;
             Current->Using += num;
@@ -612,7 +666,7 @@ namespace TJS {
                                                   tTJSVariant *ptr) {
         //		tTJSCSH csh(CS);
 
-        if(!OperationDisabledCount && num < TJS_VA_ONE_ALLOC_MAX) {
+        if(!OperationDisabledCount) {
             Current->Using -= num;
             if(Current->Using == 0) {
                 DecreaseVariantArray();
@@ -708,6 +762,8 @@ namespace TJS {
             */
             if(TJSStackTracerEnabled())
                 TJSStackTracerPush(this, false);
+            if(TJSProfilerEnabled())
+                TJSProfilerPush(this);
 
             // check whether the objthis is deleting
             if(TJSWarnOnExecutionOnDeletingObject && TJSObjectFlagEnabled() &&
@@ -777,6 +833,8 @@ namespace TJS {
                 TJSVariantArrayStack->Deallocate(num_alloc, regs);
                 if(TJSStackTracerEnabled())
                     TJSStackTracerPop();
+                if(TJSProfilerEnabled())
+                    TJSProfilerPop();
                 throw;
             }
 
@@ -796,6 +854,8 @@ namespace TJS {
 
             if(TJSStackTracerEnabled())
                 TJSStackTracerPop();
+            if(TJSProfilerEnabled())
+                TJSProfilerPop();
         } catch(...) {
             //		if(objthis) objthis->Release();
             //		Release();
@@ -879,6 +939,112 @@ namespace TJS {
         TJS_eTJSScriptException(msg, this, srcpos, val);
     }
 
+    //---------------------------------------------------------------------------
+    // VM dispatch
+    //---------------------------------------------------------------------------
+    // on GCC/Clang, ExecuteCode jumps from one operation handler directly to
+    // the next one through label addresses (computed goto) instead of going
+    // back to a single switch. define TJS_NO_VM_COMPUTED_GOTO to use the
+    // portable switch.
+#if !defined(TJS_NO_VM_COMPUTED_GOTO) &&                                       \
+    (defined(__GNUC__) || defined(__clang__))
+#define TJS_VM_COMPUTED_GOTO
+#endif
+
+#ifdef TJS_VM_COMPUTED_GOTO
+#define TJS_VM_OP(op)                                                          \
+    L_##op:                                                                    \
+    case op
+#define TJS_VM_NEXT()                                                          \
+    codesave = code;                                                           \
+    goto *decoded[code - codearea]
+#else
+#define TJS_VM_OP(op) case op
+#define TJS_VM_NEXT() break
+#endif
+
+    //---------------------------------------------------------------------------
+    // superinstructions
+    //---------------------------------------------------------------------------
+    // frequent pairs of instructions are dispatched through one handler which
+    // executes both of them. they exist only in DecodedCode; CodeArea and the
+    // bytecode keep the two original instructions, and the second one keeps
+    // its own handler so that jumps into it still work.
+    enum tTJSVMFusedCode {
+        fvCEQ_JF, fvCEQ_JNF, fvCDEQ_JF, fvCDEQ_JNF,
+        fvCLT_JF, fvCLT_JNF, fvCGT_JF, fvCGT_JNF,
+        fvTT_JF, fvTT_JNF, fvTF_JF, fvTF_JNF,
+        fvCONST_ADD, fvCONST_SUB,
+        fvINC_JMP, fvDEC_JMP,
+        __fvLAST
+    };
+
+    //---------------------------------------------------------------------------
+    static tjs_int TJSGetVMFusedCode(const tjs_int32 *first,
+                                     const tjs_int32 *second) {
+        // returns the superinstruction executing "first" then "second", or -1
+        tjs_int32 op = second[0];
+        switch(first[0]) {
+            case VM_CEQ:
+            case VM_CDEQ:
+            case VM_CLT:
+            case VM_CGT:
+                if(op != VM_JF && op != VM_JNF)
+                    return -1;
+                return fvCEQ_JF + (first[0] - VM_CEQ) * 2 +
+                    (op == VM_JNF ? 1 : 0);
+            case VM_TT:
+            case VM_TF:
+                if(op != VM_JF && op != VM_JNF)
+                    return -1;
+                return fvTT_JF + (first[0] - VM_TT) * 2 +
+                    (op == VM_JNF ? 1 : 0);
+            case VM_CONST:
+                // as generated for "x += 1", "x - 1" and so on
+                if(op == VM_ADD)
+                    return fvCONST_ADD;
+                if(op == VM_SUB)
+                    return fvCONST_SUB;
+                return -1;
+            case VM_INC:
+                return op == VM_JMP ? fvINC_JMP : -1;
+            case VM_DEC:
+                return op == VM_JMP ? fvDEC_JMP : -1;
+        }
+        return -1;
+    }
+
+    //---------------------------------------------------------------------------
+    void tTJSInterCodeContext::PredecodeCode(const void *const *handlers,
+                                             const void *const *fused,
+                                             const void *invalid) {
+        // build DecodedCode; the handler address of each instruction is
+        // placed at the instruction's position in CodeArea, so that code
+        // offsets (jumps, exception positions, the debugger) and operands
+        // stay exactly as they are in CodeArea.
+        void **decoded = new void *[CodeAreaSize + 1];
+        for(tjs_int i = 0; i <= CodeAreaSize; i++)
+            decoded[i] = const_cast<void *>(invalid);
+
+        tjs_int i = 0;
+        while(i < CodeAreaSize) {
+            tjs_int size = TJSGetVMCodeSize(CodeArea + i);
+            if(size == 0)
+                break; // ExecuteCode throws if it ever reaches here
+            decoded[i] = const_cast<void *>(handlers[CodeArea[i]]);
+            if(i + size < CodeAreaSize &&
+               TJSGetVMCodeSize(CodeArea + i + size) != 0) {
+                tjs_int f =
+                    TJSGetVMFusedCode(CodeArea + i, CodeArea + i + size);
+                if(f >= 0)
+                    decoded[i] = const_cast<void *>(fused[f]);
+            }
+            i += size;
+        }
+
+        DecodedCode = decoded;
+    }
+
     //---------------------------------------------------------------------------
     tjs_int tTJSInterCodeContext::ExecuteCode(tTJSVariant *ra_org,
                                               tjs_int startip,
@@ -901,164 +1067,223 @@ namespace TJS {
 #ifdef _DEBUG
             tjs_int cur_line_no = -1;
 #endif // _DEBUG
+
+#ifdef TJS_VM_COMPUTED_GOTO
+#define TJS_VM_LABEL4(op) &&L_##op, &&L_##op##PD, &&L_##op##PI, &&L_##op##P
+            // in the order of tTJSVMCodes
+            static const void *const handlers[] = {
+                &&L_VM_NOP,       &&L_VM_CONST,     &&L_VM_CP,
+                &&L_VM_CL,        &&L_VM_CCL,       &&L_VM_TT,
+                &&L_VM_TF,        &&L_VM_CEQ,       &&L_VM_CDEQ,
+                &&L_VM_CLT,       &&L_VM_CGT,       &&L_VM_SETF,
+                &&L_VM_SETNF,     &&L_VM_LNOT,      &&L_VM_NF,
+                &&L_VM_JF,        &&L_VM_JNF,       &&L_VM_JMP,
+                TJS_VM_LABEL4(VM_INC),              TJS_VM_LABEL4(VM_DEC),
+                TJS_VM_LABEL4(VM_LOR),              TJS_VM_LABEL4(VM_LAND),
+                TJS_VM_LABEL4(VM_BOR),              TJS_VM_LABEL4(VM_BXOR),
+                TJS_VM_LABEL4(VM_BAND),             TJS_VM_LABEL4(VM_SAR),
+                TJS_VM_LABEL4(VM_SAL),              TJS_VM_LABEL4(VM_SR),
+                TJS_VM_LABEL4(VM_ADD),              TJS_VM_LABEL4(VM_SUB),
+                TJS_VM_LABEL4(VM_MOD),              TJS_VM_LABEL4(VM_DIV),
+                TJS_VM_LABEL4(VM_IDIV),             TJS_VM_LABEL4(VM_MUL),
+                &&L_VM_BNOT,      &&L_VM_TYPEOF,    &&L_VM_TYPEOFD,
+                &&L_VM_TYPEOFI,   &&L_VM_EVAL,      &&L_VM_EEXP,
+                &&L_VM_CHKINS,    &&L_VM_ASC,       &&L_VM_CHR,
+                &&L_VM_NUM,       &&L_VM_CHS,       &&L_VM_INV,
+                &&L_VM_CHKINV,    &&L_VM_INT,       &&L_VM_REAL,
+                &&L_VM_STR,       &&L_VM_OCTET,     &&L_VM_CALL,
+                &&L_VM_CALLD,     &&L_VM_CALLI,     &&L_VM_NEW,
+                &&L_VM_GPD,       &&L_VM_SPD,       &&L_VM_SPDE,
+                &&L_VM_SPDEH,     &&L_VM_GPI,       &&L_VM_SPI,
+                &&L_VM_SPIE,      &&L_VM_GPDS,      &&L_VM_SPDS,
+                &&L_VM_GPIS,      &&L_VM_SPIS,      &&L_VM_SETP,
+                &&L_VM_GETP,      &&L_VM_DELD,      &&L_VM_DELI,
+                &&L_VM_SRV,       &&L_VM_RET,       &&L_VM_ENTRY,
+                &&L_VM_EXTRY,     &&L_VM_THROW,     &&L_VM_CHGTHIS,
+                &&L_VM_GLOBAL,    &&L_VM_ADDCI,     &&L_VM_REGMEMBER,
+                &&L_VM_DEBUGGER
+            };
+#undef TJS_VM_LABEL4
+            static_assert(sizeof(handlers) / sizeof(handlers[0]) == __VM_LAST,
+                          "handlers must cover every VM code");
+
+            // in the order of tTJSVMFusedCode
+            static const void *const fused[] = {
+                &&L_FV_CEQ_JF,    &&L_FV_CEQ_JNF,   &&L_FV_CDEQ_JF,
+                &&L_FV_CDEQ_JNF,  &&L_FV_CLT_JF,    &&L_FV_CLT_JNF,
+                &&L_FV_CGT_JF,    &&L_FV_CGT_JNF,   &&L_FV_TT_JF,
+                &&L_FV_TT_JNF,    &&L_FV_TF_JF,     &&L_FV_TF_JNF,
+                &&L_FV_CONST_ADD, &&L_FV_CONST_SUB, &&L_FV_INC_JMP,
+                &&L_FV_DEC_JMP
+            };
+            static_assert(sizeof(fused) / sizeof(fused[0]) == __fvLAST,
+                          "fused must cover every superinstruction");
+
+            if(!DecodedCode)
+                PredecodeCode(handlers, fused, &&L_VM_INVALID);
+            tjs_int32 *const codearea = CodeArea;
+            void *const *const decoded = DecodedCode;
+            TJS_VM_NEXT();
+#endif
+
             while(true) {
                 codesave = code;
                 switch(*code) {
-                    case VM_NOP:
+                    TJS_VM_OP(VM_NOP):
                         code++;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_CONST:
+                    TJS_VM_OP(VM_CONST):
                         TJS_GET_VM_REG(ra, code[1])
                             .CopyRef(TJS_GET_VM_REG(da, code[2]));
                         code += 3;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_CP:
+                    TJS_VM_OP(VM_CP):
                         TJS_GET_VM_REG(ra, code[1])
                             .CopyRef(TJS_GET_VM_REG(ra, code[2]));
                         code += 3;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_CL:
+                    TJS_VM_OP(VM_CL):
                         TJS_GET_VM_REG(ra, code[1]).Clear();
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_CCL:
+                    TJS_VM_OP(VM_CCL):
                         ContinuousClear(ra, code);
                         code += 3;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_TT:
+                    TJS_VM_OP(VM_TT):
                         flag = TJS_GET_VM_REG(ra, code[1]).operator bool();
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_TF:
+                    TJS_VM_OP(VM_TF):
                         flag = !(TJS_GET_VM_REG(ra, code[1]).operator bool());
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_CEQ:
+                    TJS_VM_OP(VM_CEQ):
                         flag = TJS_GET_VM_REG(ra, code[1])
                                    .NormalCompare(TJS_GET_VM_REG(ra, code[2]));
                         code += 3;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_CDEQ:
+                    TJS_VM_OP(VM_CDEQ):
                         flag = TJS_GET_VM_REG(ra, code[1])
                                    .DiscernCompare(TJS_GET_VM_REG(ra, code[2]));
                         code += 3;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_CLT:
+                    TJS_VM_OP(VM_CLT):
                         flag = TJS_GET_VM_REG(ra, code[1])
                                    .GreaterThan(TJS_GET_VM_REG(ra, code[2]));
                         code += 3;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_CGT:
+                    TJS_VM_OP(VM_CGT):
                         flag = TJS_GET_VM_REG(ra, code[1])
                                    .LittlerThan(TJS_GET_VM_REG(ra, code[2]));
                         code += 3;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_SETF:
+                    TJS_VM_OP(VM_SETF):
                         TJS_GET_VM_REG(ra, code[1]) = flag;
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_SETNF:
+                    TJS_VM_OP(VM_SETNF):
                         TJS_GET_VM_REG(ra, code[1]) = !flag;
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_LNOT:
+                    TJS_VM_OP(VM_LNOT):
                         TJS_GET_VM_REG(ra, code[1]).logicalnot();
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_NF:
+                    TJS_VM_OP(VM_NF):
                         flag = !flag;
                         code++;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_JF:
+                    TJS_VM_OP(VM_JF):
                         if(flag)
                             TJS_ADD_VM_CODE_ADDR(code, code[1]);
                         else
                             code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_JNF:
+                    TJS_VM_OP(VM_JNF):
                         if(!flag)
                             TJS_ADD_VM_CODE_ADDR(code, code[1]);
                         else
                             code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_JMP:
+                    TJS_VM_OP(VM_JMP):
                         TJS_ADD_VM_CODE_ADDR(code, code[1]);
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_INC:
+                    TJS_VM_OP(VM_INC):
                         TJS_GET_VM_REG(ra, code[1]).increment();
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_INCPD:
+                    TJS_VM_OP(VM_INCPD):
                         OperatePropertyDirect0(ra, code, TJS_OP_INC);
                         code += 4;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_INCPI:
+                    TJS_VM_OP(VM_INCPI):
                         OperatePropertyIndirect0(ra, code, TJS_OP_INC);
                         code += 4;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_INCP:
+                    TJS_VM_OP(VM_INCP):
                         OperateProperty0(ra, code, TJS_OP_INC);
                         code += 3;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_DEC:
+                    TJS_VM_OP(VM_DEC):
                         TJS_GET_VM_REG(ra, code[1]).decrement();
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_DECPD:
+                    TJS_VM_OP(VM_DECPD):
                         OperatePropertyDirect0(ra, code, TJS_OP_DEC);
                         code += 4;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_DECPI:
+                    TJS_VM_OP(VM_DECPI):
                         OperatePropertyIndirect0(ra, code, TJS_OP_DEC);
                         code += 4;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_DECP:
+                    TJS_VM_OP(VM_DECP):
                         OperateProperty0(ra, code, TJS_OP_DEC);
                         code += 3;
-                        break;
+                        TJS_VM_NEXT();
 
 #define TJS_DEF_VM_P(vmcode, rope)                                             \
-    case VM_##vmcode:                                                          \
+    TJS_VM_OP(VM_##vmcode):                                                    \
         TJS_GET_VM_REG(ra, code[1]).rope(TJS_GET_VM_REG(ra, code[2]));         \
         code += 3;                                                             \
-        break;                                                                 \
-    case VM_##vmcode##PD:                                                      \
+        TJS_VM_NEXT();                                                         \
+    TJS_VM_OP(VM_##vmcode##PD):                                                \
         OperatePropertyDirect(ra, code, TJS_OP_##vmcode);                      \
         code += 5;                                                             \
-        break;                                                                 \
-    case VM_##vmcode##PI:                                                      \
+        TJS_VM_NEXT();                                                         \
+    TJS_VM_OP(VM_##vmcode##PI):                                                \
         OperatePropertyIndirect(ra, code, TJS_OP_##vmcode);                    \
         code += 5;                                                             \
-        break;                                                                 \
-    case VM_##vmcode##P:                                                       \
+        TJS_VM_NEXT();                                                         \
+    TJS_VM_OP(VM_##vmcode##P):                                                 \
         OperateProperty(ra, code, TJS_OP_##vmcode);                            \
         code += 4;                                                             \
-        break
+        TJS_VM_NEXT()
 
                         TJS_DEF_VM_P(LOR, logicalorequal);
                         TJS_DEF_VM_P(LAND, logicalandequal);
@@ -1077,32 +1302,32 @@ namespace TJS {
 
 #undef TJS_DEF_VM_P
 
-                    case VM_BNOT:
+                    TJS_VM_OP(VM_BNOT):
                         TJS_GET_VM_REG(ra, code[1]).bitnot();
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_ASC:
+                    TJS_VM_OP(VM_ASC):
                         CharacterCodeOf(TJS_GET_VM_REG(ra, code[1]));
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_CHR:
+                    TJS_VM_OP(VM_CHR):
                         CharacterCodeFrom(TJS_GET_VM_REG(ra, code[1]));
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_NUM:
+                    TJS_VM_OP(VM_NUM):
                         TJS_GET_VM_REG(ra, code[1]).tonumber();
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_CHS:
+                    TJS_VM_OP(VM_CHS):
                         TJS_GET_VM_REG(ra, code[1]).changesign();
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_INV:
+                    TJS_VM_OP(VM_INV):
                         TJS_GET_VM_REG(ra, code[1]) =
                             TJS_GET_VM_REG(ra, code[1]).Type() != tvtObject
                             ? false
@@ -1112,9 +1337,9 @@ namespace TJS {
                                                ra[-1].AsObjectNoAddRef()) ==
                                TJS_S_TRUE);
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_CHKINV:
+                    TJS_VM_OP(VM_CHKINV):
                         TJS_GET_VM_REG(ra, code[1]) =
                             TJS_GET_VM_REG(ra, code[1]).Type() != tvtObject
                             ? true
@@ -1124,168 +1349,168 @@ namespace TJS {
                                       .IsValid(0, nullptr, nullptr,
                                                ra[-1].AsObjectNoAddRef()));
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_INT:
+                    TJS_VM_OP(VM_INT):
                         TJS_GET_VM_REG(ra, code[1]).ToInteger();
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_REAL:
+                    TJS_VM_OP(VM_REAL):
                         TJS_GET_VM_REG(ra, code[1]).ToReal();
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_STR:
+                    TJS_VM_OP(VM_STR):
                         TJS_GET_VM_REG(ra, code[1]).ToString();
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_OCTET:
+                    TJS_VM_OP(VM_OCTET):
                         TJS_GET_VM_REG(ra, code[1]).ToOctet();
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_TYPEOF:
+                    TJS_VM_OP(VM_TYPEOF):
                         TypeOf(TJS_GET_VM_REG(ra, code[1]));
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_TYPEOFD:
+                    TJS_VM_OP(VM_TYPEOFD):
                         TypeOfMemberDirect(ra, code, TJS_MEMBERMUSTEXIST);
                         code += 4;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_TYPEOFI:
+                    TJS_VM_OP(VM_TYPEOFI):
                         TypeOfMemberIndirect(ra, code, TJS_MEMBERMUSTEXIST);
                         code += 4;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_EVAL:
+                    TJS_VM_OP(VM_EVAL):
                         Eval(TJS_GET_VM_REG(ra, code[1]),
                              TJSEvalOperatorIsOnGlobal
                                  ? nullptr
                                  : ra[-1].AsObjectNoAddRef(),
                              true);
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_EEXP:
+                    TJS_VM_OP(VM_EEXP):
                         Eval(TJS_GET_VM_REG(ra, code[1]),
                              TJSEvalOperatorIsOnGlobal
                                  ? nullptr
                                  : ra[-1].AsObjectNoAddRef(),
                              false);
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_CHKINS:
+                    TJS_VM_OP(VM_CHKINS):
                         InstanceOf(TJS_GET_VM_REG(ra, code[2]),
                                    TJS_GET_VM_REG(ra, code[1]));
                         code += 3;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_CALL:
-                    case VM_NEW:
+                    TJS_VM_OP(VM_CALL):
+                    TJS_VM_OP(VM_NEW):
                         code += CallFunction(ra, code, args, numargs);
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_CALLD:
+                    TJS_VM_OP(VM_CALLD):
                         code += CallFunctionDirect(ra, code, args, numargs);
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_CALLI:
+                    TJS_VM_OP(VM_CALLI):
                         code += CallFunctionIndirect(ra, code, args, numargs);
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_GPD:
+                    TJS_VM_OP(VM_GPD):
                         GetPropertyDirect(ra, code, 0);
                         code += 4;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_GPDS:
+                    TJS_VM_OP(VM_GPDS):
                         GetPropertyDirect(ra, code, TJS_IGNOREPROP);
                         code += 4;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_SPD:
+                    TJS_VM_OP(VM_SPD):
                         SetPropertyDirect(ra, code, 0);
                         code += 4;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_SPDE:
+                    TJS_VM_OP(VM_SPDE):
                         SetPropertyDirect(ra, code, TJS_MEMBERENSURE);
                         code += 4;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_SPDEH:
+                    TJS_VM_OP(VM_SPDEH):
                         SetPropertyDirect(ra, code,
                                           TJS_MEMBERENSURE | TJS_HIDDENMEMBER);
                         code += 4;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_SPDS:
+                    TJS_VM_OP(VM_SPDS):
                         SetPropertyDirect(ra, code,
                                           TJS_MEMBERENSURE | TJS_IGNOREPROP);
                         code += 4;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_GPI:
+                    TJS_VM_OP(VM_GPI):
                         GetPropertyIndirect(ra, code, 0);
                         code += 4;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_GPIS:
+                    TJS_VM_OP(VM_GPIS):
                         GetPropertyIndirect(ra, code, TJS_IGNOREPROP);
                         code += 4;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_SPI:
+                    TJS_VM_OP(VM_SPI):
                         SetPropertyIndirect(ra, code, 0);
                         code += 4;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_SPIE:
+                    TJS_VM_OP(VM_SPIE):
                         SetPropertyIndirect(ra, code, TJS_MEMBERENSURE);
                         code += 4;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_SPIS:
+                    TJS_VM_OP(VM_SPIS):
                         SetPropertyIndirect(ra, code,
                                             TJS_MEMBERENSURE | TJS_IGNOREPROP);
                         code += 4;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_GETP:
+                    TJS_VM_OP(VM_GETP):
                         GetProperty(ra, code);
                         code += 3;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_SETP:
+                    TJS_VM_OP(VM_SETP):
                         SetProperty(ra, code);
                         code += 3;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_DELD:
+                    TJS_VM_OP(VM_DELD):
                         DeleteMemberDirect(ra, code);
                         code += 4;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_DELI:
+                    TJS_VM_OP(VM_DELI):
                         DeleteMemberIndirect(ra, code);
                         code += 4;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_SRV:
+                    TJS_VM_OP(VM_SRV):
                         if(result)
                             result->CopyRef(TJS_GET_VM_REG(ra, code[1]));
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_RET:
+                    TJS_VM_OP(VM_RET):
                         return (tjs_int)(code + 1 - CodeArea);
 
-                    case VM_ENTRY:
+                    TJS_VM_OP(VM_ENTRY):
                         code = CodeArea +
                             ExecuteCodeInTryBlock(
                                    ra, (tjs_int)(code - CodeArea + 3), args,
@@ -1293,47 +1518,125 @@ namespace TJS {
                                    (tjs_int)(TJS_FROM_VM_CODE_ADDR(code[1]) +
                                              code - CodeArea),
                                    TJS_FROM_VM_REG_ADDR(code[2]));
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_EXTRY:
+                    TJS_VM_OP(VM_EXTRY):
                         return (tjs_int)(code + 1 - CodeArea); // same as ret
 
-                    case VM_THROW:
+                    TJS_VM_OP(VM_THROW):
                         ThrowScriptException(
                             TJS_GET_VM_REG(ra, code[1]), Block,
                             CodePosToSrcPos((tjs_int)(code - CodeArea)));
                         code += 2; // actually here not proceed...
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_CHGTHIS:
+                    TJS_VM_OP(VM_CHGTHIS):
                         TJS_GET_VM_REG(ra, code[1])
                             .ChangeClosureObjThis(
                                 TJS_GET_VM_REG(ra, code[2]).AsObjectNoAddRef());
                         code += 3;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_GLOBAL:
+                    TJS_VM_OP(VM_GLOBAL):
                         TJS_GET_VM_REG(ra, code[1]) =
                             Block->GetTJS()->GetGlobalNoAddRef();
                         code += 2;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_ADDCI:
+                    TJS_VM_OP(VM_ADDCI):
                         AddClassInstanceInfo(ra, code);
                         code += 3;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_REGMEMBER:
+                    TJS_VM_OP(VM_REGMEMBER):
                         RegisterObjectMember(ra[-1].AsObjectNoAddRef());
                         code++;
-                        break;
+                        TJS_VM_NEXT();
 
-                    case VM_DEBUGGER:
+                    TJS_VM_OP(VM_DEBUGGER):
                         TJSNativeDebuggerBreak();
                         code++;
-                        break;
+                        TJS_VM_NEXT();
+
+#ifdef TJS_VM_COMPUTED_GOTO
+                        // superinstructions; "codesave" is moved to the
+                        // second instruction before it runs, so that errors
+                        // report the same position as unfused execution.
+                        // jumps are left to the handlers of VM_JF, VM_JNF
+                        // and VM_JMP.
+#define TJS_DEF_FV_BRANCH(name, test, size)                                    \
+    L_FV_##name##_JF:                                                          \
+        flag = (test);                                                         \
+        code += size;                                                          \
+        goto L_VM_JF;                                                          \
+    L_FV_##name##_JNF:                                                         \
+        flag = (test);                                                         \
+        code += size;                                                          \
+        goto L_VM_JNF
+
+                        TJS_DEF_FV_BRANCH(
+                            CEQ,
+                            TJS_GET_VM_REG(ra, code[1])
+                                .NormalCompare(TJS_GET_VM_REG(ra, code[2])),
+                            3);
+                        TJS_DEF_FV_BRANCH(
+                            CDEQ,
+                            TJS_GET_VM_REG(ra, code[1])
+                                .DiscernCompare(TJS_GET_VM_REG(ra, code[2])),
+                            3);
+                        TJS_DEF_FV_BRANCH(
+                            CLT,
+                            TJS_GET_VM_REG(ra, code[1])
+                                .GreaterThan(TJS_GET_VM_REG(ra, code[2])),
+                            3);
+                        TJS_DEF_FV_BRANCH(
+                            CGT,
+                            TJS_GET_VM_REG(ra, code[1])
+                                .LittlerThan(TJS_GET_VM_REG(ra, code[2])),
+                            3);
+                        TJS_DEF_FV_BRANCH(
+                            TT, TJS_GET_VM_REG(ra, code[1]).operator bool(), 2);
+                        TJS_DEF_FV_BRANCH(
+                            TF, !(TJS_GET_VM_REG(ra, code[1]).operator bool()),
+                            2);
+
+#undef TJS_DEF_FV_BRANCH
+
+                    L_FV_CONST_ADD:
+                        TJS_GET_VM_REG(ra, code[1])
+                            .CopyRef(TJS_GET_VM_REG(da, code[2]));
+                        code += 3;
+                        codesave = code;
+                        TJS_GET_VM_REG(ra, code[1]) +=
+                            TJS_GET_VM_REG(ra, code[2]);
+                        code += 3;
+                        TJS_VM_NEXT();
+
+                    L_FV_CONST_SUB:
+                        TJS_GET_VM_REG(ra, code[1])
+                            .CopyRef(TJS_GET_VM_REG(da, code[2]));
+                        code += 3;
+                        codesave = code;
+                        TJS_GET_VM_REG(ra, code[1]) -=
+                            TJS_GET_VM_REG(ra, code[2]);
+                        code += 3;
+                        TJS_VM_NEXT();
+
+                    L_FV_INC_JMP:
+                        TJS_GET_VM_REG(ra, code[1]).increment();
+                        code += 2;
+                        goto L_VM_JMP;
+
+                    L_FV_DEC_JMP:
+                        TJS_GET_VM_REG(ra, code[1]).decrement();
+                        code += 2;
+                        goto L_VM_JMP;
+#endif
 
                     default:
+#ifdef TJS_VM_COMPUTED_GOTO
+                    L_VM_INVALID:
+#endif
                         ThrowInvalidVMCode();
                 }
             }
@@ -1377,6 +1680,9 @@ namespace TJS {
         return (tjs_int)(codesave - CodeArea);
     }
 
+#undef TJS_VM_NEXT
+#undef TJS_VM_OP
+
     //---------------------------------------------------------------------------
     tjs_int tTJSInterCodeContext::ExecuteCodeInTryBlock(
         tTJSVariant *ra, tjs_int startip, tTJSVariant **args, tjs_int numargs,
@@ -1433,10 +1739,21 @@ namespace TJS {
 
         tjs_error hr;
         tTJSVariantClosure clo = ra_code2->AsObjectClosureNoAddRef();
+        if(!clo.Object)
+            TJSThrowNullAccess();
         tTJSVariant *name = TJS_GET_VM_REG_ADDR(DataArea, code[3]);
-        hr = clo.PropGet(flags, name->GetString(), name->GetHint(),
-                         TJS_GET_VM_REG_ADDR(ra, code[1]),
-                         clo.ObjThis ? clo.ObjThis : ra[-1].AsObjectNoAddRef());
+        tTJSVariant *result = TJS_GET_VM_REG_ADDR(ra, code[1]);
+        hr = TJSAccessMemberCached(
+            clo.Object, clo.ObjThis ? clo.ObjThis : ra[-1].AsObjectNoAddRef(),
+            [&](tTJSCustomObject *obj, iTJSDispatch2 *objthis) {
+                return obj->PropGetCached(GetInlineCache(code[3]), flags,
+                                          name->GetString(), name->GetHint(),
+                                          result, objthis);
+            },
+            [&](iTJSDispatch2 *dsp, iTJSDispatch2 *objthis) {
+                return dsp->PropGet(flags, name->GetString(), name->GetHint(),
+                                    result, objthis ? objthis : dsp);
+            });
         if(TJS_FAILED(hr))
             TJSThrowFrom_tjs_error(
                 hr, TJS_GET_VM_REG(DataArea, code[3]).GetString());
@@ -1463,15 +1780,27 @@ namespace TJS {
 
         tjs_error hr;
         tTJSVariantClosure clo = ra_code1->AsObjectClosureNoAddRef();
+        if(!clo.Object)
+            TJSThrowNullAccess();
         tTJSVariant *name = TJS_GET_VM_REG_ADDR(DataArea, code[2]);
-        hr = clo.PropSetByVS(
-            flags, name->AsStringNoAddRef(), TJS_GET_VM_REG_ADDR(ra, code[3]),
-            clo.ObjThis ? clo.ObjThis : ra[-1].AsObjectNoAddRef());
-        if(hr == TJS_E_NOTIMPL)
-            hr = clo.PropSet(flags, name->GetString(), name->GetHint(),
-                             TJS_GET_VM_REG_ADDR(ra, code[3]),
-                             clo.ObjThis ? clo.ObjThis
-                                         : ra[-1].AsObjectNoAddRef());
+        const tTJSVariant *param = TJS_GET_VM_REG_ADDR(ra, code[3]);
+        hr = TJSAccessMemberCached(
+            clo.Object, clo.ObjThis ? clo.ObjThis : ra[-1].AsObjectNoAddRef(),
+            [&](tTJSCustomObject *obj, iTJSDispatch2 *objthis) {
+                return obj->PropSetByVSCached(GetInlineCache(code[2]), flags,
+                                              name->AsStringNoAddRef(), param,
+                                              objthis);
+            },
+            [&](iTJSDispatch2 *dsp, iTJSDispatch2 *objthis) {
+                if(!objthis)
+                    objthis = dsp;
+                tjs_error hr = dsp->PropSetByVS(
+                    flags, name->AsStringNoAddRef(), param, objthis);
+                if(hr == TJS_E_NOTIMPL)
+                    hr = dsp->PropSet(flags, name->GetString(),
+                                      name->GetHint(), param, objthis);
+                return hr;
+            });
         if(TJS_FAILED(hr))
             TJSThrowFrom_tjs_error(
                 hr, TJS_GET_VM_REG(DataArea, code[2]).GetString());
@@ -1532,10 +1861,11 @@ namespace TJS {
             try {
                 // TODO: verify here needs hint holding
                 hr = clo.PropGet(
-                    flags, *str, nullptr, TJS_GET_VM_REG_ADDR(ra, code[1]),
+                    flags, GetMemberName(str), nullptr,
+                    TJS_GET_VM_REG_ADDR(ra, code[1]),
                     clo.ObjThis ? clo.ObjThis : ra[-1].AsObjectNoAddRef());
                 if(TJS_FAILED(hr))
-                    TJSThrowFrom_tjs_error(hr, *str);
+                    TJSThrowFrom_tjs_error(hr, GetMemberName(str));
             } catch(...) {
                 if(str)
                     str->Release();
@@ -1592,10 +1922,11 @@ namespace TJS {
                     clo.ObjThis ? clo.ObjThis : ra[-1].AsObjectNoAddRef());
                 if(hr == TJS_E_NOTIMPL)
                     hr = clo.PropSet(
-                        flags, *str, nullptr, TJS_GET_VM_REG_ADDR(ra, code[3]),
+                        flags, GetMemberName(str), nullptr,
+                        TJS_GET_VM_REG_ADDR(ra, code[3]),
                         clo.ObjThis ? clo.ObjThis : ra[-1].AsObjectNoAddRef());
                 if(TJS_FAILED(hr))
-                    TJSThrowFrom_tjs_error(hr, *str);
+                    TJSThrowFrom_tjs_error(hr, GetMemberName(str));
             } catch(...) {
                 if(str)
                     str->Release();
@@ -1633,12 +1964,26 @@ namespace TJS {
         tTJSVariantClosure clo = TJS_GET_VM_REG(ra, code[2]).AsObjectClosure();
         tjs_error hr;
         try {
+            if(!clo.Object)
+                TJSThrowNullAccess();
             tTJSVariant *name = TJS_GET_VM_REG_ADDR(DataArea, code[3]);
-            hr = clo.Operation(
-                ope, name->GetString(), name->GetHint(),
-                code[1] ? TJS_GET_VM_REG_ADDR(ra, code[1]) : nullptr,
-                TJS_GET_VM_REG_ADDR(ra, code[4]),
-                clo.ObjThis ? clo.ObjThis : ra[-1].AsObjectNoAddRef());
+            tTJSVariant *result =
+                code[1] ? TJS_GET_VM_REG_ADDR(ra, code[1]) : nullptr;
+            const tTJSVariant *param = TJS_GET_VM_REG_ADDR(ra, code[4]);
+            hr = TJSAccessMemberCached(
+                clo.Object,
+                clo.ObjThis ? clo.ObjThis : ra[-1].AsObjectNoAddRef(),
+                [&](tTJSCustomObject *obj, iTJSDispatch2 *objthis) {
+                    return obj->OperationCached(GetInlineCache(code[3]), ope,
+                                                name->GetString(),
+                                                name->GetHint(), result, param,
+                                                objthis);
+                },
+                [&](iTJSDispatch2 *dsp, iTJSDispatch2 *objthis) {
+                    return dsp->Operation(ope, name->GetString(),
+                                          name->GetHint(), result, param,
+                                          objthis ? objthis : dsp);
+                });
         } catch(...) {
             clo.Release();
             throw;
@@ -1669,12 +2014,12 @@ namespace TJS {
             tjs_error hr;
             try {
                 hr = clo.Operation(
-                    ope, *str, nullptr,
+                    ope, GetMemberName(str), nullptr,
                     code[1] ? TJS_GET_VM_REG_ADDR(ra, code[1]) : nullptr,
                     TJS_GET_VM_REG_ADDR(ra, code[4]),
                     clo.ObjThis ? clo.ObjThis : ra[-1].AsObjectNoAddRef());
                 if(TJS_FAILED(hr))
-                    TJSThrowFrom_tjs_error(hr, *str);
+                    TJSThrowFrom_tjs_error(hr, GetMemberName(str));
             } catch(...) {
                 if(str)
                     str->Release();
@@ -1734,11 +2079,26 @@ namespace TJS {
         tTJSVariantClosure clo = TJS_GET_VM_REG(ra, code[2]).AsObjectClosure();
         tjs_error hr;
         try {
+            if(!clo.Object)
+                TJSThrowNullAccess();
             tTJSVariant *name = TJS_GET_VM_REG_ADDR(DataArea, code[3]);
-            hr = clo.Operation(ope, name->GetString(), name->GetHint(),
-                               code[1] ? TJS_GET_VM_REG_ADDR(ra, code[1])
-                                       : nullptr,
-                               nullptr, ra[-1].AsObjectNoAddRef());
+            tTJSVariant *result =
+                code[1] ? TJS_GET_VM_REG_ADDR(ra, code[1]) : nullptr;
+            // clo.Operation gives clo.ObjThis priority over ra[-1]
+            hr = TJSAccessMemberCached(
+                clo.Object,
+                clo.ObjThis ? clo.ObjThis : ra[-1].AsObjectNoAddRef(),
+                [&](tTJSCustomObject *obj, iTJSDispatch2 *objthis) {
+                    return obj->OperationCached(GetInlineCache(code[3]), ope,
+                                                name->GetString(),
+                                                name->GetHint(), result,
+                                                nullptr, objthis);
+                },
+                [&](iTJSDispatch2 *dsp, iTJSDispatch2 *objthis) {
+                    return dsp->Operation(ope, name->GetString(),
+                                          name->GetHint(), result, nullptr,
+                                          objthis ? objthis : dsp);
+                });
         } catch(...) {
             clo.Release();
             throw;
@@ -1768,12 +2128,12 @@ namespace TJS {
             tjs_error hr;
             try {
                 hr = clo.Operation(
-                    ope, *str, nullptr,
+                    ope, GetMemberName(str), nullptr,
                     code[1] ? TJS_GET_VM_REG_ADDR(ra, code[1]) : nullptr,
                     nullptr,
                     clo.ObjThis ? clo.ObjThis : ra[-1].AsObjectNoAddRef());
                 if(TJS_FAILED(hr))
-                    TJSThrowFrom_tjs_error(hr, *str);
+                    TJSThrowFrom_tjs_error(hr, GetMemberName(str));
             } catch(...) {
                 if(str)
                     str->Release();
@@ -1863,7 +2223,7 @@ namespace TJS {
         tjs_error hr;
 
         try {
-            hr = clo.DeleteMember(0, *str, nullptr,
+            hr = clo.DeleteMember(0, GetMemberName(str), nullptr,
                                   clo.ObjThis ? clo.ObjThis
                                               : ra[-1].AsObjectNoAddRef());
             if(code[1]) {
@@ -1964,7 +2324,8 @@ namespace TJS {
             try {
                 // TODO: verify here needs hint holding
                 hr = clo.PropGet(
-                    flags, *str, nullptr, TJS_GET_VM_REG_ADDR(ra, code[1]),
+                    flags, GetMemberName(str), nullptr,
+                    TJS_GET_VM_REG_ADDR(ra, code[1]),
                     clo.ObjThis ? clo.ObjThis : ra[-1].AsObjectNoAddRef());
                 if(hr == TJS_S_OK) {
                     TypeOf(TJS_GET_VM_REG(ra, code[1]));
@@ -2014,6 +2375,7 @@ namespace TJS {
     tTJSVariant **pass_args;                                                   \
     tTJSVariant *pass_args_p[TJS_PASS_ARGS_PREPARED_ARRAY_COUNT];              \
     tTJSVariant *pass_args_v = nullptr;                                        \
+    tjs_int pass_args_v_count = 0;                                             \
     tjs_int code_size;                                                         \
     bool alloc_args = false;                                                   \
     try {                                                                      \
@@ -2050,7 +2412,10 @@ namespace TJS {
             }                                                                  \
             pass_args_count += args_v_count;                                   \
             /* allocate temporary variant array for Array object */            \
-            pass_args_v = new tTJSVariant[args_v_count];                       \
+            if(args_v_count) {                                                 \
+                pass_args_v = TJSVariantArrayStack->Allocate(args_v_count);    \
+                pass_args_v_count = args_v_count;                              \
+            }                                                                  \
             /* allocate pointer array */                                       \
             if(pass_args_count < TJS_PASS_ARGS_PREPARED_ARRAY_COUNT)           \
                 pass_args = pass_args_p;                                       \
@@ -2104,19 +2469,26 @@ namespace TJS {
                 pass_args[i] = TJS_GET_VM_REG_ADDR(ra, (_code)[1 + i]);        \
         }
 
+// the expanded array elements live in the register arena, above the frame
+// of the caller; they are cleared before the arena space is given back.
+#define TJS_RELEASE_PASS_ARGS_V                                                \
+    if(pass_args_v) {                                                          \
+        for(tjs_int i = 0; i < pass_args_v_count; i++)                         \
+            pass_args_v[i].Clear();                                            \
+        TJSVariantArrayStack->Deallocate(pass_args_v_count, pass_args_v);      \
+    }
+
 #define TJS_END_FUNC_CALL_ARGS                                                 \
     }                                                                          \
     catch(...) {                                                               \
         if(alloc_args)                                                         \
             delete[] pass_args;                                                \
-        if(pass_args_v)                                                        \
-            delete[] pass_args_v;                                              \
+        TJS_RELEASE_PASS_ARGS_V                                                \
         throw;                                                                 \
     }                                                                          \
     if(alloc_args)                                                             \
         delete[] pass_args;                                                    \
-    if(pass_args_v)                                                            \
-        delete[] pass_args_v;
+    TJS_RELEASE_PASS_ARGS_V
 
     //---------------------------------------------------------------------------
     tjs_int tTJSInterCodeContext::CallFunction(tTJSVariant *ra,
@@ -2194,11 +2566,25 @@ namespace TJS {
             tTJSVariantClosure clo =
                 TJS_GET_VM_REG(ra, code[2]).AsObjectClosure();
             try {
-                hr = clo.FuncCall(
-                    0, name->GetString(), name->GetHint(),
-                    code[1] ? TJS_GET_VM_REG_ADDR(ra, code[1]) : nullptr,
-                    pass_args_count, pass_args,
-                    clo.ObjThis ? clo.ObjThis : ra[-1].AsObjectNoAddRef());
+                if(!clo.Object)
+                    TJSThrowNullAccess();
+                tTJSVariant *result =
+                    code[1] ? TJS_GET_VM_REG_ADDR(ra, code[1]) : nullptr;
+                hr = TJSAccessMemberCached(
+                    clo.Object,
+                    clo.ObjThis ? clo.ObjThis : ra[-1].AsObjectNoAddRef(),
+                    [&](tTJSCustomObject *obj, iTJSDispatch2 *objthis) {
+                        return obj->FuncCallCached(
+                            GetInlineCache(code[3]), 0, name->GetString(),
+                            name->GetHint(), result, pass_args_count,
+                            pass_args, objthis);
+                    },
+                    [&](iTJSDispatch2 *dsp, iTJSDispatch2 *objthis) {
+                        return dsp->FuncCall(0, name->GetString(),
+                                             name->GetHint(), result,
+                                             pass_args_count, pass_args,
+                                             objthis ? objthis : dsp);
+                    });
             } catch(...) {
                 clo.Release();
                 throw;
@@ -26,6 +26,10 @@ namespace TJS {
     class tTJSVariantArrayStack {
         //	tTJSCriticalSection CS;
 
+        // register frames are bump-allocated from a stack of variant
+        // blocks. the blocks are constructed once and kept while they are
+        // in use or until Compact(), so a call does not run variant
+        // constructors or destructors for its frame.
         struct tVariantArray {
             tTJSVariant *Array;
             tjs_int Using;
@@ -33,6 +37,7 @@ namespace TJS {
         };
 
         tVariantArray *Arrays; // array of array
+        tjs_int NumArraysCapacity; // size of Arrays
         tjs_int NumArraysAllocated;
         tjs_int NumArraysUsing;
         tVariantArray *Current;
@@ -161,7 +161,7 @@ namespace TJS // following is in the namespace
 
     //---------------------------------------------------------------------------
     // is bytecode export
-    bool tTJSInterCodeContext::IsBytecodeCompile = false;
+    thread_local bool tTJSInterCodeContext::IsBytecodeCompile = false;
 
     //---------------------------------------------------------------------------
     tTJSInterCodeContext::tTJSInterCodeContext(tTJSInterCodeContext *parent,
@@ -187,6 +187,8 @@ namespace TJS // following is in the namespace
         _DataAreaSize = 0;
         DataArea = nullptr;
         DataAreaSize = 0;
+        InlineCaches = nullptr;
+        DecodedCode = nullptr;
 
         FrameBase = 1;
 
@@ -315,6 +317,8 @@ namespace TJS // following is in the namespace
         _DataAreaSize = 0;
         DataArea = data;
         DataAreaSize = dataSize;
+        InlineCaches = nullptr;
+        DecodedCode = nullptr;
 
         // copy
         size_t size = superpointer.size();
@@ -392,6 +396,14 @@ namespace TJS // following is in the namespace
             delete[] DataArea;
             DataArea = nullptr;
         }
+        if(InlineCaches) {
+            delete[] InlineCaches;
+            InlineCaches = nullptr;
+        }
+        if(DecodedCode) {
+            delete[] DecodedCode;
+            DecodedCode = nullptr;
+        }
 
         Block->Remove(this);
 
@@ -700,6 +712,102 @@ namespace TJS // following is in the namespace
         }
     }
 
+    //---------------------------------------------------------------------------
+    tjs_int TJSGetVMCodeSize(const tjs_int32 *code) {
+        tjs_int32 op = *code;
+        if(op >= VM_INC && op <= VM_MULP) {
+            // VM_x, VM_xPD, VM_xPI, VM_xP
+            static const tjs_int incdec[4] = { 2, 4, 4, 3 };
+            static const tjs_int binary[4] = { 3, 5, 5, 4 };
+            tjs_int sub = (op - VM_INC) % 4;
+            return op <= VM_DECP ? incdec[sub] : binary[sub];
+        }
+
+        switch(op) {
+            case VM_NOP:
+            case VM_NF:
+            case VM_RET:
+            case VM_EXTRY:
+            case VM_REGMEMBER:
+            case VM_DEBUGGER:
+                return 1;
+
+            case VM_CL:
+            case VM_TT:
+            case VM_TF:
+            case VM_SETF:
+            case VM_SETNF:
+            case VM_LNOT:
+            case VM_JF:
+            case VM_JNF:
+            case VM_JMP:
+            case VM_BNOT:
+            case VM_TYPEOF:
+            case VM_EVAL:
+            case VM_EEXP:
+            case VM_ASC:
+            case VM_CHR:
+            case VM_NUM:
+            case VM_CHS:
+            case VM_INV:
+            case VM_CHKINV:
+            case VM_INT:
+            case VM_REAL:
+            case VM_STR:
+            case VM_OCTET:
+            case VM_SRV:
+            case VM_THROW:
+            case VM_GLOBAL:
+                return 2;
+
+            case VM_CONST:
+            case VM_CP:
+            case VM_CCL:
+            case VM_CEQ:
+            case VM_CDEQ:
+            case VM_CLT:
+            case VM_CGT:
+            case VM_CHKINS:
+            case VM_SETP:
+            case VM_GETP:
+            case VM_ENTRY:
+            case VM_CHGTHIS:
+            case VM_ADDCI:
+                return 3;
+
+            case VM_TYPEOFD:
+            case VM_TYPEOFI:
+            case VM_GPD:
+            case VM_SPD:
+            case VM_SPDE:
+            case VM_SPDEH:
+            case VM_GPI:
+            case VM_SPI:
+            case VM_SPIE:
+            case VM_GPDS:
+            case VM_SPDS:
+            case VM_GPIS:
+            case VM_SPIS:
+            case VM_DELD:
+            case VM_DELI:
+                return 4;
+
+            case VM_CALL:
+            case VM_CALLD:
+            case VM_CALLI:
+            case VM_NEW: {
+                tjs_int st = (op == VM_CALLD || op == VM_CALLI) ? 5 : 4;
+                tjs_int num = code[st - 1]; // argument count
+                if(num == -1)
+                    return st; // omitted arguments
+                if(num == -2)
+                    return st + 1 + code[st] * 2; // (type, reg) pairs
+                return st + num;
+            }
+        }
+        return 0;
+    }
+
     //---------------------------------------------------------------------------
     void tTJSInterCodeContext::FixCode() {
         // code re-positioning and patch processing
@@ -870,6 +978,9 @@ namespace TJS // following is in the namespace
             CodeArea[*jmp + 1] = jumptarget - *jmp;
         }
 
+        // peephole optimization
+        OptimizeCode();
+
         // convert jump addresses to VM address
         for(std::list<tjs_int>::iterator jmp = JumpList.begin();
             jmp != JumpList.end(); jmp++) {
@@ -880,6 +991,364 @@ namespace TJS // following is in the namespace
         FixList.clear();
     }
 
+    //---------------------------------------------------------------------------
+    // peephole optimizer
+    //---------------------------------------------------------------------------
+    // OptimizeCode rewrites the code once its jumps are fixed, but before the
+    // jump offsets are converted to VM addresses. only existing VM codes are
+    // used, so the result is still exported and loaded as usual bytecode.
+    // instructions to be removed are first overwritten with VM_NOP; the NOPs
+    // are then squeezed out, and the jumps and the source positions are
+    // moved along with the code.
+    //---------------------------------------------------------------------------
+// stands for the condition flag in place of a register
+#define TJS_VM_FLAG_VALUE ((tjs_int32)0x7fffffff)
+
+    enum tTJSValueAccess { vaNone, vaRead, vaWrite };
+
+    static bool TJSIsPureWriteCode(tjs_int32 op) {
+        // operations which overwrite the register at operand 1 without
+        // reading it
+        switch(op) {
+            case VM_CONST:
+            case VM_CP:
+            case VM_CL:
+            case VM_SETF:
+            case VM_SETNF:
+            case VM_GLOBAL:
+                return true;
+        }
+        return false;
+    }
+
+    static bool TJSIsRegisterOperand(tjs_int32 op, tjs_int index) {
+        // false for the operands which are known to hold data addresses or
+        // jump offsets
+        if(op >= VM_INC && op <= VM_MULP && (op - VM_INC) % 4 == 1)
+            return index != 3; // VM_xPD %r, %o.*name...
+        switch(op) {
+            case VM_CONST:
+            case VM_SPD:
+            case VM_SPDE:
+            case VM_SPDEH:
+            case VM_SPDS:
+                return index != 2;
+            case VM_GPD:
+            case VM_GPDS:
+            case VM_DELD:
+            case VM_TYPEOFD:
+            case VM_CALLD:
+                return index != 3;
+            case VM_JF:
+            case VM_JNF:
+            case VM_JMP:
+            case VM_ENTRY:
+                return index != 1;
+        }
+        return true;
+    }
+
+    static tTJSValueAccess TJSGetValueAccess(const tjs_int32 *code,
+                                             tjs_int size, tjs_int32 reg) {
+        // how the instruction treats the register "reg" or the flag. any
+        // other operand equal to the register counts as a read; this is too
+        // strict for operands such as argument counts, but never wrong.
+        tjs_int32 op = code[0];
+        if(reg == TJS_VM_FLAG_VALUE) {
+            switch(op) {
+                case VM_JF:
+                case VM_JNF:
+                case VM_SETF:
+                case VM_SETNF:
+                case VM_NF:
+                    return vaRead;
+                case VM_TT:
+                case VM_TF:
+                case VM_CEQ:
+                case VM_CDEQ:
+                case VM_CLT:
+                case VM_CGT:
+                    return vaWrite;
+            }
+            return vaNone;
+        }
+
+        if(op == VM_CCL) {
+            // clears "code[2]" registers from "code[1]"
+            if(reg >= code[1] && reg < code[1] + TJS_TO_VM_REG_ADDR(code[2]))
+                return vaWrite;
+            return vaNone;
+        }
+
+        bool write = TJSIsPureWriteCode(op);
+        for(tjs_int i = write ? 2 : 1; i < size; i++)
+            if(code[i] == reg && TJSIsRegisterOperand(op, i))
+                return vaRead;
+        if(write && code[1] == reg)
+            return vaWrite;
+        return vaNone;
+    }
+
+    //---------------------------------------------------------------------------
+    bool tTJSInterCodeContext::IsValueDeadAt(tjs_int pos, tjs_int32 reg) const {
+        // returns whether the register "reg" (or the flag) is overwritten or
+        // left unread on every path from "pos". paths are followed through
+        // the jumps up to a limited number of instructions; the value is
+        // taken as alive beyond that, and at try blocks.
+        const tjs_int limit = 64;
+        tjs_int pending[limit + 1];
+        tjs_int visited[limit];
+        tjs_int npending = 0, nvisited = 0;
+
+        pending[npending++] = pos;
+        while(npending) {
+            tjs_int p = pending[--npending];
+            while(true) {
+                if(p < 0 || p >= CodeAreaSize)
+                    return false;
+                if(std::find(visited, visited + nvisited, p) !=
+                   visited + nvisited)
+                    break; // already followed
+                if(nvisited == limit)
+                    return false;
+                visited[nvisited++] = p;
+
+                const tjs_int32 *code = CodeArea + p;
+                tjs_int size = TJSGetVMCodeSize(code);
+                if(!size)
+                    return false;
+                tTJSValueAccess access = TJSGetValueAccess(code, size, reg);
+                if(access == vaRead)
+                    return false;
+                if(access == vaWrite)
+                    break;
+
+                tjs_int32 op = code[0];
+                if(op == VM_RET || op == VM_THROW)
+                    break;
+                if(op == VM_ENTRY || op == VM_EXTRY)
+                    return false;
+                if(op == VM_JMP) {
+                    p += code[1];
+                    continue;
+                }
+                if(op == VM_JF || op == VM_JNF) {
+                    if(npending == limit)
+                        return false;
+                    pending[npending++] = p + code[1];
+                }
+                p += size;
+            }
+        }
+        return true;
+    }
+
+    //---------------------------------------------------------------------------
+    void tTJSInterCodeContext::OptimizeCode() {
+        // list the instructions
+        std::vector<tjs_int> insns;
+        for(tjs_int p = 0; p < CodeAreaSize;) {
+            tjs_int size = TJSGetVMCodeSize(CodeArea + p);
+            if(!size)
+                return; // unknown code; leave the code as it is
+            insns.push_back(p);
+            p += size;
+        }
+        if(insns.empty())
+            return;
+
+        // mark the positions which can be reached other than from the
+        // preceding instruction; jump targets, and the instructions after
+        // VM_EXTRY, where a try block returns to.
+        std::vector<bool> target(CodeAreaSize + 1, false);
+        target[0] = true;
+        for(tjs_int jmp : JumpList) {
+            tjs_int jmptarget = jmp + CodeArea[jmp + 1];
+            if(jmptarget < 0 || jmptarget > CodeAreaSize)
+                return;
+            target[jmptarget] = true;
+        }
+        for(tjs_int p : insns)
+            if(CodeArea[p] == VM_EXTRY)
+                target[p + 1] = true;
+
+        bool changed = false, again = false;
+        auto remove = [&](tjs_int p) {
+            // overwrite the instruction with NOPs
+            tjs_int size = TJSGetVMCodeSize(CodeArea + p);
+            if(CodeArea[p] == VM_JF || CodeArea[p] == VM_JNF ||
+               CodeArea[p] == VM_JMP || CodeArea[p] == VM_ENTRY)
+                JumpList.remove(p);
+            for(tjs_int i = 0; i < size; i++)
+                CodeArea[p + i] = VM_NOP;
+            changed = again = true;
+        };
+
+        tjs_int count = (tjs_int)insns.size();
+        do {
+            // removals may make more patterns match; repeat until none
+            again = false;
+            for(tjs_int i = 0; i < count; i++) {
+                tjs_int p = insns[i];
+                tjs_int32 *code = CodeArea + p;
+                tjs_int32 op = code[0];
+                if(op == VM_NOP)
+                    continue;
+
+                // the following instructions, if they are not reachable from
+                // elsewhere
+                tjs_int32 *next = nullptr, *next2 = nullptr;
+                tjs_int np = 0, np2 = 0;
+                if(i + 1 < count && !target[insns[i + 1]]) {
+                    np = insns[i + 1];
+                    next = CodeArea + np;
+                    if(i + 2 < count && !target[insns[i + 2]]) {
+                        np2 = insns[i + 2];
+                        next2 = CodeArea + np2;
+                    }
+                }
+
+                // copy propagation through a temporary register:
+                //   const %t, *d / cp %v, %t  ->  const %v, *d
+                //   cp %t, %s / cp %v, %t     ->  cp %v, %s
+                if((op == VM_CONST || op == VM_CP) && next &&
+                   next[0] == VM_CP && code[1] > 0 && next[2] == code[1] &&
+                   next[1] != code[1] && IsValueDeadAt(np + 3, code[1])) {
+                    if(op == VM_CP && next[1] == code[2]) {
+                        remove(p); // copies the value to itself
+                    } else {
+                        code[1] = next[1];
+                    }
+                    remove(np);
+                    continue;
+                }
+
+                // operation through a temporary register:
+                //   cp %t, %s / op %t, %x / cp %s, %t  ->  op %s, %x
+                // a constant may be loaded into %x in between.
+                if(op == VM_CP && next2 && code[1] > 0 && code[1] != code[2]) {
+                    tjs_int32 t = code[1], src = code[2];
+                    tjs_int k = i + 1;
+                    if(next[0] == VM_CONST && next[1] != t && next[1] != src &&
+                       i + 3 < count && !target[insns[i + 3]])
+                        k++;
+                    tjs_int opp = insns[k], cpp = insns[k + 1];
+                    tjs_int32 *opc = CodeArea + opp, *cpc = CodeArea + cpp;
+                    if(opc[0] >= VM_LOR && opc[0] <= VM_MULP &&
+                       (opc[0] - VM_LOR) % 4 == 0 && opc[1] == t &&
+                       opc[2] != t && opc[2] != src && cpc[0] == VM_CP &&
+                       cpc[1] == src && cpc[2] == t &&
+                       IsValueDeadAt(cpp + 3, t)) {
+                        opc[1] = src;
+                        remove(p);
+                        remove(cpp);
+                        continue;
+                    }
+                }
+
+                // condition on a constant:
+                //   const %t, *d / tt %t / jf L  ->  jmp L, or nothing
+                if(op == VM_CONST && next2 && code[1] > 0 &&
+                   (next[0] == VM_TT || next[0] == VM_TF) &&
+                   next[1] == code[1] &&
+                   (next2[0] == VM_JF || next2[0] == VM_JNF)) {
+                    const tTJSVariant &val =
+                        *_DataArea[TJS_FROM_VM_REG_ADDR(code[2])];
+                    tTJSVariantType type = val.Type();
+                    if((type == tvtVoid || type == tvtInteger ||
+                        type == tvtReal) &&
+                       IsValueDeadAt(np2, code[1]) &&
+                       IsValueDeadAt(np2 + 2, TJS_VM_FLAG_VALUE) &&
+                       IsValueDeadAt(np2 + next2[1], TJS_VM_FLAG_VALUE)) {
+                        bool flag = val.operator bool();
+                        if(next[0] == VM_TF)
+                            flag = !flag;
+                        bool jump = next2[0] == VM_JF ? flag : !flag;
+                        remove(p);
+                        remove(np);
+                        if(jump)
+                            next2[0] = VM_JMP;
+                        else
+                            remove(np2);
+                        continue;
+                    }
+                }
+
+                // jump to the next instruction
+                if(op == VM_JMP || op == VM_JF || op == VM_JNF) {
+                    tjs_int k = i + 1;
+                    while(k < count && insns[k] < p + code[1] &&
+                          CodeArea[insns[k]] == VM_NOP)
+                        k++; // removed instructions
+                    if(code[1] > 0 && k < count && insns[k] == p + code[1]) {
+                        remove(p);
+                        continue;
+                    }
+                }
+
+                // unreachable code after a jump, a return or a throw
+                if(op == VM_JMP || op == VM_RET || op == VM_THROW) {
+                    while(i + 1 < count && !target[insns[i + 1]]) {
+                        i++;
+                        if(CodeArea[insns[i]] != VM_NOP)
+                            remove(insns[i]);
+                    }
+                }
+            }
+        } while(again);
+
+        if(!changed)
+            return;
+
+        // squeeze out the NOPs
+        std::vector<tjs_int> newpos(CodeAreaSize + 1);
+        tjs_int dest = 0;
+        for(tjs_int i = 0; i < count; i++) {
+            tjs_int p = insns[i];
+            tjs_int end = i + 1 < count ? insns[i + 1] : CodeAreaSize;
+            bool removed = CodeArea[p] == VM_NOP;
+            for(tjs_int j = p; j < end; j++)
+                newpos[j] = removed ? dest : dest + (j - p);
+            if(!removed)
+                dest += end - p;
+        }
+        newpos[CodeAreaSize] = dest;
+
+        for(tjs_int &jmp : JumpList) {
+            tjs_int jmptarget = jmp + CodeArea[jmp + 1];
+            CodeArea[jmp + 1] = newpos[jmptarget] - newpos[jmp];
+            jmp = newpos[jmp];
+        }
+
+        // jump operands were fixed at the old positions; move the code now
+        dest = 0;
+        for(tjs_int i = 0; i < count; i++) {
+            tjs_int p = insns[i];
+            tjs_int end = i + 1 < count ? insns[i + 1] : CodeAreaSize;
+            if(CodeArea[p] == VM_NOP)
+                continue;
+            memmove(CodeArea + dest, CodeArea + p,
+                    sizeof(tjs_int32) * (end - p));
+            dest += end - p;
+        }
+        CodeAreaSize = dest;
+
+        // an instruction takes over the source position of the removed ones
+        // before it; the last of the positions moved to the same place is
+        // the one the instruction belongs to.
+        tjs_int n = 0;
+        for(tjs_int i = 0; i < SourcePosArraySize; i++) {
+            tjs_int codepos = newpos[SourcePosArray[i].CodePos];
+            if(n && SourcePosArray[n - 1].CodePos == codepos)
+                n--;
+            SourcePosArray[n].CodePos = codepos;
+            SourcePosArray[n].SourcePos = SourcePosArray[i].SourcePos;
+            n++;
+        }
+        SourcePosArraySize = n;
+    }
+#undef TJS_VM_FLAG_VALUE
+
     //---------------------------------------------------------------------------
     void tTJSInterCodeContext::RegisterFunction() {
         // registration of function to the parent's context
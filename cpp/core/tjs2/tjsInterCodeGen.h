@@ -131,6 +131,10 @@ namespace TJS {
     };
 
 #undef TJS_NORMAL_AND_PROPERTY_ACCESSER
+
+    // returns the number of code words of the instruction at "code", or 0 if
+    // the operation code is unknown
+    extern tjs_int TJSGetVMCodeSize(const tjs_int32 *code);
     //---------------------------------------------------------------------------
     enum tTJSSubType {
         stNone = VM_NOP,
@@ -256,7 +260,7 @@ namespace TJS {
         virtual ~tTJSInterCodeContext();
 
         // is bytecode export
-        static bool IsBytecodeCompile;
+        static thread_local bool IsBytecodeCompile;
 
     protected:
         void Finalize();
@@ -402,6 +406,8 @@ namespace TJS {
         tjs_int32 *CodeArea;
         tjs_int CodeAreaCapa;
         tjs_int CodeAreaSize;
+        void **DecodedCode; // handler address per CodeArea item; built by
+                            // ExecuteCode on computed goto builds
 
         tTJSVariant **_DataArea;
         tjs_int _DataAreaSize;
@@ -409,6 +415,14 @@ namespace TJS {
         tTJSVariant *DataArea;
         tjs_int DataAreaSize;
 
+        tTJSInlineCache *InlineCaches; // per DataArea item; member names
+        tTJSInlineCache *GetInlineCache(tjs_int32 dataaddr) {
+            // dataaddr is a VM register address into DataArea
+            if(!InlineCaches)
+                InlineCaches = new tTJSInlineCache[DataAreaSize]();
+            return InlineCaches + TJS_FROM_VM_REG_ADDR(dataaddr);
+        }
+
         tTJSLocalNamespace Namespace;
 
         std::vector<tTJSExprNode *> NodeToDeleteVector;
@@ -497,6 +511,10 @@ namespace TJS {
 
         void FixCode();
 
+        bool IsValueDeadAt(tjs_int pos, tjs_int32 reg) const;
+
+        void OptimizeCode();
+
         void RegisterFunction();
 
         tjs_int _GenNodeCode(tjs_int &frame, tTJSExprNode *node,
@@ -691,6 +709,8 @@ namespace TJS {
                                       tTJSVariant *result, tjs_int catchip,
                                       tjs_int exobjreg);
 
+        void PredecodeCode(const void *const *handlers,
+                           const void *const *fused, const void *invalid);
         static void ContinuousClear(tTJSVariant *ra, const tjs_int32 *code);
 
         void GetPropertyDirect(tTJSVariant *ra, const tjs_int32 *code,
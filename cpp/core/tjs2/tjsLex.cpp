@@ -19,6 +19,7 @@
 #include "tjsCompileControl.h"
 #include "tjsScriptBlock.h"
 #include "tjsObject.h"
+#include "tjsHashSearch.h"
 
 namespace TJS {
 
@@ -885,15 +886,18 @@ namespace TJS {
     //---------------------------------------------------------------------------
     // hash table for reserved words
     //---------------------------------------------------------------------------
-    static tTJSCustomObject *TJSReservedWordHash = nullptr;
-    static bool TJSReservedWordHashInit = false;
+    // the table is filled when the first tTJS is created, and only read by
+    // the lexers; so lexers on several threads can look it up at once.
+    static tTJSHashTable<ttstr, tjs_int> *TJSReservedWordHash = nullptr;
     static tjs_int TJSReservedWordHashRefCount;
 
+    static void TJSInitReservedWordsHashTable();
+
     //---------------------------------------------------------------------------
     void TJSReservedWordsHashAddRef() {
         if(TJSReservedWordHashRefCount == 0) {
-            TJSReservedWordHashInit = false;
-            TJSReservedWordHash = new tTJSCustomObject();
+            TJSReservedWordHash = new tTJSHashTable<ttstr, tjs_int>();
+            TJSInitReservedWordsHashTable();
         }
         TJSReservedWordHashRefCount++;
     }
@@ -903,7 +907,7 @@ namespace TJS {
         TJSReservedWordHashRefCount--;
 
         if(TJSReservedWordHashRefCount == 0) {
-            TJSReservedWordHash->Release();
+            delete TJSReservedWordHash;
             TJSReservedWordHash = nullptr;
         }
     }
@@ -911,19 +915,13 @@ namespace TJS {
     //---------------------------------------------------------------------------
     static void TJSRegisterReservedWordsHash(const tjs_char *word,
                                              tjs_int num) {
-        tTJSVariant val(num);
-        TJSReservedWordHash->PropSet(TJS_MEMBERENSURE, word, nullptr, &val,
-                                     TJSReservedWordHash);
+        TJSReservedWordHash->Add(ttstr(word), num);
     }
 //---------------------------------------------------------------------------
 #define TJS_REG_RES_WORD(word, value)                                          \
     TJSRegisterReservedWordsHash(TJS_W(word), value)
 
     static void TJSInitReservedWordsHashTable() {
-        if(TJSReservedWordHashInit)
-            return;
-        TJSReservedWordHashInit = true;
-
         TJS_REG_RES_WORD("break", parser::token_kind_type::T_BREAK);
         TJS_REG_RES_WORD("continue", parser::token_kind_type::T_CONTINUE);
         TJS_REG_RES_WORD("const", parser::token_kind_type::T_CONST);
@@ -995,8 +993,6 @@ namespace TJS {
                                              bool exprmode, bool resneeded) {
         // resneeded is valid only if exprmode is true
 
-        TJSInitReservedWordsHashTable();
-
         Block = block;
         ExprMode = exprmode;
         ResultNeeded = resneeded;
@@ -1534,9 +1530,10 @@ namespace TJS {
 
         if(BareWord)
             retnum = -1;
-        else
-            retnum = TJSReservedWordHash->GetValueInteger(str.c_str(),
-                                                          str.GetHint());
+        else {
+            const tjs_int *num = TJSReservedWordHash->Find(str);
+            retnum = num ? *num : -1;
+        }
 
         BareWord = false;
 
@@ -1580,6 +1577,8 @@ namespace TJS {
                                                      tjs_int n) {
         // parses a conditional compile experssion starting with
         // "start", character count "n".
+        if(TJSBackgroundCompiling) // the values belong to the script thread
+            throw eTJSError(ttstr(TJSNotImplemented));
         auto *buf = new tjs_char[n + 1];
         tjs_char *p;
         const tjs_char *lim = start + n;
@@ -17,6 +17,10 @@
 #include "tjsGlobalStringMap.h"
 #include "tjsDebug.h"
 
+#include <algorithm>
+#include <atomic>
+#include <typeinfo>
+
 namespace TJS {
 
     //---------------------------------------------------------------------------
@@ -303,6 +307,230 @@ namespace TJS {
     void TJSDoRehash() { TJSGlobalRebuildHashMagic++; }
     //---------------------------------------------------------------------------
 
+    //---------------------------------------------------------------------------
+    // shape version for inline caches; 0 is never given to any object
+    //---------------------------------------------------------------------------
+    static std::atomic<tjs_uint64> TJSGlobalShapeVersion{ 0 };
+    //---------------------------------------------------------------------------
+
+    //---------------------------------------------------------------------------
+    thread_local bool TJSBackgroundCompiling = false;
+    //---------------------------------------------------------------------------
+
+    //---------------------------------------------------------------------------
+    // tTJSObjectShape
+    //---------------------------------------------------------------------------
+    /*
+            a shape is a node of the transition tree which starts from the
+       empty root shape; each shape adds one member to its parent. the
+       shapes of one chain share a tTJSObjectShapeTable which lists the
+       members in slot order, so a shape's members are the first Count
+       entries of its table. a shape holds its parent, while the parent
+       only refers its children (transitions) weakly; a child removes itself
+       from its parent when it is destroyed.
+    */
+#define TJS_SHAPE_LINEAR_SEARCH_MAX 8
+
+    struct tTJSObjectShapeMember {
+        tTJSVariantString *Name;
+        tjs_uint32 Hash;
+        tjs_uint32 SymFlags;
+
+        bool NameMatch(const tjs_char *name) const {
+            const tjs_char *this_name = (const tjs_char *)(*Name);
+            if(this_name == name)
+                return true;
+            return !TJS_strcmp(name, this_name);
+        }
+    };
+
+    //---------------------------------------------------------------------------
+    class tTJSObjectShapeTable {
+        tjs_int RefCount;
+        std::vector<tTJSObjectShapeMember> Members;
+        std::vector<tjs_int> Index; // slot + 1 ( 0 = empty ); empty while
+                                    // the members are few
+
+    public:
+        tTJSObjectShapeTable() : RefCount(1) {}
+
+        ~tTJSObjectShapeTable() {
+            for(auto &member : Members)
+                member.Name->Release();
+        }
+
+        void AddRef() { RefCount++; }
+
+        void Release() {
+            if(--RefCount == 0)
+                delete this;
+        }
+
+        tjs_int GetCount() const { return (tjs_int)Members.size(); }
+
+        const tTJSObjectShapeMember &GetMember(tjs_int slot) const {
+            return Members[slot];
+        }
+
+        void Append(tTJSVariantString *name, tjs_uint32 hash,
+                    tjs_uint32 symflags) {
+            // name must be AddRef'ed by the caller
+            tTJSObjectShapeMember member;
+            member.Name = name;
+            member.Hash = hash;
+            member.SymFlags = symflags;
+            Members.push_back(member);
+
+            tjs_int count = (tjs_int)Members.size();
+            if(count <= TJS_SHAPE_LINEAR_SEARCH_MAX)
+                return;
+            if((size_t)count * 2 > Index.size()) {
+                // rebuild the index
+                size_t size = 32;
+                while(size < (size_t)count * 4)
+                    size <<= 1;
+                Index.assign(size, 0);
+                for(tjs_int i = 0; i < count; i++)
+                    IndexInsert(i);
+            } else {
+                IndexInsert(count - 1);
+            }
+        }
+
+        tjs_int Find(const tjs_char *name, tjs_uint32 hash,
+                     tjs_int limit) const {
+            // returns the slot of the member within the first "limit"
+            // members, or -1 if not found. names in a table are unique.
+            if(Index.empty()) {
+                for(tjs_int i = 0; i < limit; i++) {
+                    const tTJSObjectShapeMember &member = Members[i];
+                    if(member.Hash == hash && member.NameMatch(name))
+                        return i;
+                }
+                return -1;
+            }
+
+            size_t mask = Index.size() - 1;
+            for(size_t i = hash & mask;; i = (i + 1) & mask) {
+                tjs_int slot = Index[i] - 1;
+                if(slot < 0)
+                    return -1;
+                const tTJSObjectShapeMember &member = Members[slot];
+                if(member.Hash == hash && member.NameMatch(name))
+                    return slot < limit ? slot : -1;
+            }
+        }
+
+    private:
+        void IndexInsert(tjs_int slot) {
+            size_t mask = Index.size() - 1;
+            size_t i = Members[slot].Hash & mask;
+            while(Index[i])
+                i = (i + 1) & mask;
+            Index[i] = slot + 1;
+        }
+    };
+
+    //---------------------------------------------------------------------------
+    class tTJSObjectShape {
+        tjs_int RefCount;
+        tTJSObjectShape *Parent;
+        tTJSObjectShapeTable *Table;
+        tjs_int Count; // number of the members
+        tjs_uint64 Id; // taken from TJSGlobalShapeVersion
+        std::vector<tTJSObjectShape *> Transitions;
+
+        tTJSObjectShape(tTJSObjectShape *parent, tTJSObjectShapeTable *table,
+                        tjs_int count) :
+            RefCount(1), Parent(parent), Table(table), Count(count) {
+            Id = ++TJSGlobalShapeVersion;
+            if(Parent)
+                Parent->AddRef();
+        }
+
+        ~tTJSObjectShape() {
+            if(Parent) {
+                std::vector<tTJSObjectShape *> &trans = Parent->Transitions;
+                trans.erase(std::find(trans.begin(), trans.end(), this));
+                Parent->Release();
+            }
+            Table->Release();
+        }
+
+    public:
+        static tTJSObjectShape *GetRoot() {
+            // the root is never freed
+            static tTJSObjectShape *root =
+                new tTJSObjectShape(nullptr, new tTJSObjectShapeTable(), 0);
+            return root;
+        }
+
+        void AddRef() { RefCount++; }
+
+        void Release() {
+            if(--RefCount == 0)
+                delete this;
+        }
+
+        tjs_int GetCount() const { return Count; }
+
+        tjs_uint64 GetId() const { return Id; }
+
+        const tTJSObjectShapeMember &GetMember(tjs_int slot) const {
+            return Table->GetMember(slot);
+        }
+
+        tjs_int Find(const tjs_char *name, tjs_uint32 hash) const {
+            return Table->Find(name, hash, Count);
+        }
+
+        tTJSObjectShape *GetTransition(const tjs_char *name,
+                                       tTJSVariantString *vsname,
+                                       tjs_uint32 hash, tjs_uint32 symflags) {
+            // returns the AddRef'ed shape which adds the member to this
+            // shape, or nullptr if this shape has too many transitions.
+            // the member must not exist in this shape.
+            for(tTJSObjectShape *shape : Transitions) {
+                const tTJSObjectShapeMember &member =
+                    shape->GetMember(Count);
+                if(member.Hash == hash && member.SymFlags == symflags &&
+                   member.NameMatch(name)) {
+                    shape->AddRef();
+                    return shape;
+                }
+            }
+
+            if(Transitions.size() >= TJS_SHAPE_MAX_TRANSITIONS)
+                return nullptr;
+
+            if(vsname)
+                vsname->AddRef();
+            else
+                vsname = TJSAllocVariantString(name);
+
+            // share the table if this shape is at the end of it
+            tTJSObjectShapeTable *table;
+            if(Table->GetCount() == Count) {
+                table = Table;
+                table->AddRef();
+            } else {
+                table = new tTJSObjectShapeTable();
+                for(tjs_int i = 0; i < Count; i++) {
+                    const tTJSObjectShapeMember &member = GetMember(i);
+                    member.Name->AddRef();
+                    table->Append(member.Name, member.Hash, member.SymFlags);
+                }
+            }
+            table->Append(vsname, hash, symflags);
+
+            tTJSObjectShape *shape =
+                new tTJSObjectShape(this, table, Count + 1);
+            Transitions.push_back(shape);
+            return shape;
+        }
+    };
+    //---------------------------------------------------------------------------
+
     //---------------------------------------------------------------------------
     // tTJSCustomObject
     //---------------------------------------------------------------------------
@@ -330,12 +558,24 @@ namespace TJS {
             TJSAddObjectHashRecord(this);
         Count = 0;
         RebuildHashMagic = TJSGlobalRebuildHashMagic;
+        ShapeVersion = ++TJSGlobalShapeVersion;
+        Shape = nullptr;
+        Slots = nullptr;
+        SlotCapacity = 0;
         if(hashbits > TJSObjectHashBitsLimit)
             hashbits = TJSObjectHashBitsLimit;
-        HashSize = (1 << hashbits);
-        HashMask = HashSize - 1;
-        Symbols = new tTJSSymbolData[HashSize];
-        memset(Symbols, 0, sizeof(tTJSSymbolData) * HashSize);
+        if(hashbits <= TJS_NAMESPACE_DEFAULT_HASH_BITS &&
+           !TJSBackgroundCompiling) {
+            // start in shape mode
+            HashSize = 0;
+            HashMask = 0;
+            Symbols = nullptr;
+        } else {
+            HashSize = (1 << hashbits);
+            HashMask = HashSize - 1;
+            Symbols = new tTJSSymbolData[HashSize];
+            memset(Symbols, 0, sizeof(tTJSSymbolData) * HashSize);
+        }
         IsInvalidated = false;
         IsInvalidating = false;
         CallFinalize = true;
@@ -364,6 +604,9 @@ namespace TJS {
             }
         }
         delete[] Symbols;
+        delete[] Slots;
+        if(Shape)
+            Shape->Release();
         if(TJSObjectHashMapEnabled())
             TJSRemoveObjectHashRecord(this);
     }
@@ -488,9 +731,19 @@ namespace TJS {
         return res;
     }
 
+//---------------------------------------------------------------------------
+#define GetValue(x) (*((tTJSVariant *)(&(x->Value))))
+
+    static inline tTJSCustomObject::tTJSSymbolData *
+    TJSGetSymbolDataOfValue(tTJSVariant *value) {
+        // value must be in the hash table
+        return (tTJSCustomObject::tTJSSymbolData *)((char *)value -
+            offsetof(tTJSCustomObject::tTJSSymbolData, Value));
+    }
+
     //---------------------------------------------------------------------------
-    tTJSCustomObject::tTJSSymbolData *
-    tTJSCustomObject::Add(const tjs_char *name, tjs_uint32 *hint) {
+    tTJSVariant *tTJSCustomObject::Add(const tjs_char *name, tjs_uint32 *hint,
+                                       tjs_uint32 symflags) {
         // add a data element named "name".
         // return existing element if the element named "name" is
         // already alive.
@@ -499,11 +752,10 @@ namespace TJS {
             return nullptr;
         }
 
-        tTJSSymbolData *data;
-        data = Find(name, hint);
-        if(data) {
+        tTJSVariant *value = Find(name, hint);
+        if(value) {
             // the element is already alive
-            return data;
+            return value;
         }
 
         tjs_uint32 hash;
@@ -513,6 +765,14 @@ namespace TJS {
         else
             hash = tTJSHashFunc<tjs_char *>::Make(name);
 
+        if(!Symbols) {
+            value = AddSlot(name, nullptr, hash, symflags);
+            if(value)
+                return value;
+            // now in dictionary mode
+        }
+
+        tTJSSymbolData *data;
         tTJSSymbolData *lv1 = Symbols + (hash & HashMask);
 
         if((lv1->SymFlags & TJS_SYMBOL_USING)) {
@@ -541,23 +801,22 @@ namespace TJS {
 
         Count++;
 
-        return data;
+        return &GetValue(data);
     }
 
     //---------------------------------------------------------------------------
-    tTJSCustomObject::tTJSSymbolData *
-    tTJSCustomObject::Add(tTJSVariantString *name) {
+    tTJSVariant *tTJSCustomObject::Add(tTJSVariantString *name,
+                                       tjs_uint32 symflags) {
         // tTJSVariantString version of above
 
         if(name == nullptr) {
             return nullptr;
         }
 
-        tTJSSymbolData *data;
-        data = Find((const tjs_char *)(*name), name->GetHint());
-        if(data) {
+        tTJSVariant *value = Find((const tjs_char *)(*name), name->GetHint());
+        if(value) {
             // the element is already alive
-            return data;
+            return value;
         }
 
         tjs_uint32 hash;
@@ -567,6 +826,14 @@ namespace TJS {
         else
             hash = tTJSHashFunc<tjs_char *>::Make((const tjs_char *)(*name));
 
+        if(!Symbols) {
+            value = AddSlot((const tjs_char *)(*name), name, hash, symflags);
+            if(value)
+                return value;
+            // now in dictionary mode
+        }
+
+        tTJSSymbolData *data;
         tTJSSymbolData *lv1 = Symbols + (hash & HashMask);
 
         if((lv1->SymFlags & TJS_SYMBOL_USING)) {
@@ -595,7 +862,47 @@ namespace TJS {
 
         Count++;
 
-        return data;
+        return &GetValue(data);
+    }
+
+    //---------------------------------------------------------------------------
+    tTJSVariant *tTJSCustomObject::AddSlot(const tjs_char *name,
+                                           tTJSVariantString *vsname,
+                                           tjs_uint32 hash,
+                                           tjs_uint32 symflags) {
+        // add a member which does not exist yet, in shape mode.
+        if(Count == SlotCapacity) {
+            tjs_int newcapacity = SlotCapacity ? SlotCapacity * 2 : 4;
+            tTJSVariant_S *newslots = new tTJSVariant_S[newcapacity];
+            // values are moved without touching their reference counts
+            if(Count)
+                memcpy(newslots, Slots, sizeof(tTJSVariant_S) * Count);
+            memset(newslots + Count, 0,
+                   sizeof(tTJSVariant_S) * (newcapacity - Count));
+            delete[] Slots;
+            Slots = newslots;
+            SlotCapacity = newcapacity;
+        }
+
+        tTJSObjectShape *shape = nullptr;
+        if(Count < TJS_SHAPE_MAX_MEMBERS) {
+            tTJSObjectShape *current =
+                Shape ? Shape : tTJSObjectShape::GetRoot();
+            shape = current->GetTransition(name, vsname, hash, symflags);
+        }
+
+        if(!shape) {
+            // too many members, or too many objects took different ways
+            // from the current shape; this object does not share the
+            // shape any more.
+            ConvertToDictionary(Count + 1);
+            return nullptr;
+        }
+
+        if(Shape)
+            Shape->Release();
+        Shape = shape;
+        return GetSlot(Count++);
     }
 
     //---------------------------------------------------------------------------
@@ -644,18 +951,12 @@ namespace TJS {
 
         return data;
     }
-//---------------------------------------------------------------------------
-#define GetValue(x) (*((tTJSVariant *)(&(x->Value))))
-
     //---------------------------------------------------------------------------
     void tTJSCustomObject::RebuildHash() { RebuildHash(Count); }
 
     //---------------------------------------------------------------------------
-    void tTJSCustomObject::RebuildHash(tjs_int requestcount) {
-        // rebuild hash table
-        RebuildHashMagic = TJSGlobalRebuildHashMagic;
-
-        // decide new hash table size
+    static tjs_int TJSGetHashBits(tjs_int requestcount) {
+        // decide hash table size for the members
 
         tjs_int r, v = requestcount;
         if(v & 0xffff0000)
@@ -670,7 +971,22 @@ namespace TJS {
         tjs_int newhashbits = r + ((0xffffaa50 >> v) & 0x03) + 2;
         if(newhashbits > TJSObjectHashBitsLimit)
             newhashbits = TJSObjectHashBitsLimit;
-        tjs_int newhashsize = (1 << newhashbits);
+        return newhashbits;
+    }
+
+    //---------------------------------------------------------------------------
+    void tTJSCustomObject::RebuildHash(tjs_int requestcount) {
+        // rebuild hash table
+        RebuildHashMagic = TJSGlobalRebuildHashMagic;
+
+        if(!Symbols) {
+            // shape mode has no hash table
+            if(requestcount > TJS_SHAPE_MAX_MEMBERS)
+                ConvertToDictionary(requestcount);
+            return;
+        }
+
+        tjs_int newhashsize = (1 << TJSGetHashBits(requestcount));
 
         if(newhashsize == HashSize)
             return;
@@ -753,11 +1069,71 @@ namespace TJS {
         HashSize = newhashsize;
         HashMask = newhashmask;
         Count = orgcount;
+        ChangeShape();
+    }
+
+    //---------------------------------------------------------------------------
+    void tTJSCustomObject::ConvertToDictionary(tjs_int requestcount) {
+        // leave shape mode; move the values in the slots to a new hash
+        // table.
+        if(Symbols)
+            return;
+
+        tjs_int newhashsize = (1 << TJSGetHashBits(requestcount));
+        tjs_int newhashmask = newhashsize - 1;
+        tTJSSymbolData *newsymbols = new tTJSSymbolData[newhashsize];
+        memset(newsymbols, 0, sizeof(tTJSSymbolData) * newhashsize);
+
+        try {
+            for(tjs_int i = 0; i < Count; i++) {
+                const tTJSObjectShapeMember &member = Shape->GetMember(i);
+                tTJSSymbolData *data =
+                    AddTo(member.Name, newsymbols, newhashmask);
+                // the value is moved without touching its reference
+                // count
+                memcpy(&data->Value, Slots + i, sizeof(tTJSVariant_S));
+                data->SymFlags |= member.SymFlags;
+            }
+        } catch(...) {
+            // recover; the values are still owned by the slots
+            for(tjs_int i = 0; i < newhashsize; i++) {
+                tTJSSymbolData *lv1 = newsymbols + i;
+                tTJSSymbolData *d = lv1->Next;
+                while(d) {
+                    tTJSSymbolData *nextd = d->Next;
+                    memset(&d->Value, 0, sizeof(d->Value));
+                    d->Destory();
+                    delete d;
+                    d = nextd;
+                }
+                memset(&lv1->Value, 0, sizeof(lv1->Value));
+                lv1->Destory();
+            }
+            delete[] newsymbols;
+            throw;
+        }
+
+        Symbols = newsymbols;
+        HashSize = newhashsize;
+        HashMask = newhashmask;
+        delete[] Slots;
+        Slots = nullptr;
+        SlotCapacity = 0;
+        if(Shape)
+            Shape->Release(), Shape = nullptr;
+        ChangeShape();
     }
 
     //---------------------------------------------------------------------------
     bool tTJSCustomObject::DeleteByName(const tjs_char *name,
                                         tjs_uint32 *hint) {
+        if(!Symbols) {
+            // members of a shape can not be deleted
+            if(!Find(name, hint))
+                return false;
+            ConvertToDictionary(Count);
+        }
+
         // TODO: utilize hint
         // find an element named "name" and deletes it
         tjs_uint32 hash = tTJSHashFunc<tjs_char *>::Make(name);
@@ -771,6 +1147,7 @@ namespace TJS {
             CheckObjectClosureRemove(*(tTJSVariant *)(&(lv1->Value)));
             lv1->PostClear();
             Count--;
+            ChangeShape();
             return true;
         }
 
@@ -788,6 +1165,7 @@ namespace TJS {
                     delete d;
 
                     Count--;
+                    ChangeShape();
                     return true;
                 }
             }
@@ -801,6 +1179,9 @@ namespace TJS {
     //---------------------------------------------------------------------------
     void tTJSCustomObject::DeleteAllMembers() {
         // delete all members
+        ChangeShape();
+        if(!Symbols)
+            return DeleteAllSlots();
         if(Count <= 10)
             return _DeleteAllMembers();
 
@@ -896,6 +1277,8 @@ namespace TJS {
         iTJSDispatch2 *dsps[20];
         tjs_int num_dsps = 0;
 
+        ChangeShape();
+
         try {
             tTJSSymbolData *lv1, *lv1lim;
 
@@ -979,9 +1362,75 @@ namespace TJS {
         }
     }
 
+    //---------------------------------------------------------------------------
+    void tTJSCustomObject::DeleteAllSlots() {
+        // detach all members first; the object looks empty while the
+        // values are released.
+        tTJSVariant_S *slots = Slots;
+        tjs_int count = Count;
+        tTJSObjectShape *shape = Shape;
+        Slots = nullptr;
+        SlotCapacity = 0;
+        Shape = nullptr;
+        Count = 0;
+
+        for(tjs_int i = 0; i < count; i++)
+            CheckObjectClosureRemove(*(tTJSVariant *)(slots + i));
+
+        try {
+            for(tjs_int i = 0; i < count; i++)
+                ((tTJSVariant *)(slots + i))->Clear();
+        } catch(...) {
+            delete[] slots;
+            if(shape)
+                shape->Release();
+            throw;
+        }
+
+        delete[] slots;
+        if(shape)
+            shape->Release();
+    }
+
+    //---------------------------------------------------------------------------
+    tTJSVariant *tTJSCustomObject::Find(const tjs_char *name,
+                                        tjs_uint32 *hint) {
+        // searche an element named "name" and return its value.
+        // return nullptr if the element is not found.
+        if(Symbols) {
+            tTJSSymbolData *data = FindSymbol(name, hint);
+            return data ? &GetValue(data) : nullptr;
+        }
+
+        if(!name || !Shape)
+            return nullptr;
+
+        tjs_int slot;
+        if(hint && *hint) {
+            // try finding via hint
+            slot = Shape->Find(name, *hint);
+            if(slot >= 0)
+                return GetSlot(slot);
+        }
+
+        tjs_uint32 hash = tTJSHashFunc<tjs_char *>::Make(name);
+        if(hint && *hint) {
+            if(*hint == hash)
+                return nullptr;
+            // given hint was not differ from the hash;
+            // we already know that the member was not found.
+        }
+
+        if(hint)
+            *hint = hash;
+
+        slot = Shape->Find(name, hash);
+        return slot >= 0 ? GetSlot(slot) : nullptr;
+    }
+
     //---------------------------------------------------------------------------
     tTJSCustomObject::tTJSSymbolData *
-    tTJSCustomObject::Find(const tjs_char *name, tjs_uint32 *hint) {
+    tTJSCustomObject::FindSymbol(const tjs_char *name, tjs_uint32 *hint) {
         // searche an element named "name" and return its
         // "SymbolData". return nullptr if the element is not found.
 
@@ -1061,23 +1510,113 @@ namespace TJS {
         return nullptr;
     }
 
+    //---------------------------------------------------------------------------
+    tTJSVariant *tTJSCustomObject::FindCached(const tjs_char *name,
+                                              tjs_uint32 *hint,
+                                              tTJSInlineCache *cache) {
+        // the cache is held by the caller per member name, so the entry
+        // only has to match this object's shape, or this object and its
+        // current version in dictionary mode.
+        if(!cache)
+            return Find(name, hint);
+
+        const void *owner;
+        tjs_uint64 version;
+        if(Symbols) {
+            owner = this;
+            version = ShapeVersion;
+        } else {
+            if(!Shape)
+                return nullptr;
+            owner = Shape;
+            version = Shape->GetId();
+        }
+
+        tTJSInlineCache::tEntry *ent = cache->Entries;
+        for(tjs_int i = 0; i < TJS_INLINE_CACHE_WAYS; i++) {
+            if(ent[i].Owner == owner && ent[i].ShapeVersion == version)
+                return Symbols ? ent[i].Value : GetSlot(ent[i].Slot);
+        }
+
+        tTJSVariant *value = Find(name, hint);
+        if(value) {
+            // replace the stale entry of this owner if any, otherwise the
+            // oldest one; the newest entry is always the first.
+            tjs_int victim = TJS_INLINE_CACHE_WAYS - 1;
+            for(tjs_int i = 0; i < TJS_INLINE_CACHE_WAYS; i++) {
+                if(ent[i].Owner == owner) {
+                    victim = i;
+                    break;
+                }
+            }
+            for(tjs_int i = victim; i > 0; i--)
+                ent[i] = ent[i - 1];
+            ent[0].Owner = owner;
+            ent[0].ShapeVersion = version;
+            if(Symbols)
+                ent[0].Value = value;
+            else
+                ent[0].Slot = (tjs_int)((tTJSVariant_S *)value - Slots);
+        }
+        return value;
+    }
+
+    //---------------------------------------------------------------------------
+    tTJSVariant *tTJSCustomObject::SetSymFlags(tTJSVariant *value,
+                                               tjs_uint32 symflags) {
+        if(!Symbols) {
+            tjs_int slot = (tjs_int)((tTJSVariant_S *)value - Slots);
+            const tTJSObjectShapeMember &member = Shape->GetMember(slot);
+            if(member.SymFlags == symflags)
+                return value;
+
+            // the flags are a part of the shape; the member is moved to
+            // the hash table, which keeps the name alive.
+            tTJSVariantString *name = member.Name;
+            ConvertToDictionary(Count);
+            value = &GetValue(FindSymbol((const tjs_char *)(*name), nullptr));
+        }
+
+        tTJSSymbolData *data = TJSGetSymbolDataOfValue(value);
+        data->SymFlags &= ~(TJS_SYMBOL_HIDDEN | TJS_SYMBOL_STATIC);
+        data->SymFlags |= symflags;
+        return value;
+    }
+
+    //---------------------------------------------------------------------------
+    void tTJSCustomObject::ChangeShape() {
+        ShapeVersion = ++TJSGlobalShapeVersion;
+    }
+
+    //---------------------------------------------------------------------------
+    tTJSCustomObject *
+    tTJSCustomObject::GetInlineCacheTarget(iTJSDispatch2 *dsp) {
+        // only the exact tTJSCustomObject; classes derived from this
+        // (Array, Dictionary, function/class contexts, native classes ...)
+        // override member access.
+        if(dsp && typeid(*dsp) == typeid(tTJSCustomObject))
+            return static_cast<tTJSCustomObject *>(dsp);
+        return nullptr;
+    }
+
     //---------------------------------------------------------------------------
     bool tTJSCustomObject::CallEnumCallbackForData(
         tjs_uint32 flags, tTJSVariant **params, tTJSVariantClosure &callback,
-        iTJSDispatch2 *objthis, const tTJSCustomObject::tTJSSymbolData *data) {
+        iTJSDispatch2 *objthis, tTJSVariantString *name, tjs_uint32 symflags,
+        const tTJSVariant &value) {
         tjs_uint32 newflags = 0;
-        if(data->SymFlags & TJS_SYMBOL_HIDDEN)
+        if(symflags & TJS_SYMBOL_HIDDEN)
             newflags |= TJS_HIDDENMEMBER;
-        if(data->SymFlags & TJS_SYMBOL_STATIC)
+        if(symflags & TJS_SYMBOL_STATIC)
             newflags |= TJS_STATICMEMBER;
 
-        *params[0] = data->Name;
+        *params[0] = name;
         *params[1] = (tjs_int)newflags;
 
         if(!(flags & TJS_ENUM_NO_VALUE)) {
             // get value
             if(TJS_FAILED(TJSDefaultPropGet(flags,
-                                            *(tTJSVariant *)(&(data->Value)),
+                                            const_cast<tTJSVariant &>(value),
                                             params[2], objthis)))
                 return false;
         }
@@ -1105,6 +1644,19 @@ namespace TJS {
         tTJSVariant value;
         tTJSVariant *params[3] = { &name, &newflags, &value };
 
+        if(!Symbols) {
+            // in the slot order. the members are read again at each step
+            // since the callback may change them.
+            for(tjs_int i = 0; !Symbols && i < Count; i++) {
+                const tTJSObjectShapeMember &member = Shape->GetMember(i);
+                if(!CallEnumCallbackForData(flags, params, *callback, objthis,
+                                            member.Name, member.SymFlags,
+                                            *GetSlot(i)))
+                    return;
+            }
+            return;
+        }
+
         const tTJSSymbolData *lv1 = Symbols;
         const tTJSSymbolData *lv1lim = lv1 + HashSize;
         for(; lv1 < lv1lim; lv1++) {
@@ -1114,7 +1666,8 @@ namespace TJS {
 
                 if(d->SymFlags & TJS_SYMBOL_USING) {
                     if(!CallEnumCallbackForData(flags, params, *callback,
-                                                objthis, d))
+                                                objthis, d->Name, d->SymFlags,
+                                                GetValue(d)))
                         return;
                 }
                 d = nextd;
@@ -1122,7 +1675,8 @@ namespace TJS {
 
             if(lv1->SymFlags & TJS_SYMBOL_USING) {
                 if(!CallEnumCallbackForData(flags, params, *callback, objthis,
-                                            lv1))
+                                            lv1->Name, lv1->SymFlags,
+                                            GetValue(lv1)))
                     return;
             }
         }
@@ -1131,10 +1685,10 @@ namespace TJS {
     //---------------------------------------------------------------------------
     tjs_int tTJSCustomObject::GetValueInteger(const tjs_char *name,
                                               tjs_uint32 *hint) {
-        tTJSSymbolData *data = Find(name, hint);
-        if(!data)
+        tTJSVariant *value = Find(name, hint);
+        if(!value)
             return -1;
-        return (tjs_int)data->Value.Integer;
+        return (tjs_int)((tTJSVariant_S *)value)->Integer;
     }
 
     //---------------------------------------------------------------------------
@@ -1202,6 +1756,15 @@ namespace TJS {
                                          tjs_uint32 *hint, tTJSVariant *result,
                                          tjs_int numparams, tTJSVariant **param,
                                          iTJSDispatch2 *objthis) {
+        return FuncCallCached(nullptr, flag, membername, hint, result,
+                              numparams, param, objthis);
+    }
+
+    //---------------------------------------------------------------------------
+    tjs_error tTJSCustomObject::FuncCallCached(
+        tTJSInlineCache *cache, tjs_uint32 flag, const tjs_char *membername,
+        tjs_uint32 *hint, tTJSVariant *result, tjs_int numparams,
+        tTJSVariant **param, iTJSDispatch2 *objthis) {
         if(!GetValidity())
             return TJS_E_INVALIDOBJECT;
 
@@ -1211,7 +1774,7 @@ namespace TJS {
             return TJS_E_INVALIDTYPE; // so returns TJS_E_INVALIDTYPE
         }
 
-        tTJSSymbolData *data = Find(membername, hint);
+        tTJSVariant *data = FindCached(membername, hint, cache);
 
         if(!data) {
             if(CallMissing) {
@@ -1225,7 +1788,7 @@ namespace TJS {
             return TJS_E_MEMBERNOTFOUND; // member not found
         }
 
-        return TJSDefaultFuncCall(flag, GetValue(data), result, numparams,
+        return TJSDefaultFuncCall(flag, *data, result, numparams,
                                   param, objthis);
     }
 
@@ -1277,6 +1840,16 @@ namespace TJS {
                                         const tjs_char *membername,
                                         tjs_uint32 *hint, tTJSVariant *result,
                                         iTJSDispatch2 *objthis) {
+        return PropGetCached(nullptr, flag, membername, hint, result, objthis);
+    }
+
+    //---------------------------------------------------------------------------
+    tjs_error tTJSCustomObject::PropGetCached(tTJSInlineCache *cache,
+                                              tjs_uint32 flag,
+                                              const tjs_char *membername,
+                                              tjs_uint32 *hint,
+                                              tTJSVariant *result,
+                                              iTJSDispatch2 *objthis) {
         if(RebuildHashMagic != TJSGlobalRebuildHashMagic) {
             RebuildHash();
         }
@@ -1290,7 +1863,7 @@ namespace TJS {
             return TJS_E_INVALIDTYPE;
         }
 
-        tTJSSymbolData *data = Find(membername, hint);
+        tTJSVariant *data = FindCached(membername, hint, cache);
         if(!data) {
             if(CallMissing) {
                 // call 'missing' method
@@ -1308,7 +1881,7 @@ namespace TJS {
         if(!data)
             return TJS_E_MEMBERNOTFOUND; // not found
 
-        return TJSDefaultPropGet(flag, GetValue(data), result, objthis);
+        return TJSDefaultPropGet(flag, *data, result, objthis);
     }
 
     //---------------------------------------------------------------------------
@@ -1348,6 +1921,17 @@ namespace TJS {
         return TJS_S_OK;
     }
 
+    //---------------------------------------------------------------------------
+    static inline tjs_uint32 TJSGetSymFlags(tjs_uint32 flag) {
+        // symbol flags given by member access flags
+        tjs_uint32 symflags = 0;
+        if(flag & TJS_HIDDENMEMBER)
+            symflags |= TJS_SYMBOL_HIDDEN;
+        if(flag & TJS_STATICMEMBER)
+            symflags |= TJS_SYMBOL_STATIC;
+        return symflags;
+    }
+
     //---------------------------------------------------------------------------
     tjs_error tTJSCustomObject::PropSet(tjs_uint32 flag,
                                         const tjs_char *membername,
@@ -1362,7 +1946,9 @@ namespace TJS {
             return TJS_E_INVALIDTYPE;
         }
 
-        tTJSSymbolData *data;
+        tjs_uint32 symflags = TJSGetSymFlags(flag);
+
+        tTJSVariant *data;
         if(CallMissing) {
             data = Find(membername, hint);
             if(!data) {
@@ -1373,31 +1959,23 @@ namespace TJS {
         }
 
         if(flag & TJS_MEMBERENSURE)
-            data = Add(membername,
-                       hint); // create a member when TJS_MEMBERENSURE
-                              // is specified
+            data = Add(membername, hint, symflags); // create a member when
+                                                    // TJS_MEMBERENSURE
+                                                    // is specified
         else
             data = Find(membername, hint);
 
         if(!data)
             return TJS_E_MEMBERNOTFOUND; // not found
 
-        if(flag & TJS_HIDDENMEMBER)
-            data->SymFlags |= TJS_SYMBOL_HIDDEN;
-        else
-            data->SymFlags &= ~TJS_SYMBOL_HIDDEN;
-
-        if(flag & TJS_STATICMEMBER)
-            data->SymFlags |= TJS_SYMBOL_STATIC;
-        else
-            data->SymFlags &= ~TJS_SYMBOL_STATIC;
+        data = SetSymFlags(data, symflags);
 
         //-- below is mainly the same as TJSDefaultPropSet
 
         if(!(flag & TJS_IGNOREPROP)) {
-            if(GetValue(data).Type() == tvtObject) {
+            if(data->Type() == tvtObject) {
                 tTJSVariantClosure tvclosure =
-                    GetValue(data).AsObjectClosureNoAddRef();
+                    data->AsObjectClosureNoAddRef();
                 if(tvclosure.Object) {
                     tjs_error hr = tvclosure.Object->PropSet(
                         0, nullptr, nullptr, param,
@@ -1415,14 +1993,14 @@ namespace TJS {
         if(!param)
             return TJS_E_INVALIDPARAM;
 
-        CheckObjectClosureRemove(GetValue(data));
+        CheckObjectClosureRemove(*data);
         try {
-            GetValue(data).CopyRef(*param);
+            data->CopyRef(*param);
         } catch(...) {
-            CheckObjectClosureAdd(GetValue(data));
+            CheckObjectClosureAdd(*data);
             throw;
         }
-        CheckObjectClosureAdd(GetValue(data));
+        CheckObjectClosureAdd(*data);
 
         return TJS_S_OK;
     }
@@ -1448,6 +2026,13 @@ namespace TJS {
                                             tTJSVariantString *membername,
                                             const tTJSVariant *param,
                                             iTJSDispatch2 *objthis) {
+        return PropSetByVSCached(nullptr, flag, membername, param, objthis);
+    }
+
+    //---------------------------------------------------------------------------
+    tjs_error tTJSCustomObject::PropSetByVSCached(
+        tTJSInlineCache *cache, tjs_uint32 flag, tTJSVariantString *membername,
+        const tTJSVariant *param, iTJSDispatch2 *objthis) {
         if(!GetValidity())
             return TJS_E_INVALIDOBJECT;
 
@@ -1456,9 +2041,12 @@ namespace TJS {
             return TJS_E_INVALIDTYPE;
         }
 
-        tTJSSymbolData *data;
+        tjs_uint32 symflags = TJSGetSymFlags(flag);
+
+        tTJSVariant *data;
         if(CallMissing) {
-            data = Find((const tjs_char *)(*membername), membername->GetHint());
+            data = FindCached((const tjs_char *)(*membername),
+                              membername->GetHint(), cache);
             if(!data) {
                 // call 'missing' method
                 if(CallSetMissing((const tjs_char *)(*membername), *param))
@@ -1466,31 +2054,24 @@ namespace TJS {
             }
         }
 
-        if(flag & TJS_MEMBERENSURE)
-            data = Add(membername); // create a member when
-                                    // TJS_MEMBERENSURE is specified
-        else
-            data = Find((const tjs_char *)(*membername), membername->GetHint());
+        data = FindCached((const tjs_char *)(*membername),
+                          membername->GetHint(), cache);
+        if(!data && flag & TJS_MEMBERENSURE)
+            data = Add(membername, symflags); // create a member when
+                                              // TJS_MEMBERENSURE is
+                                              // specified
 
         if(!data)
             return TJS_E_MEMBERNOTFOUND; // not found
 
-        if(flag & TJS_HIDDENMEMBER)
-            data->SymFlags |= TJS_SYMBOL_HIDDEN;
-        else
-            data->SymFlags &= ~TJS_SYMBOL_HIDDEN;
-
-        if(flag & TJS_STATICMEMBER)
-            data->SymFlags |= TJS_SYMBOL_STATIC;
-        else
-            data->SymFlags &= ~TJS_SYMBOL_STATIC;
+        data = SetSymFlags(data, symflags);
 
         //-- below is mainly the same as TJSDefaultPropSet
 
         if(!(flag & TJS_IGNOREPROP)) {
-            if(GetValue(data).Type() == tvtObject) {
+            if(data->Type() == tvtObject) {
                 tTJSVariantClosure tvclosure =
-                    GetValue(data).AsObjectClosureNoAddRef();
+                    data->AsObjectClosureNoAddRef();
                 if(tvclosure.Object) {
                     tjs_error hr = tvclosure.Object->PropSet(
                         0, nullptr, nullptr, param,
@@ -1501,22 +2082,22 @@ namespace TJS {
                        hr != TJS_E_INVALIDOBJECT)
                         return hr;
                 }
-                data = Find((const tjs_char *)(*membername),
-                            membername->GetHint());
+                data = FindCached((const tjs_char *)(*membername),
+                                  membername->GetHint(), cache);
             }
         }
 
         if(!param)
             return TJS_E_INVALIDPARAM;
 
-        CheckObjectClosureRemove(GetValue(data));
+        CheckObjectClosureRemove(*data);
         try {
-            GetValue(data).CopyRef(*param);
+            data->CopyRef(*param);
         } catch(...) {
-            CheckObjectClosureAdd(GetValue(data));
+            CheckObjectClosureAdd(*data);
             throw;
         }
-        CheckObjectClosureAdd(GetValue(data));
+        CheckObjectClosureAdd(*data);
 
         return TJS_S_OK;
     }
@@ -1583,7 +2164,7 @@ namespace TJS {
             return TJS_S_TRUE;
         }
 
-        tTJSSymbolData *data = Find(membername, hint);
+        tTJSVariant *data = Find(membername, hint);
 
         if(!data) {
             if(CallMissing) {
@@ -1597,7 +2178,7 @@ namespace TJS {
         if(!data)
             return TJS_E_MEMBERNOTFOUND; // not found
 
-        return TJSDefaultInvalidate(flag, GetValue(data), objthis);
+        return TJSDefaultInvalidate(flag, *data, objthis);
     }
 
     //---------------------------------------------------------------------------
@@ -1628,7 +2209,7 @@ namespace TJS {
             return TJS_S_TRUE;
         }
 
-        tTJSSymbolData *data = Find(membername, hint);
+        tTJSVariant *data = Find(membername, hint);
 
         if(!data) {
             if(CallMissing) {
@@ -1642,7 +2223,7 @@ namespace TJS {
         if(!data)
             return TJS_E_MEMBERNOTFOUND; // not found
 
-        return TJSDefaultIsValid(flag, GetValue(data), objthis);
+        return TJSDefaultIsValid(flag, *data, objthis);
     }
 
     //---------------------------------------------------------------------------
@@ -1677,7 +2258,7 @@ namespace TJS {
             return TJS_E_INVALIDTYPE;
         }
 
-        tTJSSymbolData *data = Find(membername, hint);
+        tTJSVariant *data = Find(membername, hint);
 
         if(!data) {
             if(CallMissing) {
@@ -1692,7 +2273,7 @@ namespace TJS {
         if(!data)
             return TJS_E_MEMBERNOTFOUND; // not found
 
-        return TJSDefaultCreateNew(flag, GetValue(data), result, numparams,
+        return TJSDefaultCreateNew(flag, *data, result, numparams,
                                    param, objthis);
     }
     //---------------------------------------------------------------------------
@@ -1780,7 +2361,7 @@ namespace TJS {
             return TJS_S_FALSE;
         }
 
-        tTJSSymbolData *data = Find(membername, hint);
+        tTJSVariant *data = Find(membername, hint);
 
         if(!data) {
             if(CallMissing) {
@@ -1795,7 +2376,7 @@ namespace TJS {
         if(!data)
             return TJS_E_MEMBERNOTFOUND; // not found
 
-        return TJSDefaultIsInstanceOf(flag, GetValue(data), classname, objthis);
+        return TJSDefaultIsInstanceOf(flag, *data, classname, objthis);
     }
 
     //---------------------------------------------------------------------------
@@ -1858,6 +2439,15 @@ namespace TJS {
                                           tjs_uint32 *hint, tTJSVariant *result,
                                           const tTJSVariant *param,
                                           iTJSDispatch2 *objthis) {
+        return OperationCached(nullptr, flag, membername, hint, result, param,
+                               objthis);
+    }
+
+    //---------------------------------------------------------------------------
+    tjs_error tTJSCustomObject::OperationCached(
+        tTJSInlineCache *cache, tjs_uint32 flag, const tjs_char *membername,
+        tjs_uint32 *hint, tTJSVariant *result, const tTJSVariant *param,
+        iTJSDispatch2 *objthis) {
         if(!GetValidity())
             return TJS_E_INVALIDOBJECT;
 
@@ -1876,7 +2466,7 @@ namespace TJS {
         if(op < TJS_OP_MIN || op > TJS_OP_MAX)
             return TJS_E_INVALIDPARAM;
 
-        tTJSSymbolData *data = Find(membername, hint);
+        tTJSVariant *data = FindCached(membername, hint, cache);
 
         if(!data) {
             if(CallMissing) {
@@ -1889,11 +2479,11 @@ namespace TJS {
         if(!data)
             return TJS_E_MEMBERNOTFOUND; // not found
 
-        if(GetValue(data).Type() == tvtObject) {
+        if(data->Type() == tvtObject) {
             tjs_error hr;
 
             tTJSVariantClosure tvclosure;
-            tvclosure = GetValue(data).AsObjectClosureNoAddRef();
+            tvclosure = data->AsObjectClosureNoAddRef();
             if(tvclosure.Object) {
                 iTJSDispatch2 *ot = TJS_SELECT_OBJTHIS(tvclosure, objthis);
 
@@ -1918,16 +2508,16 @@ namespace TJS {
             }
         }
 
-        CheckObjectClosureRemove(GetValue(data));
+        CheckObjectClosureRemove(*data);
 
-        tTJSVariant &tmp = GetValue(data);
+        tTJSVariant &tmp = *data;
         try {
             TJSDoVariantOperation(op, tmp, param);
         } catch(...) {
-            CheckObjectClosureAdd(GetValue(data));
+            CheckObjectClosureAdd(*data);
             throw;
         }
-        CheckObjectClosureAdd(GetValue(data));
+        CheckObjectClosureAdd(*data);
 
         if(result)
             result->CopyRef(tmp);
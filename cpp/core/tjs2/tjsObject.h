@@ -249,6 +249,28 @@ namespace TJS {
        TJS Object is limited as the number above.
     */
 
+#define TJS_SHAPE_MAX_MEMBERS 1024
+#define TJS_SHAPE_MAX_TRANSITIONS 64
+
+    /*
+            Objects created with hash bits not greater than
+       TJS_NAMESPACE_DEFAULT_HASH_BITS start in "shape mode"; the member
+       names live in a tTJSObjectShape shared by the objects which got the
+       same members in the same order, and the values live in a contiguous
+       slot array of the object. Such an object falls back to the member
+       hash table ("dictionary mode") when a member is deleted, when the
+       hidden/static flag of a member changes, or when the limits above are
+       exceeded.
+    */
+
+    extern thread_local bool TJSBackgroundCompiling;
+    // true on the threads running tTJS::CompileScriptInBackground; the
+    // objects created there start in dictionary mode, so that the shapes
+    // shared by all objects are touched only by the thread running scripts
+
+    class tTJSObjectShape;
+    struct tTJSInlineCache;
+
     class tTJSCustomObject : public tTJSDispatch {
         typedef tTJSDispatch inherited;
 
@@ -336,8 +358,12 @@ namespace TJS {
         tjs_int Count;
         tjs_int HashMask;
         tjs_int HashSize;
-        tTJSSymbolData *Symbols;
+        tTJSSymbolData *Symbols; // nullptr in shape mode
+        tTJSObjectShape *Shape; // shape mode only; nullptr while empty
+        tTJSVariant_S *Slots; // shape mode only; member values
+        tjs_int SlotCapacity;
         tjs_uint RebuildHashMagic;
+        tjs_uint64 ShapeVersion; // renewed whenever a symbol data may move
         bool IsInvalidated;
         bool IsInvalidating;
         iTJSNativeInstance *ClassInstances[TJS_MAX_NATIVE_CLASS];
@@ -392,19 +418,33 @@ namespace TJS {
 
         bool CallSetMissing(const tjs_char *name, const tTJSVariant &value);
 
-        tTJSSymbolData *Add(const tjs_char *name, tjs_uint32 *hint);
-        // Adds the symbol, returns the newly created data;
-        // if already exists, returns the data.
+        tTJSVariant *GetSlot(tjs_int index) {
+            return (tTJSVariant *)(Slots + index);
+        }
+
+        tTJSVariant *Add(const tjs_char *name, tjs_uint32 *hint,
+                         tjs_uint32 symflags = 0);
+        // Adds the symbol, returns the newly created value;
+        // if already exists, returns the value.
+        // symflags is the initial symbol flags of a new member.
 
-        tTJSSymbolData *Add(tTJSVariantString *name);
+        tTJSVariant *Add(tTJSVariantString *name, tjs_uint32 symflags = 0);
         // tTJSVariantString version of above.
 
+        tTJSVariant *AddSlot(const tjs_char *name, tTJSVariantString *vsname,
+                             tjs_uint32 hash, tjs_uint32 symflags);
+        // Adds a new member in shape mode; falls back to dictionary mode
+        // and returns nullptr if the shape can not be extended.
+
         tTJSSymbolData *AddTo(tTJSVariantString *name, tTJSSymbolData *newdata,
                               tjs_int newhashmask);
         // Adds member to the new hash space, used in RebuildHash
 
         void RebuildHash(); // rebuild hash table
 
+        void ConvertToDictionary(tjs_int requestcount);
+        // Moves the members in the slots to the hash table
+
         bool DeleteByName(const tjs_char *name, tjs_uint32 *hint);
         // Deletes Name
 
@@ -414,14 +454,33 @@ namespace TJS {
         void _DeleteAllMembers();
         // Deletes all members ( not to use std::vector )
 
-        tTJSSymbolData *Find(const tjs_char *name, tjs_uint32 *hint);
-        // Finds Name, returns its data; if not found, returns nullptr
+        void DeleteAllSlots();
+        // Deletes all members in shape mode
+
+        tTJSVariant *Find(const tjs_char *name, tjs_uint32 *hint);
+        // Finds Name, returns its value; if not found, returns nullptr
+
+        tTJSSymbolData *FindSymbol(const tjs_char *name, tjs_uint32 *hint);
+        // dictionary mode version of above
+
+        tTJSVariant *FindCached(const tjs_char *name, tjs_uint32 *hint,
+                                tTJSInlineCache *cache);
+        // Find through the caller's inline cache ( cache may be nullptr )
+
+        tTJSVariant *SetSymFlags(tTJSVariant *value, tjs_uint32 symflags);
+        // Sets hidden/static flags of the member, returns the value which
+        // may have moved
+
+        void ChangeShape();
+        // invalidates inline caches which refer this object's symbols
 
         static bool CallEnumCallbackForData(tjs_uint32 flags,
                                             tTJSVariant **params,
                                             tTJSVariantClosure &callback,
                                             iTJSDispatch2 *objthis,
-                                            const tTJSSymbolData *data);
+                                            tTJSVariantString *name,
+                                            tjs_uint32 symflags,
+                                            const tTJSVariant &value);
 
         void InternalEnumMembers(tjs_uint32 flags, tTJSVariantClosure *callback,
                                  iTJSDispatch2 *objthis);
@@ -489,6 +548,60 @@ namespace TJS {
 
         tjs_error ClassInstanceInfo(tjs_uint32 flag, tjs_uint num,
                                     tTJSVariant *value);
+
+        //---------------------------------------------------------------------
+    public:
+        // member access through an inline cache held by the caller.
+        // these are valid only for the objects returned by
+        // GetInlineCacheTarget, since derived classes override the member
+        // access.
+        static tTJSCustomObject *GetInlineCacheTarget(iTJSDispatch2 *dsp);
+
+        tjs_error FuncCallCached(tTJSInlineCache *cache, tjs_uint32 flag,
+                                 const tjs_char *membername, tjs_uint32 *hint,
+                                 tTJSVariant *result, tjs_int numparams,
+                                 tTJSVariant **param, iTJSDispatch2 *objthis);
+
+        tjs_error PropGetCached(tTJSInlineCache *cache, tjs_uint32 flag,
+                                const tjs_char *membername, tjs_uint32 *hint,
+                                tTJSVariant *result, iTJSDispatch2 *objthis);
+
+        tjs_error PropSetByVSCached(tTJSInlineCache *cache, tjs_uint32 flag,
+                                    tTJSVariantString *membername,
+                                    const tTJSVariant *param,
+                                    iTJSDispatch2 *objthis);
+
+        tjs_error OperationCached(tTJSInlineCache *cache, tjs_uint32 flag,
+                                  const tjs_char *membername, tjs_uint32 *hint,
+                                  tTJSVariant *result, const tTJSVariant *param,
+                                  iTJSDispatch2 *objthis);
+    };
+    //---------------------------------------------------------------------------
+
+    //---------------------------------------------------------------------------
+    // tTJSInlineCache
+    //---------------------------------------------------------------------------
+    /*
+            member lookup cache of one access site. an entry for an object
+       in shape mode remembers the slot index of the member in the shape,
+       so it hits for every object of that shape. an entry for an object in
+       dictionary mode remembers the value of the member in the object and
+       is valid while the object keeps the same ShapeVersion. shape ids and
+       versions are taken from the same counter and are never reused, so an
+       entry can not match another shape or object which is created at the
+       same address.
+    */
+#define TJS_INLINE_CACHE_WAYS 2
+
+    struct tTJSInlineCache {
+        struct tEntry {
+            const void *Owner; // the shape or the object; only compared
+            tjs_uint64 ShapeVersion;
+            union {
+                tjs_int Slot; // shape mode
+                tTJSVariant *Value; // dictionary mode
+            };
+        } Entries[TJS_INLINE_CACHE_WAYS];
     };
     //---------------------------------------------------------------------------
 
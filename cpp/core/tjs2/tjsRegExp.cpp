@@ -15,7 +15,14 @@
 #include "tjsRegExp.h"
 #include "tjsArray.h"
 
+#include <atomic>
 #include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace TJS {
 
@@ -67,6 +74,628 @@ namespace TJS {
         return flag;
     }
 
+    //---------------------------------------------------------------------------
+    // tTJSSimpleRegExp
+    //---------------------------------------------------------------------------
+    // a matcher for the patterns most scripts use: literal characters,
+    // character classes, '.', \d \w \s and their negations, and quantifiers,
+    // with '^' and '$' at the ends. for these patterns it finds the same
+    // match as Oniguruma does, so it is used in place of onig_search.
+    // patterns out of this subset (groups, alternation, ignore-case, ...)
+    // are not compiled by it and are left to Oniguruma. fixed-length patterns
+    // are searched bit-parallel (shift-and), the others by backtracking.
+#define TJS_SIMPLE_REGEXP_MAX_ATOMS 64
+#define TJS_SIMPLE_REGEXP_MAX_REPEAT 100000
+    class tTJSSimpleRegExp {
+    public:
+        enum tResult { srMatch, srMismatch, srUnknown };
+
+    private:
+        // one character of the pattern; a literal is a class of one
+        // character. Ascii holds the result for characters below 0x80,
+        // others are looked up in Ranges and the ctypes.
+        struct tAtom {
+            tjs_uint64 Ascii[2];
+            std::vector<std::pair<tjs_char, tjs_char>> Ranges;
+            tjs_uint8 CTypes; // bits of TJS_SIMPLE_CTYPE_*
+            tjs_uint8 NegCTypes; // same as above, for \D \W \S
+            bool Negate;
+            tjs_int Min;
+            tjs_int Max; // -1 for no limit
+            bool Lazy;
+        };
+
+        struct tMatchState {
+            const tjs_char *Begin; // start of the current match
+            const tjs_char *End;
+            tjs_int Steps;
+            bool Unknown;
+        };
+
+        std::vector<tAtom> Atoms;
+        bool AnchorBegin = false; // '^'; the start of the string
+        bool AnchorEnd = false; // '$'; the end, or before the last '\n'
+        bool Fixed = false; // every atom matches exactly once
+        tjs_uint64 AsciiMask[128]; // shift-and masks when Fixed
+
+        static int Test(const tAtom &atom, tjs_char ch);
+        const tjs_char *MatchAt(size_t index, const tjs_char *p,
+                                tMatchState &state) const;
+        tResult ShiftAndSearch(const tjs_char *str, const tjs_char *end,
+                               const tjs_char *&matchbegin,
+                               const tjs_char *&matchend) const;
+
+    public:
+        // returns nullptr when the pattern is not in the subset
+        static tTJSSimpleRegExp *Compile(const tjs_char *expr,
+                                         const tjs_char *exprend,
+                                         tjs_uint32 flags);
+
+        // searches [str, end) the way onig_search does with "str" as both
+        // the string and the search start. srUnknown is returned when the
+        // text has characters this matcher does not handle (surrogate
+        // pairs) or the search takes too long; search with Oniguruma then.
+        tResult Search(const tjs_char *str, const tjs_char *end,
+                       const tjs_char *&matchbegin,
+                       const tjs_char *&matchend) const;
+    };
+
+#define TJS_SIMPLE_CTYPE_DIGIT 1
+#define TJS_SIMPLE_CTYPE_WORD 2
+#define TJS_SIMPLE_CTYPE_SPACE 4
+
+    //---------------------------------------------------------------------------
+    static bool TJSIsCodeCType(tjs_char ch, tjs_uint8 ctype) {
+        // character types as Oniguruma sees them in UTF-16
+        OnigCtype onigctype = ctype == TJS_SIMPLE_CTYPE_DIGIT
+            ? ONIGENC_CTYPE_DIGIT
+            : ctype == TJS_SIMPLE_CTYPE_WORD ? ONIGENC_CTYPE_WORD
+                                             : ONIGENC_CTYPE_SPACE;
+        return ONIGENC_IS_CODE_CTYPE(ONIG_ENCODING_UTF16_LE,
+                                     (OnigCodePoint)ch, onigctype) != 0;
+    }
+
+    //---------------------------------------------------------------------------
+    static bool TJSIsSurrogate(tjs_char ch) {
+        return ch >= 0xd800 && ch <= 0xdfff;
+    }
+
+    //---------------------------------------------------------------------------
+    static bool TJSIsBrokenSurrogate(const tjs_char *p, const tjs_char *end) {
+        // Oniguruma takes a high surrogate and the code unit after it as one
+        // character whatever the latter is
+        return *p >= 0xd800 && *p <= 0xdbff &&
+            (p + 1 == end || p[1] < 0xdc00 || p[1] > 0xdfff);
+    }
+
+    //---------------------------------------------------------------------------
+    int tTJSSimpleRegExp::Test(const tAtom &atom, tjs_char ch) {
+        // returns 1 if the atom matches ch, 0 if not, or -1 if ch is a part
+        // of a surrogate pair the atom might match as one character
+        if(ch < 0x80)
+            return (int)((atom.Ascii[ch >> 6] >> (ch & 63)) & 1);
+
+        if(TJSIsSurrogate(ch))
+            return atom.Negate || atom.CTypes || atom.NegCTypes ? -1 : 0;
+
+        bool in = false;
+        for(const auto &range : atom.Ranges) {
+            if(ch >= range.first && ch <= range.second) {
+                in = true;
+                break;
+            }
+        }
+        for(tjs_uint8 bit = 1; !in && bit <= TJS_SIMPLE_CTYPE_SPACE;
+            bit <<= 1) {
+            if((atom.CTypes | atom.NegCTypes) & bit) {
+                bool is = TJSIsCodeCType(ch, bit);
+                if(((atom.CTypes & bit) && is) ||
+                   ((atom.NegCTypes & bit) && !is))
+                    in = true;
+            }
+        }
+        return in != atom.Negate ? 1 : 0;
+    }
+
+    //---------------------------------------------------------------------------
+    static bool TJSSimpleRegExpEscapeClass(tjs_char ch, tjs_uint8 &ctype,
+                                           bool &negate) {
+        switch(ch) {
+            case TJS_W('d'):
+            case TJS_W('D'):
+                ctype = TJS_SIMPLE_CTYPE_DIGIT;
+                break;
+            case TJS_W('w'):
+            case TJS_W('W'):
+                ctype = TJS_SIMPLE_CTYPE_WORD;
+                break;
+            case TJS_W('s'):
+            case TJS_W('S'):
+                ctype = TJS_SIMPLE_CTYPE_SPACE;
+                break;
+            default:
+                return false;
+        }
+        negate = ch == TJS_W('D') || ch == TJS_W('W') || ch == TJS_W('S');
+        return true;
+    }
+
+    //---------------------------------------------------------------------------
+    static bool TJSSimpleRegExpEscapeChar(tjs_char ch, tjs_char &out) {
+        switch(ch) {
+            case TJS_W('t'):
+                out = TJS_W('\t');
+                return true;
+            case TJS_W('n'):
+                out = TJS_W('\n');
+                return true;
+            case TJS_W('r'):
+                out = TJS_W('\r');
+                return true;
+            case TJS_W('f'):
+                out = TJS_W('\f');
+                return true;
+        }
+        // escaped punctuations mean themselves
+        if(ch && ch < 0x80 &&
+           TJS_strchr(TJS_W("\\^$.[]|()?*+{}/-#,:;=!@%&~'\""), ch)) {
+            out = ch;
+            return true;
+        }
+        return false;
+    }
+
+    //---------------------------------------------------------------------------
+    tTJSSimpleRegExp *tTJSSimpleRegExp::Compile(const tjs_char *expr,
+                                                const tjs_char *exprend,
+                                                tjs_uint32 flags) {
+        // case folding of Oniguruma covers the whole Unicode
+        if(flags & ONIG_OPTION_IGNORECASE)
+            return nullptr;
+        if(!(flags & ONIG_OPTION_FIND_NOT_EMPTY))
+            return nullptr;
+
+        std::unique_ptr<tTJSSimpleRegExp> re(new tTJSSimpleRegExp());
+        const tjs_char *p = expr;
+        if(p < exprend && *p == TJS_W('^'))
+            re->AnchorBegin = true, p++;
+
+        auto addchar = [](tAtom &atom, tjs_char ch) {
+            if(ch < 0x80)
+                atom.Ascii[ch >> 6] |= (tjs_uint64)1 << (ch & 63);
+            else
+                atom.Ranges.emplace_back(ch, ch);
+        };
+        auto addctype = [](tAtom &atom, tjs_uint8 ctype, bool negate) {
+            for(tjs_char ch = 0; ch < 0x80; ch++)
+                if(TJSIsCodeCType(ch, ctype) != negate)
+                    atom.Ascii[ch >> 6] |= (tjs_uint64)1 << (ch & 63);
+            (negate ? atom.NegCTypes : atom.CTypes) |= ctype;
+        };
+
+        while(p < exprend) {
+            tjs_char ch = *p++;
+            if(ch == TJS_W('$') && p == exprend) {
+                re->AnchorEnd = true;
+                break;
+            }
+            if(TJSIsSurrogate(ch))
+                return nullptr;
+
+            tAtom atom{};
+            atom.Min = atom.Max = 1;
+            switch(ch) {
+                case TJS_W('.'):
+                    // any character except for newline
+                    addchar(atom, TJS_W('\n'));
+                    atom.Negate = true;
+                    break;
+
+                case TJS_W('\\'): {
+                    if(p == exprend)
+                        return nullptr;
+                    tjs_char esc = *p++, lit;
+                    tjs_uint8 ctype;
+                    bool negate;
+                    if(TJSSimpleRegExpEscapeClass(esc, ctype, negate))
+                        addctype(atom, ctype, negate);
+                    else if(TJSSimpleRegExpEscapeChar(esc, lit))
+                        addchar(atom, lit);
+                    else
+                        return nullptr;
+                    break;
+                }
+
+                case TJS_W('['): {
+                    if(p < exprend && *p == TJS_W('^'))
+                        atom.Negate = true, p++;
+                    bool first = true;
+                    while(true) {
+                        if(p == exprend)
+                            return nullptr;
+                        tjs_char c = *p++;
+                        if(c == TJS_W(']') && !first)
+                            break;
+                        first = false;
+                        if(c == TJS_W('[') || c == TJS_W(']') ||
+                           TJSIsSurrogate(c))
+                            return nullptr;
+                        if(c == TJS_W('&') && p < exprend && *p == TJS_W('&'))
+                            return nullptr;
+                        if(c == TJS_W('\\')) {
+                            if(p == exprend)
+                                return nullptr;
+                            tjs_char esc = *p++;
+                            tjs_uint8 ctype;
+                            bool negate;
+                            if(TJSSimpleRegExpEscapeClass(esc, ctype, negate)) {
+                                addctype(atom, ctype, negate);
+                                continue;
+                            }
+                            if(!TJSSimpleRegExpEscapeChar(esc, c))
+                                return nullptr;
+                        }
+                        if(p + 1 < exprend && *p == TJS_W('-') &&
+                           p[1] != TJS_W(']')) {
+                            // range; the upper end must be a plain character
+                            tjs_char hi = p[1];
+                            if(hi == TJS_W('\\') || hi == TJS_W('[') ||
+                               TJSIsSurrogate(hi) || hi < c)
+                                return nullptr;
+                            p += 2;
+                            for(tjs_char a = c; a <= hi && a < 0x80; a++)
+                                addchar(atom, a);
+                            if(hi >= 0x80)
+                                atom.Ranges.emplace_back(c < 0x80 ? 0x80 : c,
+                                                         hi);
+                            continue;
+                        }
+                        addchar(atom, c);
+                    }
+                    break;
+                }
+
+                case TJS_W('^'):
+                case TJS_W('$'):
+                case TJS_W('|'):
+                case TJS_W('('):
+                case TJS_W(')'):
+                case TJS_W('?'):
+                case TJS_W('*'):
+                case TJS_W('+'):
+                case TJS_W('{'):
+                case TJS_W('}'):
+                case TJS_W(']'):
+                    return nullptr;
+
+                default:
+                    addchar(atom, ch);
+                    break;
+            }
+
+            if(atom.Negate) {
+                atom.Ascii[0] = ~atom.Ascii[0];
+                atom.Ascii[1] = ~atom.Ascii[1];
+            }
+
+            // quantifier
+            if(p < exprend) {
+                bool quantified = true;
+                switch(*p) {
+                    case TJS_W('?'):
+                        atom.Min = 0;
+                        p++;
+                        break;
+                    case TJS_W('*'):
+                        atom.Min = 0, atom.Max = -1;
+                        p++;
+                        break;
+                    case TJS_W('+'):
+                        atom.Max = -1;
+                        p++;
+                        break;
+                    case TJS_W('{'): {
+                        // {n}, {n,} or {n,m}
+                        const tjs_char *q = p + 1;
+                        auto number = [&q, exprend](tjs_int &n) {
+                            n = 0;
+                            const tjs_char *start = q;
+                            while(q < exprend && *q >= TJS_W('0') &&
+                                  *q <= TJS_W('9')) {
+                                n = n * 10 + (*q++ - TJS_W('0'));
+                                if(n > TJS_SIMPLE_REGEXP_MAX_REPEAT)
+                                    return false;
+                            }
+                            return q != start;
+                        };
+                        if(!number(atom.Min))
+                            return nullptr;
+                        atom.Max = atom.Min;
+                        if(q < exprend && *q == TJS_W(',')) {
+                            q++;
+                            if(q < exprend && *q == TJS_W('}'))
+                                atom.Max = -1;
+                            else if(!number(atom.Max) || atom.Max < atom.Min)
+                                return nullptr;
+                        }
+                        if(q == exprend || *q != TJS_W('}'))
+                            return nullptr;
+                        p = q + 1;
+                        break;
+                    }
+                    default:
+                        quantified = false;
+                        break;
+                }
+                if(quantified && p < exprend && *p == TJS_W('?'))
+                    atom.Lazy = true, p++;
+                if(quantified && p < exprend &&
+                   (*p == TJS_W('?') || *p == TJS_W('*') ||
+                    *p == TJS_W('+') || *p == TJS_W('{')))
+                    return nullptr; // possessive or nested quantifier
+            }
+
+            if(re->Atoms.size() == TJS_SIMPLE_REGEXP_MAX_ATOMS)
+                return nullptr;
+            re->Atoms.push_back(std::move(atom));
+        }
+
+        if(re->Atoms.empty())
+            return nullptr;
+
+        re->Fixed = !re->AnchorBegin && !re->AnchorEnd;
+        for(const auto &atom : re->Atoms)
+            if(atom.Min != 1 || atom.Max != 1)
+                re->Fixed = false;
+        if(re->Fixed) {
+            for(tjs_char ch = 0; ch < 0x80; ch++) {
+                tjs_uint64 mask = 0;
+                for(size_t i = 0; i < re->Atoms.size(); i++)
+                    if(Test(re->Atoms[i], ch))
+                        mask |= (tjs_uint64)1 << i;
+                re->AsciiMask[ch] = mask;
+            }
+        }
+
+        return re.release();
+    }
+
+    //---------------------------------------------------------------------------
+    const tjs_char *tTJSSimpleRegExp::MatchAt(size_t index, const tjs_char *p,
+                                              tMatchState &state) const {
+        // matches Atoms[index...] at p; returns the end of the match
+        if(--state.Steps < 0) {
+            state.Unknown = true;
+            return nullptr;
+        }
+
+        if(index == Atoms.size()) {
+            if(AnchorEnd &&
+               !(p == state.End || (p + 1 == state.End && *p == TJS_W('\n'))))
+                return nullptr;
+            if(p == state.Begin)
+                return nullptr; // ONIG_OPTION_FIND_NOT_EMPTY
+            return p;
+        }
+
+        // count the characters the atom can take, then try the rest from
+        // the longest (greedy) or the shortest (lazy) count
+        const tAtom &atom = Atoms[index];
+        tjs_int count = 0;
+        while((atom.Max < 0 || count < atom.Max) && p + count < state.End) {
+            int r = TJSIsBrokenSurrogate(p + count, state.End)
+                ? -1
+                : Test(atom, p[count]);
+            if(r < 0) {
+                state.Unknown = true;
+                return nullptr;
+            }
+            if(!r)
+                break;
+            count++;
+        }
+        if(count < atom.Min)
+            return nullptr;
+
+        for(tjs_int i = 0; i <= count - atom.Min; i++) {
+            tjs_int n = atom.Lazy ? atom.Min + i : count - i;
+            const tjs_char *end = MatchAt(index + 1, p + n, state);
+            if(end || state.Unknown)
+                return end;
+        }
+        return nullptr;
+    }
+
+    //---------------------------------------------------------------------------
+    tTJSSimpleRegExp::tResult
+    tTJSSimpleRegExp::ShiftAndSearch(const tjs_char *str, const tjs_char *end,
+                                     const tjs_char *&matchbegin,
+                                     const tjs_char *&matchend) const {
+        // every match has the same length, so the leftmost match is the
+        // one which ends first
+        const size_t length = Atoms.size();
+        const tjs_uint64 last = (tjs_uint64)1 << (length - 1);
+        tjs_uint64 state = 0;
+        for(const tjs_char *p = str; p < end; p++) {
+            tjs_char ch = *p;
+            tjs_uint64 mask;
+            if(ch < 0x80) {
+                mask = AsciiMask[ch];
+            } else {
+                if(TJSIsBrokenSurrogate(p, end))
+                    return srUnknown;
+                mask = 0;
+                for(size_t i = 0; i < length; i++) {
+                    int r = Test(Atoms[i], ch);
+                    if(r < 0)
+                        return srUnknown;
+                    if(r)
+                        mask |= (tjs_uint64)1 << i;
+                }
+            }
+            state = ((state << 1) | 1) & mask;
+            if(state & last) {
+                matchbegin = p + 1 - length;
+                matchend = p + 1;
+                return srMatch;
+            }
+        }
+        return srMismatch;
+    }
+
+    //---------------------------------------------------------------------------
+    tTJSSimpleRegExp::tResult
+    tTJSSimpleRegExp::Search(const tjs_char *str, const tjs_char *end,
+                             const tjs_char *&matchbegin,
+                             const tjs_char *&matchend) const {
+        if(Fixed)
+            return ShiftAndSearch(str, end, matchbegin, matchend);
+
+        // a literal first character lets the search skip ahead
+        const tAtom &first = Atoms[0];
+        tjs_int firstchar = -1;
+        if(first.Min > 0 && !first.Negate && !first.CTypes &&
+           !first.NegCTypes) {
+            tjs_int bits = 0;
+            for(tjs_char ch = 0; ch < 0x80; ch++)
+                if((first.Ascii[ch >> 6] >> (ch & 63)) & 1)
+                    bits++, firstchar = ch;
+            if(bits != 1 || !first.Ranges.empty())
+                firstchar = -1;
+        }
+
+        tMatchState state;
+        state.End = end;
+        state.Steps = 100000 + 64 * (tjs_int)(end - str);
+        state.Unknown = false;
+        const tjs_char *last = AnchorBegin ? str + 1 : end;
+        for(const tjs_char *p = str; p < last; p++) {
+            if(firstchar >= 0) {
+                while(p < last && *p != firstchar) {
+                    if(TJSIsBrokenSurrogate(p, end))
+                        return srUnknown;
+                    p++;
+                }
+                if(p == last)
+                    break;
+            }
+            if(TJSIsBrokenSurrogate(p, end))
+                return srUnknown;
+            state.Begin = p;
+            const tjs_char *e = MatchAt(0, p, state);
+            if(state.Unknown)
+                return srUnknown;
+            if(e) {
+                matchbegin = p;
+                matchend = e;
+                return srMatch;
+            }
+        }
+        return srMismatch;
+    }
+
+    //---------------------------------------------------------------------------
+    // tTJSRegExpPattern
+    //---------------------------------------------------------------------------
+    class tTJSRegExpPattern {
+        std::atomic<tjs_int> RefCount;
+
+    public:
+        regex_t *RegEx;
+        std::unique_ptr<tTJSSimpleRegExp> Simple;
+
+        tTJSRegExpPattern(const ttstr &expr, tjs_uint32 flags) :
+            RefCount(1), RegEx(nullptr) {
+            OnigErrorInfo einfo;
+            int r = onig_new(&RegEx, (UChar *)expr.c_str(),
+                             (UChar *)(expr.c_str() + expr.length()),
+                             flags & ((ONIG_OPTION_MAXBIT << 1) - 1),
+                             ONIG_ENCODING_UTF16_LE, ONIG_SYNTAX_PERL, &einfo);
+            if(r) {
+                char s[ONIG_MAX_ERROR_MESSAGE_LEN];
+                onig_error_code_to_str((UChar *)s, r, &einfo);
+                TJS_eTJSError(s);
+            }
+            Simple.reset(tTJSSimpleRegExp::Compile(
+                expr.c_str(), expr.c_str() + expr.length(), flags));
+        }
+
+        ~tTJSRegExpPattern() {
+            if(RegEx)
+                onig_free(RegEx);
+        }
+
+        void AddRef() { RefCount++; }
+        void Release() {
+            if(--RefCount == 0)
+                delete this;
+        }
+    };
+
+    //---------------------------------------------------------------------------
+    // pattern cache
+    //---------------------------------------------------------------------------
+    // scripts often create RegExp objects of the same expression again and
+    // again (regular expression literals in functions); the compiled
+    // patterns of the recently used expressions are kept and shared.
+#define TJS_REGEXP_CACHE_SIZE 64
+    typedef std::basic_string<tjs_char> tTJSRegExpCacheKey;
+    typedef std::list<std::pair<tTJSRegExpCacheKey, tTJSRegExpPattern *>>
+        tTJSRegExpCacheList;
+    static std::mutex TJSRegExpCacheMutex;
+    static tTJSRegExpCacheList TJSRegExpCacheList; // most recent first
+    static std::unordered_map<tTJSRegExpCacheKey,
+                              tTJSRegExpCacheList::iterator>
+        TJSRegExpCacheMap;
+
+    //---------------------------------------------------------------------------
+    static tTJSRegExpPattern *TJSGetRegExpPattern(const ttstr &expr,
+                                                  tjs_uint32 flags) {
+        // returns the pattern with a reference added
+        tTJSRegExpCacheKey key;
+        key.reserve(expr.length() + 2);
+        key += (tjs_char)(flags >> 16);
+        key += (tjs_char)(flags & 0xffff);
+        key.append(expr.c_str(), expr.length());
+
+        {
+            std::lock_guard<std::mutex> lock(TJSRegExpCacheMutex);
+            auto i = TJSRegExpCacheMap.find(key);
+            if(i != TJSRegExpCacheMap.end()) {
+                TJSRegExpCacheList.splice(TJSRegExpCacheList.begin(),
+                                          TJSRegExpCacheList, i->second);
+                tTJSRegExpPattern *pattern = i->second->second;
+                pattern->AddRef();
+                return pattern;
+            }
+        }
+
+        // compile out of the lock; this may throw
+        tTJSRegExpPattern *pattern = new tTJSRegExpPattern(expr, flags);
+
+        std::lock_guard<std::mutex> lock(TJSRegExpCacheMutex);
+        if(TJSRegExpCacheMap.find(key) == TJSRegExpCacheMap.end()) {
+            pattern->AddRef(); // for the cache
+            TJSRegExpCacheList.emplace_front(key, pattern);
+            TJSRegExpCacheMap[key] = TJSRegExpCacheList.begin();
+            if(TJSRegExpCacheList.size() > TJS_REGEXP_CACHE_SIZE) {
+                TJSRegExpCacheMap.erase(TJSRegExpCacheList.back().first);
+                TJSRegExpCacheList.back().second->Release();
+                TJSRegExpCacheList.pop_back();
+            }
+        }
+        return pattern;
+    }
+
+    //---------------------------------------------------------------------------
+    static void TJSClearRegExpCache() {
+        std::lock_guard<std::mutex> lock(TJSRegExpCacheMutex);
+        for(auto &i : TJSRegExpCacheList)
+            i.second->Release();
+        TJSRegExpCacheList.clear();
+        TJSRegExpCacheMap.clear();
+    }
+
     //---------------------------------------------------------------------------
     void replace_regex(tTJSVariant **param, tjs_int numparams,
                        tTJSNI_RegExp *_this, iTJSDispatch2 *objthis,
@@ -92,9 +721,7 @@ namespace TJS {
         OnigRegion *region = onig_region_new();
         const tjs_char *s = target.c_str();
         const tjs_char *send = s + target.GetLen();
-        int r = onig_search(_this->RegEx, (UChar *)s, (UChar *)send, (UChar *)s,
-                            (UChar *)send, region, ONIG_OPTION_NONE);
-        int offset = 0;
+        int r = _this->Search(s, send, region);
         if(r >= 0) { // match
             do {
                 tjs_int pos = region->beg[0] / sizeof(tjs_char);
@@ -126,9 +753,7 @@ namespace TJS {
                 s += end;
                 onig_region_free(region, 0);
             } while(isreplaceall && s < send &&
-                    onig_search(_this->RegEx, (UChar *)s, (UChar *)send,
-                                (UChar *)s, (UChar *)send, region,
-                                ONIG_OPTION_NONE) >= 0);
+                    _this->Search(s, send, region) >= 0);
             if(s < send) {
                 res += ttstr(s, (int)(send - s));
             }
@@ -145,8 +770,7 @@ namespace TJS {
         OnigRegion *region = onig_region_new();
         const tjs_char *s = target.c_str();
         const tjs_char *send = s + targlen;
-        int r = onig_search(_this->RegEx, (UChar *)s, (UChar *)send, (UChar *)s,
-                            (UChar *)send, region, ONIG_OPTION_NONE);
+        int r = _this->Search(s, send, region);
         int storecount = 0;
         if(r >= 0) { // match
             do {
@@ -158,9 +782,7 @@ namespace TJS {
                 }
                 s += region->end[0] / sizeof(tjs_char);
                 onig_region_clear(region);
-            } while(onig_search(_this->RegEx, (UChar *)s, (UChar *)send,
-                                (UChar *)s, (UChar *)send, region,
-                                ONIG_OPTION_NONE) >= 0);
+            } while(_this->Search(s, send, region) >= 0);
             if(!purgeempty || s < send) {
                 tTJSVariant val = ttstr(s, (int)(send - s));
                 array->PropSetByNum(TJS_MEMBERENSURE, storecount++, &val,
@@ -176,13 +798,16 @@ namespace TJS {
     }
 
     //---------------------------------------------------------------------------
-    void TJSReleaseRegex() { onig_end(); }
+    void TJSReleaseRegex() {
+        TJSClearRegExpCache();
+        onig_end();
+    }
     //---------------------------------------------------------------------------
 
     //---------------------------------------------------------------------------
     // tTJSNI_RegExp : TJS Native Instance : RegExp
     //---------------------------------------------------------------------------
-    tTJSNI_RegExp::tTJSNI_RegExp() : RegEx(nullptr) {
+    tTJSNI_RegExp::tTJSNI_RegExp() : Pattern(nullptr) {
         // C++constructor
         Flags = TJSRegExpFlagToValue(0, 0);
         Start = 0;
@@ -192,10 +817,47 @@ namespace TJS {
 
     //---------------------------------------------------------------------------
     tTJSNI_RegExp::~tTJSNI_RegExp() {
-        if(RegEx) {
-            onig_free(RegEx);
-            RegEx = nullptr;
+        if(Pattern) {
+            Pattern->Release();
+            Pattern = nullptr;
+        }
+    }
+
+    //---------------------------------------------------------------------------
+    void tTJSNI_RegExp::SetPattern(const ttstr &expr, tjs_uint32 flags) {
+        tTJSRegExpPattern *pattern = TJSGetRegExpPattern(expr, flags);
+        if(Pattern)
+            Pattern->Release();
+        Pattern = pattern;
+        Flags = flags;
+    }
+
+    //---------------------------------------------------------------------------
+    int tTJSNI_RegExp::Search(const tjs_char *str, const tjs_char *end,
+                              OnigRegion *region) const {
+        // the same as onig_search with "str" as the search start; returns
+        // the match position in bytes, or ONIG_MISMATCH
+        if(!Pattern)
+            return ONIG_MISMATCH;
+        if(Pattern->Simple) {
+            const tjs_char *matchbegin, *matchend;
+            switch(Pattern->Simple->Search(str, end, matchbegin, matchend)) {
+                case tTJSSimpleRegExp::srMatch:
+                    onig_region_resize(region, 1);
+                    region->beg[0] =
+                        (int)((matchbegin - str) * sizeof(tjs_char));
+                    region->end[0] =
+                        (int)((matchend - str) * sizeof(tjs_char));
+                    return region->beg[0];
+                case tTJSSimpleRegExp::srMismatch:
+                    return ONIG_MISMATCH;
+                case tTJSSimpleRegExp::srUnknown:
+                    break;
+            }
         }
+        return onig_search(Pattern->RegEx, (UChar *)str, (UChar *)end,
+                           (UChar *)str, (UChar *)end, region,
+                           ONIG_OPTION_NONE);
     }
 
     //---------------------------------------------------------------------------
@@ -296,26 +958,11 @@ TJS_BEGIN_NATIVE_METHOD_DECL(/*func. name*/ _compile) {
     tjs_uint32 flags = TJSGetRegExpFlagsFromString(p);
 
     try {
-        if(_this->RegEx) {
-            onig_free(_this->RegEx);
-            _this->RegEx = nullptr;
-        }
-        OnigErrorInfo einfo;
-        int r = onig_new(&(_this->RegEx), (UChar *)exprstart,
-                         (UChar *)(expr.c_str() + expr.length()),
-                         flags & ((ONIG_OPTION_MAXBIT << 1) - 1),
-                         ONIG_ENCODING_UTF16_LE, ONIG_SYNTAX_PERL, &einfo);
-        if(r) {
-            char s[ONIG_MAX_ERROR_MESSAGE_LEN];
-            onig_error_code_to_str((UChar *)s, r, &einfo);
-            TJS_eTJSError(s);
-        }
+        _this->SetPattern(ttstr(exprstart), flags);
     } catch(std::exception &e) {
         TJS_eTJSError(e.what());
     }
 
-    _this->Flags = flags;
-
     return TJS_S_OK;
 }
 TJS_END_NATIVE_METHOD_DECL(/*func. name*/ _compile)
@@ -639,21 +1286,7 @@ void tTJSNC_RegExp::Compile(tjs_int numparams, tTJSVariant **param,
     if(expr.IsEmpty())
         expr = TJS_W("(?:)"); // generate empty regular expression
 
-    if(_this->RegEx) {
-        onig_free(_this->RegEx);
-        _this->RegEx = nullptr;
-    }
-    OnigErrorInfo einfo;
-    int r = onig_new(&(_this->RegEx), (UChar *)expr.c_str(),
-                     (UChar *)(expr.c_str() + expr.length()),
-                     flags & ((ONIG_OPTION_MAXBIT << 1) - 1),
-                     ONIG_ENCODING_UTF16_LE, ONIG_SYNTAX_PERL, &einfo);
-    if(r) {
-        char s[ONIG_MAX_ERROR_MESSAGE_LEN];
-        onig_error_code_to_str((UChar *)s, r, &einfo);
-        TJS_eTJSError(s);
-    }
-    _this->Flags = flags;
+    _this->SetPattern(expr, flags);
 }
 
 //---------------------------------------------------------------------------
@@ -669,11 +1302,8 @@ bool tTJSNC_RegExp::Match(OnigRegion *region, const ttstr &target,
         return false;
     }
     searchstart = _this->Start;
-    int r = onig_search(_this->RegEx, (UChar *)(target.c_str() + searchstart),
-                        (UChar *)(target.c_str() + targlen),
-                        (UChar *)(target.c_str() + searchstart),
-                        (UChar *)(target.c_str() + targlen), region,
-                        ONIG_OPTION_NONE);
+    int r = _this->Search(target.c_str() + searchstart,
+                          target.c_str() + targlen, region);
     return r >= 0;
 }
 
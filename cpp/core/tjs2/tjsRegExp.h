@@ -19,12 +19,16 @@
 
 namespace TJS {
 
+    // compiled pattern; shared by the RegExp objects with the same expression
+    // and flags through the pattern cache (see tjsRegExp.cpp)
+    class tTJSRegExpPattern;
+
     //---------------------------------------------------------------------------
     // tTJSNI_RegExp
     //---------------------------------------------------------------------------
     class tTJSNI_RegExp : public tTJSNativeInstance {
     public:
-        regex_t *RegEx;
+        tTJSRegExpPattern *Pattern;
         // OnigRegion* Region;
         tjs_uint32 Flags;
         tjs_uint Start;
@@ -43,6 +47,11 @@ namespace TJS {
 
         ~tTJSNI_RegExp();
 
+        void SetPattern(const ttstr &expr, tjs_uint32 flags);
+
+        int Search(const tjs_char *str, const tjs_char *end,
+                   OnigRegion *region) const;
+
         void Split(iTJSDispatch2 **array, const ttstr &target, bool purgeempty);
     };
     //---------------------------------------------------------------------------
@@ -35,7 +35,10 @@ namespace TJS {
 
         LineOffset = 0;
 
-        Owner->AddScriptBlock(this);
+        // the owner's list is for the thread running scripts
+        InOwnerList = !TJSBackgroundCompiling;
+        if(InOwnerList)
+            Owner->AddScriptBlock(this);
     }
 
     //---------------------------------------------------------------------------
@@ -59,7 +62,10 @@ namespace TJS {
 
         UsingPreProcessor = false;
 
-        Owner->AddScriptBlock(this);
+        // the owner's list is for the thread running scripts
+        InOwnerList = !TJSBackgroundCompiling;
+        if(InOwnerList)
+            Owner->AddScriptBlock(this);
     }
 
     //---------------------------------------------------------------------------
@@ -71,7 +77,8 @@ namespace TJS {
             ContextStack.pop();
         }
 
-        Owner->RemoveScriptBlock(this);
+        if(InOwnerList)
+            Owner->RemoveScriptBlock(this);
 
         delete LexicalAnalyzer;
         delete[] Script;
@@ -194,19 +201,13 @@ namespace TJS {
         blk->Owner->OutputToConsole(msg);
     }
     //---------------------------------------------------------------------------
-
-    void tTJSScriptBlock::SetText(tTJSVariant *result, const tjs_char *text,
-                                  iTJSDispatch2 *context, bool isexpression) {
-
-        // compiles text and executes its global level scripts.
-        // the script will be compiled as an expression if isexpressn
-        // is true.
-        if(!text)
-            return;
-        if(!text[0])
-            return;
-
-        TJS_D((TJS_W("Counting lines ...\n")))
+    void tTJSScriptBlock::SetScriptText(const tjs_char *text) {
+        // keeps the script text and counts its lines. blocks loaded from
+        // bytecode have no text; they get it here to show line numbers.
+        if(Script)
+            delete[] Script;
+        LineVector.clear();
+        LineLengthVector.clear();
 
         Script = new tjs_char[TJS_strlen(text) + 1];
         TJS_strcpy(Script, text);
@@ -231,6 +232,24 @@ namespace TJS {
             LineVector.push_back(int(ls - Script));
             LineLengthVector.push_back(int(p - ls));
         }
+    }
+
+    //---------------------------------------------------------------------------
+
+    void tTJSScriptBlock::SetText(tTJSVariant *result, const tjs_char *text,
+                                  iTJSDispatch2 *context, bool isexpression) {
+
+        // compiles text and executes its global level scripts.
+        // the script will be compiled as an expression if isexpressn
+        // is true.
+        if(!text)
+            return;
+        if(!text[0])
+            return;
+
+        TJS_D((TJS_W("Counting lines ...\n")))
+
+        SetScriptText(text);
 
         try {
 
@@ -603,28 +622,7 @@ namespace TJS {
 
         tTJSInterCodeContext::IsBytecodeCompile = true;
         try {
-            Script = new tjs_char[TJS_strlen(text) + 1];
-            TJS_strcpy(Script, text);
-
-            // calculation of line-count
-            tjs_char *ls = Script;
-            tjs_char *p = Script;
-            while(*p) {
-                if(*p == TJS_W('\r') || *p == TJS_W('\n')) {
-                    LineVector.push_back(int(ls - Script));
-                    LineLengthVector.push_back(int(p - ls));
-                    if(*p == TJS_W('\r') && p[1] == TJS_W('\n'))
-                        p++;
-                    p++;
-                    ls = p;
-                } else {
-                    p++;
-                }
-            }
-            if(p != ls) {
-                LineVector.push_back(int(ls - Script));
-                LineLengthVector.push_back(int(p - ls));
-            }
+            SetScriptText(text);
 
             Parse(text, isexpression, isresultneeded);
 
@@ -57,6 +57,8 @@ namespace TJS {
 
         bool UsingPreProcessor;
 
+        bool InOwnerList; // false if compiled in background
+
     public:
         tjs_int CompileErrorCount;
 
@@ -87,6 +89,7 @@ namespace TJS {
         ttstr GetLineDescriptionString(tjs_int pos) const;
 
         const tjs_char *GetScript() const { return Script; }
+        void SetScriptText(const tjs_char *text);
 
         void PushContextStack(const tjs_char *name, tTJSContextType type);
         void PopContextStack();
@@ -199,12 +199,20 @@ namespace TJS {
     void tTJSScriptCache::LoadByteCode(const tjs_uint8 *buff, size_t len,
                                        tTJSVariant *result,
                                        iTJSDispatch2 *context,
-                                       const tjs_char *name) {
+                                       const tjs_char *name,
+                                       const tjs_char *source,
+                                       tjs_int lineofs) {
         auto loader = std::make_unique<tTJSByteCodeLoader>();
         std::unique_ptr<tTJSScriptBlock, std::function<void(tTJSScriptBlock *)>>
             blk{ loader->ReadByteCode(Owner, name, buff, len),
                  [](auto *ptr) { ptr->Release(); } };
         if(blk != nullptr) {
+            if(source) {
+                // the script the bytecode was compiled from; gives line
+                // numbers to the debug positions in the bytecode
+                blk->SetName(name, lineofs);
+                blk->SetScriptText(source);
+            }
             blk->ExecuteTopLevel(result, context);
             return;
         }
@@ -81,7 +81,9 @@ namespace TJS {
         // for Bytecode
         void LoadByteCode(const tjs_uint8 *buff, size_t len,
                           tTJSVariant *result, iTJSDispatch2 *context,
-                          const tjs_char *name);
+                          const tjs_char *name,
+                          const tjs_char *source = nullptr,
+                          tjs_int lineofs = 0);
     };
     //---------------------------------------------------------------------------
 
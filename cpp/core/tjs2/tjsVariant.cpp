@@ -934,8 +934,12 @@ namespace TJS {
 
     //---------------------------------------------------------------------------
     void tTJSVariant::increment() {
-        if(vt == tvtString)
-            String->ToNumber(*this);
+        if(vt == tvtString) {
+            if(String)
+                String->ToNumber(*this);
+            else
+                *this = 0;
+        }
 
         if(vt == tvtReal) {
             TJSSetFPUE();
@@ -950,8 +954,12 @@ namespace TJS {
 
     //---------------------------------------------------------------------------
     void tTJSVariant::decrement() {
-        if(vt == tvtString)
-            String->ToNumber(*this);
+        if(vt == tvtString) {
+            if(String)
+                String->ToNumber(*this);
+            else
+                *this = 0;
+        }
 
         if(vt == tvtReal) {
             TJSSetFPUE();
@@ -1075,7 +1083,10 @@ namespace TJS {
             return; // nothing to do
 
         if(vt == tvtString) {
-            String->ToNumber(*this);
+            if(String)
+                String->ToNumber(*this);
+            else
+                *this = 0;
             return;
         }
 
@@ -1127,11 +1138,11 @@ namespace TJS {
 
                 // independ string
                 if(String && String->GetRefCount() != 0) {
-                    // sever dependency
+                    // sever dependency; the concatenation is a new string
                     tTJSVariantString *orgstr = String;
-                    String = TJSAllocVariantString(
-                        String->operator const tjs_char *());
+                    String = TJSConcatVariantString(orgstr, rhs.String);
                     orgstr->Release();
+                    return;
                 }
 
                 // append
@@ -1144,7 +1155,7 @@ namespace TJS {
             tTJSVariantString *s1, *s2;
             s1 = AsString();
             s2 = rhs.AsString();
-            val.String = TJSAllocVariantString(*s1, *s2);
+            val.String = TJSConcatVariantString(s1, s2);
             if(s1)
                 s1->Release();
             if(s2)
@@ -793,7 +793,7 @@ namespace TJS {
             // returns String
             if(vt != tvtString)
                 TJSThrowVariantConvertError(*this, tvtString);
-            return *String;
+            return String ? String->operator const tjs_char *() : nullptr;
         }
 
         TJS_METHOD_DEF(tjs_uint32 *, GetHint, ()) {
@@ -864,7 +864,7 @@ namespace TJS {
                 case tvtObject:
                     TJSThrowVariantConvertError(*this, tvtInteger);
                 case tvtString:
-                    return String->ToInteger();
+                    return String ? String->ToInteger() : 0;
                 case tvtInteger:
                     return Integer;
                 case tvtReal:
@@ -884,7 +884,10 @@ namespace TJS {
                 case tvtObject:
                     TJSThrowVariantConvertError(*this, tvtInteger, tvtReal);
                 case tvtString:
-                    String->ToNumber(targ);
+                    if(String)
+                        String->ToNumber(targ);
+                    else
+                        targ = (tjs_int)0;
                     return;
                 case tvtInteger:
                     targ = Integer;
@@ -941,7 +944,7 @@ namespace TJS {
                 case tvtObject:
                     TJSThrowVariantConvertError(*this, tvtReal);
                 case tvtString:
-                    return String->ToReal();
+                    return String ? String->ToReal() : 0;
                 case tvtInteger:
                     return (tTVReal)Integer;
                 case tvtReal:
@@ -1161,7 +1164,10 @@ namespace TJS {
 
             if(vt == tvtString) {
                 tTJSVariant val;
-                String->ToNumber(val);
+                if(String)
+                    String->ToNumber(val);
+                else
+                    val = (tjs_int)0;
                 return val;
             }
 
@@ -1210,7 +1216,7 @@ namespace TJS {
                 tTJSVariantString *s1, *s2;
                 s1 = AsString();
                 s2 = rhs.AsString();
-                val.String = TJSAllocVariantString(*s1, *s2);
+                val.String = TJSConcatVariantString(s1, s2);
                 if(s1)
                     s1->Release();
                 if(s2)
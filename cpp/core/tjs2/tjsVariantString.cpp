@@ -15,6 +15,7 @@
 #include "tjsUtils.h"
 #include "tjsLex.h"
 #include <algorithm>
+#include <vector>
 
 namespace TJS {
     //---------------------------------------------------------------------------
@@ -51,12 +52,9 @@ namespace TJS {
 // base memory allocation functions for long string
 //---------------------------------------------------------------------------
 #define TJSVS_ALLOC_INC_SIZE_S 16
-// additional space for long string heap under
-// TJSVS_ALLOC_DOUBLE_LIMIT
-#define TJSVS_ALLOC_INC_SIZE_L 4000000
-// additional space for long string heap over TJSVS_ALLOC_DOUBLE_LIMIT
+// additional space for new long string heap
 #define TJSVS_ALLOC_DOUBLE_LIMIT 4000000
-    // switching value of double-sizing or incremental-sizing
+    // switching value of double-sizing or half-sizing
     //---------------------------------------------------------------------------
     /*static inline*/ tjs_char *TJSVS_malloc(tjs_uint len) {
         char *ret = (char *)malloc((len = (len + TJSVS_ALLOC_INC_SIZE_S)) *
@@ -77,22 +75,18 @@ namespace TJS {
         if(*ptr >= len)
             return buf; // still adequate
 
-        //	char *ret = (char*)realloc(ptr,
-        //		(len = (len + TJSVS_ALLOC_INC_SIZE))*sizeof(tjs_char)
-        //+
-        // sizeof(size_t));
+        // grow geometrically, so that appending to a string many times
+        // costs linear time. a fixed increment makes it quadratic.
         if(len < TJSVS_ALLOC_DOUBLE_LIMIT)
             len = len * 2;
         else
-            len = len + TJSVS_ALLOC_INC_SIZE_L;
+            len = len + len / 2;
 
-        char *ret = (char *)malloc( // ptr,
-            len * sizeof(tjs_char) + sizeof(size_t));
+        char *ret = (char *)realloc(ptr, len * sizeof(tjs_char) +
+                                             sizeof(size_t));
         if(!ret)
             TJSThrowStringAllocError();
-        memcpy(ret + sizeof(size_t), ptr + 1, *ptr * sizeof(tjs_char));
         *(size_t *)ret = len; // embed size
-        TJSVS_free(buf);
         return (tjs_char *)(ret + sizeof(size_t));
     }
     //---------------------------------------------------------------------------
@@ -383,6 +377,7 @@ namespace TJS {
 
             ret->RefCount = 0;
             ret->Length = 0;
+            ret->RopeFlag = false;
             ret->LongString = nullptr;
             ret->HeapFlag = HEAP_FLAG_USING;
             ret->Hint = 0;
@@ -395,8 +390,14 @@ namespace TJS {
     }
 
     //---------------------------------------------------------------------------
+    static void TJSDeallocRope(tTJSVariantString *rope);
+
     void TJSDeallocStringHeap(tTJSVariantString *vs) {
         // free vs
+        if(vs->IsRope()) {
+            TJSDeallocRope(vs);
+            return;
+        }
 
         { // thread-pretected
             tTJSSpinLockHolder csh(TJSStringHeapCS);
@@ -434,6 +435,33 @@ namespace TJS {
         }
     }
     //---------------------------------------------------------------------------
+    static void TJSDeallocRope(tTJSVariantString *rope) {
+        // a rope built by a script loop is as deep as the loop was long, so
+        // the parts are released here without recursion
+        std::vector<tTJSVariantString *> parts;
+        tTJSVariantString *vs = rope;
+        while(true) {
+            // vs has no owner any longer
+            if(vs->IsRope()) {
+                parts.push_back(vs->Rope.Right);
+                parts.push_back(vs->Rope.Left);
+                vs->RopeFlag = false;
+            }
+            TJSDeallocStringHeap(vs);
+
+            // next part which loses its last owner
+            do {
+                if(parts.empty())
+                    return;
+                vs = parts.back();
+                parts.pop_back();
+                if(vs->RefCount == 0)
+                    break;
+                vs->RefCount--;
+            } while(true);
+        }
+    }
+    //---------------------------------------------------------------------------
 
     //---------------------------------------------------------------------------
     // tTJSVariantString
@@ -491,9 +519,58 @@ namespace TJS {
         dest = 0;
     }
 
+    //---------------------------------------------------------------------------
+    static tTJSSpinLock TJSStringRopeCS;
+    void tTJSVariantString::Flatten() {
+        // build the text of the rope, and release the parts
+        tTJSVariantString *left, *right;
+        { // thread-protected
+            tTJSSpinLockHolder csh(TJSStringRopeCS);
+            if(!RopeFlag.load(std::memory_order_relaxed))
+                return; // flattened by another thread
+
+            tjs_char *buf = TJSVS_malloc(Length + 1);
+            tjs_char *p = buf;
+            std::vector<const tTJSVariantString *> parts{ Rope.Right,
+                                                          Rope.Left };
+            while(!parts.empty()) {
+                const tTJSVariantString *vs = parts.back();
+                parts.pop_back();
+                if(vs->IsRope()) {
+                    // parts of the parts are not flattened; they may never
+                    // be used by themselves
+                    parts.push_back(vs->Rope.Right);
+                    parts.push_back(vs->Rope.Left);
+                    continue;
+                }
+                memcpy(p, vs->LongString ? vs->LongString : vs->ShortString,
+                       vs->Length * sizeof(tjs_char));
+                p += vs->Length;
+            }
+            *p = 0;
+
+            left = Rope.Left;
+            right = Rope.Right;
+            LongString = buf;
+            // threads which see the flag cleared see the text as well
+            RopeFlag.store(false, std::memory_order_release);
+        } // end-of-thread-protected
+
+        left->Release();
+        right->Release();
+    }
+    //---------------------------------------------------------------------------
+    void tTJSVariantString::ReleaseRope() {
+        tTJSVariantString *left = Rope.Left, *right = Rope.Right;
+        RopeFlag = false;
+        left->Release();
+        right->Release();
+    }
     //---------------------------------------------------------------------------
     tTJSVariantString::operator const tjs_char *() const {
-        return (!this) ? (nullptr) : (LongString ? LongString : ShortString);
+        if(IsRope())
+            const_cast<tTJSVariantString *>(this)->Flatten();
+        return LongString ? LongString : ShortString;
     }
 
     //---------------------------------------------------------------------------
@@ -615,6 +692,43 @@ namespace TJS {
         return ret;
     }
 
+    //---------------------------------------------------------------------------
+    tTJSVariantString *TJSConcatVariantString(tTJSVariantString *s1,
+                                              tTJSVariantString *s2) {
+        // returns a new reference to the concatenation of s1 and s2.
+        // s1 and s2 are not changed.
+        if(!s1 || !s2) {
+            tTJSVariantString *ret = s1 ? s1 : s2;
+            if(ret)
+                ret->AddRef();
+            return ret;
+        }
+
+        tjs_int len = s1->Length + s2->Length;
+#ifndef TJS_VS_NO_ROPE
+        if(len >= TJS_VS_ROPE_MIN_LEN) {
+            // refer to s1 and s2 instead of copying them. a script which
+            // builds a long string by "s = s + x" copies the string only
+            // once, when the result is used.
+            tTJSVariantString *ret = TJSAllocStringHeap();
+            s1->AddRef();
+            s2->AddRef();
+            ret->Rope.Left = s1;
+            ret->Rope.Right = s2;
+            ret->Length = len;
+            ret->RopeFlag = true;
+            return ret;
+        }
+#endif
+
+        tTJSVariantString *ret = TJSAllocVariantStringBuffer(len);
+        tjs_char *p = const_cast<tjs_char *>(ret->operator const tjs_char *());
+        memcpy(p, s1->operator const tjs_char *(),
+               s1->Length * sizeof(tjs_char));
+        memcpy(p + s1->Length, s2->operator const tjs_char *(),
+               s2->Length * sizeof(tjs_char));
+        return ret;
+    }
     //---------------------------------------------------------------------------
     tTJSVariantString *TJSAppendVariantString(tTJSVariantString *str,
                                               const tjs_char *app) {
@@ -21,12 +21,15 @@ namespace TJS {
 // #define TJS_DEBUG_UNRELEASED_STRING
 // #define TJS_DEBUG_CHECK_STRING_HEAP_INTEGRITY
 // #define TJS_DEBUG_DUMP_STRING
+// #define TJS_VS_NO_ROPE
 
 /*[*/
 //---------------------------------------------------------------------------
 // tTJSVariantString stuff
 //---------------------------------------------------------------------------
 #define TJS_VS_SHORT_LEN 21
+#define TJS_VS_ROPE_MIN_LEN 256
+// concatenation results of this length or longer are made ropes
 
     /*]*/
     class tTJSVariantString;
@@ -57,8 +60,15 @@ namespace TJS {
     struct tTJSVariantString_S {
         std::atomic_long RefCount{};
         tjs_char *LongString{};
-        tjs_char ShortString[TJS_VS_SHORT_LEN + 1]{};
+        union {
+            tjs_char ShortString[TJS_VS_SHORT_LEN + 1]{};
+            struct {
+                tTJSVariantString *Left;
+                tTJSVariantString *Right;
+            } Rope; // see tTJSVariantString::IsRope
+        };
         tjs_int Length{}; // string length
+        std::atomic_bool RopeFlag{}; // see tTJSVariantString::IsRope
         tjs_uint32 HeapFlag{};
         tjs_uint32 Hint{};
     };
@@ -71,9 +81,28 @@ namespace TJS {
 
         void Release();
 
-        void SetString(const tjs_char *ref, ssize_t maxlen = -1) {
+        bool IsRope() const {
+            // a rope has no buffer; the text is that of Rope.Left followed by
+            // that of Rope.Right, and is built on the first request of the
+            // buffer. a rope may be shared by threads before that, so
+            // Flatten clears the flag only after LongString is complete.
+            return RopeFlag.load(std::memory_order_acquire);
+        }
+
+        void Flatten();
+
+        void ReleaseRope();
+
+        void FreeBuffer() {
             if(LongString)
                 TJSVS_free(LongString), LongString = nullptr;
+            else if(IsRope())
+                ReleaseRope();
+            Length = 0;
+        }
+
+        void SetString(const tjs_char *ref, ssize_t maxlen = -1) {
+            FreeBuffer();
             tjs_int len;
             if(maxlen != -1)
                 len = TJSGetShorterStrLen(ref, maxlen);
@@ -90,8 +119,7 @@ namespace TJS {
         }
 
         void SetString(const tjs_nchar *ref) {
-            if(LongString)
-                TJSVS_free(LongString), LongString = nullptr;
+            FreeBuffer();
             tjs_int len = (tjs_int)TJS_narrowtowidelen(ref);
             if(len == -1)
                 TJSThrowNarrowToWideConversionError();
@@ -110,8 +138,7 @@ namespace TJS {
             /* note that you must call FixLength if you allocate
                larger than the actual string size */
 
-            if(LongString)
-                TJSVS_free(LongString), LongString = nullptr;
+            FreeBuffer();
 
             Length = len;
             if(len > TJS_VS_SHORT_LEN) {
@@ -122,17 +149,15 @@ namespace TJS {
             }
         }
 
-        void ResetString(const tjs_char *ref) {
-            if(LongString)
-                TJSVS_free(LongString), LongString = nullptr;
-            SetString(ref);
-        }
+        void ResetString(const tjs_char *ref) { SetString(ref); }
 
         void AppendBuffer(tjs_uint applen) {
             /* note that you must call FixLength if you allocate
                larger than the actual string size */
 
             // assume this != nullptr
+            if(IsRope())
+                Flatten();
             tjs_int newlen = Length += applen;
             if(LongString) {
                 // still long string
@@ -161,6 +186,8 @@ namespace TJS {
 
         void Append(const tjs_char *str, tjs_int applen) {
             // assume this != nullptr
+            if(IsRope())
+                Flatten();
             tjs_int orglen = Length;
             tjs_int newlen = Length += applen;
             if(LongString) {
@@ -206,7 +233,7 @@ namespace TJS {
 
         void Persist(tjs_uint8 *dest) const {
             tjs_uint size;
-            const tjs_char *ptr = LongString ? LongString : ShortString;
+            const tjs_char *ptr = this->operator const tjs_char *();
             *(tjs_uint *)dest = size = GetLength();
             dest += sizeof(tjs_uint);
             while(size--) {
@@ -236,6 +263,9 @@ namespace TJS {
     TJS_EXP_FUNC_DEF(tTJSVariantString *, TJSAppendVariantString,
                      (tTJSVariantString * str, const tjs_char *app));
 
+    tTJSVariantString *TJSConcatVariantString(tTJSVariantString *s1,
+                                              tTJSVariantString *s2);
+
     TJS_EXP_FUNC_DEF(tTJSVariantString *, TJSAppendVariantString,
                      (tTJSVariantString * str, const tTJSVariantString *app));
 
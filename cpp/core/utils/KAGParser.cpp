@@ -9,8 +9,12 @@
 // KAG Parser Utility Class
 //---------------------------------------------------------------------------
 
+#include <algorithm>
+#include <unordered_map>
+
 #include "KAGParser.h"
 #include "EventIntf.h"
+#include "ScriptByteCodeCache.h"
 
 namespace TJS {
     ttstr TJSMapGlobalStringMap(const ttstr &string);
@@ -59,10 +63,23 @@ const tjs_char *TVPUnknownMacroName = TJS_W("Unknown macro \"%1\"");
 #define TVPThrowInternalError                                                  \
     TVPThrowExceptionMessage(TVPInternalError, __FILE__, __LINE__)
 
+//---------------------------------------------------------------------------
+static bool inline TVPIsWS(tjs_char ch) {
+    // is white space ?
+    return (ch == TJS_W(' ') || ch == TJS_W('\t'));
+}
+
+//---------------------------------------------------------------------------
+// increase this when the tokenized form of the scenario tags changes
+#define TVP_SCENARIO_TAG_CACHE_FORMAT 1
+
 #undef TJS_NATIVE_SET_ClassID
 #define TJS_NATIVE_SET_ClassID ClassID_KAGParser = TJS_NCM_CLASSID;
 static tjs_int32 ClassID_KAGParser = -1;
 
+//---------------------------------------------------------------------------
+bool TVPKAGUseTokenizedTags = true;
+
 //---------------------------------------------------------------------------
 // tTVPScenarioCacheItem : Scenario Cache Item
 //---------------------------------------------------------------------------
@@ -96,6 +113,7 @@ void tTVPScenarioCacheItem::Release() {
 //---------------------------------------------------------------------------
 void tTVPScenarioCacheItem::LoadScenario(const ttstr &name, bool isstring) {
     // load scenario from file or string to buffer
+    ttstr text; // file content, to check the cached tags
 
     if(isstring) {
         // when onScenarioLoad returns string;
@@ -111,11 +129,10 @@ void tTVPScenarioCacheItem::LoadScenario(const ttstr &name, bool isstring) {
             //			stream =
             // TVPCreateTextStreamForReadByEncoding(name, TJS_W(""),
             // TJS_W("Shift_JIS"));
-            ttstr tmp;
             if(stream) {
-                stream->Read(tmp, 0);
+                stream->Read(text, 0);
             }
-            Buffer = tmp.c_str();
+            Buffer = text.c_str();
         } catch(...) {
             if(stream)
                 stream->Destruct();
@@ -187,6 +204,20 @@ void tTVPScenarioCacheItem::LoadScenario(const ttstr &name, bool isstring) {
     LineCount = count;
     // tab-only last line will not be counted in pass2, thus makes
     // pass2 counted lines are lesser than pass1 lines.
+
+    // tokenize the tags, or read the tags tokenized for the same file before
+    std::vector<tjs_uint8> data;
+    if(isstring ||
+       !TVPReadCompiledCache(name, "ksc", TVP_SCENARIO_TAG_CACHE_FORMAT, text,
+                             data) ||
+       !UnserializeTags(data)) {
+        CompileTags();
+        if(!isstring) {
+            SerializeTags(data);
+            TVPWriteCompiledCache(name, "ksc", TVP_SCENARIO_TAG_CACHE_FORMAT,
+                                  text, data);
+        }
+    }
 }
 
 //---------------------------------------------------------------------------
@@ -237,6 +268,407 @@ void tTVPScenarioCacheItem::EnsureLabelCache() {
 }
 //---------------------------------------------------------------------------
 
+//---------------------------------------------------------------------------
+// scenario tags
+//---------------------------------------------------------------------------
+// the tags are tokenized once when the scenario is loaded; _GetNextTag only
+// stores the attributes of a tokenized tag into the dictionary. the result
+// for a scenario file is cached in the bytecode cache directory.
+//---------------------------------------------------------------------------
+static void TVPUnescapeKAGValue(ttstr &value, bool &entity, bool &macroarg) {
+    // unescape ` character of value
+    if(value.IsEmpty())
+        return;
+
+    // value has at least one character
+    tjs_char *vp = value.Independ();
+    tjs_char *wvp = vp;
+
+    if(!entity && *vp == TJS_W('&'))
+        entity = true, vp++;
+    if(!macroarg && *vp == TJS_W('%'))
+        macroarg = true, vp++;
+
+    while(*vp) {
+        if(*vp == TJS_W('`')) {
+            vp++;
+            if(!*vp)
+                break;
+        }
+        *wvp = *vp;
+        vp++;
+        wvp++;
+    }
+    *wvp = 0;
+    value.FixLen();
+}
+
+//---------------------------------------------------------------------------
+static bool
+TVPTokenizeScenarioTag(const tjs_char *line, tjs_int pos, tjs_char ldelim,
+                       tTVPScenarioTag &tag,
+                       std::vector<tTVPScenarioTagAttrib> &attribs) {
+    // read the tag at "pos" the same way as _GetNextTag does. returns false
+    // where _GetNextTag throws a syntax error, or goes past the end of the
+    // line; _GetNextTag reads such a tag by itself.
+    tjs_int p = pos + 1;
+
+    // tag name
+    while(TVPIsWS(line[p]))
+        p++;
+    if(line[p] == 0)
+        return false;
+    tjs_int namestart = p;
+    while(line[p] && !TVPIsWS(line[p]) && line[p] != ldelim)
+        p++;
+    if(p == namestart)
+        return false;
+
+    ttstr tagname(line + namestart, p - namestart);
+    tagname.ToLowerCase();
+    tag.Start = pos;
+    tag.Name = TJSMapGlobalStringMap(tagname);
+    tag.AttribStart = (tjs_int)attribs.size();
+
+    // tag attributes
+    while(true) {
+        while(TVPIsWS(line[p]))
+            p++;
+
+        if(line[p] == ldelim) {
+            tag.End = p;
+            tag.AttribCount = (tjs_int)attribs.size() - tag.AttribStart;
+            return true;
+        }
+
+        if(line[p] == 0)
+            return false;
+
+        tTVPScenarioTagAttrib attrib;
+        attrib.Entity = false;
+        attrib.MacroArg = false;
+        attrib.MacroArgAll = false;
+
+        if(line[p] == TJS_W('*')) {
+            // macro entity all
+            attrib.MacroArgAll = true;
+            attribs.push_back(attrib);
+            p++;
+            while(line[p] && TVPIsWS(line[p]))
+                p++;
+            continue;
+        }
+
+        namestart = p;
+        while(line[p] && !TVPIsWS(line[p]) && line[p] != TJS_W('=') &&
+              line[p] != ldelim)
+            p++;
+        ttstr attribname(line + namestart, p - namestart);
+        attribname.ToLowerCase();
+        attrib.Name = TJSMapGlobalStringMap(attribname);
+
+        // =
+        while(TVPIsWS(line[p]))
+            p++;
+
+        if(line[p] != TJS_W('=')) {
+            // arrtibute value omitted
+            attrib.Value = TJS_W("true");
+        } else {
+            p++;
+            while(line[p] && TVPIsWS(line[p]))
+                p++;
+            if(line[p] == 0)
+                return false;
+
+            // attrib value
+            tjs_char vdelim = 0; // value delimiter
+
+            if(line[p] == TJS_W('&'))
+                attrib.Entity = true, p++;
+            else if(line[p] == TJS_W('%'))
+                attrib.MacroArg = true, p++;
+
+            if(line[p] == TJS_W('\"') || line[p] == TJS_W('\'')) {
+                vdelim = line[p];
+                p++;
+            }
+
+            tjs_int valuestart = p;
+
+            while(line[p] &&
+                  (vdelim ? (line[p] != vdelim)
+                          : (line[p] != ldelim && !TVPIsWS(line[p])))) {
+                if(line[p] == TJS_W('`')) {
+                    // escaped with '`'
+                    p++;
+                    if(line[p] == 0)
+                        return false;
+                }
+                p++;
+            }
+
+            // an unterminated quote makes _GetNextTag step over the end of
+            // a line command
+            if(line[p] == 0 && (ldelim != 0 || vdelim))
+                return false;
+
+            attrib.Value = ttstr(line + valuestart, p - valuestart);
+
+            if(vdelim)
+                p++;
+
+            TVPUnescapeKAGValue(attrib.Value, attrib.Entity, attrib.MacroArg);
+        }
+
+        attribs.push_back(attrib);
+    }
+}
+
+//---------------------------------------------------------------------------
+static bool TVPIsInlineScriptLine(const tjs_char *p, const tjs_char *tag) {
+    // [tag], [tag]\ or @tag, as SkipCommentOrLabel finds them
+    tjs_int len = (tjs_int)TJS_strlen(tag);
+    if(p[0] == TJS_W('['))
+        return !TJS_strncmp(p + 1, tag, len) && p[len + 1] == TJS_W(']') &&
+            (p[len + 2] == 0 ||
+             (p[len + 2] == TJS_W('\\') && p[len + 3] == 0));
+    if(p[0] == TJS_W('@'))
+        return !TJS_strcmp(p + 1, tag);
+    return false;
+}
+
+//---------------------------------------------------------------------------
+void tTVPScenarioCacheItem::CompileTags() {
+    Tags.clear();
+    TagAttribs.clear();
+    LineTags.resize(LineCount + 1);
+
+    bool inscript = false;
+    for(tjs_int i = 0; i < LineCount; i++) {
+        LineTags[i] = (tjs_int)Tags.size();
+        const tjs_char *line = Lines[i].Start;
+
+        // comments, labels and inline scripts are not parsed as tags
+        if(inscript) {
+            if(TVPIsInlineScriptLine(line, TJS_W("endscript")))
+                inscript = false;
+            continue;
+        }
+        if(line[0] == TJS_W(';') || line[0] == TJS_W('*'))
+            continue;
+        if(TVPIsInlineScriptLine(line, TJS_W("iscript"))) {
+            inscript = true;
+            continue;
+        }
+
+        tTVPScenarioTag tag;
+        size_t attribcount = TagAttribs.size();
+        if(line[0] == TJS_W('@')) {
+            // line command
+            if(TVPTokenizeScenarioTag(line, 0, 0, tag, TagAttribs))
+                Tags.push_back(tag);
+            else
+                TagAttribs.resize(attribcount);
+            continue;
+        }
+
+        for(tjs_int p = 0; line[p];) {
+            if(line[p] != TJS_W('[')) {
+                p++;
+            } else if(line[p + 1] == TJS_W('[')) {
+                p += 2; // escaped '['
+            } else {
+                if(!TVPTokenizeScenarioTag(line, p, TJS_W(']'), tag,
+                                           TagAttribs)) {
+                    TagAttribs.resize(attribcount);
+                    break;
+                }
+                Tags.push_back(tag);
+                attribcount = TagAttribs.size();
+                p = tag.End + 1;
+            }
+        }
+    }
+    LineTags[LineCount] = (tjs_int)Tags.size();
+}
+
+//---------------------------------------------------------------------------
+const tTVPScenarioTag *tTVPScenarioCacheItem::FindTag(tjs_int line,
+                                                      tjs_int pos) const {
+    if(line < 0 || line >= (tjs_int)LineTags.size() - 1)
+        return nullptr;
+    auto begin = Tags.begin() + LineTags[line];
+    auto end = Tags.begin() + LineTags[line + 1];
+    auto i = std::lower_bound(begin, end, pos,
+                              [](const tTVPScenarioTag &tag, tjs_int start) {
+                                  return tag.Start < start;
+                              });
+    return i != end && i->Start == pos ? &*i : nullptr;
+}
+
+//---------------------------------------------------------------------------
+// serialized form : the name table, the numbers of the tags and attributes,
+// LineTags, the tags, then the attributes, in the native byte order. tag and
+// attribute names are stored once in the name table and referred by index.
+//---------------------------------------------------------------------------
+static void TVPPutScenarioInt(std::vector<tjs_uint8> &data, tjs_int v) {
+    const auto *p = reinterpret_cast<const tjs_uint8 *>(&v);
+    data.insert(data.end(), p, p + sizeof(v));
+}
+
+static void TVPPutScenarioStr(std::vector<tjs_uint8> &data, const ttstr &v) {
+    tjs_int len = v.IsEmpty() ? 0 : v.GetLen();
+    TVPPutScenarioInt(data, len);
+    const auto *p = reinterpret_cast<const tjs_uint8 *>(v.c_str());
+    data.insert(data.end(), p, p + len * sizeof(tjs_char));
+}
+
+//---------------------------------------------------------------------------
+void tTVPScenarioCacheItem::SerializeTags(std::vector<tjs_uint8> &data) const {
+    // names are interned by CompileTags, so the string object identifies
+    // the name
+    std::vector<ttstr> names;
+    std::unordered_map<const tTJSVariantString *, tjs_int> nameindex;
+    auto getname = [&names, &nameindex](const ttstr &name) {
+        auto r = nameindex.emplace(name.AsVariantStringNoAddRef(),
+                                   (tjs_int)names.size());
+        if(r.second)
+            names.push_back(name);
+        return r.first->second;
+    };
+    std::vector<tjs_int> tagnames, attribnames;
+    tagnames.reserve(Tags.size());
+    for(const auto &tag : Tags)
+        tagnames.push_back(getname(tag.Name));
+    attribnames.reserve(TagAttribs.size());
+    for(const auto &attrib : TagAttribs)
+        attribnames.push_back(getname(attrib.Name));
+
+    data.clear();
+    TVPPutScenarioInt(data, (tjs_int)names.size());
+    for(const auto &name : names)
+        TVPPutScenarioStr(data, name);
+    TVPPutScenarioInt(data, (tjs_int)Tags.size());
+    TVPPutScenarioInt(data, (tjs_int)TagAttribs.size());
+    for(tjs_int n : LineTags)
+        TVPPutScenarioInt(data, n);
+    for(size_t i = 0; i < Tags.size(); i++) {
+        const tTVPScenarioTag &tag = Tags[i];
+        TVPPutScenarioInt(data, tag.Start);
+        TVPPutScenarioInt(data, tag.End);
+        TVPPutScenarioInt(data, tag.AttribStart);
+        TVPPutScenarioInt(data, tag.AttribCount);
+        TVPPutScenarioInt(data, tagnames[i]);
+    }
+    for(size_t i = 0; i < TagAttribs.size(); i++) {
+        const tTVPScenarioTagAttrib &attrib = TagAttribs[i];
+        TVPPutScenarioInt(data, (attrib.Entity ? 1 : 0) |
+                              (attrib.MacroArg ? 2 : 0) |
+                              (attrib.MacroArgAll ? 4 : 0));
+        TVPPutScenarioInt(data, attribnames[i]);
+        TVPPutScenarioStr(data, attrib.Value);
+    }
+}
+
+//---------------------------------------------------------------------------
+bool tTVPScenarioCacheItem::UnserializeTags(
+    const std::vector<tjs_uint8> &data) {
+    if(ReadTags(data))
+        return true;
+    // no tags; every tag is read by the character scanner
+    Tags.clear();
+    TagAttribs.clear();
+    LineTags.assign(LineCount + 1, 0);
+    return false;
+}
+
+//---------------------------------------------------------------------------
+bool tTVPScenarioCacheItem::ReadTags(const std::vector<tjs_uint8> &data) {
+    const tjs_uint8 *p = data.data();
+    const tjs_uint8 *end = p + data.size();
+    auto getint = [&p, end](tjs_int &v) {
+        if(end - p < (ptrdiff_t)sizeof(v))
+            return false;
+        memcpy(&v, p, sizeof(v));
+        p += sizeof(v);
+        return true;
+    };
+    auto getstr = [&p, end, &getint](ttstr &v) {
+        tjs_int len;
+        if(!getint(len) || len < 0 ||
+           (end - p) / (ptrdiff_t)sizeof(tjs_char) < len)
+            return false;
+        // ttstr(const tjs_char *, n) looks one character past n, which is
+        // beyond the end of the data for the last string
+        v.Clear();
+        if(len)
+            memcpy(v.AllocBuffer(len), p, len * sizeof(tjs_char));
+        p += len * sizeof(tjs_char);
+        return true;
+    };
+
+    tjs_int namecount;
+    if(!getint(namecount) || namecount < 0 ||
+       namecount > (end - p) / (ptrdiff_t)sizeof(tjs_int))
+        return false;
+    std::vector<ttstr> names(namecount);
+    for(auto &name : names) {
+        if(!getstr(name))
+            return false;
+        name = TJSMapGlobalStringMap(name);
+    }
+    auto getname = [&getint, &names](ttstr &v) {
+        tjs_int n;
+        if(!getint(n) || n < 0 || n >= (tjs_int)names.size())
+            return false;
+        v = names[n];
+        return true;
+    };
+
+    tjs_int tagcount, attribcount;
+    if(!getint(tagcount) || !getint(attribcount) || tagcount < 0 ||
+       attribcount < 0)
+        return false;
+
+    // the positions must be in the lines of this scenario
+    LineTags.resize(LineCount + 1);
+    for(tjs_int &n : LineTags)
+        if(!getint(n) || n < 0 || n > tagcount)
+            return false;
+    Tags.resize(tagcount);
+    for(tjs_int i = 0; i < LineCount; i++) {
+        if(LineTags[i] > LineTags[i + 1])
+            return false;
+        for(tjs_int t = LineTags[i]; t < LineTags[i + 1]; t++) {
+            tTVPScenarioTag &tag = Tags[t];
+            if(!getint(tag.Start) || !getint(tag.End) ||
+               !getint(tag.AttribStart) || !getint(tag.AttribCount) ||
+               !getname(tag.Name))
+                return false;
+            if(tag.Start < 0 || tag.End <= tag.Start ||
+               tag.End > Lines[i].Length || tag.AttribStart < 0 ||
+               tag.AttribCount < 0 ||
+               tag.AttribCount > attribcount - tag.AttribStart)
+                return false;
+        }
+    }
+    if(LineTags[LineCount] != tagcount)
+        return false;
+
+    TagAttribs.resize(attribcount);
+    for(auto &attrib : TagAttribs) {
+        tjs_int flags;
+        if(!getint(flags) || !getname(attrib.Name) || !getstr(attrib.Value))
+            return false;
+        attrib.Entity = (flags & 1) != 0;
+        attrib.MacroArg = (flags & 2) != 0;
+        attrib.MacroArgAll = (flags & 4) != 0;
+    }
+    return p == end;
+}
+//---------------------------------------------------------------------------
+
 //---------------------------------------------------------------------------
 // tTVPScenarioCache
 //---------------------------------------------------------------------------
@@ -1004,12 +1436,6 @@ void tTJSNI_KAGParser::BreakConditionAndMacro() {
     // clear macro argument down to current base stack position
 }
 
-//---------------------------------------------------------------------------
-static bool inline TVPIsWS(tjs_char ch) {
-    // is white space ?
-    return (ch == TJS_W(' ') || ch == TJS_W('\t'));
-}
-
 //---------------------------------------------------------------------------
 void tTJSNI_KAGParser::GoToLabel(const ttstr &name) {
     // search label and set current position
@@ -1204,6 +1630,76 @@ void tTJSNI_KAGParser::PushMacroArgs(iTJSDispatch2 *args) {
     DicAssign->FuncCall(0, nullptr, nullptr, nullptr, 1, &psrc, dsp);
 }
 
+//---------------------------------------------------------------------------
+void tTJSNI_KAGParser::AssignMacroArgsToTag(const ttstr &tagname) {
+    if(RecordingMacro)
+        return;
+
+    iTJSDispatch2 *dsp = GetMacroTopNoAddRef();
+    if(dsp) {
+        // assign macro arguments to current arguments
+        tTJSVariant src(dsp, dsp);
+        tTJSVariant *psrc = &src;
+        DicAssign->FuncCall(0, nullptr, nullptr, nullptr, 1, &psrc, DicObj);
+    }
+    static ttstr __tag_name(TJSMapGlobalStringMap(TJS_W("tagname")));
+    tTJSVariant tag_val(tagname);
+    DicObj->PropSetByVS(TJS_MEMBERENSURE, __tag_name.AsVariantStringNoAddRef(),
+                        &tag_val, DicObj);
+    // reset tag_name
+}
+
+//---------------------------------------------------------------------------
+void tTJSNI_KAGParser::StoreTagAttrib(const ttstr &name, const ttstr &value,
+                                      bool entity, bool macroarg, bool elsif,
+                                      bool &condition) {
+    // special attibute processing
+    bool store = true;
+    if((!RecordingMacro && ExcludeLevel == -1) || elsif) {
+        // process expression entity or macro argument
+        if(entity) {
+            TVPExecuteExpression(value, Owner, &ValueVariant);
+            if(ValueVariant.Type() != tvtVoid)
+                ValueVariant.ToString();
+        } else if(macroarg) {
+            iTJSDispatch2 *args = GetMacroTopNoAddRef();
+            if(args) {
+                const tjs_char *vp = TJS_strchr(value.c_str(), TJS_W('|'));
+
+                if(vp) {
+                    ttstr argname(value.c_str(), vp - value.c_str());
+                    args->PropGet(0, argname.c_str(), nullptr, &ValueVariant,
+                                  args);
+                    if(ValueVariant.Type() == tvtVoid)
+                        ValueVariant = ttstr(vp + 1);
+                } else {
+                    args->PropGet(0, value.c_str(), nullptr, &ValueVariant,
+                                  args);
+                }
+
+            } else {
+                ValueVariant = value;
+            }
+        } else {
+            ValueVariant = value;
+        }
+
+        if(name == TJS_W("cond")) {
+            // condition
+
+            tTJSVariant val;
+            TVPExecuteExpression(ttstr(ValueVariant), Owner, &val);
+            condition = val.operator bool();
+            store = false;
+        }
+    }
+
+    // store value into the dictionary object
+    if(store)
+        DicObj->PropSetByVS(TJS_MEMBERENSURE, name.AsVariantStringNoAddRef(),
+                            &ValueVariant, DicObj);
+}
+
 //---------------------------------------------------------------------------
 void tTJSNI_KAGParser::PopMacroArgs() {
     if(MacroArgStackDepth == 0)
@@ -1518,26 +2014,38 @@ parse_start:
         bool condition = true;
         TagLine = CurLine;
         tjs_int tagstart = CurPos;
-        CurPos++;
 
-        if(CurLineStr[CurPos] == 0)
-            TVPThrowExceptionMessage(TVPKAGSyntaxError);
+        // tags of the scenario lines are tokenized in advance; the lines
+        // expanded from macros or [emb] are read here
+        const tTVPScenarioTag *compiledtag = nullptr;
+        if(!LineBufferUsing && Scenario && TVPKAGUseTokenizedTags)
+            compiledtag = Scenario->FindTag(CurLine, CurPos);
 
-        // tag name
-        while(TVPIsWS(CurLineStr[CurPos]))
-            CurPos++;
-        if(CurLineStr[CurPos] == 0)
-            TVPThrowExceptionMessage(TVPKAGSyntaxError);
-        const tjs_char *tagnamestart = CurLineStr + CurPos;
-        while(CurLineStr[CurPos] && !TVPIsWS(CurLineStr[CurPos]) &&
-              CurLineStr[CurPos] != ldelim)
+        ttstr tagname;
+        if(compiledtag) {
+            tagname = compiledtag->Name;
+        } else {
             CurPos++;
 
-        if(tagnamestart == CurLineStr + CurPos)
-            TVPThrowExceptionMessage(TVPKAGSyntaxError);
+            if(CurLineStr[CurPos] == 0)
+                TVPThrowExceptionMessage(TVPKAGSyntaxError);
+
+            // tag name
+            while(TVPIsWS(CurLineStr[CurPos]))
+                CurPos++;
+            if(CurLineStr[CurPos] == 0)
+                TVPThrowExceptionMessage(TVPKAGSyntaxError);
+            const tjs_char *tagnamestart = CurLineStr + CurPos;
+            while(CurLineStr[CurPos] && !TVPIsWS(CurLineStr[CurPos]) &&
+                  CurLineStr[CurPos] != ldelim)
+                CurPos++;
+
+            if(tagnamestart == CurLineStr + CurPos)
+                TVPThrowExceptionMessage(TVPKAGSyntaxError);
 
-        ttstr tagname(tagnamestart, CurLineStr + CurPos - tagnamestart);
-        tagname.ToLowerCase();
+            tagname = ttstr(tagnamestart, CurLineStr + CurPos - tagnamestart);
+            tagname.ToLowerCase();
+        }
         {
 
             tTJSVariant tag_val(tagname);
@@ -1597,6 +2105,22 @@ parse_start:
         if(tagkind == tag_macro)
             RecordingMacroName.Clear();
 
+        if(compiledtag) {
+            // store the tokenized attributes, then go on to the end of the
+            // tag below
+            CurPos = compiledtag->End;
+            const tTVPScenarioTagAttrib *attrib =
+                Scenario->GetTagAttribs(compiledtag);
+            for(tjs_int i = 0; i < compiledtag->AttribCount; i++, attrib++) {
+                if(attrib->MacroArgAll)
+                    AssignMacroArgsToTag(tagname);
+                else
+                    StoreTagAttrib(attrib->Name, attrib->Value, attrib->Entity,
+                                   attrib->MacroArg, tagkind == tag_elsif,
+                                   condition);
+            }
+        }
+
 #define TVP_KAG_STEP_NEXT                                                      \
     if(ldelim == 0) {                                                          \
         CurLine++;                                                             \
@@ -2011,21 +2535,7 @@ parse_start:
             // attrib name
             if(CurLineStr[CurPos] == TJS_W('*')) {
                 // macro entity all
-                if(!RecordingMacro) {
-                    iTJSDispatch2 *dsp = GetMacroTopNoAddRef();
-                    if(dsp) {
-                        // assign macro arguments to current arguments
-                        tTJSVariant src(dsp, dsp);
-                        tTJSVariant *psrc = &src;
-                        DicAssign->FuncCall(0, nullptr, nullptr, nullptr, 1,
-                                            &psrc, DicObj);
-                    }
-                    tTJSVariant tag_val(tagname);
-                    DicObj->PropSetByVS(TJS_MEMBERENSURE,
-                                        __tag_name.AsVariantStringNoAddRef(),
-                                        &tag_val, DicObj);
-                    // reset tag_name
-                }
+                AssignMacroArgsToTag(tagname);
 
                 CurPos++;
                 while(CurLineStr[CurPos] && TVPIsWS(CurLineStr[CurPos]))
@@ -2102,81 +2612,12 @@ parse_start:
                 if(vdelim)
                     CurPos++;
 
-                // unescape ` character of value
                 value = ttstr(valuestart, valueend - valuestart);
-                if(valueend != valuestart) {
-                    // value has at least one character
-                    tjs_char *vp = value.Independ();
-                    tjs_char *wvp = vp;
-
-                    if(!entity && *vp == TJS_W('&'))
-                        entity = true, vp++;
-                    if(!macroarg && *vp == TJS_W('%'))
-                        macroarg = true, vp++;
-
-                    while(*vp) {
-                        if(*vp == TJS_W('`')) {
-                            vp++;
-                            if(!*vp)
-                                break;
-                        }
-                        *wvp = *vp;
-                        vp++;
-                        wvp++;
-                    }
-                    *wvp = 0;
-                    value.FixLen();
-                }
-            }
-
-            // special attibute processing
-            bool store = true;
-            if((!RecordingMacro && ExcludeLevel == -1) ||
-               tagkind == tag_elsif) {
-                // process expression entity or macro argument
-                if(entity) {
-                    TVPExecuteExpression(value, Owner, &ValueVariant);
-                    if(ValueVariant.Type() != tvtVoid)
-                        ValueVariant.ToString();
-                } else if(macroarg) {
-                    iTJSDispatch2 *args = GetMacroTopNoAddRef();
-                    if(args) {
-                        tjs_char *vp = TJS_strchr(
-                            const_cast<tjs_char *>(value.c_str()), TJS_W('|'));
-
-                        if(vp) {
-                            ttstr name(value.c_str(), vp - value.c_str());
-                            args->PropGet(0, name.c_str(), nullptr,
-                                          &ValueVariant, args);
-                            if(ValueVariant.Type() == tvtVoid)
-                                ValueVariant = ttstr(vp + 1);
-                        } else {
-                            args->PropGet(0, value.c_str(), nullptr,
-                                          &ValueVariant, args);
-                        }
-
-                    } else {
-                        ValueVariant = value;
-                    }
-                } else {
-                    ValueVariant = value;
-                }
-
-                if(attribname == TJS_W("cond")) {
-                    // condition
-
-                    tTJSVariant val;
-                    TVPExecuteExpression(ttstr(ValueVariant), Owner, &val);
-                    condition = val.operator bool();
-                    store = false;
-                }
+                TVPUnescapeKAGValue(value, entity, macroarg);
             }
 
-            // store value into the dictionary object
-            if(store)
-                DicObj->PropSetByVS(TJS_MEMBERENSURE,
-                                    attribname.AsVariantStringNoAddRef(),
-                                    &ValueVariant, DicObj);
+            StoreTagAttrib(attribname, value, entity, macroarg,
+                           tagkind == tag_elsif, condition);
         }
     }
 
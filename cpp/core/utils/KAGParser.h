@@ -86,6 +86,33 @@ public:
 };
 //---------------------------------------------------------------------------
 
+//---------------------------------------------------------------------------
+// tTVPScenarioTag : a tag in a scenario line, tokenized when the scenario is
+// loaded
+//---------------------------------------------------------------------------
+struct tTVPScenarioTagAttrib {
+    ttstr Name; // lower-cased, in the global string map
+    ttstr Value; // '`' escapes are removed
+    bool Entity; // "&" value; an expression
+    bool MacroArg; // "%" value; a macro argument name
+    bool MacroArgAll; // "*"; all of the macro arguments
+};
+
+struct tTVPScenarioTag {
+    tjs_int Start; // position of '[' or '@'
+    tjs_int End; // position of the delimiter which ends the tag
+    ttstr Name; // lower-cased, in the global string map
+    tjs_int AttribStart; // index of the first attribute
+    tjs_int AttribCount;
+};
+//---------------------------------------------------------------------------
+
+// whether the parser takes the tags of the scenario lines from the tokenized
+// form; false reads them with the character scanner, as the lines expanded
+// from macros are read
+extern bool TVPKAGUseTokenizedTags;
+//---------------------------------------------------------------------------
+
 //---------------------------------------------------------------------------
 // tTVPScenarioCacheItem : Scenario Cache Item
 //---------------------------------------------------------------------------
@@ -101,6 +128,13 @@ private:
     tLine *Lines;
     tjs_int LineCount;
 
+    // tags of all lines; LineTags[n] .. LineTags[n + 1] - 1 are the tags of
+    // the line n, in the order of the position. a tag which has a syntax
+    // error is not here, nor the tags after it in the line.
+    std::vector<tTVPScenarioTag> Tags;
+    std::vector<tTVPScenarioTagAttrib> TagAttribs;
+    std::vector<tjs_int> LineTags;
+
 public:
     struct tLabelCacheData {
         tjs_int Line;
@@ -136,7 +170,18 @@ public:
 private:
     void LoadScenario(const ttstr &name, bool isstring);
     // load file or string to buffer
+
+    void CompileTags(); // tokenize tags of all lines
+
+    bool ReadTags(const std::vector<tjs_uint8> &data);
+
 public:
+    // the tokenized tags, as stored in the ".ksc" cache file. a damaged
+    // form is rejected, and the tags are left empty then.
+    void SerializeTags(std::vector<tjs_uint8> &data) const;
+
+    bool UnserializeTags(const std::vector<tjs_uint8> &data);
+
     const ttstr &GetLabelAliasFromLine(tjs_int line) const {
         return LabelAliases[line];
     }
@@ -147,6 +192,14 @@ public:
 
     tjs_int GetLineCount() const { return LineCount; }
 
+    const tTVPScenarioTag *FindTag(tjs_int line, tjs_int pos) const;
+    // returns the tag at the position of the line, or nullptr
+
+    const tTVPScenarioTagAttrib *
+    GetTagAttribs(const tTVPScenarioTag *tag) const {
+        return TagAttribs.data() + tag->AttribStart;
+    }
+
     const tLabelCacheHash &GetLabelCache() const { return LabelCache; }
 };
 //---------------------------------------------------------------------------
@@ -280,6 +333,13 @@ private:
 
     void PushMacroArgs(iTJSDispatch2 *args);
 
+    void AssignMacroArgsToTag(const ttstr &tagname);
+    // "*" attribute; copy all of the macro arguments to the tag
+
+    void StoreTagAttrib(const ttstr &name, const ttstr &value, bool entity,
+                        bool macroarg, bool elsif, bool &condition);
+    // store an attribute of the current tag into DicObj
+
 public:
     void PopMacroArgs();
 
@@ -31,15 +31,43 @@ enum tTVPThreadPriority {
 #include "ThreadImpl.h"
 
 /*[*/
-const tjs_int TVPMaxThreadNum = 8;
+const tjs_int TVPMaxThreadNum = 64;
+// slices handed out per thread by TVPGetThreadTaskNum; more slices than
+// threads let the pool balance uneven rows
+const tjs_int TVPThreadTaskSlicePerThread = 4;
 typedef const std::function<void(int)> &TVP_THREAD_TASK_FUNC;
+typedef const std::function<void(int, int)> &TVP_THREAD_RANGE_FUNC;
 /*]*/
 
+//---------------------------------------------------------------------------
+// draw slots
+//---------------------------------------------------------------------------
+// slot 0 is the serial drawing path. TVPExecDrawSlotTask hands slots
+// 1..TVPMaxThreadNum to the threads that run its tasks, and per-slot drawing
+// state is indexed by TVPGetDrawSlot(). thread tasks started while holding a
+// slot run inline on the calling thread.
+const tjs_int TVPMaxDrawSlot = TVPMaxThreadNum + 1;
+extern thread_local tjs_int TVPCurrentDrawSlot;
+inline tjs_int TVPGetDrawSlot() { return TVPCurrentDrawSlot; }
+//---------------------------------------------------------------------------
+
 TJS_EXP_FUNC_DEF(tjs_int, TVPGetProcessorNum, ());
 
 TJS_EXP_FUNC_DEF(tjs_int, TVPGetThreadNum, ());
 
+TJS_EXP_FUNC_DEF(tjs_int, TVPGetThreadTaskNum, ());
+
 TJS_EXP_FUNC_DEF(void, TVPExecThreadTask,
                  (int numThreads, TVP_THREAD_TASK_FUNC func));
 
+TJS_EXP_FUNC_DEF(void, TVPExecThreadRangeTask,
+                 (int begin, int end, int grain, TVP_THREAD_RANGE_FUNC func));
+
+void TVPExecDrawSlotTask(int numTasks, TVP_THREAD_TASK_FUNC func);
+
+// runs "func" on a pool thread and returns without waiting for it.
+// returns false, without running "func", when the pool has no threads
+// (TVPGetThreadNum() == 1). errors thrown by "func" are ignored.
+bool TVPPostThreadTask(const std::function<void()> &func);
+
 #endif
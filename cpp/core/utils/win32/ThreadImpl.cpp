@@ -20,15 +20,10 @@
 #include "MsgIntf.h"
 #include "DebugIntf.h"
 
-#if defined(CC_TARGET_OS_IPHONE) || defined(__aarch64__)
-#else
-// #define USING_THREADPOOL11
-#endif
-
-#ifdef USING_THREADPOOL11
-#include "threadpool11/pool.hpp"
-#endif
-
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <memory>
 #include <thread>
 
 //---------------------------------------------------------------------------
@@ -134,38 +129,330 @@ tjs_int TVPGetProcessorNum() { return GetProcesserNum(); }
 //---------------------------------------------------------------------------
 tjs_int TVPGetThreadNum() {
     tjs_int threadNum = TVPDrawThreadNum ? TVPDrawThreadNum : GetProcesserNum();
-    threadNum = std::min(threadNum, TVPMaxThreadNum);
+    threadNum = std::max<tjs_int>(1, std::min(threadNum, TVPMaxThreadNum));
     return threadNum;
 }
 
+//---------------------------------------------------------------------------
+tjs_int TVPGetThreadTaskNum() {
+    tjs_int threadNum = TVPGetThreadNum();
+    return threadNum == 1 ? 1 : threadNum * TVPThreadTaskSlicePerThread;
+}
+
+//---------------------------------------------------------------------------
+// tTVPThreadTaskPool : persistent work-stealing pool behind TVPExecThreadTask
+//---------------------------------------------------------------------------
+// Each worker owns a deque of range tasks. A worker splits its range in
+// halves, keeps working on the lower half and pushes the upper half to the
+// back of its deque; idle workers steal from the front, which holds the
+// largest remaining ranges. The submitting thread helps until its group is
+// done, so a task may call TVPExecThreadTask again without deadlocking.
+// Posted tasks have no submitter; the workers (or threads helping with
+// their own groups) run them.
+//---------------------------------------------------------------------------
+namespace {
+    struct tTVPThreadTaskGroup {
+        const std::function<void(int, int)> *Func;
+        int Grain;
+        int Remaining; // guarded by Mutex
+        // posted groups own their function and are deleted by the thread
+        // which finishes them; nobody waits for them
+        bool Posted = false;
+        std::function<void(int, int)> PostedFunc;
+        std::atomic<bool> Failed{ false };
+        std::mutex Mutex;
+        std::condition_variable Done;
+        std::exception_ptr Error;
+
+        bool IsDone() {
+            std::lock_guard<std::mutex> lk(Mutex);
+            return Remaining == 0;
+        }
+    };
+
+    struct tTVPRangeTask {
+        tTVPThreadTaskGroup *Group;
+        int Begin;
+        int End;
+    };
+
+    struct tTVPTaskQueue {
+        std::mutex Mutex;
+        std::deque<tTVPRangeTask> Tasks;
+    };
+
+    class tTVPThreadTaskPool {
+        // Queues[0..WorkerCount-1] belong to the workers, the last one is
+        // shared by the threads outside of the pool.
+        std::vector<std::unique_ptr<tTVPTaskQueue>> Queues;
+        std::atomic<int> WorkerCount{ 0 };
+        std::atomic<int> ActiveWorkers{ 0 };
+        std::atomic<int> Queued{ 0 };
+        std::mutex SleepMutex;
+        std::condition_variable WakeUp;
+        std::mutex ResizeMutex;
+
+        static thread_local int CurrentQueue;
+
+    public:
+        tTVPThreadTaskPool() {
+            Queues.resize(TVPMaxThreadNum);
+            for(auto &q : Queues)
+                q.reset(new tTVPTaskQueue);
+        }
+
+        // The caller counts as one thread, so numThreads - 1 workers run.
+        void SetThreadNum(int numThreads) {
+            int workers = std::min(numThreads, (int)TVPMaxThreadNum) - 1;
+            ActiveWorkers = workers;
+            if(workers <= WorkerCount)
+                return;
+            std::lock_guard<std::mutex> lk(ResizeMutex);
+            while(WorkerCount < workers) {
+                int index = WorkerCount;
+                std::thread([this, index] { WorkerProc(index); }).detach();
+                ++WorkerCount;
+            }
+        }
+
+        void Run(int begin, int end, int grain,
+                 const std::function<void(int, int)> &func) {
+            tTVPThreadTaskGroup group;
+            group.Func = &func;
+            group.Grain = std::max(grain, 1);
+            group.Remaining = end - begin;
+            Push({ &group, begin, end });
+
+            // help until the whole range is done
+            int spin = 0;
+            while(!group.IsDone()) {
+                tTVPRangeTask task;
+                if(Take(task)) {
+                    Execute(task);
+                    spin = 0;
+                } else if(++spin < 64) {
+                    std::this_thread::yield();
+                } else {
+                    std::unique_lock<std::mutex> lk(group.Mutex);
+                    group.Done.wait_for(lk, std::chrono::microseconds(500),
+                                        [&] { return group.Remaining == 0; });
+                }
+            }
+            if(group.Error)
+                std::rethrow_exception(group.Error);
+        }
+
+        void Post(const std::function<void()> &func) {
+            tTVPThreadTaskGroup *group = new tTVPThreadTaskGroup;
+            group->Posted = true;
+            group->PostedFunc = [func](int, int) { func(); };
+            group->Func = &group->PostedFunc;
+            group->Grain = 1;
+            group->Remaining = 1;
+            Push({ group, 0, 1 });
+        }
+
+    private:
+        tTVPTaskQueue &OwnQueue() {
+            return CurrentQueue >= 0 ? *Queues[CurrentQueue]
+                                     : *Queues[TVPMaxThreadNum - 1];
+        }
+
+        void Push(const tTVPRangeTask &task) {
+            tTVPTaskQueue &q = OwnQueue();
+            {
+                std::lock_guard<std::mutex> lk(q.Mutex);
+                q.Tasks.push_back(task);
+                ++Queued;
+            }
+            {
+                std::lock_guard<std::mutex> lk(SleepMutex);
+            }
+            // inactive workers ignore the wake up, so wake everyone
+            WakeUp.notify_all();
+        }
+
+        bool PopBack(tTVPTaskQueue &q, tTVPRangeTask &task) {
+            std::lock_guard<std::mutex> lk(q.Mutex);
+            if(q.Tasks.empty())
+                return false;
+            task = q.Tasks.back();
+            q.Tasks.pop_back();
+            --Queued;
+            return true;
+        }
+
+        bool StealFront(tTVPTaskQueue &q, tTVPRangeTask &task) {
+            std::lock_guard<std::mutex> lk(q.Mutex);
+            if(q.Tasks.empty())
+                return false;
+            task = q.Tasks.front();
+            q.Tasks.pop_front();
+            --Queued;
+            return true;
+        }
+
+        bool Take(tTVPRangeTask &task) {
+            if(PopBack(OwnQueue(), task))
+                return true;
+            if(Queued <= 0)
+                return false;
+            int count = WorkerCount;
+            int start = CurrentQueue >= 0 ? CurrentQueue + 1 : 0;
+            for(int i = 0; i < count; i++) {
+                int victim = (start + i) % count;
+                if(victim != CurrentQueue && StealFront(*Queues[victim], task))
+                    return true;
+            }
+            if(CurrentQueue >= 0)
+                return StealFront(*Queues[TVPMaxThreadNum - 1], task);
+            return false;
+        }
+
+        void Execute(tTVPRangeTask task) {
+            tTVPThreadTaskGroup *group = task.Group;
+            bool posted = group->Posted;
+            // split off the upper halves so that idle threads can steal them
+            while(task.End - task.Begin > group->Grain) {
+                int mid = task.Begin + (task.End - task.Begin) / 2;
+                Push({ group, mid, task.End });
+                task.End = mid;
+            }
+            std::exception_ptr error;
+            try {
+                if(!group->Failed)
+                    (*group->Func)(task.Begin, task.End);
+            } catch(...) {
+                error = std::current_exception();
+            }
+            // the group lives on the submitter's stack; do not touch it
+            // after the last range has been accounted for
+            bool finished;
+            {
+                std::lock_guard<std::mutex> lk(group->Mutex);
+                if(error && !group->Error) {
+                    group->Error = error;
+                    group->Failed = true;
+                }
+                group->Remaining -= task.End - task.Begin;
+                finished = group->Remaining == 0;
+                if(finished && !posted)
+                    group->Done.notify_all();
+            }
+            if(finished && posted)
+                delete group;
+        }
+
+        void WorkerProc(int index) {
+            CurrentQueue = index;
+            for(;;) {
+                tTVPRangeTask task;
+                if(index < ActiveWorkers && Take(task)) {
+                    Execute(task);
+                    continue;
+                }
+                std::unique_lock<std::mutex> lk(SleepMutex);
+                WakeUp.wait(lk, [&] {
+                    return index < ActiveWorkers && Queued > 0;
+                });
+            }
+        }
+    };
+
+    thread_local int tTVPThreadTaskPool::CurrentQueue = -1;
+
+    tTVPThreadTaskPool &TVPGetThreadTaskPool() {
+        // never destroyed; the workers are detached and live until exit
+        static tTVPThreadTaskPool *pool = new tTVPThreadTaskPool;
+        return *pool;
+    }
+} // namespace
+
+//---------------------------------------------------------------------------
+void TVPExecThreadRangeTask(int begin, int end, int grain,
+                            TVP_THREAD_RANGE_FUNC func) {
+    if(end <= begin)
+        return;
+    tjs_int threadNum = TVPGetThreadNum();
+    // a draw slot task must not pick up another stripe while it waits, or
+    // the stripe would run with this thread's slot
+    if(threadNum == 1 || end - begin <= std::max(grain, 1) ||
+       TVPCurrentDrawSlot) {
+        func(begin, end);
+        return;
+    }
+    tTVPThreadTaskPool &pool = TVPGetThreadTaskPool();
+    pool.SetThreadNum(threadNum);
+    pool.Run(begin, end, grain, func);
+}
+
+//---------------------------------------------------------------------------
+bool TVPPostThreadTask(const std::function<void()> &func) {
+    tjs_int threadNum = TVPGetThreadNum();
+    if(threadNum == 1)
+        return false;
+    tTVPThreadTaskPool &pool = TVPGetThreadTaskPool();
+    pool.SetThreadNum(threadNum);
+    pool.Post(func);
+    return true;
+}
+
 //---------------------------------------------------------------------------
 void TVPExecThreadTask(int numThreads, TVP_THREAD_TASK_FUNC func) {
     if(numThreads == 1) {
         func(0);
         return;
     }
-#if !defined(USING_THREADPOOL11)
-#pragma omp parallel for schedule(static)
-    for(int i = 0; i < numThreads; ++i)
-        func(i);
-#else
-    static threadpool11::Pool pool;
-    std::vector<std::future<void>> futures;
-    for(int i = 0; i < numThreads; ++i) {
-        futures.emplace_back(pool.postWork<void>(std::bind(func, i)));
+    // every index is one slice chosen by the caller
+    TVPExecThreadRangeTask(0, numThreads, 1, [&func](int begin, int end) {
+        for(int i = begin; i < end; ++i)
+            func(i);
+    });
+}
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// draw slots
+//---------------------------------------------------------------------------
+thread_local tjs_int TVPCurrentDrawSlot = 0;
+// bit n set : slot n + 1 is in use
+static std::atomic<tjs_uint64> TVPDrawSlotMask{ 0 };
+//---------------------------------------------------------------------------
+namespace {
+    class tTVPDrawSlotHolder {
+    public:
+        tTVPDrawSlotHolder() {
+            // every thread holds at most one slot at a time (nested tasks
+            // run inline), so a free bit always exists
+            tjs_uint64 mask = TVPDrawSlotMask.load();
+            tjs_int bit;
+            do {
+                bit = 0;
+                while(mask & ((tjs_uint64)1 << bit))
+                    bit++;
+            } while(!TVPDrawSlotMask.compare_exchange_weak(
+                mask, mask | ((tjs_uint64)1 << bit)));
+            TVPCurrentDrawSlot = bit + 1;
+        }
+        ~tTVPDrawSlotHolder() {
+            TVPDrawSlotMask &= ~((tjs_uint64)1 << (TVPCurrentDrawSlot - 1));
+            TVPCurrentDrawSlot = 0;
+        }
+    };
+} // namespace
+//---------------------------------------------------------------------------
+void TVPExecDrawSlotTask(int numTasks, TVP_THREAD_TASK_FUNC func) {
+    if(TVPCurrentDrawSlot) {
+        // already drawing in a slot
+        for(int i = 0; i < numTasks; ++i)
+            func(i);
+        return;
     }
-    for(auto &it : futures)
-        it.get();
-#endif
-#if 0
-    ThreadInfo *threadInfo;
-    threadInfo = TVPThreadList[TVPThreadTaskCount++];
-    threadInfo->lpStartAddress = func;
-    threadInfo->lpParameter = param;
-    InterlockedIncrement(&TVPRunningThreadCount);
-    while (ResumeThread(threadInfo->thread) == 0)
-      Sleep(0);
-#endif
+    TVPExecThreadRangeTask(0, numTasks, 1, [&func](int begin, int end) {
+        tTVPDrawSlotHolder slot;
+        for(int i = begin; i < end; ++i)
+            func(i);
+    });
 }
 //---------------------------------------------------------------------------
 
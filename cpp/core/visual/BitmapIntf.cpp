@@ -44,6 +44,7 @@ tjs_error tTJSNI_Bitmap::Construct(tjs_int numparams, tTJSVariant **param,
 }
 //----------------------------------------------------------------------
 void tTJSNI_Bitmap::Invalidate() {
+    CancelLoadAsync();
     if(Bitmap)
         delete Bitmap, Bitmap = nullptr;
 }
@@ -106,11 +107,16 @@ iTJSDispatch2 *tTJSNI_Bitmap::Load(const ttstr &name, tjs_uint32 colorkey) {
     return metainfo;
 }
 //----------------------------------------------------------------------
-void tTJSNI_Bitmap::LoadAsync(const ttstr &name) {
+void tTJSNI_Bitmap::LoadAsync(const ttstr &name, tjs_int priority) {
     if(Loading)
         TVPThrowExceptionMessage(TVPCurrentlyAsyncLoadBitmap);
     Loading = true;
-    Application->LoadImageRequest(Owner, this, name);
+    Application->LoadImageRequest(Owner, this, name, priority);
+}
+//----------------------------------------------------------------------
+void tTJSNI_Bitmap::CancelLoadAsync() {
+    if(Loading && Owner)
+        Application->CancelLoadImageRequest(Owner);
 }
 //----------------------------------------------------------------------
 void tTJSNI_Bitmap::Save(const ttstr &name, const ttstr &type,
@@ -194,7 +200,7 @@ tjs_uint tTJSNI_Bitmap::GetHeight() const {
 const void *tTJSNI_Bitmap::GetPixelBuffer() const {
     if(!Bitmap)
         return nullptr;
-    return Bitmap->GetScanLine(0);
+    return Bitmap->GetPixelData();
 }
 //----------------------------------------------------------------------
 void *tTJSNI_Bitmap::GetPixelBufferForWrite() {
@@ -370,11 +376,22 @@ tTJSNC_Bitmap::tTJSNC_Bitmap() : inherited(TJS_W("Bitmap")) {
         if(numparams < 1)
             return TJS_E_BADPARAMCOUNT;
         ttstr name(*param[0]);
-        _this->LoadAsync(name);
+        tjs_int priority = 0;
+        if(numparams > 1 && param[1]->Type() != tvtVoid)
+            priority = (tjs_int)*param[1];
+        _this->LoadAsync(name, priority);
         return TJS_S_OK;
     }
     TJS_END_NATIVE_METHOD_DECL(/*func. name*/ loadAsync)
     //----------------------------------------------------------------------
+    TJS_BEGIN_NATIVE_METHOD_DECL(/*func. name*/ cancelLoadAsync) {
+        TJS_GET_NATIVE_INSTANCE(/*var. name*/ _this,
+                                /*var. type*/ tTJSNI_Bitmap);
+        _this->CancelLoadAsync();
+        return TJS_S_OK;
+    }
+    TJS_END_NATIVE_METHOD_DECL(/*func. name*/ cancelLoadAsync)
+    //----------------------------------------------------------------------
     TJS_BEGIN_NATIVE_METHOD_DECL(/*func. name*/ loadHeader) {
         if(numparams < 1)
             return TJS_E_BADPARAMCOUNT;
@@ -34,7 +34,8 @@ public:
     void Independ(bool copy = true);
 
     iTJSDispatch2 *Load(const ttstr &name, tjs_uint32 colorkey);
-    void LoadAsync(const ttstr &name);
+    void LoadAsync(const ttstr &name, tjs_int priority = 0);
+    void CancelLoadAsync();
     void Save(const ttstr &name, const ttstr &type,
               iTJSDispatch2 *meta = nullptr);
 
@@ -85,7 +85,12 @@ void tTJSNI_BitmapLayerTreeOwner::NotifyBitmapCompleted(
         long width_bytes = cliprect.get_width() * 4; // 32bit
         long dest_y = y;
         long dest_x = x;
-        const tjs_uint8 *src_p = (const tjs_uint8 *)bitmapinfo->GetScanLine(0);
+        // the lines are read bottom-up below; src_y is counted from the
+        // last line of the bitmap
+        tjs_int src_h = bitmapinfo->GetHeight();
+        const tjs_uint8 *src_p =
+            (const tjs_uint8 *)bitmapinfo->GetPixelDataForLines(
+                src_h - src_y_limit, src_h - src_y);
         long src_pitch;
 #if 0
 		if(bitmapinfo->GetHeight() < 0) {
@@ -14,9 +14,10 @@
 #include "ComplexRect.h"
 #include <vector>
 #include <algorithm>
+#include <limits>
 
-// Some algorithms and ideas are based on implementation of Mozilla,
-// gfx/src/nsRegion.cpp.
+// The band operations are based on the region implementation of
+// X11/pixman (pixman-region.c).
 
 //---------------------------------------------------------------------------
 // TVPIntersectRect
@@ -66,91 +67,204 @@ bool TVPUnionRect(tTVPRect *dest, const tTVPRect &src1, const tTVPRect &src2) {
 //---------------------------------------------------------------------------
 
 //---------------------------------------------------------------------------
-// tTVPRegionRect allocation routines
+// band operations
 //---------------------------------------------------------------------------
-// variables
-static tjs_uint TVPRegionFreeMaxCount = 0;
-// maximum count of free rectangles in TVPRegionFreeRects
-static std::vector<tTVPRegionRect *> *TVPRegionFreeRects = nullptr;
-#define TVP_REGIONRECT_ALLOC_UNITS 256
-// Number of rectangles which to be allocated in a call of
-// TVPPrepareRegionRectangle()
-//---------------------------------------------------------------------------
-class tTVPRegionRectInitialHolder {
-    // Initial rectangle holder to prevent unnecessary freeing of the
-    // vector. This holds a rectangle from program start to end.
-    tTVPRegionRect *InitialRect;
+namespace {
+    enum tTVPRegionOp { roOr, roSub, roAnd };
 
-public:
-    tTVPRegionRectInitialHolder() { InitialRect = nullptr; }
-    void Hold() {
-        if(!InitialRect) {
-            InitialRect = (tTVPRegionRect *)-1;
-            InitialRect = TVPAllocateRegionRect();
-        }
-    }
-    ~tTVPRegionRectInitialHolder() {
-        if(InitialRect)
-            TVPDeallocateRegionRect(InitialRect);
-    }
-};
-static tTVPRegionRectInitialHolder TVPRegionRectInitialHolder;
-//---------------------------------------------------------------------------
-static void TVPPrepareRegionRectangle() {
-    // Prepare rectangles and insert them into free rectangle list
-    for(tjs_int i = 0; i < TVP_REGIONRECT_ALLOC_UNITS; i++) {
-        TVPRegionFreeRects->push_back(
-            (tTVPRegionRect *)(new char[sizeof(tTVPRegionRect)]));
-        TVPRegionFreeMaxCount++;
+    // scratch storage for operation results; the result is swapped with
+    // the destination region, so the storage is recycled in turn.
+    thread_local std::vector<tTVPRect> TVPRegionScratch;
+
+    //-----------------------------------------------------------------------
+    const tTVPRect *TVPFindBandEnd(const tTVPRect *r, const tTVPRect *end) {
+        tjs_int top = r->top;
+        while(r != end && r->top == top)
+            r++;
+        return r;
     }
-}
-//---------------------------------------------------------------------------
-tTVPRegionRect *TVPAllocateRegionRect() {
-    // Allocate a region rectangle. Note that this function does not
-    // clear nor initialize the rectangle object.
 
-    // Create a vector of free rectangle list if it does not exists
-    if(!TVPRegionFreeRects)
-        TVPRegionFreeRects = new std::vector<tTVPRegionRect *>();
+    //-----------------------------------------------------------------------
+    class tTVPRegionBuilder {
+        std::vector<tTVPRect> &Dest;
+        size_t PrevBand; // start index of the last finished band
+        size_t CurBand; // start index of the band being built
+
+    public:
+        tTVPRegionBuilder(std::vector<tTVPRect> &dest) :
+            Dest(dest), PrevBand(0), CurBand(0) {
+            Dest.clear();
+        }
+
+        void BeginBand() { CurBand = Dest.size(); }
 
-    // Prepare free rectangles if the free list is empty
-    if(TVPRegionFreeRects->size() == 0)
-        TVPPrepareRegionRectangle();
+        void AddSpan(tjs_int left, tjs_int right, tjs_int top,
+                     tjs_int bottom) {
+            // spans must be added in the left order
+            if(Dest.size() > CurBand && Dest.back().right >= left) {
+                // overlaps or touches the last span; extend it
+                if(Dest.back().right < right)
+                    Dest.back().right = right;
+                return;
+            }
+            Dest.push_back(tTVPRect(left, top, right, bottom));
+        }
 
-    // Take a free rectangle from last of the free rectangle list
-    tTVPRegionRect *r = TVPRegionFreeRects->back();
-    TVPRegionFreeRects->pop_back();
+        void EndBand() {
+            // coalesce the band with the previous one if they are
+            // vertically adjacent and have the same spans
+            size_t count = Dest.size() - CurBand;
+            if(!count)
+                return;
+            if(CurBand - PrevBand == count &&
+               Dest[PrevBand].bottom == Dest[CurBand].top) {
+                size_t i;
+                for(i = 0; i < count; i++) {
+                    const tTVPRect &p = Dest[PrevBand + i];
+                    const tTVPRect &c = Dest[CurBand + i];
+                    if(p.left != c.left || p.right != c.right)
+                        break;
+                }
+                if(i == count) {
+                    tjs_int bottom = Dest[CurBand].bottom;
+                    for(i = 0; i < count; i++)
+                        Dest[PrevBand + i].bottom = bottom;
+                    Dest.resize(CurBand);
+                    return;
+                }
+            }
+            PrevBand = CurBand;
+        }
 
-    // Hold initial rectangle
-    TVPRegionRectInitialHolder.Hold();
+        void AppendBand(const tTVPRect *r, const tTVPRect *end, tjs_int top,
+                        tjs_int bottom) {
+            // append the spans of a band with given vertical extent
+            BeginBand();
+            for(; r != end; r++)
+                Dest.push_back(tTVPRect(r->left, top, r->right, bottom));
+            EndBand();
+        }
 
-    // Return the rectangle
-    return r;
-}
-//---------------------------------------------------------------------------
-void TVPDeallocateRegionRect(tTVPRegionRect *rect) {
-    // Deallocate a region rectangle allocated in
-    // TVPAllocateRegionRect().
+        void OverlapBand(const tTVPRect *r1, const tTVPRect *r1end,
+                         const tTVPRect *r2, const tTVPRect *r2end,
+                         tjs_int top, tjs_int bottom, tTVPRegionOp op) {
+            // operate the spans of two bands over [top, bottom)
+            BeginBand();
+            switch(op) {
+                case roOr:
+                    while(r1 != r1end || r2 != r2end) {
+                        const tTVPRect *r;
+                        if(r2 == r2end || (r1 != r1end && r1->left < r2->left))
+                            r = r1++;
+                        else
+                            r = r2++;
+                        AddSpan(r->left, r->right, top, bottom);
+                    }
+                    break;
+
+                case roSub:
+                    for(; r1 != r1end; r1++) {
+                        tjs_int left = r1->left;
+                        tjs_int right = r1->right;
+                        while(r2 != r2end && r2->right <= left)
+                            r2++;
+                        for(const tTVPRect *s = r2;
+                            s != r2end && s->left < right; s++) {
+                            if(s->left > left)
+                                AddSpan(left, s->left, top, bottom);
+                            left = s->right;
+                            if(left >= right)
+                                break;
+                        }
+                        if(left < right)
+                            AddSpan(left, right, top, bottom);
+                    }
+                    break;
+
+                case roAnd:
+                    while(r1 != r1end && r2 != r2end) {
+                        tjs_int left = std::max(r1->left, r2->left);
+                        tjs_int right = std::min(r1->right, r2->right);
+                        if(left < right)
+                            AddSpan(left, right, top, bottom);
+                        if(r1->right < r2->right)
+                            r1++;
+                        else
+                            r2++;
+                    }
+                    break;
+            }
+            EndBand();
+        }
+    };
+
+    //-----------------------------------------------------------------------
+    void TVPRegionOperate(std::vector<tTVPRect> &dest, const tTVPRect *r1,
+                          const tTVPRect *r1end, const tTVPRect *r2,
+                          const tTVPRect *r2end, tTVPRegionOp op) {
+        // dest = r1 (op) r2. walks the bands of both regions from the
+        // top; parts which are covered by only one region are appended
+        // as is, or dropped, according to the operation.
+        bool append1 = op != roAnd; // keep parts only in r1
+        bool append2 = op == roOr; // keep parts only in r2
+        tTVPRegionBuilder builder(dest);
+
+        // bottom of the last processed part; the band which has started
+        // above this is already processed down to here
+        tjs_int ybot = std::numeric_limits<tjs_int>::min();
+
+        while(r1 != r1end && r2 != r2end) {
+            const tTVPRect *r1bandend = TVPFindBandEnd(r1, r1end);
+            const tTVPRect *r2bandend = TVPFindBandEnd(r2, r2end);
+            tjs_int ytop;
+
+            if(r1->top < r2->top) {
+                // part of r1 band above r2 band
+                if(append1) {
+                    tjs_int top = std::max(r1->top, ybot);
+                    tjs_int bottom = std::min(r1->bottom, r2->top);
+                    if(top < bottom)
+                        builder.AppendBand(r1, r1bandend, top, bottom);
+                }
+                ytop = r2->top;
+            } else if(r2->top < r1->top) {
+                // part of r2 band above r1 band
+                if(append2) {
+                    tjs_int top = std::max(r2->top, ybot);
+                    tjs_int bottom = std::min(r2->bottom, r1->top);
+                    if(top < bottom)
+                        builder.AppendBand(r2, r2bandend, top, bottom);
+                }
+                ytop = r1->top;
+            } else {
+                ytop = r1->top;
+            }
 
-    // Append to TVPRegionFreeRects
-    //	if(!TVPRegionFreeRects) TVPThrowInternalError();
-    ////-----------------
-    // geee
-    TVPRegionFreeRects->push_back(rect);
+            // overlapping part of the two bands
+            ybot = std::min(r1->bottom, r2->bottom);
+            if(ybot > ytop)
+                builder.OverlapBand(r1, r1bandend, r2, r2bandend, ytop, ybot,
+                                    op);
 
-    // Full-Free check
-    if(TVPRegionFreeRects->size() == TVPRegionFreeMaxCount) {
-        // Free all rectangles
-        for(std::vector<tTVPRegionRect *>::iterator i =
-                TVPRegionFreeRects->begin();
-            i != TVPRegionFreeRects->end(); i++)
-            delete[](char *)(*i);
+            if(r1->bottom == ybot)
+                r1 = r1bandend;
+            if(r2->bottom == ybot)
+                r2 = r2bandend;
+        }
 
-        // Free the vector
-        delete TVPRegionFreeRects, TVPRegionFreeRects = nullptr;
-        TVPRegionFreeMaxCount = 0;
+        // remaining bands of either region
+        const tTVPRect *r = nullptr, *rend = nullptr;
+        if(r1 != r1end && append1)
+            r = r1, rend = r1end;
+        else if(r2 != r2end && append2)
+            r = r2, rend = r2end;
+        while(r != rend) {
+            const tTVPRect *bandend = TVPFindBandEnd(r, rend);
+            builder.AppendBand(r, bandend, std::max(r->top, ybot), r->bottom);
+            r = bandend;
+        }
     }
-}
+} // namespace
 //---------------------------------------------------------------------------
 
 //---------------------------------------------------------------------------
@@ -158,245 +272,81 @@ void TVPDeallocateRegionRect(tTVPRegionRect *rect) {
 //---------------------------------------------------------------------------
 tTVPComplexRect::tTVPComplexRect() {
     // normal constructor
-    Init();
+    Bound.clear();
 }
 //---------------------------------------------------------------------------
 tTVPComplexRect::tTVPComplexRect(const tTVPComplexRect &ref) :
-    Bound(ref.Bound) {
+    Rects(ref.Rects), Bound(ref.Bound) {
     // copy constructor
-    Init();
-
-    // allocate storage
-    SetCount(ref.Count);
-
-    // copy rectangles
-    if(Count) {
-        tTVPRegionRect *this_cur = Head;
-        tTVPRegionRect *ref_cur = ref.Head;
-        do {
-            *(tTVPRect *)this_cur = *(tTVPRect *)ref_cur; // copy as tTVPRect
-            this_cur = this_cur->Next;
-            ref_cur = ref_cur->Next;
-        } while(ref_cur != ref.Head);
-    }
 }
 //---------------------------------------------------------------------------
 tTVPComplexRect::~tTVPComplexRect() {
     // destructor
-    FreeAllRectangles();
-}
-//---------------------------------------------------------------------------
-void tTVPComplexRect::Clear() {
-    FreeAllRectangles();
-    Init();
 }
 //---------------------------------------------------------------------------
-void tTVPComplexRect::FreeAllRectangles() {
-    // free all rectangles
-    if(Count) {
-        tTVPRegionRect *cur = Head;
-        do {
-            tTVPRegionRect *n = cur->Next;
-            delete cur;
-            cur = n;
-        } while(cur != Head);
-    }
+tTVPComplexRect &tTVPComplexRect::operator=(const tTVPComplexRect &ref) {
+    Rects = ref.Rects;
+    Bound = ref.Bound;
+    return *this;
 }
 //---------------------------------------------------------------------------
-void tTVPComplexRect::Init() {
-    // initialize internal states
-    Head = nullptr;
-    Current = nullptr;
-    Count = 0;
-    Bound.left = Bound.top = Bound.right = Bound.bottom = 0;
-    BoundValid = false;
+void tTVPComplexRect::Clear() {
+    Rects.clear();
+    Bound.clear();
 }
 //---------------------------------------------------------------------------
-void tTVPComplexRect::SetCount(tjs_int count) {
-    // grow or shrink rectangle storage area
-    if(count > Count) {
-        // grow
-        tjs_int add_count = count - Count;
-        if(!Count) {
-            // no existent rectangle
-            Head = new tTVPRegionRect();
-            Head->Prev = Head;
-            Head->Next = Head;
-            add_count--;
-        }
-
-        tTVPRegionRect *cur = Head->Prev;
-        Current = cur;
-        while(add_count--) {
-            tTVPRegionRect *newrect = new tTVPRegionRect();
-            newrect->LinkBefore(Head);
-        }
-        Count = count;
-    } else if(count < Count) {
-        // shrink
-        if(Count) {
-            tjs_int remove_count = Count - count;
-            tTVPRegionRect *cur = Head->Prev;
-            while(remove_count--) {
-                tTVPRegionRect *prev = cur->Prev;
-                delete cur;
-                cur = prev;
-            }
-            Count = count;
-            if(Count)
-                cur->Next = Head, Current = Head, Head->Prev = cur;
-            else
-                Head = nullptr, Current = nullptr;
-        }
-    }
+void tTVPComplexRect::Operate(const tTVPRect *r2, const tTVPRect *r2end,
+                              tjs_int op) {
+    // this = this (op) r2
+    std::vector<tTVPRect> &dest = TVPRegionScratch;
+    const tTVPRect *r1 = Rects.data();
+    TVPRegionOperate(dest, r1, r1 + Rects.size(), r2, r2end,
+                     (tTVPRegionOp)op);
+    Rects.swap(dest);
+    CalcBound();
 }
 //---------------------------------------------------------------------------
-bool tTVPComplexRect::Insert(const tTVPRect &rect) {
-    // Insert a region rectangle inplace.
-    // Note that this function does not update the bounding rectangle.
-    // This does empty check.
-
-    if(rect.is_empty())
-        return false;
-
-    if(!Count) {
-        // first insertion
-        Head = new tTVPRegionRect(rect);
-        Head->Prev = Head->Next = Head;
-        Current = Head;
-        Count = 1;
-        return true;
+void tTVPComplexRect::OperateRect(const tTVPRect &r, tjs_int op) {
+    // this = this (op) r, for roOr and roSub.
+    // only the bands which intersect r vertically can change; they are
+    // operated with their neighbor bands (for coalescing) and spliced
+    // back into the array.
+    tTVPRect *begin = Rects.data();
+    tTVPRect *end = begin + Rects.size();
+    tTVPRect *first = std::lower_bound(
+        begin, end, r.top,
+        [](const tTVPRect &a, tjs_int top) { return a.bottom <= top; });
+    tTVPRect *last = std::lower_bound(
+        first, end, r.bottom,
+        [](const tTVPRect &a, tjs_int bottom) { return a.top < bottom; });
+    if(first != begin) {
+        // include the band above
+        tjs_int top = first[-1].top;
+        while(first != begin && first[-1].top == top)
+            first--;
     }
-
-    // Search insertion point and insert there.
-    // Link list is sorted by upper-left point of the rectangle,
-    // Search starts from "Current", which is the most recently
-    // touched rectangle.
-    if(*Current > rect) {
-        // insertion point is before Current
-        tTVPRegionRect *prev;
-        while(true) {
-            if(Current == Head) {
-                // insert before head
-                if(Head->top == rect.top && Head->bottom == rect.bottom &&
-                   Head->Left == rect.right) {
-                    Head->Left = rect.left; // unite Head
-                    break;
-                } else {
-                    tTVPRegionRect *new_rect = new tTVPRegionRect(rect);
-                    new_rect->LinkBefore(Head);
-                    Count++;
-                    Head = new_rect;
-                    break;
-                }
-            }
-            prev = Current->Prev;
-            if(*prev < rect) {
-
-                // insert between prev and Current
-                if(Current->top == rect.top && Current->bottom == rect.bottom &&
-                   Current->left == rect.right) {
-                    Current->left = rect.left; // unite right
-                    break;
-                } else {
-                    tTVPRegionRect *new_rect = new tTVPRegionRect(rect);
-                    new_rect->LinkBefore(Current);
-                    Count++;
-                    break;
-                }
-            }
-            Current = prev;
-        }
-    } else {
-        // insertion point is after Current
-        tTVPRegionRect *next;
-        while(true) {
-            next = Current->Next;
-            if(next == Head) {
-                // insert after last of the link list
-                // (that is, before the Head)
-                if(Current->top == rect.top && Current->bottom == rect.bottom &&
-                   Current->right == rect.left) {
-                    Current->right = rect.right; // unite right
-                    break;
-                } else {
-                    tTVPRegionRect *new_rect = new tTVPRegionRect(rect);
-                    new_rect->LinkBefore(Head);
-                    Count++;
-                    break;
-                }
-            }
-            if(*next > rect) {
-                // insert between next and Current
-                if(next->top == rect.top && next->bottom == rect.bottom &&
-                   next->left == rect.right) {
-                    next->left = rect.left; // unite right
-                    if(Current->top == rect.top &&
-                       Current->bottom == rect.bottom &&
-                       Current->right == rect.left) {
-                        next->left = Current->left; // unite left
-                        Remove(Current);
-                    }
-                    break;
-                } else {
-                    tTVPRegionRect *new_rect = new tTVPRegionRect(rect);
-                    new_rect->LinkBefore(next);
-                    Count++;
-                    break;
-                }
-            }
-            Current = next;
-        }
+    if(last != end) {
+        // include the band below
+        tjs_int top = last->top;
+        while(last != end && last->top == top)
+            last++;
     }
 
-    return true;
-}
-//---------------------------------------------------------------------------
-void tTVPComplexRect::Remove(tTVPRegionRect *rect) {
-    // Remove a rectangle.
-    // Note that this function does not update the bounding rectangle.
-    if(rect == Head)
-        Head = rect->Next;
-
-    Count--;
-    if(!Count) {
-        // no more rectangles
-        Current = Head = nullptr;
-    } else {
-        if(rect == Current)
-            Current = rect->Prev;
-    }
-    rect->Unlink();
-    delete rect;
-}
-//---------------------------------------------------------------------------
-void tTVPComplexRect::Merge(const tTVPComplexRect &rects) {
-    // Merge non-overlaped complex rectangle
+    std::vector<tTVPRect> &dest = TVPRegionScratch;
+    TVPRegionOperate(dest, first, last, &r, &r + 1, (tTVPRegionOp)op);
 
-    // Calculate bounding rectangle
-    (const_cast<tTVPComplexRect *>(&rects))->EnsureBound();
-    EnsureBound();
-    if(Count) {
-        if(rects.Count)
-            Bound.do_union(rects.Bound);
-        else
-            ; // do nothing
+    size_t pos = first - begin;
+    size_t count = last - first;
+    if(dest.size() > count) {
+        std::copy(dest.begin(), dest.begin() + count, Rects.begin() + pos);
+        Rects.insert(Rects.begin() + pos + count, dest.begin() + count,
+                     dest.end());
     } else {
-        if(rects.Count)
-            Bound = rects.Bound;
-        else
-            return; // both empty; do nothing
+        std::copy(dest.begin(), dest.end(), Rects.begin() + pos);
+        Rects.erase(Rects.begin() + pos + dest.size(),
+                    Rects.begin() + pos + count);
     }
-
-    // merge per a rectangle
-    tTVPRegionRect *ref_cur = rects.Head;
-    do {
-        Insert(*ref_cur);
-        ref_cur = ref_cur->Next;
-    } while(ref_cur != rects.Head);
 }
-//---------------------------------------------------------------------------
-
 //---------------------------------------------------------------------------
 void tTVPComplexRect::Or(const tTVPRect &r) {
     // OR operation
@@ -405,233 +355,81 @@ void tTVPComplexRect::Or(const tTVPRect &r) {
     if(r.is_empty())
         return;
 
-    // simply insert when no rectangle exists
-    if(Count == 0) {
-        if(Insert(r))
-            Bound = r, BoundValid = true;
-        return;
-    }
-
-    // Check for bounding rectangle
-    EnsureBound();
-    if(!Bound.intersects_with_no_empty_check(r)) {
-        // Out of the Bouding rectangle; Simply insert
-        if(Insert(r))
-            Bound.do_union(r);
+    // simply insert when no rectangle exists or r covers all
+    if(Rects.empty() || Bound.included_in_no_empty_check(r)) {
+        Rects.assign(1, r);
+        Bound = r;
         return;
     }
 
-    // Check for nullptr rectangle
-    if(r.left >= r.right || r.top >= r.bottom)
-        return; // nullptr rect
-
-    // Update bounding rectangle
+    OperateRect(r, roOr);
     Bound.do_union(r);
-
-    // Walk through rectangles
-    tTVPRegionRect *c = Head;
-    while(c->top < r.bottom) {
-        // Check inclusion
-        if(r.included_in_no_empty_check(*c)) {
-            // r is completely included in c
-            return; //---                         returns here
-        }
-
-        // Check intersection
-        bool next_is_head;
-        if(c->intersects_with_no_empty_check(r)) {
-            // Do OR operation. This may increase the rectangle count.
-            tTVPRegionRect *next = c->Next;
-            next_is_head = next == Head;
-            Current = c;
-            RectangleSub(c, &r);
-            c = next_is_head ? Head : next;
-            // Re-assign head since the "Head" may change in
-            // "RectangleSub"
-        } else {
-            // Step next
-            c = c->Next;
-            next_is_head = c == Head;
-        }
-
-        if(!Head || !c || next_is_head)
-            break;
-    }
-
-    // finally insert r
-    Insert(r);
 }
 //---------------------------------------------------------------------------
 void tTVPComplexRect::Or(const tTVPComplexRect &ref) {
     // OR operation
-    if(ref.Count == 0)
+    if(ref.Rects.empty())
         return; // nothing to do
 
-    EnsureBound();
-    (const_cast<tTVPComplexRect *>(&ref))->EnsureBound();
-    if(!Bound.intersects_with_no_empty_check(ref.Bound)) {
-        // Out of the Bouding rectangle; Simply marge
-        Merge(ref);
+    if(Rects.empty()) {
+        *this = ref;
         return;
     }
 
-    tTVPRegionRect *c = ref.Head;
-    while(true) {
-        Or(*c);
-        c = c->Next;
-        if(c == ref.Head)
-            break;
-    }
+    Operate(ref.Rects.data(), ref.Rects.data() + ref.Rects.size(), roOr);
 }
 //---------------------------------------------------------------------------
 void tTVPComplexRect::Sub(const tTVPRect &r) {
     // Subtraction operation
 
     // Check for nullptr rectangle
-    if(r.left >= r.right || r.top >= r.bottom)
+    if(r.is_empty() || Rects.empty())
         return; // nullptr rect
 
     // check bounding rectangle
-    EnsureBound();
     if(!Bound.intersects_with_no_empty_check(r)) {
         // Out of the Bouding rectangle; nothing to do
         return;
     }
 
-    switch(GetRectangleIntersectionCode(Bound, r)) {
-        case 8 + 4 + 2 + 1: // r overlaps Bound
-            Clear(); // nothing remains
-            return;
-        case 8 + 4 + 2: // r overlaps upper of Bound
-            Bound.top = r.bottom;
-            break;
-        case 4 + 2 + 1: // r overlaps right of Bound
-            Bound.right = r.left;
-            break;
-        case 8 + 4 + 1: // r overlaps bottom of Bound
-            Bound.bottom = r.top;
-            break;
-        case 8 + 2 + 1: // r overlaps left of Bound
-            Bound.left = r.right;
-            break;
+    if(Bound.included_in_no_empty_check(r)) {
+        Clear(); // nothing remains
+        return;
     }
 
-    // Walk through rectangles
-    tTVPRegionRect *c = Head;
-    while(c->top < r.bottom) {
-        // Check intersection
-        bool next_is_head;
-        if(c->intersects_with_no_empty_check(r)) {
-            // check bounding rectangle
-            if(c->left == Bound.left || c->top == Bound.top ||
-               c->right == Bound.top || c->bottom == Bound.bottom) {
-                // one of the rectangle edge touches bounding
-                // rectangle
-                BoundValid = false; // invalidate bounding rectangle
-            }
-
-            // Do Subtract operation. This may increase the rectangle
-            // count.
-            tTVPRegionRect *next = c->Next;
-            next_is_head = next == Head;
-            Current = c;
-            RectangleSub(c, &r);
-            c = next_is_head ? Head : next;
-            // Re-assign head since the "Head" may change in
-            // "RectangleSub"
-        } else {
-            // Step next
-            c = c->Next;
-            next_is_head = c == Head;
-        }
-
-        if(!Head || !c || next_is_head)
-            break;
-    }
+    OperateRect(r, roSub);
+    CalcBound();
 }
 //---------------------------------------------------------------------------
 void tTVPComplexRect::Sub(const tTVPComplexRect &ref) {
     // Subtract operation
-    if(ref.Count == 0)
+    if(ref.Rects.empty() || Rects.empty())
         return; // nothing to do
 
     // check bounding rectangle
-    EnsureBound();
-    (const_cast<tTVPComplexRect *>(&ref))->EnsureBound();
     if(!Bound.intersects_with_no_empty_check(ref.Bound)) {
         // Out of the Bouding rectangle; nothing to do
         return;
     }
 
-    tTVPRegionRect *c = ref.Head;
-    bool boundvalid = true;
-    while(true) {
-        // subtract a rectangle
-        Sub(*c);
-
-        // check bounding rectangle validity
-        boundvalid = BoundValid && boundvalid;
-        BoundValid = true; // force validate bounding rectangle not to
-                           // recalculate it.
-
-        // step next
-        c = c->Next;
-        if(c == ref.Head)
-            break;
-    }
-
-    BoundValid = boundvalid;
+    Operate(ref.Rects.data(), ref.Rects.data() + ref.Rects.size(), roSub);
 }
 //---------------------------------------------------------------------------
 void tTVPComplexRect::And(const tTVPRect &r) {
     // Do "logical and" operation
-    if(Count == 0)
+    if(Rects.empty())
         return; // nothing to do
 
     // Check for nullptr rectangle
-    if(r.left >= r.right || r.top >= r.bottom) {
-        Clear(); // nullptr rectangle; nothing remains
-        return;
-    }
-
-    // check bounding rectangle
-    EnsureBound();
-    if(!Bound.intersects_with_no_empty_check(r)) {
-        // Out of the Bouding rectangle; nothing remains
-        Clear();
+    if(r.is_empty() || !Bound.intersects_with_no_empty_check(r)) {
+        Clear(); // nothing remains
         return;
     }
 
-    switch(GetRectangleIntersectionCode(Bound, r)) {
-        case 8 + 4 + 2 + 1: // r overlaps Bound
-            // nothing to do
-            return;
-    }
-
-    bool is_first = true;
-    bool next_is_head;
-    tTVPRegionRect *c = Head, *cc;
-    while(true) {
-        c = (cc = c)->Next;
-        next_is_head = c == Head;
-        if(cc->clip(r)) // clip with r
-        {
-            if(is_first)
-                Bound = *cc, is_first = false;
-            else
-                Bound.do_union(*cc);
-        } else {
-            Remove(cc);
-        }
-
-        if(next_is_head)
-            break;
-    }
+    if(Bound.included_in_no_empty_check(r))
+        return; // r overlaps Bound; nothing to do
 
-    if(is_first)
-        BoundValid = false; // Nothing remains
-    else
-        BoundValid = true;
+    Operate(&r, &r + 1, roAnd);
 }
 //---------------------------------------------------------------------------
 void tTVPComplexRect::CopyWithOffsets(const tTVPComplexRect &ref,
@@ -642,473 +440,57 @@ void tTVPComplexRect::CopyWithOffsets(const tTVPComplexRect &ref,
     // with the "clip", Note that this function must be called
     // immediately after the construction or the "Clear" function
     // (This function never clears the rectangles).
+    if(ref.Rects.empty())
+        return;
 
-    // copy rectangles
-    if(ref.Count) {
-        tTVPRegionRect *ref_cur = ref.Head;
-        bool is_first = true;
-        do {
-            tTVPRect rect(*ref_cur);
-            rect.add_offsets(ofsx, ofsy);
-            if(TVPIntersectRect(&rect, rect, clip)) {
-                // has intersection
-                Insert(rect);
-                if(is_first)
-                    Bound = rect, is_first = false;
-                else
-                    Bound.do_union(rect);
-            }
-            ref_cur = ref_cur->Next;
-        } while(ref_cur != ref.Head);
-
-        if(is_first)
-            BoundValid = false; // Nothing remains
-        else
-            BoundValid = true;
+    if(!Rects.empty()) {
+        tTVPComplexRect rects;
+        rects.CopyWithOffsets(ref, clip, ofsx, ofsy);
+        Or(rects);
+        return;
     }
+
+    // clip in ref's coordinates, then move
+    tTVPRect r(clip);
+    r.add_offsets(-ofsx, -ofsy);
+    if(r.is_empty())
+        return;
+    const tTVPRect *r1 = ref.Rects.data();
+    TVPRegionOperate(Rects, r1, r1 + ref.Rects.size(), &r, &r + 1, roAnd);
+    for(tTVPRect &rect : Rects)
+        rect.add_offsets(ofsx, ofsy);
+    CalcBound();
 }
 //---------------------------------------------------------------------------
 void tTVPComplexRect::AddOffsets(tjs_int x, tjs_int y) {
     // Add offsets to rectangles
-    if(Count == 0)
+    if(Rects.empty())
         return; // nothing to do
 
     // for bounding rectangle
     Bound.add_offsets(x, y);
 
     // process per a rectangle
-    tTVPRegionRect *cur = Head;
-    do {
-        cur->add_offsets(x, y);
-        cur = cur->Next;
-    } while(cur != Head);
+    for(tTVPRect &rect : Rects)
+        rect.add_offsets(x, y);
 }
 //---------------------------------------------------------------------------
 void tTVPComplexRect::CalcBound() {
     // Calculate bounding rectangle
-    if(Count) {
-        tTVPRegionRect *c = Head;
-        Bound = *Head;
-        c = c->Next;
-        while(c != Head) {
-            Bound.do_union(*c);
-            c = c->Next;
+    if(!Rects.empty()) {
+        Bound.top = Rects.front().top;
+        Bound.bottom = Rects.back().bottom;
+        Bound.left = Rects.front().left;
+        Bound.right = Rects.front().right;
+        for(const tTVPRect &rect : Rects) {
+            if(Bound.left > rect.left)
+                Bound.left = rect.left;
+            if(Bound.right < rect.right)
+                Bound.right = rect.right;
         }
     } else {
         // no rectangles; bounding rectangle is not valid
-        Bound.left = Bound.top = Bound.right = Bound.bottom = 0;
-    }
-}
-//---------------------------------------------------------------------------
-
-//---------------------------------------------------------------------------
-void tTVPComplexRect::RectangleSub(tTVPRegionRect *r, const tTVPRect *rr) {
-    // Subtract rr from r
-    tjs_int cond = GetRectangleIntersectionCode(*r, *rr);
-
-    tTVPRect nr;
-    switch(cond) {
-            //--------------------------------------------------
-        case 0:
-            /*
-                 +-----------+
-                     |     r     |
-                     +---+---+---+
-                 |nr2|rr |nr3|
-                 +---+---+---+
-                 |    nr4    |
-                     +-----------+
-            */
-            // nr2
-            nr.left = r->left;
-            nr.top = rr->top;
-            nr.right = rr->left;
-            nr.bottom = rr->bottom;
-            Insert(nr);
-            // nr3
-            nr.left = rr->right;
-            nr.top = rr->top;
-            nr.right = r->right;
-            nr.bottom = rr->bottom;
-            Insert(nr);
-            // nr4
-            nr.left = r->left;
-            nr.top = rr->bottom;
-            nr.right = r->right;
-            nr.bottom = r->bottom;
-            Insert(nr);
-
-            // r
-            r->bottom = rr->top;
-
-            break;
-            //--------------------------------------------------
-        case 8 + 4 + 2 + 1:
-            /*
-            +---------------------+
-            |                     |
-            |                     |
-            |                     |
-            |                     |
-            |         rr          |
-            |                     |
-            |                     |
-            |                     |
-            |                     |
-            +---------------------+
-            */
-            Remove(r);
-            break;
-            //--------------------------------------------------
-        case 8 + 4:
-            /*
-                 +-----------+
-                     |     r     |
-            +----+-----------+----+
-            |         rr          |
-            +----+-----------+----+
-                 |    nr2    |
-                 +-----------+
-            */
-            // nr2
-            nr.left = r->left;
-            nr.top = rr->bottom;
-            nr.right = r->right;
-            nr.bottom = r->bottom;
-            Insert(nr);
-
-            // r
-            r->bottom = rr->top;
-
-            break;
-            //--------------------------------------------------
-        case 1 + 2:
-            /*
-                     +---+
-                     |   |
-                 +---+   +---+
-                 |   |   |   |
-                 |   |   |   |
-                     | r |rr |nr2|
-                 |   |   |   |
-                 |   |   |   |
-                 +---+   +---+
-                     |   |
-                     +---+
-            */
-            // nr2
-            nr.left = rr->right;
-            nr.top = r->top;
-            nr.right = r->right;
-            nr.bottom = r->bottom;
-            Insert(nr);
-
-            // r
-            r->right = rr->left;
-
-            break;
-            //--------------------------------------------------
-        case 8 + 2:
-            /*
-            +------+
-            |      |
-            |      +---------+
-            |  rr  |         |
-            |      |   nr1   |
-            |      |         |
-            +----+-+---------+
-                 |     nr2   |
-                 +-----------+
-            */
-            // nr1
-            nr.left = rr->right;
-            nr.top = r->top;
-            nr.right = r->right;
-            nr.bottom = rr->bottom;
-            Insert(nr);
-            // nr2
-            nr.left = r->left;
-            nr.top = rr->bottom;
-            nr.right = r->right;
-            nr.bottom = r->bottom;
-            Insert(nr);
-
-            Remove(r);
-            break;
-            //--------------------------------------------------
-        case 4 + 2:
-            /*
-                           +------+
-                           |      |
-                 +---------+      |
-                 |         |  rr  |
-                     |    r    |      |
-                 |         |      |
-                 +---------+-+----+
-                 |   nr2     |
-                 +-----------+
-            */
-            // nr2
-            nr.left = r->left;
-            nr.top = rr->bottom;
-            nr.right = r->right;
-            nr.bottom = r->bottom;
-            Insert(nr);
-
-            // r
-            r->bottom = rr->bottom;
-            r->right = rr->left;
-
-            break;
-            //--------------------------------------------------
-        case 4 + 1:
-            /*
-                     +-----------+
-                     |     r     |
-                     +---------+-+----+
-                     |         |      |
-                     |    nr2  |      |
-                     |         |  rr  |
-                     +---------+      |
-                                       |      |
-                                       +------+
-            */
-            // nr2
-            nr.left = r->left;
-            nr.top = rr->top;
-            nr.right = rr->left;
-            nr.bottom = r->bottom;
-            Insert(nr);
-
-            // r
-            r->bottom = rr->top;
-
-            break;
-            //--------------------------------------------------
-        case 8 + 1:
-            /*
-                 +-----------+
-                     |      r    |
-            +----+-+---------+
-            |      |         |
-            |      |   nr2   |
-            |  rr  |         |
-            |      +---------+
-            |      |
-            +------+
-            */
-            // nr2
-            nr.left = rr->right;
-            nr.top = rr->top;
-            nr.right = r->right;
-            nr.bottom = r->bottom;
-            Insert(nr);
-
-            // r
-            r->bottom = rr->top;
-
-            break;
-            //--------------------------------------------------
-        case 8 + 4 + 2:
-            /*
-            +---------------------+
-            |                     |
-            |                     |
-            |          rr         |
-            |                     |
-            |                     |
-            +----+-----------+----+
-                     |     nr    |
-                     +-----------+
-            */
-            // nr
-            nr.left = r->left;
-            nr.top = rr->bottom;
-            nr.right = r->right;
-            nr.bottom = r->bottom;
-            Insert(nr);
-
-            Remove(r);
-            break;
-            //--------------------------------------------------
-        case 4 + 2 + 1:
-            /*
-                             +------------+
-                             |            |
-                     +---+            |
-                     |   |            |
-                     |   |            |
-                     | r |     rr     |
-                     |   |            |
-                     |   |            |
-                     +---+            |
-                             |            |
-                             +------------+
-            */
-            // r
-            r->right = rr->left;
-
-            break;
-            //--------------------------------------------------
-        case 8 + 4 + 1:
-            /*
-                     +-----------+
-                     |     r     |
-            +----+-----------+----+
-            |                     |
-            |                     |
-            |          rr         |
-            |                     |
-            |                     |
-            +---------------------+
-            */
-            // r
-            r->bottom = rr->top;
-
-            break;
-            //--------------------------------------------------
-        case 8 + 2 + 1:
-            /*
-            +------------+
-            |            |
-            |            +---+
-            |            |   |
-            |            |   |
-            |    rr      |nr |
-            |            |   |
-            |            |   |
-            |            +---+
-            |            |
-            +------------+
-            */
-            // nr
-            nr.left = rr->right;
-            nr.top = r->top;
-            nr.right = r->right;
-            nr.bottom = r->bottom;
-            Insert(nr);
-
-            Remove(r);
-            break;
-            //--------------------------------------------------
-        case 8:
-            /*
-                 +-----------+
-                     |      r    |
-            +----+-+---------+
-            |  rr  |   nr2   |
-            +----+-+---------+
-                 |     nr3   |
-                 +-----------+
-            */
-            // nr2
-            nr.left = rr->right;
-            nr.top = rr->top;
-            nr.right = r->right;
-            nr.bottom = rr->bottom;
-            Insert(nr);
-            // nr3
-            nr.left = r->left;
-            nr.top = rr->bottom;
-            nr.right = r->right;
-            nr.bottom = r->bottom;
-            Insert(nr);
-            // r
-            r->bottom = rr->top;
-
-            break;
-            //--------------------------------------------------
-        case 4:
-            /*
-                 +-----------+
-                     |    r      |
-                     +---------+-+----+
-                 |   nr2   |  rr  |
-                 +---------+-+----+
-                 |   nr3     |
-                 +-----------+
-            */
-            // nr2
-            nr.left = r->left;
-            nr.top = rr->top;
-            nr.right = rr->left;
-            nr.bottom = rr->bottom;
-            Insert(nr);
-            // nr3
-            nr.left = r->left;
-            nr.top = rr->bottom;
-            nr.right = r->right;
-            nr.bottom = r->bottom;
-            Insert(nr);
-
-            // r
-            r->bottom = rr->top;
-
-            break;
-            //--------------------------------------------------
-        case 2:
-            /*
-                     +---+
-                     |   |
-                 +---+ rr+---+
-                     | r |   |nr2|
-                 +---+---+---+
-                 |           |
-                 |    nr3    |
-                 |           |
-                 +-----------+
-            */
-            // nr2
-            nr.left = rr->right;
-            nr.top = r->top;
-            nr.right = r->right;
-            nr.bottom = rr->bottom;
-            Insert(nr);
-            // nr3
-            nr.left = r->left;
-            nr.top = rr->bottom;
-            nr.right = r->right;
-            nr.bottom = r->bottom;
-            Insert(nr);
-
-            // r
-            r->right = rr->left;
-            r->bottom = rr->bottom;
-
-            break;
-            //--------------------------------------------------
-        case 1:
-            /*
-                 +-----------+
-                 |           |
-                     |     r     |
-                 |           |
-                 +---+---+---+
-                 |nr2|   |nr3|
-                 +---+rr +---+
-                     |   |
-                     +---+
-            */
-            // nr2
-            nr.left = r->left;
-            nr.top = rr->top;
-            nr.right = rr->left;
-            nr.bottom = r->bottom;
-            Insert(nr);
-            // nr3
-            nr.left = rr->right;
-            nr.top = rr->top;
-            nr.right = r->right;
-            nr.bottom = r->bottom;
-            Insert(nr);
-
-            // r
-            r->bottom = rr->top;
-
-            break;
-
-        default:
-            return;
+        Bound.clear();
     }
 }
 //---------------------------------------------------------------------------
@@ -1122,10 +504,8 @@ void tTVPComplexRect::DumpChain() {
     ttstr str;
     tIterator it = GetIterator();
     while(it.Step()) {
-        str +=
-            { fmt::format("{} ({}) {} : ", static_cast<void *>(it.Get().Prev),
-                          static_cast<const void *>(&(it.Get())),
-                          static_cast<void *>(it.Get().Next)) };
+        str += { fmt::format("({}, {})-({}, {}) : ", it->left, it->top,
+                             it->right, it->bottom) };
     }
     OutputDebugString(str.c_str());
 }
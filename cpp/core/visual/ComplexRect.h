@@ -13,6 +13,7 @@
 #define ComplexRectUnitH
 
 #include <stdlib.h>
+#include <vector>
 #include "tjsTypes.h"
 
 //---------------------------------------------------------------------------
@@ -171,71 +172,31 @@ public: // comparison operators for sorting
 
 /*]*/
 
-//---------------------------------------------------------------------------
-// tTVPRegionRect : a class for a rectangle in region
-//---------------------------------------------------------------------------
-class tTVPRegionRect;
-extern tTVPRegionRect *TVPAllocateRegionRect();
-extern void TVPDeallocateRegionRect(tTVPRegionRect *rect);
-//---------------------------------------------------------------------------
-class tTVPRegionRect : public tTVPRect {
-public: // data members
-    tTVPRegionRect *Prev; // previous link
-    tTVPRegionRect *Next; // next link
-
-public: // new and delete
-    void *operator new(size_t size) { return TVPAllocateRegionRect(); }
-    void operator delete(void *p) {
-        TVPDeallocateRegionRect((tTVPRegionRect *)p);
-    }
-
-public: // constructors and destructor
-    tTVPRegionRect() { ; };
-    tTVPRegionRect(const tTVPRect &r) : tTVPRect(r) { ; };
-    ~tTVPRegionRect() { ; };
-
-public: // link operations
-    void LinkAfter(tTVPRegionRect *r) {
-        // Insert this after r.
-        tTVPRegionRect *n = r->Next;
-        r->Next = this;
-        n->Prev = this;
-        Prev = r;
-        Next = n;
-    }
-
-    void LinkBefore(tTVPRegionRect *r) {
-        // Insert this before r.
-        tTVPRegionRect *p = r->Prev;
-        r->Prev = this;
-        p->Next = this;
-        Prev = p;
-        Next = r;
-    }
-
-    void Unlink() {
-        // unchain from the link list
-        tTVPRegionRect *prev = Prev;
-        tTVPRegionRect *next = Next;
-        prev->Next = next;
-        next->Prev = prev;
-    }
-};
-//---------------------------------------------------------------------------
-
 //---------------------------------------------------------------------------
 // tTVPComplexRect
 //---------------------------------------------------------------------------
+// The region is held as y-x banded rectangles in a contiguous array, in
+// the same manner as X11/pixman regions:
+//  - rectangles are sorted by top, then by left.
+//  - rectangles in a band share the same top and bottom, and never
+//    overlap nor touch each other horizontally.
+//  - bands never overlap vertically, and vertically adjacent bands
+//    which have the same spans are coalesced into one band.
+// Thus the logical operations are done with one merge walk over the two
+// band lists.
+//---------------------------------------------------------------------------
 class tTVPComplexRect {
 public: // iterator
     class tIterator {
     private: // data members
-        const tTVPRegionRect *Head;
-        const tTVPRegionRect *Current;
+        const tTVPRect *Next;
+        const tTVPRect *End;
+        const tTVPRect *Current;
 
     public: // constructor and destructor
-        tIterator() : Head(nullptr), Current(nullptr) { ; }
-        tIterator(const tTVPRegionRect *head) : Head(head), Current(nullptr) {
+        tIterator() : Next(nullptr), End(nullptr), Current(nullptr) { ; }
+        tIterator(const tTVPRect *begin, const tTVPRect *end) :
+            Next(begin), End(end), Current(nullptr) {
             ;
         }
 
@@ -243,7 +204,7 @@ public: // iterator
         const tTVPRect &operator*() const { return *Current; }
         const tTVPRect *operator->() const { return Current; }
 
-        const tTVPRegionRect &Get() const { return *Current; }
+        const tTVPRect &Get() const { return *Current; }
 
     public: // stepping forward; this object supports only forward
             // step. method step returns true if stepping successful,
@@ -253,45 +214,29 @@ public: // iterator
             //   while(it.Step()) { .. do something with it .. }
         bool Step() {
             // Step forward
-            if(!Head)
+            if(Next == End)
                 return false;
-            if(!Current) {
-                Current = Head;
-                return true;
-            }
-            if(Current->Next == Head) {
-                return false;
-            }
-            Current = Current->Next;
+            Current = Next++;
             return true;
         }
     };
 
 private: // data members
-    tTVPRegionRect *Head; // head of the link list
-    tTVPRegionRect *Current; // a rectangle which is touched last time
-    tjs_int Count; // rectangle Count
+    std::vector<tTVPRect> Rects; // banded rectangles
     tTVPRect Bound; // bounding rectangle
-    bool BoundValid; // whether the bounding rectangle is ready to use
 
 public: // constructors and destructors
     tTVPComplexRect();
     tTVPComplexRect(const tTVPComplexRect &ref);
     ~tTVPComplexRect();
 
+    tTVPComplexRect &operator=(const tTVPComplexRect &ref);
+
 public: // storage management
     void Clear();
 
-private: // storage management
-    void FreeAllRectangles(); // free all rectangles
-    void Init(); // initialize internal states
-    void SetCount(tjs_int count); // grow or shrink rectangle storage area
-    bool Insert(const tTVPRect &rect); // insert inplace
-    void Remove(tTVPRegionRect *rect); // remove a rectangle
-    void Merge(
-        const tTVPComplexRect &rects); // merge non-overlaped complex rectangle
 public:
-    tjs_int GetCount() const { return Count; }
+    tjs_int GetCount() const { return (tjs_int)Rects.size(); }
 
 public: // logical operations
     void Or(const tTVPRect &r);
@@ -305,10 +250,7 @@ public: // operation utilities
                          tjs_int ofsx, tjs_int ofsy);
 
 public: // bounding rectangle
-    const tTVPRect &GetBound() const {
-        (const_cast<tTVPComplexRect *>(this))->EnsureBound();
-        return Bound;
-    }
+    const tTVPRect &GetBound() const { return Bound; }
 
     void Unite() {
         // make union (bounding) one rectangle
@@ -318,57 +260,19 @@ public: // bounding rectangle
     }
 
 private:
-    void EnsureBound() {
-        if(!BoundValid)
-            CalcBound();
-    }
     void CalcBound();
-
-private: // geometric rectangle operations
-    tjs_int GetRectangleIntersectionCode(const tTVPRect &r,
-                                         const tTVPRect &rr) {
-        // Retrieve condition code which represents
-        // how two rectangles have the intersection.
-        tjs_int cond;
-        if(rr.left <= r.left && rr.right >= r.left)
-            cond = 8;
-        else
-            cond = 0;
-        if(rr.left <= r.right && rr.right >= r.right)
-            cond |= 4;
-        if(rr.top <= r.top && rr.bottom >= r.top)
-            cond |= 2;
-        if(rr.top <= r.bottom && rr.bottom >= r.bottom)
-            cond |= 1;
-        /*
-                           +8             +4
-
-                        +------+ +---+ +------+
-                        |rr    | |rr | |    rr|     +2
-                        |    +-----------+    |
-                        +----|-+ +---+ +-|----+
-                        +----|-+       +-|----+
-                        |rr  | |   r   | |  rr|
-                        +----|-+       +-|----+
-                        +----|-+ +---+ +-|----+
-                        |    +-----------+    |     +1
-                        |rr    | | rr| |    rr|
-                        +------+ +---+ +------+
-        */
-        return cond;
-    }
-
-    void RectangleSub(tTVPRegionRect *r, const tTVPRect *rr);
+    void Operate(const tTVPRect *r2, const tTVPRect *r2end, tjs_int op);
+    void OperateRect(const tTVPRect &r, tjs_int op);
 
 public:
     void AddOffsets(tjs_int x, tjs_int y);
 
 public: // iterator
     tIterator GetIterator() const {
-        if(Count)
-            return tIterator(Head);
+        if(Rects.empty())
+            return tIterator();
         else
-            return tIterator(nullptr);
+            return tIterator(Rects.data(), Rects.data() + Rects.size());
     }
 
 public: // debug
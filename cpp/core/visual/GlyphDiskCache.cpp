@@ -0,0 +1,471 @@
+//---------------------------------------------------------------------------
+/*
+        TVP2 ( T Visual Presenter 2 )  A script authoring tool
+        Copyright (C) 2000 W.Dee <dee@kikyou.info> and contributors
+
+        See details of license at "license.txt"
+*/
+//---------------------------------------------------------------------------
+// On-disk cache of rasterized glyphs
+//---------------------------------------------------------------------------
+#include "tjsCommHead.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "GlyphDiskCache.h"
+#include "FontImpl.h"
+#include "FontSystem.h"
+#include "MsgIntf.h"
+#include "StorageIntf.h"
+#include "SysInitIntf.h"
+#include "Platform.h"
+
+extern FontSystem *TVPFontSystem;
+
+//---------------------------------------------------------------------------
+// increase this when the rasterizer output changes while the engine version
+// stays the same; glyphs stored by older builds are then ignored.
+#define TVP_GLYPH_CACHE_FORMAT 1
+
+// a file stops growing at this size
+#define TVP_GLYPH_CACHE_MAX_FILE_SIZE (16 * 1024 * 1024)
+
+// the glyphs are written when this many bytes are pending, or when the
+// application is idle
+#define TVP_GLYPH_CACHE_FLUSH_SIZE (256 * 1024)
+
+//---------------------------------------------------------------------------
+// cache file layout : tTVPGlyphCacheHeader, then the records appended one
+// after another. each record is a tTVPGlyphCacheRecord followed by the 8-bit
+// coverage of the glyph, BlackBoxX * BlackBoxY bytes with no padding between
+// the lines, padded to 4 bytes at the end. a later record of the same
+// character overrides the earlier ones. the files are written in the native
+// byte order; they never leave the machine.
+//---------------------------------------------------------------------------
+static const char TVPGlyphCacheTag[8] = { 'T', 'V', 'P', 'G',
+                                          'L', 'Y', 'C', 0 };
+
+struct tTVPGlyphCacheRecord {
+    tjs_uint32 Character;
+    tjs_int32 OriginX; // without the offset given to the rasterizer
+    tjs_int32 OriginY;
+    tjs_int32 CellIncX;
+    tjs_int32 CellIncY;
+    tjs_uint32 BlackBoxX;
+    tjs_uint32 BlackBoxY;
+    tjs_uint32 Gray;
+    tjs_uint32 Hash; // of the fields above and the coverage
+};
+
+// glyphs larger than this are not stored, and records claiming to be larger
+// are taken as broken
+#define TVP_GLYPH_CACHE_MAX_GLYPH_SIZE 4096
+
+//---------------------------------------------------------------------------
+#define TVP_GLYPH_CACHE_HASH_BASIS 14695981039346656037ULL
+static tjs_uint64
+TVPGlyphCacheHash(const void *data, size_t size,
+                  tjs_uint64 hash = TVP_GLYPH_CACHE_HASH_BASIS) {
+    // FNV-1a
+    const auto *p = static_cast<const tjs_uint8 *>(data);
+    for(size_t i = 0; i < size; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+//---------------------------------------------------------------------------
+static tjs_uint64
+TVPGlyphCacheHash(const ttstr &str,
+                  tjs_uint64 hash = TVP_GLYPH_CACHE_HASH_BASIS) {
+    if(str.IsEmpty())
+        return hash;
+    return TVPGlyphCacheHash(str.c_str(), str.GetLen() * sizeof(tjs_char),
+                             hash);
+}
+//---------------------------------------------------------------------------
+static tjs_uint32 TVPGetGlyphCacheRecordHash(const tTVPGlyphCacheRecord &rec,
+                                             const tjs_uint8 *coverage) {
+    tjs_uint64 hash =
+        TVPGlyphCacheHash(&rec, offsetof(tTVPGlyphCacheRecord, Hash));
+    hash = TVPGlyphCacheHash(coverage, (size_t)rec.BlackBoxX * rec.BlackBoxY,
+                             hash);
+    return (tjs_uint32)(hash ^ (hash >> 32));
+}
+//---------------------------------------------------------------------------
+static size_t TVPGetGlyphCacheRecordSize(const tTVPGlyphCacheRecord &rec) {
+    size_t size = (size_t)rec.BlackBoxX * rec.BlackBoxY;
+    return sizeof(tTVPGlyphCacheRecord) + ((size + 3) & ~(size_t)3);
+}
+//---------------------------------------------------------------------------
+static bool TVPIsGlyphDiskCacheEnabled() {
+    static int enabled = -1;
+    if(enabled == -1) {
+        enabled = 1;
+        tTJSVariant val;
+        if(TVPGetCommandLine(TJS_W("-glyphcache"), &val)) {
+            ttstr str(val);
+            if(str == TJS_W("no"))
+                enabled = 0;
+        }
+    }
+    return enabled == 1;
+}
+//---------------------------------------------------------------------------
+static tjs_uint64 TVPGetGlyphCacheEngineHash() {
+    static tjs_uint64 hash = 0;
+    if(!hash) {
+        ttstr sig = TVPGetVersionString() + TJS_W("/") +
+            ttstr((tjs_int)TVP_GLYPH_CACHE_FORMAT);
+        hash = TVPGlyphCacheHash(sig);
+    }
+    return hash;
+}
+//---------------------------------------------------------------------------
+static std::string TVPGetGlyphCacheFolder() {
+    return TVPGetInternalPreferencePath() + "glyph/";
+}
+//---------------------------------------------------------------------------
+static ttstr TVPGetGlyphCacheFontFile(const ttstr &face) {
+    // the font file which the rasterizer opens for "face". the size of the
+    // file is taken in, so that a replaced font does not use the glyphs
+    // of the old one.
+    ttstr name = TVPFontSystem->GetBeingFont(face);
+    TVPFontNamePathInfo *info = TVPFindFont(name);
+    if(!info)
+        info = TVPFindFont(TVPGetDefaultFontName());
+    if(!info)
+        return ttstr();
+
+    tjs_uint64 size = 0;
+    std::unique_ptr<tTJSBinaryStream> stream(TVPCreateFontStream(name));
+    if(stream)
+        size = stream->GetSize();
+    return info->Path + TJS_W("/") + ttstr(info->Index) + TJS_W("/") +
+        ttstr((tjs_int64)size);
+}
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// tTVPGlyphCacheFile
+//---------------------------------------------------------------------------
+tTVPGlyphCacheFile::tTVPGlyphCacheFile(const std::string &filename,
+                                       tjs_uint64 fonthash) :
+    FileName(filename) {
+    memcpy(Header.Tag, TVPGlyphCacheTag, sizeof(Header.Tag));
+    Header.EngineHash = TVPGetGlyphCacheEngineHash();
+    Header.FontHash = fonthash;
+}
+//---------------------------------------------------------------------------
+tTVPGlyphCacheFile::~tTVPGlyphCacheFile() { Unmap(); }
+//---------------------------------------------------------------------------
+void tTVPGlyphCacheFile::Load() {
+    Loaded = true;
+
+#ifndef _WIN32
+    int fd = open(FileName.c_str(), O_RDONLY);
+    if(fd >= 0) {
+        struct stat st;
+        if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+           (size_t)st.st_size >= sizeof(tTVPGlyphCacheHeader)) {
+            void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ,
+                           MAP_SHARED, fd, 0);
+            if(p != MAP_FAILED) {
+                Mapped = (tjs_uint8 *)p;
+                MappedSize = (size_t)st.st_size;
+                Stored = Mapped;
+                StoredSize = MappedSize;
+            }
+        }
+        close(fd);
+    }
+#endif
+    if(!Stored) {
+        FILE *fp = fopen(FileName.c_str(), "rb");
+        if(fp) {
+            if(fseek(fp, 0, SEEK_END) == 0) {
+                long size = ftell(fp);
+                if(size >= (long)sizeof(tTVPGlyphCacheHeader)) {
+                    FileData.resize((size_t)size);
+                    fseek(fp, 0, SEEK_SET);
+                    if(fread(FileData.data(), 1, FileData.size(), fp) !=
+                       FileData.size())
+                        FileData.clear();
+                }
+            }
+            fclose(fp);
+        }
+        Stored = FileData.data();
+        StoredSize = FileData.size();
+    }
+
+    if(StoredSize < sizeof(tTVPGlyphCacheHeader) ||
+       memcmp(Stored, &Header, sizeof(Header))) {
+        // missing, or written by another engine; made again on Flush
+        Unmap();
+        FileEnd = 0;
+        return;
+    }
+
+    // index the records. a record which is cut at the end of the file was
+    // being written when the engine stopped; records are appended over it.
+    size_t pos = sizeof(tTVPGlyphCacheHeader);
+    while(pos + sizeof(tTVPGlyphCacheRecord) <= StoredSize) {
+        tTVPGlyphCacheRecord rec;
+        memcpy(&rec, Stored + pos, sizeof(rec));
+        if(rec.BlackBoxX > TVP_GLYPH_CACHE_MAX_GLYPH_SIZE ||
+           rec.BlackBoxY > TVP_GLYPH_CACHE_MAX_GLYPH_SIZE)
+            break;
+        size_t size = TVPGetGlyphCacheRecordSize(rec);
+        if(size > StoredSize - pos)
+            break;
+        Index[rec.Character] = pos;
+        pos += size;
+    }
+    FileEnd = pos;
+}
+//---------------------------------------------------------------------------
+void tTVPGlyphCacheFile::Unmap() {
+#ifndef _WIN32
+    if(Mapped)
+        munmap(Mapped, MappedSize);
+#endif
+    Mapped = nullptr;
+    MappedSize = 0;
+    std::vector<tjs_uint8>().swap(FileData);
+    Stored = nullptr;
+    StoredSize = 0;
+}
+//---------------------------------------------------------------------------
+tTVPCharacterData *tTVPGlyphCacheFile::Read(tjs_uint32 ch, tjs_int aofsx) {
+    if(!Loaded)
+        Load();
+
+    auto i = Index.find(ch);
+    if(i == Index.end())
+        return nullptr;
+
+    const tjs_uint8 *p = GetRecord(i->second);
+    tTVPGlyphCacheRecord rec;
+    memcpy(&rec, p, sizeof(rec));
+    const tjs_uint8 *coverage = p + sizeof(rec);
+    if(TVPGetGlyphCacheRecordHash(rec, coverage) != rec.Hash) {
+        // damaged; rendered and stored again
+        Index.erase(i);
+        return nullptr;
+    }
+
+    tGlyphMetrics metrics;
+    metrics.CellIncX = rec.CellIncX;
+    metrics.CellIncY = rec.CellIncY;
+    tTVPCharacterData *data = new tTVPCharacterData(
+        coverage, rec.BlackBoxX, rec.OriginX + aofsx, rec.OriginY,
+        rec.BlackBoxX, rec.BlackBoxY, metrics);
+    data->Gray = rec.Gray;
+    return data;
+}
+//---------------------------------------------------------------------------
+void tTVPGlyphCacheFile::Write(tjs_uint32 ch, tjs_int aofsx,
+                               const tTVPCharacterData *data) {
+    if(!Loaded)
+        Load();
+    if(Failed || Index.find(ch) != Index.end())
+        return;
+    if(data->BlackBoxX > TVP_GLYPH_CACHE_MAX_GLYPH_SIZE ||
+       data->BlackBoxY > TVP_GLYPH_CACHE_MAX_GLYPH_SIZE)
+        return;
+
+    tTVPGlyphCacheRecord rec;
+    rec.Character = ch;
+    rec.OriginX = data->OriginX - aofsx;
+    rec.OriginY = data->OriginY;
+    rec.CellIncX = data->Metrics.CellIncX;
+    rec.CellIncY = data->Metrics.CellIncY;
+    rec.BlackBoxX = data->BlackBoxX;
+    rec.BlackBoxY = data->BlackBoxY;
+    rec.Gray = data->Gray;
+
+    size_t size = TVPGetGlyphCacheRecordSize(rec);
+    tjs_uint64 end = FileEnd ? FileEnd : sizeof(tTVPGlyphCacheHeader);
+    if(end + GetPendingSize() + size > TVP_GLYPH_CACHE_MAX_FILE_SIZE)
+        return;
+
+    size_t offset = Added.size();
+    Added.resize(offset + size, 0);
+    tjs_uint8 *coverage = Added.data() + offset + sizeof(rec);
+    for(tjs_uint y = 0; y < rec.BlackBoxY; y++)
+        memcpy(coverage + (size_t)rec.BlackBoxX * y,
+               data->GetData() + (size_t)data->Pitch * y, rec.BlackBoxX);
+    rec.Hash = TVPGetGlyphCacheRecordHash(rec, coverage);
+    memcpy(Added.data() + offset, &rec, sizeof(rec));
+
+    Index[ch] = StoredSize + offset;
+}
+//---------------------------------------------------------------------------
+void tTVPGlyphCacheFile::Flush() {
+    if(Failed || !GetPendingSize())
+        return;
+
+    FILE *fp = nullptr;
+    if(FileEnd) {
+        fp = fopen(FileName.c_str(), "r+b");
+        if(fp && fseek(fp, (long)FileEnd, SEEK_SET)) {
+            fclose(fp);
+            fp = nullptr;
+        }
+        if(!fp) {
+            Failed = true;
+            return;
+        }
+    } else {
+        fp = fopen(FileName.c_str(), "wb");
+        if(!fp) { // make dirs
+            TVPCreateFolders(TVPGetGlyphCacheFolder());
+            fp = fopen(FileName.c_str(), "wb");
+        }
+        if(!fp || fwrite(&Header, sizeof(Header), 1, fp) != 1) {
+            if(fp)
+                fclose(fp);
+            Failed = true;
+            return;
+        }
+        FileEnd = sizeof(Header);
+    }
+
+    size_t size = GetPendingSize();
+    bool ok = fwrite(Added.data() + Written, 1, size, fp) == size;
+    ok = fclose(fp) == 0 && ok;
+    if(!ok) {
+        // the last records may be cut; they are skipped when loaded
+        Failed = true;
+        return;
+    }
+    Written = Added.size();
+    FileEnd += size;
+}
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// font -> file
+//---------------------------------------------------------------------------
+static std::map<ttstr, std::unique_ptr<tTVPGlyphCacheFile>>
+    TVPGlyphCacheFiles;
+static tTVPFontAndCharacterData TVPLastGlyphCacheFont;
+static tTVPGlyphCacheFile *TVPLastGlyphCacheFile = nullptr;
+static size_t TVPGlyphCachePendingSize = 0;
+//---------------------------------------------------------------------------
+static bool TVPIsSameGlyphCacheFont(const tTVPFontAndCharacterData &a,
+                                    const tTVPFontAndCharacterData &b) {
+    return a.Font == b.Font && a.Antialiased == b.Antialiased &&
+        a.Hinting == b.Hinting && a.Blured == b.Blured &&
+        a.BlurLevel == b.BlurLevel && a.BlurWidth == b.BlurWidth;
+}
+//---------------------------------------------------------------------------
+static tTVPGlyphCacheFile *
+TVPGetGlyphCacheFile(const tTVPFontAndCharacterData &font) {
+    // returns nullptr if the glyphs of the font can not be stored
+    if(TVPLastGlyphCacheFile &&
+       TVPIsSameGlyphCacheFont(font, TVPLastGlyphCacheFont))
+        return TVPLastGlyphCacheFile;
+
+    ttstr sig = font.Font.Face + TJS_W("/") + ttstr(font.Font.Height) +
+        TJS_W("/") + ttstr((tjs_int)font.Font.Flags) + TJS_W("/") +
+        ttstr(font.Font.Angle) + TJS_W("/") +
+        ttstr((tjs_int)font.Antialiased) + ttstr((tjs_int)font.Hinting) +
+        ttstr((tjs_int)font.Blured) + TJS_W("/") + ttstr(font.BlurLevel) +
+        TJS_W("/") + ttstr(font.BlurWidth);
+
+    tTVPGlyphCacheFile *file;
+    auto i = TVPGlyphCacheFiles.find(sig);
+    if(i != TVPGlyphCacheFiles.end()) {
+        file = i->second.get();
+    } else {
+        file = nullptr;
+        try {
+            // the default font renders the characters missing in the font
+            ttstr fontfile = TVPGetGlyphCacheFontFile(font.Font.Face);
+            ttstr fallback = TVPGetGlyphCacheFontFile(TVPGetDefaultFontName());
+            if(!fontfile.IsEmpty()) {
+                tjs_uint64 hash = TVPGlyphCacheHash(sig);
+                hash = TVPGlyphCacheHash(fontfile, hash);
+                hash = TVPGlyphCacheHash(fallback, hash);
+                char name[24];
+                snprintf(name, sizeof(name), "%016llx.gly",
+                         (unsigned long long)hash);
+                file = new tTVPGlyphCacheFile(TVPGetGlyphCacheFolder() + name,
+                                              hash);
+            }
+        } catch(...) {
+            // the glyphs are rendered as usual
+        }
+        TVPGlyphCacheFiles[sig].reset(file);
+    }
+
+    TVPLastGlyphCacheFont = font;
+    TVPLastGlyphCacheFile = file;
+    return file;
+}
+//---------------------------------------------------------------------------
+tTVPCharacterData *TVPReadGlyphDiskCache(const tTVPFontAndCharacterData &font,
+                                         tjs_int aofsx) {
+    if(!TVPIsGlyphDiskCacheEnabled())
+        return nullptr;
+    tTVPGlyphCacheFile *file = TVPGetGlyphCacheFile(font);
+    if(!file)
+        return nullptr;
+
+    tTVPCharacterData *data = file->Read(font.Character, aofsx);
+    if(data) {
+        data->Antialiased = font.Antialiased;
+        data->Blured = font.Blured;
+        data->BlurLevel = font.BlurLevel;
+        data->BlurWidth = font.BlurWidth;
+    }
+    return data;
+}
+//---------------------------------------------------------------------------
+void TVPWriteGlyphDiskCache(const tTVPFontAndCharacterData &font,
+                            tjs_int aofsx, const tTVPCharacterData *data) {
+    if(!data || data->FullColored || !TVPIsGlyphDiskCacheEnabled())
+        return;
+    tTVPGlyphCacheFile *file = TVPGetGlyphCacheFile(font);
+    if(!file)
+        return;
+
+    size_t pending = file->GetPendingSize();
+    file->Write(font.Character, aofsx, data);
+    TVPGlyphCachePendingSize += file->GetPendingSize() - pending;
+    if(TVPGlyphCachePendingSize >= TVP_GLYPH_CACHE_FLUSH_SIZE)
+        TVPFlushGlyphDiskCache();
+}
+//---------------------------------------------------------------------------
+void TVPFlushGlyphDiskCache() {
+    if(!TVPGlyphCachePendingSize)
+        return;
+    for(auto &i : TVPGlyphCacheFiles)
+        if(i.second)
+            i.second->Flush();
+    TVPGlyphCachePendingSize = 0;
+}
+//---------------------------------------------------------------------------
+static void TVPReleaseGlyphDiskCache() {
+    TVPFlushGlyphDiskCache();
+    TVPLastGlyphCacheFile = nullptr;
+    TVPGlyphCacheFiles.clear();
+}
+static tTVPAtExit TVPReleaseGlyphDiskCacheAtExit(TVP_ATEXIT_PRI_SHUTDOWN,
+                                                 TVPReleaseGlyphDiskCache);
+//---------------------------------------------------------------------------
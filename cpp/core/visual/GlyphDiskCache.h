@@ -0,0 +1,98 @@
+//---------------------------------------------------------------------------
+/*
+        TVP2 ( T Visual Presenter 2 )  A script authoring tool
+        Copyright (C) 2000 W.Dee <dee@kikyou.info> and contributors
+
+        See details of license at "license.txt"
+*/
+//---------------------------------------------------------------------------
+// On-disk cache of rasterized glyphs
+//---------------------------------------------------------------------------
+#ifndef GlyphDiskCacheH
+#define GlyphDiskCacheH
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "CharacterData.h"
+
+//---------------------------------------------------------------------------
+// TVPReadGlyphDiskCache / TVPWriteGlyphDiskCache
+//---------------------------------------------------------------------------
+// glyphs rendered by the font rasterizer are kept in the user's cache
+// directory, one file per font file, size, style and antialiasing/blur
+// options. the file of a font is mapped when the font first misses the
+// memory cache; glyphs rendered later are appended to it.
+// "aofsx" is the origin offset given to the rasterizer.
+
+// returns the glyph stored for "font", or nullptr when it is not stored.
+// the returned object has its reference count set to 1.
+extern tTVPCharacterData *
+TVPReadGlyphDiskCache(const tTVPFontAndCharacterData &font, tjs_int aofsx);
+
+// stores "data", which the rasterizer rendered for "font"
+extern void TVPWriteGlyphDiskCache(const tTVPFontAndCharacterData &font,
+                                   tjs_int aofsx,
+                                   const tTVPCharacterData *data);
+
+// writes the glyphs stored since the last call to the files
+extern void TVPFlushGlyphDiskCache();
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// tTVPGlyphCacheFile : the glyphs of one font
+//---------------------------------------------------------------------------
+// the functions above keep one of these per font. "fonthash" identifies the
+// font; a file stored for another font or by another engine is made again.
+// records cut or damaged in the file are skipped, and rendered again.
+struct tTVPGlyphCacheHeader {
+    char Tag[8];
+    tjs_uint64 EngineHash; // engine version and cache format
+    tjs_uint64 FontHash; // font file, size, style and options
+};
+
+class tTVPGlyphCacheFile {
+    std::string FileName;
+    tTVPGlyphCacheHeader Header;
+
+    bool Loaded = false;
+    bool Failed = false; // stop writing after an error
+    tjs_uint8 *Mapped = nullptr;
+    size_t MappedSize = 0;
+    std::vector<tjs_uint8> FileData; // used when the file is not mapped
+    const tjs_uint8 *Stored = nullptr; // Mapped or FileData
+    size_t StoredSize = 0;
+
+    // records added in this session. they stay here after they are
+    // written, as the file is not mapped again.
+    std::vector<tjs_uint8> Added;
+    size_t Written = 0; // bytes of Added in the file
+    tjs_uint64 FileEnd = 0; // where to append; 0 if the file is to be made
+
+    // character -> offset of the record; offsets from StoredSize on are in
+    // Added
+    std::unordered_map<tjs_uint32, size_t> Index;
+
+public:
+    tTVPGlyphCacheFile(const std::string &filename, tjs_uint64 fonthash);
+    ~tTVPGlyphCacheFile();
+
+    size_t GetPendingSize() const { return Added.size() - Written; }
+
+    // the returned object has its reference count set to 1
+    tTVPCharacterData *Read(tjs_uint32 ch, tjs_int aofsx);
+    void Write(tjs_uint32 ch, tjs_int aofsx, const tTVPCharacterData *data);
+    void Flush();
+
+private:
+    void Load();
+    void Unmap();
+    const tjs_uint8 *GetRecord(size_t offset) const {
+        return offset < StoredSize ? Stored + offset
+                                   : Added.data() + (offset - StoredSize);
+    }
+};
+//---------------------------------------------------------------------------
+
+#endif
@@ -13,6 +13,9 @@
 #include "UtilStreams.h"
 #include "BitmapBitsAlloc.h"
 #include "LayerIntf.h"
+#include "SysInitIntf.h"
+
+#include <algorithm>
 
 tTVPTmpBitmapImage::tTVPTmpBitmapImage() : MetaInfo(nullptr) {}
 tTVPTmpBitmapImage::~tTVPTmpBitmapImage() {
@@ -26,8 +29,10 @@ tTVPTmpBitmapImage::~tTVPTmpBitmapImage() {
     }
 }
 tTVPImageLoadCommand::tTVPImageLoadCommand() :
-    owner_(nullptr), bmp_(nullptr), dest_(nullptr) {}
+    owner_(nullptr), bmp_(nullptr), dest_(nullptr), priority_(0), order_(0) {}
 tTVPImageLoadCommand::~tTVPImageLoadCommand() {
+    for(tTVPImageLoadCommand *waiter : waiters_)
+        delete waiter;
     if(owner_) {
         owner_->Release();
         owner_ = nullptr;
@@ -86,33 +91,57 @@ static void TVPLoadGraphicAsync_MetaInfoPushCallback(void *callbackdata,
 }
 //---------------------------------------------------------------------------
 
+// 自動設定時の読込みスレッド数の上限
+static const tjs_int TVPMaxAutoImageLoadThread = 4;
+//---------------------------------------------------------------------------
 tTVPAsyncImageLoader::tTVPAsyncImageLoader() :
-    EventQueue(this, &tTVPAsyncImageLoader::Proc), tTVPThread(true) {
+    EventQueue(this, &tTVPAsyncImageLoader::Proc), CommandOrder(0),
+    Terminated(false) {
     EventQueue.Allocate();
 }
 tTVPAsyncImageLoader::~tTVPAsyncImageLoader() {
     ExitRequest();
-    WaitFor();
+    for(std::thread &worker : Workers)
+        worker.join();
     EventQueue.Deallocate();
-    while(CommandQueue.size() > 0) {
-        tTVPImageLoadCommand *cmd = CommandQueue.front();
-        CommandQueue.pop();
+    // 読込み中だったコマンドは全て LoadedQueue に入っている
+    RunningCommands.clear();
+    for(tTVPImageLoadCommand *cmd : CommandQueue)
         delete cmd;
-    }
+    CommandQueue.clear();
     while(LoadedQueue.size() > 0) {
         tTVPImageLoadCommand *cmd = LoadedQueue.front();
         LoadedQueue.pop();
         delete cmd;
     }
 }
-void tTVPAsyncImageLoader::ExitRequest() {
-    Terminate();
-    PushCommandQueueEvent.Set();
+void tTVPAsyncImageLoader::Start() {
+    tjs_int num = 0;
+    tTJSVariant opt;
+    if(TVPGetCommandLine(TJS_W("-imgloadthread"), &opt)) {
+        ttstr str(opt);
+        if(str != TJS_W("auto"))
+            num = (tjs_int)opt;
+    }
+    if(num <= 0) {
+        // 描画スレッドの分を残しておく
+        num = std::max<tjs_int>(1, TVPGetProcessorNum() / 2);
+        num = std::min(num, TVPMaxAutoImageLoadThread);
+    }
+    num = std::min(num, TVPMaxThreadNum);
+    for(tjs_int i = 0; i < num; i++) {
+        Workers.emplace_back([this] {
+            LoadingThread();
+            TVPOnThreadExited();
+        });
+    }
 }
-void tTVPAsyncImageLoader::Execute() {
-    // プライオリティは最低にする
-    SetPriority(ttpIdle);
-    LoadingThread();
+void tTVPAsyncImageLoader::ExitRequest() {
+    {
+        std::lock_guard<std::mutex> lock(CommandQueueMutex);
+        Terminated = true;
+    }
+    CommandQueueCond.notify_all();
 }
 void tTVPAsyncImageLoader::SendToLoadFinish() {
     NativeEvent ev(TVP_EV_IMAGE_LOAD_THREAD);
@@ -125,6 +154,20 @@ void tTVPAsyncImageLoader::Proc(NativeEvent &ev) {
     }
     HandleLoadedImage();
 }
+// onLoaded( dic, is_async, is_error, error_mes )
+static void TVPPostImageLoadedEvent(iTJSDispatch2 *owner,
+                                    iTJSDispatch2 *metainfo, bool async,
+                                    const ttstr &error) {
+    if(!owner || owner->IsValid(0, nullptr, nullptr, owner) != TJS_S_TRUE)
+        return;
+    tTJSVariant param[4];
+    param[0] = tTJSVariant(metainfo, metainfo);
+    param[1] = async ? 1 : 0;
+    param[2] = error.IsEmpty() ? 0 : 1;
+    param[3] = error; // error_mes
+    static ttstr eventname(TJS_W("onLoaded"));
+    TVPPostEvent(owner, owner, eventname, 0, TVP_EPT_IMMEDIATE, 4, param);
+}
 void tTVPAsyncImageLoader::HandleLoadedImage() {
     bool loading;
     do {
@@ -139,32 +182,37 @@ void tTVPAsyncImageLoader::HandleLoadedImage() {
             }
         }
         if(cmd != nullptr) {
-            cmd->bmp_->SetLoading(false);
+            {
+                std::lock_guard<std::mutex> lock(CommandQueueMutex);
+                RunningCommands.erase(std::find(RunningCommands.begin(),
+                                                RunningCommands.end(), cmd));
+            }
+            // 読込みを要求した Bitmap 全て (取り消された要求は bmp_ が無い)
+            std::vector<tTVPImageLoadCommand *> requests;
+            if(cmd->bmp_)
+                requests.push_back(cmd);
+            requests.insert(requests.end(), cmd->waiters_.begin(),
+                            cmd->waiters_.end());
+
             if(cmd->result_.length() > 0) {
                 // error
-                tTJSVariant param[4];
-                param[0] = tTJSVariant((iTJSDispatch2 *)nullptr,
-                                       (iTJSDispatch2 *)nullptr);
-                param[1] = 1; // true async
-                param[2] = 1; // true error
-                param[3] = cmd->result_; // error_mes
-                static ttstr eventname(TJS_W("onLoaded"));
-                if(cmd->owner_ &&
-                   cmd->owner_->IsValid(0, nullptr, nullptr, cmd->owner_) ==
-                       TJS_S_TRUE) {
-                    TVPPostEvent(cmd->owner_, cmd->owner_, eventname, 0,
-                                 TVP_EPT_IMMEDIATE, 4, param);
+                for(tTVPImageLoadCommand *req : requests) {
+                    req->bmp_->SetLoading(false);
+                    TVPPostImageLoadedEvent(req->owner_, nullptr, true,
+                                            cmd->result_);
                 }
-
                 if(cmd->dest_->MetaInfo) {
                     delete cmd->dest_->MetaInfo;
                     cmd->dest_->MetaInfo = nullptr;
                 }
             } else {
-                iTJSDispatch2 *metainfo =
-                    TVPMetaInfoPairsToDictionary(cmd->dest_->MetaInfo);
-
-                cmd->bmp_->SetSizeAndImageBuffer(cmd->dest_->bmp);
+                std::vector<iTJSDispatch2 *> metainfos;
+                for(tTVPImageLoadCommand *req : requests) {
+                    req->bmp_->SetLoading(false);
+                    metainfos.push_back(
+                        TVPMetaInfoPairsToDictionary(cmd->dest_->MetaInfo));
+                    req->bmp_->SetSizeAndImageBuffer(cmd->dest_->bmp);
+                }
                 // 読込み完了時にもキャッシュチェック(非同期なので完了前に読み込まれている可能性あり)
                 if(TVPHasImageCache(cmd->path_, glmNormal, 0, 0, TVP_clNone) ==
                    false) {
@@ -178,19 +226,11 @@ void tTVPAsyncImageLoader::HandleLoadedImage() {
                 cmd->dest_->bmp->Release();
                 cmd->dest_->bmp = nullptr;
 
-                tTJSVariant param[4];
-                param[0] = tTJSVariant(metainfo, metainfo);
-                if(metainfo)
-                    metainfo->Release();
-                param[1] = 1; // true async
-                param[2] = 0; // false error
-                param[3] = TJS_W(""); // error_mes
-                static ttstr eventname(TJS_W("onLoaded"));
-                if(cmd->owner_ &&
-                   cmd->owner_->IsValid(0, nullptr, nullptr, cmd->owner_) ==
-                       TJS_S_TRUE) {
-                    TVPPostEvent(cmd->owner_, cmd->owner_, eventname, 0,
-                                 TVP_EPT_IMMEDIATE, 4, param);
+                for(size_t i = 0; i < requests.size(); i++) {
+                    TVPPostImageLoadedEvent(requests[i]->owner_, metainfos[i],
+                                            true, TJS_W(""));
+                    if(metainfos[i])
+                        metainfos[i]->Release();
                 }
             }
             delete cmd;
@@ -202,7 +242,7 @@ void tTVPAsyncImageLoader::HandleLoadedImage() {
 // onLoaded( dic, is_async, is_error, error_mes ); エラーは
 // sync ( main thead )
 void tTVPAsyncImageLoader::LoadRequest(iTJSDispatch2 *owner, tTJSNI_Bitmap *bmp,
-                                       const ttstr &name) {
+                                       const ttstr &name, tjs_int priority) {
     // tTVPBaseBitmap* dest = new tTVPBaseBitmap( 32, 32, 32 );
     tTVPBaseBitmap dest(TVPGetInitialBitmap());
     iTJSDispatch2 *metainfo = nullptr;
@@ -214,17 +254,9 @@ void tTVPAsyncImageLoader::LoadRequest(iTJSDispatch2 *owner, tTJSNI_Bitmap *bmp,
             bmp->CopyFrom(&dest);
             bmp->SetLoading(false);
         }
-        if(!owner)
-            return;
-        tTJSVariant param[4];
-        param[0] = tTJSVariant(metainfo, metainfo);
+        TVPPostImageLoadedEvent(owner, metainfo, false, TJS_W(""));
         if(metainfo)
             metainfo->Release();
-        param[1] = 0; // false
-        param[2] = 0; // false
-        param[3] = TJS_W(""); // error_mes
-        static ttstr eventname(TJS_W("onLoaded"));
-        TVPPostEvent(owner, owner, eventname, 0, TVP_EPT_IMMEDIATE, 4, param);
         return;
     }
     if(TVPIsExistentStorage(name) == false) {
@@ -236,61 +268,137 @@ void tTVPAsyncImageLoader::LoadRequest(iTJSDispatch2 *owner, tTJSNI_Bitmap *bmp,
                                  name);
     }
 
-    PushLoadQueue(owner, bmp, nname);
+    PushLoadQueue(owner, bmp, nname, priority);
 }
 
 // tTJSCriticalSectionHolder cs_holder(TVPCreateStreamCS);
 //	tTJSBinaryStream* stream = TVPCreateStream(nname, TJS_BS_READ);
 // TVPCreateStream はロックされているので、非同期で実行可能
 
+tTVPImageLoadCommand *tTVPAsyncImageLoader::FindCommand(const ttstr &nname) {
+    for(tTVPImageLoadCommand *cmd : RunningCommands) {
+        if(cmd->path_ == nname)
+            return cmd;
+    }
+    for(tTVPImageLoadCommand *cmd : CommandQueue) {
+        if(cmd->path_ == nname)
+            return cmd;
+    }
+    return nullptr;
+}
 void tTVPAsyncImageLoader::PushLoadQueue(iTJSDispatch2 *owner,
                                          tTJSNI_Bitmap *bmp,
-                                         const ttstr &nname) {
+                                         const ttstr &nname,
+                                         tjs_int priority) {
     tTVPImageLoadCommand *cmd = new tTVPImageLoadCommand();
     cmd->owner_ = owner;
     if(owner)
         owner->AddRef();
     cmd->bmp_ = bmp;
     cmd->path_ = nname;
-    cmd->dest_ = new tTVPTmpBitmapImage();
+    cmd->priority_ = priority;
     cmd->result_.Clear();
     {
         // キューをロックしてプッシュ
-        tTJSCriticalSectionHolder cs(CommandQueueCS);
-        CommandQueue.push(cmd);
+        std::lock_guard<std::mutex> lock(CommandQueueMutex);
+        tTVPImageLoadCommand *loading = FindCommand(nname);
+        if(loading) {
+            // 同じ画像を読込み中、その結果を共有する
+            loading->waiters_.push_back(cmd);
+            if(loading->priority_ < priority)
+                loading->priority_ = priority; // 読込み待ちなら繰り上げる
+            return;
+        }
+        cmd->dest_ = new tTVPTmpBitmapImage();
+        cmd->order_ = CommandOrder++;
+        CommandQueue.push_back(cmd);
     }
-    // 追加したことをイベントで通知
-    PushCommandQueueEvent.Set();
+    // 追加したことを通知
+    CommandQueueCond.notify_one();
 }
-void tTVPAsyncImageLoader::LoadingThread() {
-    while(!GetTerminated()) {
-        // キュー追加イベント待ち
-        PushCommandQueueEvent.WaitFor(0);
-        if(GetTerminated())
-            break;
-        bool loading;
-        do {
-            loading = false;
-            tTVPImageLoadCommand *cmd = nullptr;
-
-            { // Lock
-                tTJSCriticalSectionHolder cs(CommandQueueCS);
-                if(CommandQueue.size()) {
-                    cmd = CommandQueue.front();
-                    CommandQueue.pop();
+void tTVPAsyncImageLoader::CancelRequest(iTJSDispatch2 *owner) {
+    if(!owner)
+        return;
+    std::vector<tTVPImageLoadCommand *> cancelled;
+    {
+        std::lock_guard<std::mutex> lock(CommandQueueMutex);
+        auto detach = [&](tTVPImageLoadCommand *cmd) {
+            std::vector<tTVPImageLoadCommand *> &waiters = cmd->waiters_;
+            for(auto it = waiters.begin(); it != waiters.end();) {
+                if((*it)->owner_ == owner) {
+                    cancelled.push_back(*it);
+                    it = waiters.erase(it);
+                } else {
+                    ++it;
                 }
             }
-            if(cmd) {
-                loading = true;
-                LoadImageFromCommand(cmd);
-                { // Lock
-                    tTJSCriticalSectionHolder cs(ImageQueueCS);
-                    LoadedQueue.push(cmd);
-                }
-                // Send to message
-                SendToLoadFinish();
+            if(cmd->owner_ == owner) {
+                // 読込み自体は他の要求やキャッシュのために続ける
+                tTVPImageLoadCommand *req = new tTVPImageLoadCommand();
+                std::swap(req->owner_, cmd->owner_);
+                std::swap(req->bmp_, cmd->bmp_);
+                cancelled.push_back(req);
+            }
+        };
+        for(tTVPImageLoadCommand *cmd : RunningCommands)
+            detach(cmd);
+        for(auto it = CommandQueue.begin(); it != CommandQueue.end();) {
+            tTVPImageLoadCommand *cmd = *it;
+            detach(cmd);
+            if(!cmd->bmp_ && cmd->waiters_.empty()) {
+                // 誰も待っていない読込み待ちは捨てる
+                it = CommandQueue.erase(it);
+                delete cmd;
+            } else {
+                ++it;
             }
-        } while(loading && !GetTerminated());
+        }
+    }
+    for(tTVPImageLoadCommand *req : cancelled) {
+        req->bmp_->SetLoading(false);
+        delete req;
+    }
+}
+tTVPImageLoadCommand *tTVPAsyncImageLoader::TakeCommand() {
+    if(CommandQueue.empty())
+        return nullptr;
+    // 優先度が最も高いもの、同じ優先度なら最も古いものを読む
+    auto it = std::max_element(
+        CommandQueue.begin(), CommandQueue.end(),
+        [](const tTVPImageLoadCommand *a, const tTVPImageLoadCommand *b) {
+            if(a->priority_ != b->priority_)
+                return a->priority_ < b->priority_;
+            return a->order_ > b->order_;
+        });
+    tTVPImageLoadCommand *cmd = *it;
+    CommandQueue.erase(it);
+    RunningCommands.push_back(cmd);
+    return cmd;
+}
+tTVPImageLoadCommand *tTVPAsyncImageLoader::PopLoadQueue() {
+    std::lock_guard<std::mutex> lock(CommandQueueMutex);
+    return TakeCommand();
+}
+void tTVPAsyncImageLoader::LoadingThread() {
+    while(true) {
+        tTVPImageLoadCommand *cmd = nullptr;
+        { // Lock
+            std::unique_lock<std::mutex> lock(CommandQueueMutex);
+            // キュー追加待ち
+            CommandQueueCond.wait(lock, [this] {
+                return Terminated || !CommandQueue.empty();
+            });
+            if(Terminated)
+                break;
+            cmd = TakeCommand();
+        }
+        LoadImageFromCommand(cmd);
+        { // Lock
+            tTJSCriticalSectionHolder cs(ImageQueueCS);
+            LoadedQueue.push(cmd);
+        }
+        // Send to message
+        SendToLoadFinish();
     }
 }
 tTVPGraphicHandlerType *TVPGuessGraphicLoadHandler(ttstr &name);
@@ -2,7 +2,10 @@
 #ifndef __GRAPHICS_LOAD_THREAD_H__
 #define __GRAPHICS_LOAD_THREAD_H__
 
+#include <condition_variable>
+#include <mutex>
 #include <queue>
+#include <thread>
 #include <vector>
 #include "ThreadIntf.h"
 #include "NativeEventQueue.h"
@@ -24,26 +27,45 @@ struct tTVPImageLoadCommand {
     ttstr path_;
     tTVPTmpBitmapImage *dest_;
     ttstr result_;
+    /** 優先度、大きいものから先に読む */
+    tjs_int priority_;
+    /** 要求順、同じ優先度の中では先に要求されたものから読む */
+    tjs_uint64 order_;
+    /**
+     * 同じパスの読込み完了を待っている要求 (メインスレッドでのみ触る)
+     * これらは dest_ を持たず、このコマンドの読込み結果を共有する
+     */
+    std::vector<tTVPImageLoadCommand *> waiters_;
     tTVPImageLoadCommand();
     ~tTVPImageLoadCommand();
 };
 
-class tTVPAsyncImageLoader : public tTVPThread {
-    /** 読込み要求コマンドのキュー用CS */
-    tTJSCriticalSection CommandQueueCS;
+class tTVPAsyncImageLoader {
+    /** 読込み要求コマンドのキュー用 mutex */
+    std::mutex CommandQueueMutex;
+    /** 読込みスレッドへ読込み要求があったことを伝える */
+    std::condition_variable CommandQueueCond;
     /** 読込み済み画像キュー用CS */
     tTJSCriticalSection ImageQueueCS;
 
     /** ロード完了後メインスレッドで処理するためのメッセージキュー */
     NativeEventQueue<tTVPAsyncImageLoader> EventQueue;
-    /**  読込みスレッドへ読込み要求があったことを伝えるイベント */
-    tTVPThreadEvent PushCommandQueueEvent;
 
-    /** 読込み要求コマンドキュー */
-    std::queue<tTVPImageLoadCommand *> CommandQueue;
+    /** 読込み要求コマンドキュー (優先度順に取り出す) */
+    std::vector<tTVPImageLoadCommand *> CommandQueue;
+    /**
+     * 読込み中または読込み完了後メインスレッドでの処理待ちのコマンド
+     * 同じパスの重複読込みを避けるために使う
+     */
+    std::vector<tTVPImageLoadCommand *> RunningCommands;
     /** 読込み完了画像キュー */
     std::queue<tTVPImageLoadCommand *> LoadedQueue;
 
+    /** 読込みスレッド */
+    std::vector<std::thread> Workers;
+    tjs_uint64 CommandOrder;
+    bool Terminated;
+
 private:
     /**
      * 読込みスレッドからメインスレッドへ読込みが完了したことを通知する
@@ -54,16 +76,35 @@ private:
      */
     void HandleLoadedImage();
 
+    /**
+     * 同じパスの読込み中、または読込み待ちのコマンドを探す
+     * CommandQueueMutex をロックして呼ぶこと
+     */
+    tTVPImageLoadCommand *FindCommand(const ttstr &nname);
+
+    /**
+     * 優先度の最も高いコマンド、同じ優先度なら最も古いものを読込み中へ移して返す
+     * CommandQueueMutex をロックして呼ぶこと。キューが空なら nullptr
+     */
+    tTVPImageLoadCommand *TakeCommand();
+
 public:
     /**
      * 読込みを読込みスレッドに要求する(キューへ入れる)
+     * 同じパスが既に読込み中か読込み待ちの場合は、その結果を共有する
      */
     void PushLoadQueue(iTJSDispatch2 *owner, tTJSNI_Bitmap *bmp,
-                       const ttstr &nname);
+                       const ttstr &nname, tjs_int priority = 0);
+
+    /**
+     * 読込みスレッドが次に読むコマンドを取り出す (読込みは行わない)
+     * 取り出したコマンドは読込み中として扱われ、同じパスの要求はこれを待つ
+     */
+    tTVPImageLoadCommand *PopLoadQueue();
 
     /**
      * 読込みスレッド実体
-     * キューにコマンドが入るのを待ち、イベントが来たらキューからコマンドを取り出して読込み処理を実行
+     * キューにコマンドが入るのを待ち、優先度の最も高いコマンドを取り出して読込み処理を実行
      * 読込みが完了したら読込み済み画像キューに入れてメインスレッドへ完了を通知する
      */
     void LoadingThread();
@@ -73,11 +114,6 @@ public:
      */
     void LoadImageFromCommand(tTVPImageLoadCommand *cmd);
 
-    /**
-     * 読込みスレッドメイン
-     */
-    void Execute();
-
     /**
      * メインスレッドハンドラ
      * メインスレッドへのイベント(メッセージ)通知を受ける
@@ -88,6 +124,13 @@ public:
     tTVPAsyncImageLoader();
     ~tTVPAsyncImageLoader();
 
+    /**
+     * 読込みスレッドを開始する
+     * スレッド数は -imgloadthread オプションで指定 (auto
+     * の場合はプロセッサ数から決める)
+     */
+    void Start();
+
     /**
      読込みスレッドの終了を要求する(終了は待たない)
      */
@@ -100,7 +143,14 @@ public:
      * 即座に終了し、onLoaded イベントを発生させる。
      */
     void LoadRequest(iTJSDispatch2 *owner, tTJSNI_Bitmap *bmp,
-                     const ttstr &name);
+                     const ttstr &name, tjs_int priority = 0);
+
+    /**
+     * owner の読込み要求を取り消す
+     * 取り消した Bitmap は読込み中状態が解除され、onLoaded
+     * イベントは発生しない。既に読込み中の画像は読込み完了後キャッシュにだけ入る。
+     */
+    void CancelRequest(iTJSDispatch2 *owner);
 };
 
 #endif // __GRAPHICS_LOAD_THREAD_H__
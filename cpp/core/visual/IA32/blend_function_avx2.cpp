@@ -0,0 +1,26 @@
+/*
+
+        TVP2 ( T Visual Presenter 2 )  A script authoring tool
+        Copyright (C) 2000-2009 W.Dee <dee@kikyou.info> and
+   contributors
+
+        See details of license at "license.txt"
+
+
+*/
+/******************************************************************************/
+/**
+ * AVX2 版ブレンド関数
+ * このファイルのみ -mavx2 (/arch:AVX2) でコンパイルする
+ * 呼び出しは TVPCPUType に TVP_CPU_HAS_AVX2 がある場合に限ること
+ *****************************************************************************/
+
+#include "tvpgl_ia32_intf.h"
+#include "blend_functor_simd.h"
+
+#if defined(__AVX2__)
+void TVPGL_AVX2_Init() { TVPGL_SIMD_Setup<tTVPSimdAVX2>(); }
+#else
+// AVX2 でコンパイルされていない場合は SSE2 版のままにする
+void TVPGL_AVX2_Init() {}
+#endif
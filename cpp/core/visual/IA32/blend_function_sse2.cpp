@@ -0,0 +1,20 @@
+/*
+
+        TVP2 ( T Visual Presenter 2 )  A script authoring tool
+        Copyright (C) 2000-2009 W.Dee <dee@kikyou.info> and
+   contributors
+
+        See details of license at "license.txt"
+
+
+*/
+/******************************************************************************/
+/**
+ * SSE2 版ブレンド関数
+ * x64 では SSE2 は常に使用可能なので、追加のコンパイルオプションは不要
+ *****************************************************************************/
+
+#include "tvpgl_ia32_intf.h"
+#include "blend_functor_simd.h"
+
+void TVPGL_SSE2_Init() { TVPGL_SIMD_Setup<tTVPSimdSSE2>(); }
@@ -0,0 +1,953 @@
+/*
+
+        TVP2 ( T Visual Presenter 2 )  A script authoring tool
+        Copyright (C) 2000-2009 W.Dee <dee@kikyou.info> and
+   contributors
+
+        See details of license at "license.txt"
+
+
+*/
+/******************************************************************************/
+/**
+ * SSE2/AVX2 で共通のブレンドファンクタ
+ *
+ * 各ファンクタは blend_functor_c.h の同名のファンクタとビット単位で
+ * 同じ結果を返す。ベクタ幅に満たない端数と、SIMD
+ * で扱えない不透明度は C 版のファンクタで処理する。
+ *
+ * T は simd_def_x86x64.h の tTVPSimdSSE2 / tTVPSimdAVX2
+ * 翻訳単位ごとに異なる命令セットでコンパイルされるため、すべて内部リンケージ
+ *****************************************************************************/
+
+#ifndef __BLEND_FUNCTOR_SIMD_H__
+#define __BLEND_FUNCTOR_SIMD_H__
+
+#include "tjsTypes.h"
+#include "tvpgl.h"
+#include "simd_def_x86x64.h"
+
+extern "C" {
+extern unsigned char TVPOpacityOnOpacityTable[256 * 256];
+extern unsigned char TVPNegativeMulTable[256 * 256];
+extern unsigned char TVPOpacityOnOpacityTable65[65 * 256];
+extern unsigned char TVPNegativeMulTable65[65 * 256];
+extern tjs_uint32 TVPRecipTable256[256];
+}
+
+// C 版のファンクタはインライン関数の実体が SSE2/AVX2 の翻訳単位で
+// 共有されないように、内部リンケージで取り込む
+namespace {
+#include "blend_functor_c.h"
+} // namespace
+
+namespace {
+
+    //--------------------------------------------------------------------------
+    // 共通処理
+    //--------------------------------------------------------------------------
+    template <class T>
+    struct simd_util {
+        typedef typename T::V V;
+
+        /** 16bit に展開したピクセルのアルファをピクセル内に複製 */
+        static inline V alpha_lo(V s) {
+            return T::template bcast16<3>(T::lo8(s));
+        }
+        static inline V alpha_hi(V s) {
+            return T::template bcast16<3>(T::hi8(s));
+        }
+
+        /**
+         * d + ((s - d) * a >> 8) を各チャンネルで計算する (a <= 256)
+         * d*(256-a) + s*a は 0..65280 に収まるので、16bit
+         * でラップした積に d<<8 を足してから論理シフトしても C
+         * 版の算術シフトと一致する
+         */
+        static inline V lerp(V d, V s, V alo, V ahi) {
+            V dl = T::lo8(d);
+            V dh = T::hi8(d);
+            V rl = T::add16(T::mullo16(T::sub16(T::lo8(s), dl), alo),
+                            T::template slli16<8>(dl));
+            V rh = T::add16(T::mullo16(T::sub16(T::hi8(s), dh), ahi),
+                            T::template slli16<8>(dh));
+            return T::pack16(T::template srli16<8>(rl),
+                             T::template srli16<8>(rh));
+        }
+
+        /** (c * a) >> 8 を各チャンネルで計算する (a <= 256) */
+        static inline V mul(V c, V alo, V ahi) {
+            return T::pack16(T::template srli16<8>(T::mullo16(T::lo8(c), alo)),
+                             T::template srli16<8>(T::mullo16(T::hi8(c), ahi)));
+        }
+        static inline V mul(V c, V a) { return mul(c, a, a); }
+
+        /** (a * b) >> 8 をピクセル同士の各チャンネルで計算する */
+        static inline V mulpix(V a, V b) {
+            return T::pack16(
+                T::template srli16<8>(T::mullo16(T::lo8(a), T::lo8(b))),
+                T::template srli16<8>(T::mullo16(T::hi8(a), T::hi8(b))));
+        }
+
+        /** ソースアルファに不透明度をかけたもの ((sa * opa) >> 8) */
+        static inline V alpha_opa_lo(V s, V opa) {
+            return T::template srli16<8>(T::mullo16(alpha_lo(s), opa));
+        }
+        static inline V alpha_opa_hi(V s, V opa) {
+            return T::template srli16<8>(T::mullo16(alpha_hi(s), opa));
+        }
+
+        /** 32bit レーンの下位バイトをピクセル内に複製 */
+        static inline V bcast_lane_lo(V v) {
+            return T::template bcast16<0>(T::lo8(v));
+        }
+        static inline V bcast_lane_hi(V v) {
+            return T::template bcast16<0>(T::hi8(v));
+        }
+    };
+
+    /** ファンクタが共通で使う定数 */
+    template <class T>
+    struct simd_masks {
+        typedef typename T::V V;
+        const V rgb_;
+        const V alpha_;
+        const V ones_;
+        inline simd_masks() :
+            rgb_(T::set1_32(0x00ffffff)), alpha_(T::set1_32(0xff000000)),
+            ones_(T::set1_32(0xffffffff)) {}
+        inline V keep_dest_alpha(V r, V d) const {
+            return T::or_(T::and_(r, rgb_), T::and_(d, alpha_));
+        }
+        inline V not_(V v) const { return T::xor_(v, ones_); }
+    };
+
+    /** 不透明度を保持するファンクタの基底 */
+    template <class T>
+    struct simd_opa_base : simd_masks<T> {
+        typedef typename T::V V;
+        const V opa_;
+        inline simd_opa_base(tjs_int opa) : opa_(T::set1_16(opa)) {}
+    };
+
+    //--------------------------------------------------------------------------
+    // アルファブレンド
+    //--------------------------------------------------------------------------
+    template <class T, bool HDA>
+    struct simd_alpha_blend_functor : simd_masks<T> {
+        typedef typename T::V V;
+        typedef simd_util<T> U;
+        inline simd_alpha_blend_functor(tjs_int opa = 255) {}
+        inline V operator()(V d, V s) const {
+            V r = U::lerp(d, s, U::alpha_lo(s), U::alpha_hi(s));
+            return HDA ? this->keep_dest_alpha(r, d) : T::and_(r, this->rgb_);
+        }
+    };
+    template <class T, bool HDA>
+    struct simd_alpha_blend_o_functor : simd_opa_base<T> {
+        typedef typename T::V V;
+        typedef simd_util<T> U;
+        inline simd_alpha_blend_o_functor(tjs_int opa) :
+            simd_opa_base<T>(opa) {}
+        inline V operator()(V d, V s) const {
+            V r = U::lerp(d, s, U::alpha_opa_lo(s, this->opa_),
+                          U::alpha_opa_hi(s, this->opa_));
+            return HDA ? this->keep_dest_alpha(r, d) : T::and_(r, this->rgb_);
+        }
+    };
+
+    /**
+     * dest_alpha_op 相当
+     * テーブル参照はスカラで行い、色の合成のみ SIMD で行う
+     * TAddr は (d, s) からテーブルのアドレスを求める
+     */
+    template <class T, class TAddr>
+    struct simd_dest_alpha_functor : simd_masks<T> {
+        typedef typename T::V V;
+        typedef simd_util<T> U;
+        TAddr addr_;
+        inline simd_dest_alpha_functor(tjs_int opa = 255) : addr_(opa) {}
+        inline V operator()(V d, V s) const {
+            tjs_uint32 dp[T::N], sp[T::N], sopa[T::N], dalpha[T::N];
+            T::store(dp, d);
+            T::store(sp, s);
+            for(int i = 0; i < T::N; i++) {
+                tjs_uint32 addr = addr_(dp[i], sp[i]);
+                sopa[i] = TVPOpacityOnOpacityTable[addr];
+                dalpha[i] = TVPNegativeMulTable[addr] << 24;
+            }
+            V a = T::set_32(sopa);
+            V r = U::lerp(d, s, U::bcast_lane_lo(a), U::bcast_lane_hi(a));
+            return T::or_(T::and_(r, this->rgb_), T::set_32(dalpha));
+        }
+    };
+    struct simd_addr_d {
+        inline simd_addr_d(tjs_int) {}
+        inline tjs_uint32 operator()(tjs_uint32 d, tjs_uint32 s) const {
+            return ((s >> 16) & 0xff00) + (d >> 24);
+        }
+    };
+    struct simd_addr_do {
+        const tjs_int opa_;
+        inline simd_addr_do(tjs_int opa) : opa_(opa) {}
+        inline tjs_uint32 operator()(tjs_uint32 d, tjs_uint32 s) const {
+            return (((s >> 24) * opa_) & 0xff00) + (d >> 24);
+        }
+    };
+    struct simd_addr_const_d {
+        const tjs_uint32 opa_;
+        inline simd_addr_const_d(tjs_int opa) : opa_(opa << 8) {}
+        inline tjs_uint32 operator()(tjs_uint32 d, tjs_uint32 s) const {
+            return opa_ + (d >> 24);
+        }
+    };
+
+    //--------------------------------------------------------------------------
+    // pre-multiplied alpha
+    //--------------------------------------------------------------------------
+    /** premulalpha_blend_n_a_func 相当 */
+    template <class T>
+    struct simd_premulalpha_n_a : simd_masks<T> {
+        typedef typename T::V V;
+        typedef simd_util<T> U;
+        const V c255_;
+        inline simd_premulalpha_n_a() : c255_(T::set1_16(255)) {}
+        inline V blend(V d, V s) const {
+            V r = U::mul(d, T::sub16(c255_, U::alpha_lo(s)),
+                         T::sub16(c255_, U::alpha_hi(s)));
+            return T::adds8(T::and_(r, this->rgb_), s);
+        }
+    };
+    /** premulalpha_blend_a_a_func 相当 */
+    template <class T>
+    struct simd_premulalpha_a_a : simd_premulalpha_n_a<T> {
+        typedef typename T::V V;
+        typedef simd_util<T> U;
+        inline V blend(V d, V s) const {
+            V sal = U::alpha_lo(s);
+            V sah = U::alpha_hi(s);
+            // da = da + sa - (da * sa >> 8); da -= da >> 8;
+            V dl = T::lo8(d);
+            V dh = T::hi8(d);
+            V tl = T::sub16(T::add16(dl, sal),
+                            T::template srli16<8>(T::mullo16(dl, sal)));
+            V th = T::sub16(T::add16(dh, sah),
+                            T::template srli16<8>(T::mullo16(dh, sah)));
+            tl = T::sub16(tl, T::template srli16<8>(tl));
+            th = T::sub16(th, T::template srli16<8>(th));
+            V da = T::and_(T::pack16(tl, th), this->alpha_);
+            V r = U::mul(d, T::sub16(this->c255_, sal),
+                         T::sub16(this->c255_, sah));
+            return T::or_(da, T::adds8(T::and_(r, this->rgb_),
+                                       T::and_(s, this->rgb_)));
+        }
+    };
+
+    template <class T, bool HDA>
+    struct simd_premulalpha_blend_functor : simd_premulalpha_n_a<T> {
+        typedef typename T::V V;
+        inline simd_premulalpha_blend_functor(tjs_int opa = 255) {}
+        inline V operator()(V d, V s) const {
+            V r = this->blend(d, s);
+            return HDA ? this->keep_dest_alpha(r, d) : r;
+        }
+    };
+    template <class T, bool HDA>
+    struct simd_premulalpha_blend_o_functor : simd_premulalpha_n_a<T> {
+        typedef typename T::V V;
+        typedef simd_util<T> U;
+        const V opa_;
+        inline simd_premulalpha_blend_o_functor(tjs_int opa) :
+            opa_(T::set1_16(opa)) {}
+        inline V operator()(V d, V s) const {
+            V r = this->blend(d, U::mul(s, opa_));
+            return HDA ? this->keep_dest_alpha(r, d) : r;
+        }
+    };
+    template <class T>
+    struct simd_premulalpha_blend_a_functor : simd_premulalpha_a_a<T> {
+        typedef typename T::V V;
+        inline simd_premulalpha_blend_a_functor(tjs_int opa = 255) {}
+        inline V operator()(V d, V s) const { return this->blend(d, s); }
+    };
+    template <class T>
+    struct simd_premulalpha_blend_ao_functor : simd_premulalpha_a_a<T> {
+        typedef typename T::V V;
+        typedef simd_util<T> U;
+        const V opa_;
+        inline simd_premulalpha_blend_ao_functor(tjs_int opa) :
+            opa_(T::set1_16(opa)) {}
+        inline V operator()(V d, V s) const {
+            return this->blend(d, U::mul(s, opa_));
+        }
+    };
+
+    /** alpha_blend_a_functor : 通常アルファを pre-multiplied に変換して合成 */
+    template <class T>
+    struct simd_alpha_blend_a_functor : simd_premulalpha_a_a<T> {
+        typedef typename T::V V;
+        typedef simd_util<T> U;
+        inline simd_alpha_blend_a_functor(tjs_int opa = 255) {}
+        inline V operator()(V d, V s) const {
+            V ps = U::mul(s, U::alpha_lo(s), U::alpha_hi(s));
+            ps = T::or_(T::and_(ps, this->rgb_), T::and_(s, this->alpha_));
+            return this->blend(d, ps);
+        }
+    };
+    /** alpha_blend_ao_functor */
+    template <class T>
+    struct simd_alpha_blend_ao_functor : simd_premulalpha_a_a<T> {
+        typedef typename T::V V;
+        typedef simd_util<T> U;
+        const V opa_;
+        inline simd_alpha_blend_ao_functor(tjs_int opa) :
+            opa_(T::set1_16(opa)) {}
+        inline V operator()(V d, V s) const {
+            V al = U::alpha_opa_lo(s, opa_);
+            V ah = U::alpha_opa_hi(s, opa_);
+            V ps = U::mul(s, al, ah);
+            // 新しいアルファは al/ah のどのワードにも入っている
+            V na = T::and_(T::pack16(al, ah), this->alpha_);
+            return this->blend(d, T::or_(T::and_(ps, this->rgb_), na));
+        }
+    };
+
+    //--------------------------------------------------------------------------
+    // 一定不透明度での合成
+    //--------------------------------------------------------------------------
+    template <class T, bool HDA>
+    struct simd_const_alpha_blend_functor : simd_opa_base<T> {
+        typedef typename T::V V;
+        typedef simd_util<T> U;
+        inline simd_const_alpha_blend_functor(tjs_int opa) :
+            simd_opa_base<T>(opa) {}
+        inline V operator()(V d, V s) const {
+            V r = U::lerp(d, s, this->opa_, this->opa_);
+            return HDA ? this->keep_dest_alpha(r, d) : T::and_(r, this->rgb_);
+        }
+    };
+    template <class T>
+    struct simd_const_alpha_blend_a_functor : simd_premulalpha_a_a<T> {
+        typedef typename T::V V;
+        const V opa_;
+        inline simd_const_alpha_blend_a_functor(tjs_int opa) :
+            opa_(T::set1_32((tjs_uint32)opa << 24)) {}
+        inline V operator()(V d, V s) const {
+            return this->blend(d, T::or_(T::and_(s, this->rgb_), opa_));
+        }
+    };
+
+    //--------------------------------------------------------------------------
+    // コピーと塗りつぶし
+    //--------------------------------------------------------------------------
+    template <class T>
+    struct simd_color_copy_functor : simd_masks<T> {
+        typedef typename T::V V;
+        inline V operator()(V d, V s) const {
+            return this->keep_dest_alpha(s, d);
+        }
+    };
+    template <class T>
+    struct simd_alpha_copy_functor : simd_masks<T> {
+        typedef typename T::V V;
+        inline V operator()(V d, V s) const {
+            return this->keep_dest_alpha(d, s);
+        }
+    };
+    template <class T>
+    struct simd_color_opaque_functor : simd_masks<T> {
+        typedef typename T::V V;
+        inline V operator()(V d, V s) const { return T::or_(s, this->alpha_); }
+    };
+    template <class T>
+    struct simd_fill_argb_functor {
+        typedef typename T::V V;
+        const V color_;
+        inline simd_fill_argb_functor(tjs_uint32 c) : color_(T::set1_32(c)) {}
+        inline V operator()(V d) const { return color_; }
+    };
+    template <class T>
+    struct simd_const_color_copy_functor : simd_masks<T> {
+        typedef typename T::V V;
+        const V color_;
+        inline simd_const_color_copy_functor(tjs_uint32 c) :
+            color_(T::set1_32(c & 0xffffff)) {}
+        inline V operator()(V d) const {
+            return T::or_(T::and_(d, this->alpha_), color_);
+        }
+    };
+    template <class T>
+    struct simd_const_alpha_copy_functor : simd_masks<T> {
+        typedef typename T::V V;
+        const V alpha_value_;
+        inline simd_const_alpha_copy_functor(tjs_uint32 a) :
+            alpha_value_(T::set1_32(a << 24)) {}
+        inline V operator()(V d) const {
+            return T::or_(T::and_(d, this->rgb_), alpha_value_);
+        }
+    };
+
+    //--------------------------------------------------------------------------
+    // 加算/減算/乗算/比較/スクリーン合成
+    //--------------------------------------------------------------------------
+    template <class T, bool HDA>
+    struct simd_add_blend_functor : simd_masks<T> {
+        typedef typename T::V V;
+        inline simd_add_blend_functor(tjs_int opa = 255) {}
+        inline V operator()(V d, V s) const {
+            V r = T::adds8(d, s);
+            return HDA ? this->keep_dest_alpha(r, d) : r;
+        }
+    };
+    template <class T, bool HDA>
+    struct simd_add_blend_o_functor : simd_opa_base<T> {
+        typedef typename T::V V;
+        typedef simd_util<T> U;
+        inline simd_add_blend_o_functor(tjs_int opa) : simd_opa_base<T>(opa) {}
+        inline V operator()(V d, V s) const {
+            V r = T::adds8(d, T::and_(U::mul(s, this->opa_), this->rgb_));
+            return HDA ? this->keep_dest_alpha(r, d) : r;
+        }
+    };
+
+    template <class T, bool HDA>
+    struct simd_sub_blend_functor : simd_masks<T> {
+        typedef typename T::V V;
+        inline simd_sub_blend_functor(tjs_int opa = 255) {}
+        inline V operator()(V d, V s) const {
+            V r = T::subs8(d, this->not_(s));
+            return HDA ? this->keep_dest_alpha(r, d) : r;
+        }
+    };
+    template <class T, bool HDA>
+    struct simd_sub_blend_o_functor : simd_opa_base<T> {
+        typedef typename T::V V;
+        typedef simd_util<T> U;
+        inline simd_sub_blend_o_functor(tjs_int opa) : simd_opa_base<T>(opa) {}
+        inline V operator()(V d, V s) const {
+            V r = T::subs8(
+                d, T::and_(U::mul(this->not_(s), this->opa_), this->rgb_));
+            return HDA ? this->keep_dest_alpha(r, d) : r;
+        }
+    };
+
+    template <class T, bool HDA>
+    struct simd_mul_blend_functor : simd_masks<T> {
+        typedef typename T::V V;
+        typedef simd_util<T> U;
+        inline simd_mul_blend_functor(tjs_int opa = 255) {}
+        inline V operator()(V d, V s) const {
+            V r = U::mulpix(d, s);
+            return HDA ? this->keep_dest_alpha(r, d) : T::and_(r, this->rgb_);
+        }
+    };
+    template <class T, bool HDA>
+    struct simd_mul_blend_o_functor : simd_opa_base<T> {
+        typedef typename T::V V;
+        typedef simd_util<T> U;
+        inline simd_mul_blend_o_functor(tjs_int opa) : simd_opa_base<T>(opa) {}
+        inline V operator()(V d, V s) const {
+            s = this->not_(
+                T::and_(U::mul(this->not_(s), this->opa_), this->rgb_));
+            V r = U::mulpix(d, s);
+            return HDA ? this->keep_dest_alpha(r, d) : T::and_(r, this->rgb_);
+        }
+    };
+
+    /** darken/lighten の共通部 : LIGHTEN で max, それ以外で min */
+    template <class T, bool LIGHTEN>
+    struct simd_minmax {
+        typedef typename T::V V;
+        static inline V op(V d, V s) {
+            return LIGHTEN ? T::max8(d, s) : T::min8(d, s);
+        }
+    };
+    template <class T, bool LIGHTEN, bool HDA>
+    struct simd_minmax_blend_functor : simd_masks<T> {
+        typedef typename T::V V;
+        inline simd_minmax_blend_functor(tjs_int opa = 255) {}
+        inline V operator()(V d, V s) const {
+            V r = simd_minmax<T, LIGHTEN>::op(d, s);
+            return HDA ? this->keep_dest_alpha(r, d) : r;
+        }
+    };
+    template <class T, bool LIGHTEN, bool HDA>
+    struct simd_minmax_blend_o_functor : simd_opa_base<T> {
+        typedef typename T::V V;
+        typedef simd_util<T> U;
+        inline simd_minmax_blend_o_functor(tjs_int opa) :
+            simd_opa_base<T>(opa) {}
+        inline V operator()(V d, V s) const {
+            V r = U::lerp(d, simd_minmax<T, LIGHTEN>::op(d, s), this->opa_,
+                          this->opa_);
+            return HDA ? this->keep_dest_alpha(r, d) : T::and_(r, this->rgb_);
+        }
+    };
+
+    template <class T, bool HDA>
+    struct simd_screen_blend_functor : simd_masks<T> {
+        typedef typename T::V V;
+        typedef simd_util<T> U;
+        inline simd_screen_blend_functor(tjs_int opa = 255) {}
+        inline V operator()(V d, V s) const {
+            V r = this->not_(T::and_(
+                U::mulpix(this->not_(d), this->not_(s)), this->rgb_));
+            return HDA ? this->keep_dest_alpha(r, d) : r;
+        }
+    };
+    /**
+     * screen_blend_o_functor / screen_blend_HDA_o_functor
+     * C 版の screen_blend_func は最後の反転を行わないので、それに合わせる
+     */
+    template <class T, bool HDA>
+    struct simd_screen_blend_o_functor : simd_opa_base<T> {
+        typedef typename T::V V;
+        typedef simd_util<T> U;
+        inline simd_screen_blend_o_functor(tjs_int opa) :
+            simd_opa_base<T>(opa) {}
+        inline V operator()(V d, V s) const {
+            s = this->not_(T::and_(U::mul(s, this->opa_), this->rgb_));
+            V r = T::and_(U::mulpix(this->not_(d), s), this->rgb_);
+            return HDA ? this->keep_dest_alpha(this->not_(r), d) : r;
+        }
+    };
+
+    //--------------------------------------------------------------------------
+    // Photoshop 互換合成
+    //--------------------------------------------------------------------------
+    /**
+     * ps_alpha_blend_func 相当の最後の合成
+     * C 版は R と B をまとめて 32bit で計算するが、結果は各チャンネルの
+     * (d + ((t * a) >> 8)) & 0xff と一致する (t は合成色と d の差)。
+     * t が負や 255 を超えても 16bit でラップした積に d<<8
+     * を足して論理シフトすれば同じ値になる。アルファは 0 になる
+     *
+     * TOp は d, s と 16bit に展開した d から t を求める
+     */
+    template <class T, class TOp, bool HDA, bool O>
+    struct simd_ps_blend_functor : simd_opa_base<T> {
+        typedef typename T::V V;
+        typedef simd_util<T> U;
+        TOp op_;
+        inline simd_ps_blend_functor(tjs_int opa = 255) :
+            simd_opa_base<T>(opa) {}
+        inline V operator()(V d, V s) const {
+            V al = O ? U::alpha_opa_lo(s, this->opa_) : U::alpha_lo(s);
+            V ah = O ? U::alpha_opa_hi(s, this->opa_) : U::alpha_hi(s);
+            V dl = T::lo8(d);
+            V dh = T::hi8(d);
+            V tl, th;
+            op_(d, s, dl, dh, tl, th);
+            V rl = T::add16(T::mullo16(tl, al), T::template slli16<8>(dl));
+            V rh = T::add16(T::mullo16(th, ah), T::template slli16<8>(dh));
+            V r = T::pack16(T::template srli16<8>(rl),
+                            T::template srli16<8>(rh));
+            return HDA ? this->keep_dest_alpha(r, d) : T::and_(r, this->rgb_);
+        }
+    };
+
+    /** 合成色をバイト単位で求めるもの : t = c - d */
+    template <class T, class TColor>
+    struct simd_ps_color_op {
+        typedef typename T::V V;
+        TColor color_;
+        inline void operator()(V d, V s, V dl, V dh, V &tl, V &th) const {
+            V c = color_(d, s);
+            tl = T::sub16(T::lo8(c), dl);
+            th = T::sub16(T::hi8(c), dh);
+        }
+    };
+    template <class T>
+    struct simd_ps_alpha_color {
+        typedef typename T::V V;
+        inline V operator()(V d, V s) const { return s; }
+    };
+    /** 覆い焼き(リニア) : min(d + s, 255) */
+    template <class T>
+    struct simd_ps_add_color {
+        typedef typename T::V V;
+        inline V operator()(V d, V s) const { return T::adds8(d, s); }
+    };
+    /** 焼き込み(リニア) : max(d + s - 255, 0) */
+    template <class T>
+    struct simd_ps_sub_color : simd_masks<T> {
+        typedef typename T::V V;
+        inline V operator()(V d, V s) const {
+            return T::subs8(d, this->not_(s));
+        }
+    };
+    template <class T>
+    struct simd_ps_mul_color {
+        typedef typename T::V V;
+        inline V operator()(V d, V s) const {
+            return simd_util<T>::mulpix(d, s);
+        }
+    };
+    template <class T, bool LIGHTEN>
+    struct simd_ps_minmax_color {
+        typedef typename T::V V;
+        inline V operator()(V d, V s) const {
+            return simd_minmax<T, LIGHTEN>::op(d, s);
+        }
+    };
+    /** 差の絶対値 */
+    template <class T>
+    struct simd_ps_diff_color {
+        typedef typename T::V V;
+        inline V operator()(V d, V s) const {
+            return T::or_(T::subs8(s, d), T::subs8(d, s));
+        }
+    };
+
+    /**
+     * スクリーン (SHIFT = 8) : t = s - (s * d >> 8)
+     * 除外 (SHIFT = 7) : t = s - (s * d >> 7)
+     */
+    template <class T, int SHIFT>
+    struct simd_ps_screen_op {
+        typedef typename T::V V;
+        inline void operator()(V d, V s, V dl, V dh, V &tl, V &th) const {
+            V sl = T::lo8(s);
+            V sh = T::hi8(s);
+            tl = T::sub16(sl, T::template srli16<SHIFT>(T::mullo16(sl, dl)));
+            th = T::sub16(sh, T::template srli16<SHIFT>(T::mullo16(sh, dh)));
+        }
+    };
+
+    //--------------------------------------------------------------------------
+    // ループ
+    //--------------------------------------------------------------------------
+    template <class T, typename vfunctor, typename cfunctor>
+    static inline void simd_blend_func(tjs_uint32 *__restrict dest,
+                                       const tjs_uint32 *__restrict src,
+                                       tjs_int len, const vfunctor &vfunc,
+                                       const cfunctor &cfunc) {
+        tjs_int i = 0;
+        for(; i + T::N <= len; i += T::N) {
+            T::store(dest + i, vfunc(T::load(dest + i), T::load(src + i)));
+        }
+        for(; i < len; i++) {
+            dest[i] = cfunc(dest[i], src[i]);
+        }
+    }
+    // dest = src1 * src2 となっているもの
+    template <class T, typename vfunctor, typename cfunctor>
+    static inline void simd_sd_blend_func(tjs_uint32 *__restrict dest,
+                                          const tjs_uint32 *__restrict src1,
+                                          const tjs_uint32 *__restrict src2,
+                                          tjs_int len, const vfunctor &vfunc,
+                                          const cfunctor &cfunc) {
+        tjs_int i = 0;
+        for(; i + T::N <= len; i += T::N) {
+            T::store(dest + i, vfunc(T::load(src1 + i), T::load(src2 + i)));
+        }
+        for(; i < len; i++) {
+            dest[i] = cfunc(src1[i], src2[i]);
+        }
+    }
+    // src と dest が重複している可能性のあるもの
+    template <class T, typename vfunctor, typename cfunctor>
+    static inline void simd_overlap_blend_func(tjs_uint32 *dest,
+                                               const tjs_uint32 *src,
+                                               tjs_int len,
+                                               const vfunctor &vfunc,
+                                               const cfunctor &cfunc) {
+        if(dest > src && dest < src + len) {
+            // backward : C 版と同じく後ろから 1 ピクセルずつ
+            for(tjs_int i = len - 1; i >= 0; i--)
+                dest[i] = cfunc(dest[i], src[i]);
+            return;
+        }
+        // forward : ベクタ単位で読み終えてから書くので前方コピーと同じ結果になる
+        tjs_int i = 0;
+        for(; i + T::N <= len; i += T::N) {
+            T::store(dest + i, vfunc(T::load(dest + i), T::load(src + i)));
+        }
+        for(; i < len; i++) {
+            dest[i] = cfunc(dest[i], src[i]);
+        }
+    }
+    template <class T, typename vfunctor, typename cfunctor>
+    static inline void simd_const_color_func(tjs_uint32 *dest, tjs_int len,
+                                             const vfunctor &vfunc,
+                                             const cfunctor &cfunc) {
+        tjs_int i = 0;
+        for(; i + T::N <= len; i += T::N) {
+            T::store(dest + i, vfunc(T::load(dest + i)));
+        }
+        for(; i < len; i++) {
+            dest[i] = cfunc(dest[i]);
+        }
+    }
+
+    /** SIMD の積が 16bit に収まる不透明度か */
+    static inline bool simd_opa_in_range(tjs_int opa) {
+        return opa >= 0 && opa <= 255;
+    }
+
+    //--------------------------------------------------------------------------
+    // 関数定義
+    //--------------------------------------------------------------------------
+    // 不透明度を取らないもの
+#define DEFINE_SIMD_BLEND_FUNCTION(NAME, CFUNCTOR, ...)                        \
+    template <class T>                                                         \
+    void TVP_##NAME##_simd(tjs_uint32 *dest, const tjs_uint32 *src,            \
+                           tjs_int len) {                                      \
+        __VA_ARGS__ vfunc;                                                     \
+        CFUNCTOR cfunc;                                                        \
+        simd_blend_func<T>(dest, src, len, vfunc, cfunc);                      \
+    }
+    // 不透明度を取るもの : 範囲外の値は C 版で処理する
+#define DEFINE_SIMD_BLEND_O_FUNCTION(NAME, CFUNCTOR, ...)                      \
+    template <class T>                                                         \
+    void TVP_##NAME##_simd(tjs_uint32 *dest, const tjs_uint32 *src,            \
+                           tjs_int len, tjs_int opa) {                         \
+        CFUNCTOR cfunc(opa);                                                   \
+        if(!simd_opa_in_range(opa)) {                                          \
+            for(tjs_int i = 0; i < len; i++)                                   \
+                dest[i] = cfunc(dest[i], src[i]);                              \
+            return;                                                            \
+        }                                                                      \
+        __VA_ARGS__ vfunc(opa);                                                \
+        simd_blend_func<T>(dest, src, len, vfunc, cfunc);                      \
+    }
+
+    DEFINE_SIMD_BLEND_FUNCTION(alpha_blend, alpha_blend_functor,
+                               simd_alpha_blend_functor<T, false>)
+    DEFINE_SIMD_BLEND_FUNCTION(alpha_blend_HDA, alpha_blend_HDA_functor,
+                               simd_alpha_blend_functor<T, true>)
+    DEFINE_SIMD_BLEND_O_FUNCTION(alpha_blend_o, alpha_blend_o_functor,
+                                 simd_alpha_blend_o_functor<T, false>)
+    DEFINE_SIMD_BLEND_O_FUNCTION(alpha_blend_HDA_o, alpha_blend_HDA_o_functor,
+                                 simd_alpha_blend_o_functor<T, true>)
+    DEFINE_SIMD_BLEND_FUNCTION(alpha_blend_d, alpha_blend_d_functor,
+                               simd_dest_alpha_functor<T, simd_addr_d>)
+    DEFINE_SIMD_BLEND_O_FUNCTION(alpha_blend_do, alpha_blend_do_functor,
+                                 simd_dest_alpha_functor<T, simd_addr_do>)
+    DEFINE_SIMD_BLEND_FUNCTION(alpha_blend_a, alpha_blend_a_functor,
+                               simd_alpha_blend_a_functor<T>)
+    DEFINE_SIMD_BLEND_O_FUNCTION(alpha_blend_ao, alpha_blend_ao_functor,
+                                 simd_alpha_blend_ao_functor<T>)
+
+    DEFINE_SIMD_BLEND_FUNCTION(premulalpha_blend, premulalpha_blend_functor,
+                               simd_premulalpha_blend_functor<T, false>)
+    DEFINE_SIMD_BLEND_FUNCTION(premulalpha_blend_HDA,
+                               premulalpha_blend_HDA_functor,
+                               simd_premulalpha_blend_functor<T, true>)
+    DEFINE_SIMD_BLEND_O_FUNCTION(premulalpha_blend_o,
+                                 premulalpha_blend_o_functor,
+                                 simd_premulalpha_blend_o_functor<T, false>)
+    DEFINE_SIMD_BLEND_O_FUNCTION(premulalpha_blend_HDA_o,
+                                 premulalpha_blend_HDA_o_functor,
+                                 simd_premulalpha_blend_o_functor<T, true>)
+    DEFINE_SIMD_BLEND_FUNCTION(premulalpha_blend_a, premulalpha_blend_a_functor,
+                               simd_premulalpha_blend_a_functor<T>)
+    DEFINE_SIMD_BLEND_O_FUNCTION(premulalpha_blend_ao,
+                                 premulalpha_blend_ao_functor,
+                                 simd_premulalpha_blend_ao_functor<T>)
+
+    DEFINE_SIMD_BLEND_O_FUNCTION(const_alpha_blend, const_alpha_blend_functor,
+                                 simd_const_alpha_blend_functor<T, false>)
+    DEFINE_SIMD_BLEND_O_FUNCTION(const_alpha_blend_hda,
+                                 const_alpha_blend_hda_functor,
+                                 simd_const_alpha_blend_functor<T, true>)
+    DEFINE_SIMD_BLEND_O_FUNCTION(const_alpha_blend_d,
+                                 const_alpha_blend_d_functor,
+                                 simd_dest_alpha_functor<T, simd_addr_const_d>)
+    DEFINE_SIMD_BLEND_O_FUNCTION(const_alpha_blend_a,
+                                 const_alpha_blend_a_functor,
+                                 simd_const_alpha_blend_a_functor<T>)
+
+    DEFINE_SIMD_BLEND_FUNCTION(color_opaque, color_opaque_functor,
+                               simd_color_opaque_functor<T>)
+
+    DEFINE_SIMD_BLEND_FUNCTION(add_blend, add_blend_functor,
+                               simd_add_blend_functor<T, false>)
+    DEFINE_SIMD_BLEND_FUNCTION(add_blend_HDA, add_blend_HDA_functor,
+                               simd_add_blend_functor<T, true>)
+    DEFINE_SIMD_BLEND_O_FUNCTION(add_blend_o, add_blend_o_functor,
+                                 simd_add_blend_o_functor<T, false>)
+    DEFINE_SIMD_BLEND_O_FUNCTION(add_blend_HDA_o, add_blend_HDA_o_functor,
+                                 simd_add_blend_o_functor<T, true>)
+
+    DEFINE_SIMD_BLEND_FUNCTION(sub_blend, sub_blend_functor,
+                               simd_sub_blend_functor<T, false>)
+    DEFINE_SIMD_BLEND_FUNCTION(sub_blend_HDA, sub_blend_HDA_functor,
+                               simd_sub_blend_functor<T, true>)
+    DEFINE_SIMD_BLEND_O_FUNCTION(sub_blend_o, sub_blend_o_functor,
+                                 simd_sub_blend_o_functor<T, false>)
+    DEFINE_SIMD_BLEND_O_FUNCTION(sub_blend_HDA_o, sub_blend_HDA_o_functor,
+                                 simd_sub_blend_o_functor<T, true>)
+
+    DEFINE_SIMD_BLEND_FUNCTION(mul_blend, mul_blend_functor,
+                               simd_mul_blend_functor<T, false>)
+    DEFINE_SIMD_BLEND_FUNCTION(mul_blend_HDA, mul_blend_HDA_functor,
+                               simd_mul_blend_functor<T, true>)
+    DEFINE_SIMD_BLEND_O_FUNCTION(mul_blend_o, mul_blend_o_functor,
+                                 simd_mul_blend_o_functor<T, false>)
+    DEFINE_SIMD_BLEND_O_FUNCTION(mul_blend_HDA_o, mul_blend_HDA_o_functor,
+                                 simd_mul_blend_o_functor<T, true>)
+
+    DEFINE_SIMD_BLEND_FUNCTION(darken_blend, darken_blend_functor,
+                               simd_minmax_blend_functor<T, false, false>)
+    DEFINE_SIMD_BLEND_FUNCTION(darken_blend_HDA, darken_blend_HDA_functor,
+                               simd_minmax_blend_functor<T, false, true>)
+    DEFINE_SIMD_BLEND_O_FUNCTION(darken_blend_o, darken_blend_o_functor,
+                                 simd_minmax_blend_o_functor<T, false, false>)
+    DEFINE_SIMD_BLEND_O_FUNCTION(darken_blend_HDA_o, darken_blend_HDA_o_functor,
+                                 simd_minmax_blend_o_functor<T, false, true>)
+
+    DEFINE_SIMD_BLEND_FUNCTION(lighten_blend, lighten_blend_functor,
+                               simd_minmax_blend_functor<T, true, false>)
+    DEFINE_SIMD_BLEND_FUNCTION(lighten_blend_HDA, lighten_blend_HDA_functor,
+                               simd_minmax_blend_functor<T, true, true>)
+    DEFINE_SIMD_BLEND_O_FUNCTION(lighten_blend_o, lighten_blend_o_functor,
+                                 simd_minmax_blend_o_functor<T, true, false>)
+    DEFINE_SIMD_BLEND_O_FUNCTION(lighten_blend_HDA_o,
+                                 lighten_blend_HDA_o_functor,
+                                 simd_minmax_blend_o_functor<T, true, true>)
+
+    DEFINE_SIMD_BLEND_FUNCTION(screen_blend, screen_blend_functor,
+                               simd_screen_blend_functor<T, false>)
+    DEFINE_SIMD_BLEND_FUNCTION(screen_blend_HDA, screen_blend_HDA_functor,
+                               simd_screen_blend_functor<T, true>)
+    DEFINE_SIMD_BLEND_O_FUNCTION(screen_blend_o, screen_blend_o_functor,
+                                 simd_screen_blend_o_functor<T, false>)
+    DEFINE_SIMD_BLEND_O_FUNCTION(screen_blend_HDA_o, screen_blend_HDA_o_functor,
+                                 simd_screen_blend_o_functor<T, true>)
+
+    // Photoshop 互換合成 : TOp ごとに 4 種類
+#define DEFINE_SIMD_PS_BLEND_FUNCTIONS(NAME, ...)                              \
+    DEFINE_SIMD_BLEND_FUNCTION(                                                \
+        NAME, NAME##_functor,                                                  \
+        simd_ps_blend_functor<T, __VA_ARGS__, false, false>)                   \
+    DEFINE_SIMD_BLEND_O_FUNCTION(                                              \
+        NAME##_o, NAME##_o_functor,                                            \
+        simd_ps_blend_functor<T, __VA_ARGS__, false, true>)                    \
+    DEFINE_SIMD_BLEND_FUNCTION(                                                \
+        NAME##_HDA, NAME##_HDA_functor,                                        \
+        simd_ps_blend_functor<T, __VA_ARGS__, true, false>)                    \
+    DEFINE_SIMD_BLEND_O_FUNCTION(                                              \
+        NAME##_HDA_o, NAME##_HDA_o_functor,                                    \
+        simd_ps_blend_functor<T, __VA_ARGS__, true, true>)
+
+    DEFINE_SIMD_PS_BLEND_FUNCTIONS(ps_alpha_blend,
+                                   simd_ps_color_op<T, simd_ps_alpha_color<T>>)
+    DEFINE_SIMD_PS_BLEND_FUNCTIONS(ps_add_blend,
+                                   simd_ps_color_op<T, simd_ps_add_color<T>>)
+    DEFINE_SIMD_PS_BLEND_FUNCTIONS(ps_sub_blend,
+                                   simd_ps_color_op<T, simd_ps_sub_color<T>>)
+    DEFINE_SIMD_PS_BLEND_FUNCTIONS(ps_mul_blend,
+                                   simd_ps_color_op<T, simd_ps_mul_color<T>>)
+    DEFINE_SIMD_PS_BLEND_FUNCTIONS(
+        ps_lighten_blend, simd_ps_color_op<T, simd_ps_minmax_color<T, true>>)
+    DEFINE_SIMD_PS_BLEND_FUNCTIONS(
+        ps_darken_blend, simd_ps_color_op<T, simd_ps_minmax_color<T, false>>)
+    DEFINE_SIMD_PS_BLEND_FUNCTIONS(ps_diff_blend,
+                                   simd_ps_color_op<T, simd_ps_diff_color<T>>)
+    DEFINE_SIMD_PS_BLEND_FUNCTIONS(ps_screen_blend, simd_ps_screen_op<T, 8>)
+    DEFINE_SIMD_PS_BLEND_FUNCTIONS(ps_exclusion_blend, simd_ps_screen_op<T, 7>)
+
+#undef DEFINE_SIMD_PS_BLEND_FUNCTIONS
+#undef DEFINE_SIMD_BLEND_FUNCTION
+#undef DEFINE_SIMD_BLEND_O_FUNCTION
+
+    template <class T>
+    void TVP_const_alpha_blend_SD_simd(tjs_uint32 *dest, const tjs_uint32 *src1,
+                                       const tjs_uint32 *src2, tjs_int len,
+                                       tjs_int opa) {
+        const_alpha_blend_functor cfunc(opa);
+        if(!simd_opa_in_range(opa)) {
+            for(tjs_int i = 0; i < len; i++)
+                dest[i] = cfunc(src1[i], src2[i]);
+            return;
+        }
+        simd_const_alpha_blend_functor<T, false> vfunc(opa);
+        simd_sd_blend_func<T>(dest, src1, src2, len, vfunc, cfunc);
+    }
+    template <class T>
+    void TVP_color_copy_simd(tjs_uint32 *dest, const tjs_uint32 *src,
+                             tjs_int len) {
+        simd_color_copy_functor<T> vfunc;
+        color_copy_functor cfunc;
+        simd_overlap_blend_func<T>(dest, src, len, vfunc, cfunc);
+    }
+    template <class T>
+    void TVP_alpha_copy_simd(tjs_uint32 *dest, const tjs_uint32 *src,
+                             tjs_int len) {
+        simd_alpha_copy_functor<T> vfunc;
+        alpha_copy_functor cfunc;
+        simd_overlap_blend_func<T>(dest, src, len, vfunc, cfunc);
+    }
+#define DEFINE_SIMD_COLOR_COPY(NAME)                                           \
+    template <class T>                                                         \
+    void TVP_##NAME##_simd(tjs_uint32 *dest, tjs_int len, tjs_uint32 value) { \
+        simd_##NAME##_functor<T> vfunc(value);                                 \
+        NAME##_functor cfunc(value);                                           \
+        simd_const_color_func<T>(dest, len, vfunc, cfunc);                     \
+    }
+    DEFINE_SIMD_COLOR_COPY(fill_argb)
+    DEFINE_SIMD_COLOR_COPY(const_color_copy)
+    DEFINE_SIMD_COLOR_COPY(const_alpha_copy)
+#undef DEFINE_SIMD_COLOR_COPY
+
+    //--------------------------------------------------------------------------
+    // 関数ポインタの設定
+    //--------------------------------------------------------------------------
+#define SET_SIMD_BLEND_MIN_FUNCTIONS(DEST_FUNC, FUNC)                          \
+    TVP##DEST_FUNC = TVP_##FUNC##_simd<T>;                                     \
+    TVP##DEST_FUNC##_HDA = TVP_##FUNC##_HDA_simd<T>;                           \
+    TVP##DEST_FUNC##_o = TVP_##FUNC##_o_simd<T>;                               \
+    TVP##DEST_FUNC##_HDA_o = TVP_##FUNC##_HDA_o_simd<T>;
+
+    template <class T>
+    void TVPGL_SIMD_Setup() {
+        SET_SIMD_BLEND_MIN_FUNCTIONS(AlphaBlend, alpha_blend);
+        TVPAlphaBlend_d = TVP_alpha_blend_d_simd<T>;
+        TVPAlphaBlend_a = TVP_alpha_blend_a_simd<T>;
+        TVPAlphaBlend_do = TVP_alpha_blend_do_simd<T>;
+        TVPAlphaBlend_ao = TVP_alpha_blend_ao_simd<T>;
+
+        SET_SIMD_BLEND_MIN_FUNCTIONS(AdditiveAlphaBlend, premulalpha_blend);
+        TVPAdditiveAlphaBlend_a = TVP_premulalpha_blend_a_simd<T>;
+        TVPAdditiveAlphaBlend_ao = TVP_premulalpha_blend_ao_simd<T>;
+
+        SET_SIMD_BLEND_MIN_FUNCTIONS(AddBlend, add_blend);
+        SET_SIMD_BLEND_MIN_FUNCTIONS(SubBlend, sub_blend);
+        SET_SIMD_BLEND_MIN_FUNCTIONS(MulBlend, mul_blend);
+        SET_SIMD_BLEND_MIN_FUNCTIONS(DarkenBlend, darken_blend);
+        SET_SIMD_BLEND_MIN_FUNCTIONS(LightenBlend, lighten_blend);
+        SET_SIMD_BLEND_MIN_FUNCTIONS(ScreenBlend, screen_blend);
+
+        // テーブルを引く SoftLight/ColorDodge/ColorBurn/Overlay/HardLight
+        // と、ソースを先に減衰させる ColorDodge5/Diff5 は C 版のまま
+        SET_SIMD_BLEND_MIN_FUNCTIONS(PsAlphaBlend, ps_alpha_blend);
+        SET_SIMD_BLEND_MIN_FUNCTIONS(PsAddBlend, ps_add_blend);
+        SET_SIMD_BLEND_MIN_FUNCTIONS(PsSubBlend, ps_sub_blend);
+        SET_SIMD_BLEND_MIN_FUNCTIONS(PsMulBlend, ps_mul_blend);
+        SET_SIMD_BLEND_MIN_FUNCTIONS(PsScreenBlend, ps_screen_blend);
+        SET_SIMD_BLEND_MIN_FUNCTIONS(PsLightenBlend, ps_lighten_blend);
+        SET_SIMD_BLEND_MIN_FUNCTIONS(PsDarkenBlend, ps_darken_blend);
+        SET_SIMD_BLEND_MIN_FUNCTIONS(PsDiffBlend, ps_diff_blend);
+        SET_SIMD_BLEND_MIN_FUNCTIONS(PsExclusionBlend, ps_exclusion_blend);
+
+        TVPConstAlphaBlend = TVP_const_alpha_blend_simd<T>;
+        TVPConstAlphaBlend_HDA = TVP_const_alpha_blend_hda_simd<T>;
+        TVPConstAlphaBlend_d = TVP_const_alpha_blend_d_simd<T>;
+        TVPConstAlphaBlend_a = TVP_const_alpha_blend_a_simd<T>;
+        TVPConstAlphaBlend_SD = TVP_const_alpha_blend_SD_simd<T>;
+
+        TVPCopyColor = TVP_color_copy_simd<T>;
+        TVPCopyMask = TVP_alpha_copy_simd<T>;
+        TVPCopyOpaqueImage = TVP_color_opaque_simd<T>;
+
+        TVPFillARGB = TVP_fill_argb_simd<T>;
+        TVPFillARGB_NC = TVP_fill_argb_simd<T>;
+        TVPFillColor = TVP_const_color_copy_simd<T>;
+        TVPFillMask = TVP_const_alpha_copy_simd<T>;
+    }
+#undef SET_SIMD_BLEND_MIN_FUNCTIONS
+
+} // namespace
+
+#endif // __BLEND_FUNCTOR_SIMD_H__
@@ -0,0 +1,161 @@
+/*
+
+        TVP2 ( T Visual Presenter 2 )  A script authoring tool
+        Copyright (C) 2000-2009 W.Dee <dee@kikyou.info> and
+   contributors
+
+        See details of license at "license.txt"
+
+
+*/
+/******************************************************************************/
+/**
+ * x86/x64 SIMD のラッパー
+ * SSE2 と AVX2 で同じブレンドコードを共有するための最小限の命令セット
+ * AVX2 版は __AVX2__ が定義された翻訳単位 (-mavx2 / /arch:AVX2) でのみ有効
+ *
+ * unpack/pack は 128bit レーン内で動作するため、AVX2
+ * でもピクセルの並びは保たれる
+ *****************************************************************************/
+
+#ifndef __SIMD_DEF_X86X64_H__
+#define __SIMD_DEF_X86X64_H__
+
+#include "tjsTypes.h"
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+    /** SSE2 : 4 pixels / vector */
+    struct tTVPSimdSSE2 {
+        typedef __m128i V;
+        enum { N = 4 };
+
+        static inline V load(const void *p) {
+            return _mm_loadu_si128((const __m128i *)p);
+        }
+        static inline void store(void *p, V v) {
+            _mm_storeu_si128((__m128i *)p, v);
+        }
+        static inline V zero() { return _mm_setzero_si128(); }
+        static inline V set1_32(tjs_uint32 v) { return _mm_set1_epi32((int)v); }
+        static inline V set1_16(tjs_int v) { return _mm_set1_epi16((short)v); }
+        static inline V set_32(const tjs_uint32 *v) {
+            return _mm_set_epi32((int)v[3], (int)v[2], (int)v[1], (int)v[0]);
+        }
+
+        // 8bit <-> 16bit
+        static inline V lo8(V v) { return _mm_unpacklo_epi8(v, zero()); }
+        static inline V hi8(V v) { return _mm_unpackhi_epi8(v, zero()); }
+        static inline V pack16(V lo, V hi) { return _mm_packus_epi16(lo, hi); }
+
+        // 16bit word 演算
+        static inline V add16(V a, V b) { return _mm_add_epi16(a, b); }
+        static inline V sub16(V a, V b) { return _mm_sub_epi16(a, b); }
+        static inline V mullo16(V a, V b) { return _mm_mullo_epi16(a, b); }
+        template <int n>
+        static inline V srli16(V a) {
+            return _mm_srli_epi16(a, n);
+        }
+        template <int n>
+        static inline V slli16(V a) {
+            return _mm_slli_epi16(a, n);
+        }
+        /** 各ピクセルの idx 番目のワードをピクセル内の 4 ワードに複製する */
+        template <int idx>
+        static inline V bcast16(V v) {
+            v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(idx, idx, idx, idx));
+            return _mm_shufflehi_epi16(v, _MM_SHUFFLE(idx, idx, idx, idx));
+        }
+
+        // 8bit 飽和演算
+        static inline V adds8(V a, V b) { return _mm_adds_epu8(a, b); }
+        static inline V subs8(V a, V b) { return _mm_subs_epu8(a, b); }
+        static inline V min8(V a, V b) { return _mm_min_epu8(a, b); }
+        static inline V max8(V a, V b) { return _mm_max_epu8(a, b); }
+
+        // ビット演算
+        static inline V and_(V a, V b) { return _mm_and_si128(a, b); }
+        static inline V or_(V a, V b) { return _mm_or_si128(a, b); }
+        static inline V xor_(V a, V b) { return _mm_xor_si128(a, b); }
+        template <int n>
+        static inline V srli32(V a) {
+            return _mm_srli_epi32(a, n);
+        }
+        template <int n>
+        static inline V slli32(V a) {
+            return _mm_slli_epi32(a, n);
+        }
+    };
+
+#if defined(__AVX2__)
+    /** AVX2 : 8 pixels / vector */
+    struct tTVPSimdAVX2 {
+        typedef __m256i V;
+        enum { N = 8 };
+
+        static inline V load(const void *p) {
+            return _mm256_loadu_si256((const __m256i *)p);
+        }
+        static inline void store(void *p, V v) {
+            _mm256_storeu_si256((__m256i *)p, v);
+        }
+        static inline V zero() { return _mm256_setzero_si256(); }
+        static inline V set1_32(tjs_uint32 v) {
+            return _mm256_set1_epi32((int)v);
+        }
+        static inline V set1_16(tjs_int v) {
+            return _mm256_set1_epi16((short)v);
+        }
+        static inline V set_32(const tjs_uint32 *v) {
+            return _mm256_loadu_si256((const __m256i *)v);
+        }
+
+        static inline V lo8(V v) { return _mm256_unpacklo_epi8(v, zero()); }
+        static inline V hi8(V v) { return _mm256_unpackhi_epi8(v, zero()); }
+        static inline V pack16(V lo, V hi) {
+            return _mm256_packus_epi16(lo, hi);
+        }
+
+        static inline V add16(V a, V b) { return _mm256_add_epi16(a, b); }
+        static inline V sub16(V a, V b) { return _mm256_sub_epi16(a, b); }
+        static inline V mullo16(V a, V b) { return _mm256_mullo_epi16(a, b); }
+        template <int n>
+        static inline V srli16(V a) {
+            return _mm256_srli_epi16(a, n);
+        }
+        template <int n>
+        static inline V slli16(V a) {
+            return _mm256_slli_epi16(a, n);
+        }
+        template <int idx>
+        static inline V bcast16(V v) {
+            v = _mm256_shufflelo_epi16(v, _MM_SHUFFLE(idx, idx, idx, idx));
+            return _mm256_shufflehi_epi16(v, _MM_SHUFFLE(idx, idx, idx, idx));
+        }
+
+        static inline V adds8(V a, V b) { return _mm256_adds_epu8(a, b); }
+        static inline V subs8(V a, V b) { return _mm256_subs_epu8(a, b); }
+        static inline V min8(V a, V b) { return _mm256_min_epu8(a, b); }
+        static inline V max8(V a, V b) { return _mm256_max_epu8(a, b); }
+
+        static inline V and_(V a, V b) { return _mm256_and_si256(a, b); }
+        static inline V or_(V a, V b) { return _mm256_or_si256(a, b); }
+        static inline V xor_(V a, V b) { return _mm256_xor_si256(a, b); }
+        template <int n>
+        static inline V srli32(V a) {
+            return _mm256_srli_epi32(a, n);
+        }
+        template <int n>
+        static inline V slli32(V a) {
+            return _mm256_slli_epi32(a, n);
+        }
+    };
+#endif
+
+} // namespace
+
+#endif // __SIMD_DEF_X86X64_H__
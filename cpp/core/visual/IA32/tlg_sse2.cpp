@@ -0,0 +1,322 @@
+/*
+
+        TVP2 ( T Visual Presenter 2 )  A script authoring tool
+        Copyright (C) 2000-2009 W.Dee <dee@kikyou.info> and
+   contributors
+
+        See details of license at "license.txt"
+
+
+*/
+/******************************************************************************/
+/**
+ * SSE2 版 TLG5/TLG6 デコード関数
+ *
+ * TLG6 の MED/AVG 予測は左隣の画素に依存するため画素単位で逐次処理するが、
+ * 4 チャンネルを 1 つの 32bit レーンでまとめて計算する。
+ * 色相関フィルタは 4 画素ずつベクタで処理する。
+ * TLG5 の色合成は 16 画素ずつ、ベクタ内の累積和 (prefix sum) で処理する。
+ *****************************************************************************/
+
+#include "tjsCommHead.h"
+#include "tvpgl.h"
+#include "tvpgl_ia32_intf.h"
+#include <emmintrin.h>
+
+namespace {
+
+    // チャンネル番号 : B=0 G=1 R=2 A=3
+    /** 各画素のチャンネル S をチャンネル D の位置に移し、他を 0 にする */
+    template <int S, int D>
+    inline __m128i TVPTLGMoveChannel(__m128i x) {
+        const __m128i mask = _mm_set1_epi32(0xff << (D * 8));
+        if(D > S)
+            x = _mm_slli_epi32(x, (D - S) * 8);
+        else if(D < S)
+            x = _mm_srli_epi32(x, (S - D) * 8);
+        return _mm_and_si128(x, mask);
+    }
+
+#define M(S, D) TVPTLGMoveChannel<S, D>(x)
+    /**
+     * TLG6 の色相関フィルタ (tvpgl.cpp の TVP_TLG6_DO_CHROMA_DECODE と同じ式)
+     * 各チャンネルに加える項を列挙する
+     */
+    template <int F>
+    inline __m128i TVPTLG6Chroma(__m128i x) {
+        const int B = 0, G = 1, R = 2;
+        __m128i a;
+        switch(F) {
+            case 0: // B, G, R
+                return x;
+            case 1: // B+G, G, R+G
+                a = _mm_add_epi8(M(G, B), M(G, R));
+                break;
+            case 2: // B, G+B, R+B+G
+                a = _mm_add_epi8(_mm_add_epi8(M(B, G), M(B, R)), M(G, R));
+                break;
+            case 3: // B+R+G, G+R, R
+                a = _mm_add_epi8(_mm_add_epi8(M(R, B), M(G, B)), M(R, G));
+                break;
+            case 4: // B+R, G+B+R, R+B+R+G
+                a = _mm_add_epi8(_mm_add_epi8(M(R, B), M(B, G)),
+                                 _mm_add_epi8(M(R, G), M(R, R)));
+                a = _mm_add_epi8(a, _mm_add_epi8(M(B, R), M(G, R)));
+                break;
+            case 5: // B+R, G+B+R, R
+                a = _mm_add_epi8(_mm_add_epi8(M(R, B), M(B, G)), M(R, G));
+                break;
+            case 6: // B+G, G, R
+                a = M(G, B);
+                break;
+            case 7: // B, G+B, R
+                a = M(B, G);
+                break;
+            case 8: // B, G, R+G
+                a = M(G, R);
+                break;
+            case 9: // B+G+R+B, G+R+B, R+B
+                a = _mm_add_epi8(_mm_add_epi8(M(G, B), M(R, B)),
+                                 _mm_add_epi8(M(B, B), M(R, G)));
+                a = _mm_add_epi8(a, _mm_add_epi8(M(B, G), M(B, R)));
+                break;
+            case 10: // B+R, G+R, R
+                a = _mm_add_epi8(M(R, B), M(R, G));
+                break;
+            case 11: // B, G+B, R+B
+                a = _mm_add_epi8(M(B, G), M(B, R));
+                break;
+            case 12: // B, G+R+B, R+B
+                a = _mm_add_epi8(_mm_add_epi8(M(R, G), M(B, G)), M(B, R));
+                break;
+            case 13: // B+G, G+R+B+G, R+B+G
+                a = _mm_add_epi8(_mm_add_epi8(M(G, B), M(R, G)),
+                                 _mm_add_epi8(M(B, G), M(G, G)));
+                a = _mm_add_epi8(a, _mm_add_epi8(M(B, R), M(G, R)));
+                break;
+            case 14: // B+G+R, G+R, R+B+G+R
+                a = _mm_add_epi8(_mm_add_epi8(M(G, B), M(R, B)),
+                                 _mm_add_epi8(M(R, G), M(B, R)));
+                a = _mm_add_epi8(a, _mm_add_epi8(M(G, R), M(R, R)));
+                break;
+            default: // 15: B, G+(B<<1), R+(B<<1)
+                a = _mm_add_epi8(M(B, G), M(B, R));
+                a = _mm_add_epi8(a, a);
+                break;
+        }
+        return _mm_add_epi8(x, a);
+    }
+#undef M
+
+    /** 各画素のチャンネル 0 と 2 を入れ替える */
+    inline __m128i TVPTLGSwapRB(__m128i x) {
+        const __m128i ga = _mm_set1_epi32(0xff00ff00);
+        const __m128i low = _mm_set1_epi32(0xff);
+        __m128i b = _mm_slli_epi32(_mm_and_si128(x, low), 16);
+        __m128i r = _mm_and_si128(_mm_srli_epi32(x, 16), low);
+        return _mm_or_si128(_mm_and_si128(x, ga), _mm_or_si128(b, r));
+    }
+
+    /**
+     * フィルタ番号 (0..15) に対応する色相関フィルタを適用する
+     * TLG6 のデータはチャンネル 0 と 2 が入れ替わって格納されている
+     */
+    inline __m128i TVPTLG6ChromaDecode(int f, __m128i x) {
+        switch(f) {
+#define TVP_TLG6_CHROMA_CASE(N)                                                \
+    case N:                                                                    \
+        return TVPTLGSwapRB(TVPTLG6Chroma<N>(x));
+            TVP_TLG6_CHROMA_CASE(0)
+            TVP_TLG6_CHROMA_CASE(1)
+            TVP_TLG6_CHROMA_CASE(2)
+            TVP_TLG6_CHROMA_CASE(3)
+            TVP_TLG6_CHROMA_CASE(4)
+            TVP_TLG6_CHROMA_CASE(5)
+            TVP_TLG6_CHROMA_CASE(6)
+            TVP_TLG6_CHROMA_CASE(7)
+            TVP_TLG6_CHROMA_CASE(8)
+            TVP_TLG6_CHROMA_CASE(9)
+            TVP_TLG6_CHROMA_CASE(10)
+            TVP_TLG6_CHROMA_CASE(11)
+            TVP_TLG6_CHROMA_CASE(12)
+            TVP_TLG6_CHROMA_CASE(13)
+            TVP_TLG6_CHROMA_CASE(14)
+            TVP_TLG6_CHROMA_CASE(15)
+#undef TVP_TLG6_CHROMA_CASE
+        }
+        return TVPTLGSwapRB(x);
+    }
+
+    /**
+     * MED (Median Edge Detector) 予測
+     * a, b の小さい方を mn、大きい方を mx とすると
+     * c >= mx なら mn、c <= mn なら mx、それ以外は a + b - c
+     * 飽和演算で min(mx, mn + (mx - c)) として求める
+     */
+    inline __m128i TVPTLG6Med(__m128i a, __m128i b, __m128i c) {
+        __m128i mx = _mm_max_epu8(a, b);
+        __m128i mn = _mm_min_epu8(a, b);
+        return _mm_min_epu8(mx, _mm_adds_epu8(mn, _mm_subs_epu8(mx, c)));
+    }
+
+    /** 1 ブロック (8 画素) の予測を逐次行う。p と up は次のブロックへ引き継ぐ */
+    template <bool AVG>
+    inline void TVPTLG6DecodeBlock(const tjs_uint32 *prevline,
+                                   tjs_uint32 *curline, __m128i v0, __m128i v1,
+                                   __m128i &p, __m128i &up) {
+        for(int h = 0; h < 2; h++) {
+            __m128i v = h ? v1 : v0;
+            __m128i u4 = _mm_loadu_si128((const __m128i *)(prevline + h * 4));
+            for(int j = 0; j < 4; j++) {
+                __m128i t = AVG ? _mm_avg_epu8(p, u4) : TVPTLG6Med(p, u4, up);
+                p = _mm_add_epi8(t, v);
+                curline[h * 4 + j] = (tjs_uint32)_mm_cvtsi128_si32(p);
+                up = u4;
+                u4 = _mm_srli_si128(u4, 4);
+                v = _mm_srli_si128(v, 4);
+            }
+        }
+    }
+
+} // namespace
+
+static void TVPTLG6DecodeLine_sse2(tjs_uint32 *prevline, tjs_uint32 *curline,
+                                   tjs_int width, tjs_int block_count,
+                                   tjs_uint8 *filtertypes,
+                                   tjs_int skipblockbytes, tjs_uint32 *in,
+                                   tjs_uint32 initialp, tjs_int oddskip,
+                                   tjs_int dir) {
+    // block_count 個のブロックはすべて TVP_TLG6_W_BLOCK_SIZE 画素幅
+    __m128i p = _mm_cvtsi32_si128((int)initialp);
+    __m128i up = p;
+    for(tjs_int i = 0; i < block_count; i++) {
+        const tjs_uint32 *bin = in + i * skipblockbytes;
+        if(i & 1)
+            bin += oddskip * TVP_TLG6_W_BLOCK_SIZE;
+        __m128i v0 = _mm_loadu_si128((const __m128i *)bin);
+        __m128i v1 = _mm_loadu_si128((const __m128i *)(bin + 4));
+        if(!(dir & 1)) {
+            // 右から左へ並んでいる
+            __m128i t = _mm_shuffle_epi32(v1, _MM_SHUFFLE(0, 1, 2, 3));
+            v1 = _mm_shuffle_epi32(v0, _MM_SHUFFLE(0, 1, 2, 3));
+            v0 = t;
+        }
+
+        tjs_int ft = filtertypes[i];
+        if(ft >= 32)
+            return; // 不正なフィルタ番号 (C 版と同じく打ち切る)
+        v0 = TVPTLG6ChromaDecode(ft >> 1, v0);
+        v1 = TVPTLG6ChromaDecode(ft >> 1, v1);
+
+        tjs_int x = i * TVP_TLG6_W_BLOCK_SIZE;
+        if(ft & 1)
+            TVPTLG6DecodeBlock<true>(prevline + x, curline + x, v0, v1, p, up);
+        else
+            TVPTLG6DecodeBlock<false>(prevline + x, curline + x, v0, v1, p,
+                                      up);
+    }
+}
+
+namespace {
+    /**
+     * TLG5 の色合成 16 画素分
+     * b g r a は各プレーンの 16 バイト、pc は直前の画素の累積値
+     * (最上位レーン) で、処理後は最後の画素の累積値になる
+     */
+    inline void TVPTLG5Compose16(tjs_uint8 *outp, const tjs_uint8 *upper,
+                                 __m128i b, __m128i g, __m128i r, __m128i a,
+                                 __m128i &pc, __m128i alpha) {
+        __m128i bg_lo = _mm_unpacklo_epi8(b, g);
+        __m128i bg_hi = _mm_unpackhi_epi8(b, g);
+        __m128i ra_lo = _mm_unpacklo_epi8(r, a);
+        __m128i ra_hi = _mm_unpackhi_epi8(r, a);
+        __m128i px[4] = {
+            _mm_unpacklo_epi16(bg_lo, ra_lo),
+            _mm_unpackhi_epi16(bg_lo, ra_lo),
+            _mm_unpacklo_epi16(bg_hi, ra_hi),
+            _mm_unpackhi_epi16(bg_hi, ra_hi),
+        };
+        for(int i = 0; i < 4; i++) {
+            // B+G, G, R+G
+            __m128i x = TVPTLG6Chroma<1>(px[i]);
+            // ベクタ内の累積和
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+            x = _mm_add_epi8(x, _mm_shuffle_epi32(pc, _MM_SHUFFLE(3, 3, 3, 3)));
+            pc = x;
+            __m128i u = _mm_loadu_si128((const __m128i *)(upper + i * 16));
+            _mm_storeu_si128((__m128i *)(outp + i * 16),
+                             _mm_or_si128(_mm_add_epi8(x, u), alpha));
+        }
+    }
+} // namespace
+
+static void TVPTLG5ComposeColors3To4_sse2(tjs_uint8 *outp,
+                                          const tjs_uint8 *upper,
+                                          tjs_uint8 *const *buf,
+                                          tjs_int width) {
+    const __m128i alpha = _mm_set1_epi32(0xff000000);
+    __m128i pc = _mm_setzero_si128();
+    tjs_int x = 0;
+    for(; x + 16 <= width; x += 16) {
+        __m128i r = _mm_loadu_si128((const __m128i *)(buf[0] + x));
+        __m128i g = _mm_loadu_si128((const __m128i *)(buf[1] + x));
+        __m128i b = _mm_loadu_si128((const __m128i *)(buf[2] + x));
+        TVPTLG5Compose16(outp + x * 4, upper + x * 4, b, g, r,
+                         _mm_setzero_si128(), pc, alpha);
+    }
+
+    // 残り
+    tjs_uint32 last = (tjs_uint32)_mm_cvtsi128_si32(
+        _mm_shuffle_epi32(pc, _MM_SHUFFLE(3, 3, 3, 3)));
+    tjs_uint8 pc0 = last & 0xff, pc1 = (last >> 8) & 0xff,
+              pc2 = (last >> 16) & 0xff;
+    for(; x < width; x++) {
+        tjs_uint8 c1 = buf[1][x];
+        tjs_uint8 c0 = buf[2][x] + c1;
+        tjs_uint8 c2 = buf[0][x] + c1;
+        const tjs_uint8 *u = upper + x * 4;
+        *(tjs_uint32 *)(outp + x * 4) = (((pc0 += c0) + u[0]) & 0xff) +
+            ((((pc1 += c1) + u[1]) & 0xff) << 8) +
+            ((((pc2 += c2) + u[2]) & 0xff) << 16) + 0xff000000;
+    }
+}
+
+static void TVPTLG5ComposeColors4To4_sse2(tjs_uint8 *outp,
+                                          const tjs_uint8 *upper,
+                                          tjs_uint8 *const *buf,
+                                          tjs_int width) {
+    const __m128i alpha = _mm_setzero_si128();
+    __m128i pc = _mm_setzero_si128();
+    tjs_int x = 0;
+    for(; x + 16 <= width; x += 16) {
+        __m128i r = _mm_loadu_si128((const __m128i *)(buf[0] + x));
+        __m128i g = _mm_loadu_si128((const __m128i *)(buf[1] + x));
+        __m128i b = _mm_loadu_si128((const __m128i *)(buf[2] + x));
+        __m128i a = _mm_loadu_si128((const __m128i *)(buf[3] + x));
+        TVPTLG5Compose16(outp + x * 4, upper + x * 4, b, g, r, a, pc, alpha);
+    }
+
+    // 残り
+    tjs_uint32 last = (tjs_uint32)_mm_cvtsi128_si32(
+        _mm_shuffle_epi32(pc, _MM_SHUFFLE(3, 3, 3, 3)));
+    tjs_uint8 pc0 = last & 0xff, pc1 = (last >> 8) & 0xff,
+              pc2 = (last >> 16) & 0xff, pc3 = last >> 24;
+    for(; x < width; x++) {
+        tjs_uint8 c1 = buf[1][x];
+        tjs_uint8 c0 = buf[2][x] + c1;
+        tjs_uint8 c2 = buf[0][x] + c1;
+        tjs_uint8 c3 = buf[3][x];
+        const tjs_uint8 *u = upper + x * 4;
+        *(tjs_uint32 *)(outp + x * 4) = (((pc0 += c0) + u[0]) & 0xff) +
+            ((((pc1 += c1) + u[1]) & 0xff) << 8) +
+            ((((pc2 += c2) + u[2]) & 0xff) << 16) +
+            ((((pc3 += c3) + u[3]) & 0xff) << 24);
+    }
+}
+
+void TVPTLG_SSE2_Init() {
+    TVPTLG5ComposeColors3To4 = TVPTLG5ComposeColors3To4_sse2;
+    TVPTLG5ComposeColors4To4 = TVPTLG5ComposeColors4To4_sse2;
+    TVPTLG6DecodeLine = TVPTLG6DecodeLine_sse2;
+}
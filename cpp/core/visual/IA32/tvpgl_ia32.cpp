@@ -0,0 +1,35 @@
+/*
+
+        TVP2 ( T Visual Presenter 2 )  A script authoring tool
+        Copyright (C) 2000-2009 W.Dee <dee@kikyou.info> and
+   contributors
+
+        See details of license at "license.txt"
+
+
+*/
+/******************************************************************************/
+/**
+ * x86/x64 向けの tvpgl 初期化
+ * C 版で初期化した後、CPU が対応している命令セットの関数で上書きする
+ *****************************************************************************/
+
+#include "tjsCommHead.h"
+
+#include "DetectCPU.h"
+#include "tvpgl_asm_init.h"
+#include "tvpgl_ia32_intf.h"
+
+void TVPGL_ASM_Init() {
+    tjs_uint32 family = TVPCPUType & TVP_CPU_FAMILY_MASK;
+    if(family != TVP_CPU_FAMILY_X86 && family != TVP_CPU_FAMILY_X64)
+        return;
+
+    TVPInitTVPGL();
+    if(TVPCPUType & TVP_CPU_HAS_SSE2) {
+        TVPGL_SSE2_Init();
+        TVPTLG_SSE2_Init();
+    }
+    if(TVPCPUType & TVP_CPU_HAS_AVX2)
+        TVPGL_AVX2_Init();
+}
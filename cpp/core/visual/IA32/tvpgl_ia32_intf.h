@@ -0,0 +1,21 @@
+/*
+        this is a part of TVP (KIRIKIRI) software source.
+        see other sources for license.
+        (C)2001-2009 W.Dee <dee@kikyou.info> and contributors
+*/
+
+/* C-language interface to the x86/x64 SIMD routines */
+
+#ifndef __TVPGL_IA32_INTF__
+#define __TVPGL_IA32_INTF__
+
+#include "tjsTypes.h"
+#include "tvpgl.h"
+
+/* 各命令セットの関数ポインタを設定する。TVPInitTVPGL の後に呼ぶこと */
+extern void TVPGL_SSE2_Init();
+extern void TVPGL_AVX2_Init();
+/* TLG5/TLG6 デコード関数 */
+extern void TVPTLG_SSE2_Init();
+
+#endif
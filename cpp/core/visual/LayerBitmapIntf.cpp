@@ -1218,7 +1218,7 @@ bool iTVPBaseBitmap::Copy9Patch(const iTVPBaseBitmap *ref, tTVPRect &margin) {
         return false; // TODO implement universal version
     }
 
-    const tjs_uint32 *src = (const tjs_uint32 *)ref->GetScanLine(0);
+    const tjs_uint32 *src = (const tjs_uint32 *)ref->GetPixelData();
     tjs_int pitch = ref->GetPitchBytes() / sizeof(tjs_uint32);
     const tjs_uint32 *srcbottom = (const tjs_uint32 *)ref->GetScanLine(h - 1);
     tTVPRect scale(-1, -1, -1, -1);
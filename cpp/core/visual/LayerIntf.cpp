@@ -43,6 +43,8 @@
 #include "vkdefine.h"
 #include "RenderManager.h"
 #include <cstdlib>
+#include <mutex>
+#include <exception>
 #include "FontImpl.h"
 
 extern void TVPSetFontRasterizer(tjs_int index);
@@ -93,14 +95,18 @@ class tTVPTempBitmapHolder : public tTVPCompactEventCallbackIntf {
 
     tTVPBaseTexture *Bitmap;
 
-    std::vector<tTVPBaseTexture *> Temporaries;
-    tjs_uint TempLevel;
+    struct tTempStack {
+        std::vector<tTVPBaseTexture *> Temporaries;
+        tjs_uint TempLevel = 0;
+    };
+    tTempStack TempStacks[TVPMaxDrawSlot]; // one nesting stack per draw slot
+    std::mutex TempAllocMutex; // bitmap (re)allocation from draw slots
     bool TempCompactInit;
 
 private:
     tjs_int RefCount;
 
-    tTVPTempBitmapHolder() : TempLevel(0), TempCompactInit(false) {
+    tTVPTempBitmapHolder() : TempCompactInit(false) {
         // the default image must be a transparent, white colored
         // rectangle
         RefCount = 1;
@@ -109,9 +115,12 @@ private:
     }
 
     ~tTVPTempBitmapHolder() {
-        std::vector<tTVPBaseTexture *>::iterator i;
-        for(i = Temporaries.begin(); i != Temporaries.end(); i++) {
-            delete(*i);
+        for(tTempStack &stack : TempStacks) {
+            std::vector<tTVPBaseTexture *>::iterator i;
+            for(i = stack.Temporaries.begin(); i != stack.Temporaries.end();
+                i++) {
+                delete(*i);
+            }
         }
         if(TempCompactInit)
             TVPRemoveCompactEventHook(this);
@@ -119,12 +128,29 @@ private:
             delete Bitmap;
     }
 
-    tTVPBaseTexture *InternalGetTemp(tjs_uint w, tjs_uint h, bool fit) {
+    void InitCompactHook() {
         // compact initialization
         if(!TempCompactInit) {
             TVPAddCompactEventHook(this);
             TempCompactInit = true;
         }
+    }
+
+    tTVPBaseTexture *InternalGetTemp(tjs_uint w, tjs_uint h, bool fit) {
+        tjs_int slot = TVPGetDrawSlot();
+        if(slot) {
+            // bitmap construction is not thread safe
+            std::lock_guard<std::mutex> lock(TempAllocMutex);
+            return InternalGetTemp(TempStacks[slot], w, h, fit);
+        }
+        InitCompactHook();
+        return InternalGetTemp(TempStacks[0], w, h, fit);
+    }
+
+    tTVPBaseTexture *InternalGetTemp(tTempStack &stack, tjs_uint w,
+                                     tjs_uint h, bool fit) {
+        std::vector<tTVPBaseTexture *> &Temporaries = stack.Temporaries;
+        tjs_uint &TempLevel = stack.TempLevel;
 
         // align width to even
         if(!fit)
@@ -158,19 +184,23 @@ private:
     }
 
     void InternalFreeTemp() {
-        if(TempLevel == 0)
+        tTempStack &stack = TempStacks[TVPGetDrawSlot()];
+        if(stack.TempLevel == 0)
             return; // this must be a logical failure
-        TempLevel--;
+        stack.TempLevel--;
     }
 
     void CompactTempBitmap() {
         // compact tmporary bitmap cache
-        std::vector<tTVPBaseTexture *>::iterator i;
-        for(i = Temporaries.begin() + TempLevel; i != Temporaries.end(); i++) {
-            delete(*i);
-        }
+        for(tTempStack &stack : TempStacks) {
+            std::vector<tTVPBaseTexture *>::iterator i;
+            for(i = stack.Temporaries.begin() + stack.TempLevel;
+                i != stack.Temporaries.end(); i++) {
+                delete(*i);
+            }
 
-        Temporaries.resize(TempLevel);
+            stack.Temporaries.resize(stack.TempLevel);
+        }
     }
 
     void OnCompact(tjs_int level) {
@@ -207,6 +237,11 @@ public:
     }
 
     static void FreeTemp() { TVPTempBitmapHolder->InternalFreeTemp(); }
+
+    // must be called on the main thread before drawing in draw slots
+    static void PrepareParallel() {
+        TVPTempBitmapHolder->InitCompactHook();
+    }
 };
 
 //---------------------------------------------------------------------------
@@ -275,6 +310,45 @@ void TVPTempBitmapHolderRelease() { tTVPTempBitmapHolder::Release(); }
     }                                                                          \
     }
 //---------------------------------------------------------------------------
+// for each child ( for the drawing pipe line )
+// the children of the layers drawn in draw slots are safe-locked by
+// PrepareParallelDraw; the lock count must not be touched from there.
+class tTVPLayerDrawChildrenLocker {
+    tObjectList<tTJSNI_BaseLayer> *List;
+
+public:
+    tTVPLayerDrawChildrenLocker(tObjectList<tTJSNI_BaseLayer> &list) :
+        List(TVPGetDrawSlot() ? nullptr : &list) {
+        if(List)
+            List->SafeLock();
+    }
+    ~tTVPLayerDrawChildrenLocker() {
+        if(List)
+            List->SafeUnlock();
+    }
+    bool IsLocked() const { return List != nullptr; }
+};
+
+#define TVP_LAYER_FOR_EACH_DRAW_CHILD_BEGIN(varname)                           \
+    {                                                                          \
+        tTVPLayerDrawChildrenLocker __locker(Children);                        \
+        tjs_int __count = Children.GetSafeLockedObjectCount();                 \
+        tjs_int __i;                                                           \
+        for(__i = 0; __i < __count; __i++) {                                   \
+            tTJSNI_BaseLayer *varname = Children.GetSafeLockedObjectAt(__i);   \
+            if(!varname)                                                       \
+                continue;
+
+#define TVP_LAYER_FOR_EACH_DRAW_CHILD_END                                      \
+    }                                                                          \
+    if(__locker.IsLocked()) {                                                  \
+        ChildrenArrayValid = false;                                            \
+        ChildrenOrderIndexValid = false;                                       \
+        if(Manager)                                                            \
+            Manager->InvalidateOverallIndex();                                 \
+    }                                                                          \
+    }
+//---------------------------------------------------------------------------
 
 //---------------------------------------------------------------------------
 // Recursive Call
@@ -2824,7 +2898,7 @@ void tTJSNI_BaseLayer::SetProvincePixel(tjs_int x, tjs_int y, tjs_int n) {
 const void *tTJSNI_BaseLayer::GetMainImagePixelBuffer() const {
     if(!MainImage)
         return nullptr;
-    return MainImage->GetScanLine(0);
+    return MainImage->GetPixelData();
 }
 
 //---------------------------------------------------------------------------
@@ -2846,7 +2920,7 @@ tjs_int tTJSNI_BaseLayer::GetMainImagePixelBufferPitch() const {
 const void *tTJSNI_BaseLayer::GetProvinceImagePixelBuffer() const {
     if(!ProvinceImage)
         return nullptr;
-    return ProvinceImage->GetScanLine(0);
+    return ProvinceImage->GetPixelData();
 }
 
 //---------------------------------------------------------------------------
@@ -5489,6 +5563,17 @@ void tTJSNI_BaseLayer::GetFontGlyphDrawRect(const ttstr &text, tTVPRect &area) {
     MainImage->GetFontGlyphDrawRect(text, area);
 }
 //---------------------------------------------------------------------------
+void tTJSNI_BaseLayer::PrepareText(const ttstr &text, bool aa, tjs_int shlevel,
+                                   tjs_int shwidth) {
+    if(!MainImage)
+        TVPThrowExceptionMessage(TVPUnsupportedLayerType,
+                                 TJS_W("prepareText"));
+
+    ApplyFont();
+
+    MainImage->PrepareText(text, aa, shlevel, shwidth);
+}
+//---------------------------------------------------------------------------
 #if 0
                                                                                                                         bool tTJSNI_BaseLayer::DoUserFontSelect(tjs_uint32 flags, const ttstr &caption,
 		const ttstr &prompt, const ttstr &samplestring)
@@ -6202,6 +6287,8 @@ void tTJSNI_BaseLayer::Draw_GPU(tTVPDrawable *target, int x, int y,
     if(visiblecheck && !IsSeen())
         return;
 
+    tDrawState &ds = GetDrawState();
+
     tTVPRect rect;
     if(!TVPIntersectRect(&rect, r, Rect))
         return; // no intersection
@@ -6211,12 +6298,12 @@ void tTJSNI_BaseLayer::Draw_GPU(tTVPDrawable *target, int x, int y,
     tTVPRect rctar(rect);
     rctar.set_offsets(x, y);
 
-    CurrentDrawTarget = target;
+    ds.CurrentDrawTarget = target;
 
     ParentRectToChildRect(rect); // to this layer based axis
 
     // process drawing
-    DirectTransferToParent = false;
+    ds.DirectTransferToParent = false;
 
     // caching is not enabled
 
@@ -6232,10 +6319,10 @@ void tTJSNI_BaseLayer::Draw_GPU(tTVPDrawable *target, int x, int y,
             // rearrange pipe line for transition
             bool useTemp = false;
             if(GetCacheEnabled()) {
-                UpdateBitmapForChild = CacheBitmap;
+                ds.UpdateBitmapForChild = CacheBitmap;
             } else {
                 useTemp = true;
-                UpdateBitmapForChild = tTVPTempBitmapHolder::GetTemp(
+                ds.UpdateBitmapForChild = tTVPTempBitmapHolder::GetTemp(
                     rect.get_width(), rect.get_height());
             }
             // copy self image to UpdateBitmapForChild
@@ -6245,7 +6332,7 @@ void tTJSNI_BaseLayer::Draw_GPU(tTVPDrawable *target, int x, int y,
                 // && UpdateExcludeRect.bottom >= rect.bottom &&
                 // rect.left >= UpdateExcludeRect.left && rect.right
                 // <= UpdateExcludeRect.right) { 				} else
-                CopySelfForRect(UpdateBitmapForChild, 0, 0,
+                CopySelfForRect(ds.UpdateBitmapForChild, 0, 0,
                                 rect); // transfer self image
             }
 
@@ -6257,24 +6344,26 @@ void tTJSNI_BaseLayer::Draw_GPU(tTVPDrawable *target, int x, int y,
                     continue;
 
                 // intersection check
-                if(!TVPIntersectRect(&UpdateRectForChild, rect, child->Rect))
+                if(!TVPIntersectRect(&ds.UpdateRectForChild, rect, child->Rect))
                     continue;
 
                 // setup UpdateOfsX/Y UpdateRectForChildOfsX/Y
-                UpdateOfsX = 0;
-                UpdateOfsY = 0;
-                UpdateRectForChildOfsX =
-                    UpdateRectForChild.left - child->Rect.left;
-                UpdateRectForChildOfsY =
-                    UpdateRectForChild.top - child->Rect.top;
+                ds.UpdateOfsX = 0;
+                ds.UpdateOfsY = 0;
+                ds.UpdateRectForChildOfsX =
+                    ds.UpdateRectForChild.left - child->Rect.left;
+                ds.UpdateRectForChildOfsY =
+                    ds.UpdateRectForChild.top - child->Rect.top;
 
                 // call children's "Draw" method
-                child->Draw_GPU((tTVPDrawable *)this, UpdateRectForChild.left,
-                                UpdateRectForChild.top, UpdateRectForChild);
+                child->Draw_GPU((tTVPDrawable *)this,
+                                ds.UpdateRectForChild.left,
+                                ds.UpdateRectForChild.top,
+                                ds.UpdateRectForChild);
             }
             TVP_LAYER_FOR_EACH_CHILD_END
             rect.set_offsets(0, 0);
-            target->DrawCompleted(rctar, UpdateBitmapForChild, rect,
+            target->DrawCompleted(rctar, ds.UpdateBitmapForChild, rect,
                                   DisplayType, Opacity);
             if(useTemp)
                 tTVPTempBitmapHolder::FreeTemp();
@@ -6283,7 +6372,7 @@ void tTJSNI_BaseLayer::Draw_GPU(tTVPDrawable *target, int x, int y,
         if(GetVisibleChildrenCount() == 0) {
             DrawSelf(target, rctar, rect);
         } else {
-            DrawnRegion.Clear();
+            ds.DrawnRegion.Clear();
             // send completion message to the target
 
             // 			if (UpdateExcludeRect.top <= rect.top &&
@@ -6315,12 +6404,13 @@ void tTJSNI_BaseLayer::Draw_GPU(tTVPDrawable *target, int x, int y,
         }
     }
 
-    CurrentDrawTarget = nullptr;
+    ds.CurrentDrawTarget = nullptr;
 }
 
 //---------------------------------------------------------------------------
 void tTJSNI_BaseLayer::InternalDrawNoCache_CPU(tTVPDrawable *target,
                                                const tTVPRect &rect) {
+    tDrawState &ds = GetDrawState();
     bool totalopaque = (DisplayType == ltOpaque && Opacity == 255);
     if(GetVisibleChildrenCount() == 0) {
         // no visible children; no action needed
@@ -6337,7 +6427,7 @@ void tTJSNI_BaseLayer::InternalDrawNoCache_CPU(tTVPDrawable *target,
         // clear DrawnRegion
         tTVPComplexRect::tIterator it;
 
-        DrawnRegion.Clear();
+        ds.DrawnRegion.Clear();
 
         it = overlapped.GetIterator();
         while(it.Step()) {
@@ -6353,13 +6443,13 @@ void tTJSNI_BaseLayer::InternalDrawNoCache_CPU(tTVPDrawable *target,
             // setup UpdateBitmapForChild and "updaterectforchild"
             if(totalopaque) {
                 // this layer is totally opaque
-                UpdateBitmapForChild =
+                ds.UpdateBitmapForChild =
                     target->GetDrawTargetBitmap(cr, updaterectforchild);
             } else {
                 // this layer is transparent
 
                 // retrieve temporary bitmap
-                UpdateBitmapForChild = tTVPTempBitmapHolder::GetTemp(
+                ds.UpdateBitmapForChild = tTVPTempBitmapHolder::GetTemp(
                     cr.get_width(), cr.get_height());
                 tempalloc = true;
                 updaterectforchild.left = 0;
@@ -6370,10 +6460,10 @@ void tTJSNI_BaseLayer::InternalDrawNoCache_CPU(tTVPDrawable *target,
 
             try {
                 // copy self image to the target
-                CopySelf(UpdateBitmapForChild, updaterectforchild.left,
+                CopySelf(ds.UpdateBitmapForChild, updaterectforchild.left,
                          updaterectforchild.top, cr);
 
-                TVP_LAYER_FOR_EACH_CHILD_BEGIN(child) {
+                TVP_LAYER_FOR_EACH_DRAW_CHILD_BEGIN(child) {
                     // for each child...
 
                     // visible check
@@ -6389,19 +6479,20 @@ void tTJSNI_BaseLayer::InternalDrawNoCache_CPU(tTVPDrawable *target,
                     tjs_int ox = chrect.left - cr.left;
                     tjs_int oy = chrect.top - cr.top;
 
-                    UpdateRectForChild = updaterectforchild;
-                    UpdateRectForChild.add_offsets(ox, oy);
-                    UpdateRectForChildOfsX = chrect.left - child->Rect.left;
-                    UpdateRectForChildOfsY = chrect.top - child->Rect.top;
+                    ds.UpdateRectForChild = updaterectforchild;
+                    ds.UpdateRectForChild.add_offsets(ox, oy);
+                    ds.UpdateRectForChildOfsX =
+                        chrect.left - child->Rect.left;
+                    ds.UpdateRectForChildOfsY = chrect.top - child->Rect.top;
 
                     // setup UpdateOfsX, UpdateOfsY
-                    UpdateOfsX = cr.left - updaterectforchild.left;
-                    UpdateOfsY = cr.top - updaterectforchild.top;
+                    ds.UpdateOfsX = cr.left - updaterectforchild.left;
+                    ds.UpdateOfsY = cr.top - updaterectforchild.top;
 
                     // call children's "Draw" method
                     child->Draw((tTVPDrawable *)this, chrect, true);
                 }
-                TVP_LAYER_FOR_EACH_CHILD_END
+                TVP_LAYER_FOR_EACH_DRAW_CHILD_END
 
             } catch(...) {
                 if(tempalloc)
@@ -6413,7 +6504,7 @@ void tTJSNI_BaseLayer::InternalDrawNoCache_CPU(tTVPDrawable *target,
             if(DisplayType != ltBinder) {
                 tTVPRect pr = cr;
                 pr.add_offsets(Rect.left, Rect.top);
-                target->DrawCompleted(pr, UpdateBitmapForChild,
+                target->DrawCompleted(pr, ds.UpdateBitmapForChild,
                                       updaterectforchild, DisplayType, Opacity);
             }
 
@@ -6424,7 +6515,7 @@ void tTJSNI_BaseLayer::InternalDrawNoCache_CPU(tTVPDrawable *target,
         } // overlapped region
 
         // process exposed region
-        DirectTransferToParent =
+        ds.DirectTransferToParent =
             true; // this flag is used only when MainImage == nullptr
 
         it = exposed.GetIterator();
@@ -6451,7 +6542,7 @@ void tTJSNI_BaseLayer::InternalDrawNoCache_CPU(tTVPDrawable *target,
 
                 tTVPRect updaterectforchild;
 
-                TVP_LAYER_FOR_EACH_CHILD_BEGIN(child) {
+                TVP_LAYER_FOR_EACH_DRAW_CHILD_BEGIN(child) {
                     // for each child...
 
                     // visible check
@@ -6466,10 +6557,10 @@ void tTJSNI_BaseLayer::InternalDrawNoCache_CPU(tTVPDrawable *target,
                     // call children's "Draw" method
                     child->Draw((tTVPDrawable *)this, chrect, true);
                 }
-                TVP_LAYER_FOR_EACH_CHILD_END
+                TVP_LAYER_FOR_EACH_DRAW_CHILD_END
             }
         }
-        DirectTransferToParent = false;
+        ds.DirectTransferToParent = false;
     } // has visible children/no visible children
 }
 //---------------------------------------------------------------------------
@@ -6490,7 +6581,9 @@ void tTJSNI_BaseLayer::Draw(tTVPDrawable *target, const tTVPRect &r,
     if(!TVPIntersectRect(&rect, rect, Rect))
         return; // no intersection
 
-    CurrentDrawTarget = target;
+    tDrawState &ds = GetDrawState();
+
+    ds.CurrentDrawTarget = target;
 
     ParentRectToChildRect(rect);
 
@@ -6501,7 +6594,7 @@ void tTJSNI_BaseLayer::Draw(tTVPDrawable *target, const tTVPRect &r,
     }
 
     // process drawing
-    DirectTransferToParent = false;
+    ds.DirectTransferToParent = false;
     bool totalopaque = (DisplayType == ltOpaque && Opacity == 255);
 
     if(GetCacheEnabled() &&
@@ -6517,47 +6610,47 @@ void tTJSNI_BaseLayer::Draw(tTVPDrawable *target, const tTVPRect &r,
                 continue;
 
             // clear DrawnRegion
-            DrawnRegion.Clear();
+            ds.DrawnRegion.Clear();
 
             // setup UpdateBitmapForChild
-            UpdateBitmapForChild = CacheBitmap;
+            ds.UpdateBitmapForChild = CacheBitmap;
 
             // copy self image to UpdateBitmapForChild
             if(MainImage != nullptr) {
-                CopySelf(UpdateBitmapForChild, cr.left, cr.top,
+                CopySelf(ds.UpdateBitmapForChild, cr.left, cr.top,
                          cr); // transfer self image
             }
 
-            TVP_LAYER_FOR_EACH_CHILD_BEGIN(child) {
+            TVP_LAYER_FOR_EACH_DRAW_CHILD_BEGIN(child) {
                 // for each child...
 
                 // intersection check
-                if(!TVPIntersectRect(&UpdateRectForChild, cr, child->Rect))
+                if(!TVPIntersectRect(&ds.UpdateRectForChild, cr, child->Rect))
                     continue;
 
                 // setup UpdateOfsX/Y UpdateRectForChildOfsX/Y
-                UpdateOfsX = 0;
-                UpdateOfsY = 0;
-                UpdateRectForChildOfsX =
-                    UpdateRectForChild.left - child->Rect.left;
-                UpdateRectForChildOfsY =
-                    UpdateRectForChild.top - child->Rect.top;
+                ds.UpdateOfsX = 0;
+                ds.UpdateOfsY = 0;
+                ds.UpdateRectForChildOfsX =
+                    ds.UpdateRectForChild.left - child->Rect.left;
+                ds.UpdateRectForChildOfsY =
+                    ds.UpdateRectForChild.top - child->Rect.top;
 
                 // call children's "Draw" method
-                child->Draw((tTVPDrawable *)this, UpdateRectForChild, true);
+                child->Draw((tTVPDrawable *)this, ds.UpdateRectForChild, true);
             }
-            TVP_LAYER_FOR_EACH_CHILD_END
+            TVP_LAYER_FOR_EACH_DRAW_CHILD_END
 
             // special optimazation for MainImage == nullptr
 
             if(MainImage == nullptr) {
                 tTVPComplexRect nr;
                 nr.Or(cr);
-                nr.Sub(DrawnRegion);
+                nr.Sub(ds.DrawnRegion);
                 tTVPComplexRect::tIterator it = nr.GetIterator();
                 while(it.Step()) {
                     tTVPRect r(*it);
-                    CopySelf(UpdateBitmapForChild, r.left, r.top, r);
+                    CopySelf(ds.UpdateBitmapForChild, r.left, r.top, r);
                     // CopySelf of MainImage == nullptr actually
                     // fills target rectangle with full transparency
                 }
@@ -6593,7 +6686,7 @@ void tTJSNI_BaseLayer::Draw(tTVPDrawable *target, const tTVPRect &r,
             // clear DrawnRegion
             tTVPComplexRect::tIterator it;
 
-            DrawnRegion.Clear();
+            ds.DrawnRegion.Clear();
 
             it = overlapped.GetIterator();
             while(it.Step()) {
@@ -6609,13 +6702,13 @@ void tTJSNI_BaseLayer::Draw(tTVPDrawable *target, const tTVPRect &r,
                 // setup UpdateBitmapForChild and "updaterectforchild"
                 if(totalopaque) {
                     // this layer is totally opaque
-                    UpdateBitmapForChild =
+                    ds.UpdateBitmapForChild =
                         target->GetDrawTargetBitmap(cr, updaterectforchild);
                 } else {
                     // this layer is transparent
 
                     // retrieve temporary bitmap
-                    UpdateBitmapForChild = tTVPTempBitmapHolder::GetTemp(
+                    ds.UpdateBitmapForChild = tTVPTempBitmapHolder::GetTemp(
                         cr.get_width(), cr.get_height());
                     tempalloc = true;
                     updaterectforchild.left = 0;
@@ -6626,10 +6719,10 @@ void tTJSNI_BaseLayer::Draw(tTVPDrawable *target, const tTVPRect &r,
 
                 try {
                     // copy self image to the target
-                    CopySelf(UpdateBitmapForChild, updaterectforchild.left,
+                    CopySelf(ds.UpdateBitmapForChild, updaterectforchild.left,
                              updaterectforchild.top, cr);
 
-                    TVP_LAYER_FOR_EACH_CHILD_BEGIN(child) {
+                    TVP_LAYER_FOR_EACH_DRAW_CHILD_BEGIN(child) {
                         // for each child...
 
                         // visible check
@@ -6645,19 +6738,21 @@ void tTJSNI_BaseLayer::Draw(tTVPDrawable *target, const tTVPRect &r,
                         tjs_int ox = chrect.left - cr.left;
                         tjs_int oy = chrect.top - cr.top;
 
-                        UpdateRectForChild = updaterectforchild;
-                        UpdateRectForChild.add_offsets(ox, oy);
-                        UpdateRectForChildOfsX = chrect.left - child->Rect.left;
-                        UpdateRectForChildOfsY = chrect.top - child->Rect.top;
+                        ds.UpdateRectForChild = updaterectforchild;
+                        ds.UpdateRectForChild.add_offsets(ox, oy);
+                        ds.UpdateRectForChildOfsX =
+                            chrect.left - child->Rect.left;
+                        ds.UpdateRectForChildOfsY =
+                            chrect.top - child->Rect.top;
 
                         // setup UpdateOfsX, UpdateOfsY
-                        UpdateOfsX = cr.left - updaterectforchild.left;
-                        UpdateOfsY = cr.top - updaterectforchild.top;
+                        ds.UpdateOfsX = cr.left - updaterectforchild.left;
+                        ds.UpdateOfsY = cr.top - updaterectforchild.top;
 
                         // call children's "Draw" method
                         child->Draw((tTVPDrawable *)this, chrect, true);
                     }
-                    TVP_LAYER_FOR_EACH_CHILD_END
+                    TVP_LAYER_FOR_EACH_DRAW_CHILD_END
 
                 } catch(...) {
                     if(tempalloc)
@@ -6669,7 +6764,7 @@ void tTJSNI_BaseLayer::Draw(tTVPDrawable *target, const tTVPRect &r,
                 if(DisplayType != ltBinder) {
                     tTVPRect pr = cr;
                     pr.add_offsets(Rect.left, Rect.top);
-                    target->DrawCompleted(pr, UpdateBitmapForChild,
+                    target->DrawCompleted(pr, ds.UpdateBitmapForChild,
                                           updaterectforchild, DisplayType,
                                           Opacity);
                 }
@@ -6681,7 +6776,7 @@ void tTJSNI_BaseLayer::Draw(tTVPDrawable *target, const tTVPRect &r,
             } // overlapped region
 
             // process exposed region
-            DirectTransferToParent = true; // this flag is used only when
+            ds.DirectTransferToParent = true; // this flag is used only when
                                            // MainImage == nullptr
 
             it = exposed.GetIterator();
@@ -6708,7 +6803,7 @@ void tTJSNI_BaseLayer::Draw(tTVPDrawable *target, const tTVPRect &r,
 
                     tTVPRect updaterectforchild;
 
-                    TVP_LAYER_FOR_EACH_CHILD_BEGIN(child) {
+                    TVP_LAYER_FOR_EACH_DRAW_CHILD_BEGIN(child) {
                         // for each child...
 
                         // visible check
@@ -6723,37 +6818,38 @@ void tTJSNI_BaseLayer::Draw(tTVPDrawable *target, const tTVPRect &r,
                         // call children's "Draw" method
                         child->Draw((tTVPDrawable *)this, chrect, true);
                     }
-                    TVP_LAYER_FOR_EACH_CHILD_END
+                    TVP_LAYER_FOR_EACH_DRAW_CHILD_END
                 }
             }
-            DirectTransferToParent = false;
+            ds.DirectTransferToParent = false;
         } // has visible children/no visible children
     } // cache enabled/disabled
 
-    CurrentDrawTarget = nullptr;
+    ds.CurrentDrawTarget = nullptr;
 }
 
 //---------------------------------------------------------------------------
 tTVPBaseTexture *tTJSNI_BaseLayer::GetDrawTargetBitmap(const tTVPRect &rect,
                                                        tTVPRect &cliprect) {
     // called from children to get the image buffer drawn to.
+    tDrawState &ds = GetDrawState();
     if(DisplayType == ltBinder ||
-       (MainImage == nullptr && DirectTransferToParent)) {
+       (MainImage == nullptr && ds.DirectTransferToParent)) {
         tTVPRect _rect(rect);
         _rect.add_offsets(Rect.left, Rect.top);
         tTVPBaseTexture *bmp =
-            CurrentDrawTarget->GetDrawTargetBitmap(_rect, cliprect);
+            ds.CurrentDrawTarget->GetDrawTargetBitmap(_rect, cliprect);
         return bmp;
     }
     tjs_int w = rect.get_width();
     tjs_int h = rect.get_height();
-    if(UpdateRectForChild.get_width() < w ||
-       UpdateRectForChild.get_height() < h)
+    if(ds.UpdateRectForChild.get_width() < w ||
+       ds.UpdateRectForChild.get_height() < h)
         TVPThrowExceptionMessage(TVPInternalError);
-    cliprect = UpdateRectForChild;
-    cliprect.add_offsets(rect.left - UpdateRectForChildOfsX,
-                         rect.top - UpdateRectForChildOfsY);
-    return UpdateBitmapForChild;
+    cliprect = ds.UpdateRectForChild;
+    cliprect.add_offsets(rect.left - ds.UpdateRectForChildOfsX,
+                         rect.top - ds.UpdateRectForChildOfsY);
+    return ds.UpdateBitmapForChild;
 }
 
 //---------------------------------------------------------------------------
@@ -6772,23 +6868,24 @@ void tTJSNI_BaseLayer::DrawCompleted(const tTVPRect &destrect,
     // called from children to notify that the image drawing is
     // completed. blend the image to the target unless bmp is the same
     // as UpdateBitmapForChild.
+    tDrawState &ds = GetDrawState();
     if(DisplayType == ltBinder ||
-       (MainImage == nullptr && DirectTransferToParent)) {
+       (MainImage == nullptr && ds.DirectTransferToParent)) {
         tTVPRect _destrect(destrect);
         tTVPRect _cliprect(cliprect);
         _destrect.add_offsets(Rect.left, Rect.top);
-        CurrentDrawTarget->DrawCompleted(_destrect, bmp, _cliprect, type,
+        ds.CurrentDrawTarget->DrawCompleted(_destrect, bmp, _cliprect, type,
                                          opacity);
         return;
     }
 
-    if(bmp != UpdateBitmapForChild) {
+    if(bmp != ds.UpdateBitmapForChild) {
         if(MainImage == nullptr) {
             // special optimization for MainImage == nullptr
             // (all the layer face is treated as transparent)
             tTVPComplexRect nr; // new region
             nr.Or(destrect);
-            nr.Sub(DrawnRegion);
+            nr.Sub(ds.DrawnRegion);
             tTVPComplexRect opr; // operation region
             // now nr is a client region which is not overlapped by
             // children at this time
@@ -6804,8 +6901,9 @@ void tTJSNI_BaseLayer::DrawCompleted(const tTVPRect &destrect,
                     sr.right = sr.left + r.get_width();
                     sr.bottom = sr.top + r.get_height();
 
-                    UpdateBitmapForChild->CopyRect(r.left - UpdateOfsX,
-                                                   r.top - UpdateOfsY, bmp, sr);
+                    ds.UpdateBitmapForChild->CopyRect(r.left - ds.UpdateOfsX,
+                                                      r.top - ds.UpdateOfsY,
+                                                      bmp, sr);
                 }
                 // calculate operation region
                 opr.Or(destrect);
@@ -6815,9 +6913,9 @@ void tTJSNI_BaseLayer::DrawCompleted(const tTVPRect &destrect,
                 tTVPComplexRect::tIterator it = nr.GetIterator();
                 while(it.Step()) {
                     tTVPRect r(*it);
-                    r.add_offsets(-UpdateOfsX, -UpdateOfsY);
+                    r.add_offsets(-ds.UpdateOfsX, -ds.UpdateOfsY);
                     // fill r with transparent color
-                    CopySelf(UpdateBitmapForChild, r.left, r.top, r);
+                    CopySelf(ds.UpdateBitmapForChild, r.left, r.top, r);
                     // CopySelf of MainImage == nullptr actually
                     // fills target rectangle with full transparency
                 }
@@ -6834,16 +6932,18 @@ void tTJSNI_BaseLayer::DrawCompleted(const tTVPRect &destrect,
                 sr.right = sr.left + r.get_width();
                 sr.bottom = sr.top + r.get_height();
 
-                BltImage(UpdateBitmapForChild, DisplayType, r.left - UpdateOfsX,
-                         r.top - UpdateOfsY, bmp, sr, type, opacity);
+                BltImage(ds.UpdateBitmapForChild, DisplayType,
+                         r.left - ds.UpdateOfsX, r.top - ds.UpdateOfsY, bmp,
+                         sr, type, opacity);
             }
 
             // update DrawnRegion
-            DrawnRegion.Or(destrect);
+            ds.DrawnRegion.Or(destrect);
         } else {
-            BltImage(UpdateBitmapForChild, DisplayType,
-                     destrect.left - UpdateOfsX, destrect.top - UpdateOfsY, bmp,
-                     cliprect, type, opacity);
+            BltImage(ds.UpdateBitmapForChild, DisplayType,
+                     destrect.left - ds.UpdateOfsX,
+                     destrect.top - ds.UpdateOfsY, bmp, cliprect, type,
+                     opacity);
         }
     }
 }
@@ -6863,6 +6963,7 @@ void tTJSNI_BaseLayer::InternalComplete2(tTVPComplexRect &updateregion,
     // caching.
 
     // tjs_int i;
+    std::vector<tTVPRect> stripes;
     tTVPComplexRect::tIterator it = updateregion.GetIterator();
     while(it.Step()) {
         tTVPRect r(*it);
@@ -6914,6 +7015,14 @@ void tTJSNI_BaseLayer::InternalComplete2(tTVPComplexRect &updateregion,
                     // call "Draw" to draw to the window
                     Draw(drawable, opr, false);
                 }
+            } else if(TVPGraphicSplitOperationType == gsotParallel) {
+                // non-interlaced; stripes are drawn later on the
+                // thread pool
+                for(y = r.top; y < r.bottom; y += oh) {
+                    opr.top = y;
+                    opr.bottom = (y + oh < r.bottom) ? y + oh : r.bottom;
+                    stripes.push_back(opr);
+                }
             } else if(TVPGraphicSplitOperationType == gsotSimple) {
                 // non-interlaced
                 for(y = r.top; y < r.bottom; y += oh) {
@@ -6959,9 +7068,104 @@ void tTJSNI_BaseLayer::InternalComplete2(tTVPComplexRect &updateregion,
         }
     }
 
+    if(!stripes.empty())
+        InternalComplete2_Parallel(stripes, drawable);
+
     updateregion.Clear();
 }
 
+//---------------------------------------------------------------------------
+bool tTJSNI_BaseLayer::CanDrawInParallel() {
+    // cached layers share CacheBitmap/CacheRecalcRegion among stripes,
+    // and transition handlers keep their own state; draw them serially.
+    if(GetCacheEnabled() || InTransition)
+        return false;
+
+    TVP_LAYER_FOR_EACH_CHILD_NOLOCK_BEGIN(child) {
+        if(child->IsSeen() && !child->CanDrawInParallel())
+            return false;
+    }
+    TVP_LAYER_FOR_EACH_CHILD_NOLOCK_END
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+void tTJSNI_BaseLayer::PrepareParallelDraw(
+    tjs_int slots, std::vector<tTJSNI_BaseLayer *> &locked) {
+    // do everything that lazily modifies the layer here, on the main
+    // thread, so that Draw() only reads the layer tree from the slots.
+    Children.SafeLock();
+    locked.push_back(this);
+
+    if((tjs_int)ParallelDrawStates.size() < slots)
+        ParallelDrawStates.resize(slots);
+
+    if(GetVisibleChildrenCount()) {
+        GetOverlappedRegion();
+        GetExposedRegion();
+    }
+
+    tjs_int count = Children.GetSafeLockedObjectCount();
+    for(tjs_int i = 0; i < count; i++) {
+        tTJSNI_BaseLayer *child = Children.GetSafeLockedObjectAt(i);
+        if(child && child->IsSeen())
+            child->PrepareParallelDraw(slots, locked);
+    }
+}
+
+//---------------------------------------------------------------------------
+void tTJSNI_BaseLayer::InternalComplete2_Parallel(
+    const std::vector<tTVPRect> &stripes, tTVPDrawable *drawable) {
+    // the stripes do not overlap each other, so they can be drawn into
+    // the layer manager's draw buffer at the same time.
+    bool parallel = stripes.size() > 1 && TVPGetThreadNum() > 1 &&
+        Manager && drawable == (tTVPDrawable *)Manager &&
+        CanDrawInParallel();
+
+    if(parallel) {
+        // the draw buffer must not be (re)created nor resized while the
+        // stripes are drawn
+        tjs_int w, h;
+        tTVPBaseTexture *buffer = Manager->GetOrCreateDrawBuffer();
+        parallel = buffer && Manager->GetPrimaryLayerSize(w, h) &&
+            (tjs_int)buffer->GetWidth() >= w &&
+            (tjs_int)buffer->GetHeight() >= h;
+        if(parallel)
+            buffer->Independ();
+    }
+
+    if(!parallel) {
+        for(const tTVPRect &r : stripes)
+            Draw(drawable, r, false);
+        return;
+    }
+
+    tTVPTempBitmapHolder::PrepareParallel();
+
+    std::vector<tTJSNI_BaseLayer *> locked;
+    std::exception_ptr error;
+    try {
+        PrepareParallelDraw(TVPGetThreadNum(), locked);
+
+        TVPExecDrawSlotTask((int)stripes.size(), [&](int i) {
+            Draw(drawable, stripes[i], false);
+        });
+    } catch(...) {
+        error = std::current_exception();
+    }
+
+    for(tTJSNI_BaseLayer *layer : locked) {
+        layer->Children.SafeUnlock();
+        layer->ChildrenArrayValid = false;
+        layer->ChildrenOrderIndexValid = false;
+    }
+    Manager->InvalidateOverallIndex();
+
+    if(error)
+        std::rethrow_exception(error);
+}
+
 //---------------------------------------------------------------------------
 void tTJSNI_BaseLayer::InternalComplete2_GPU(tTVPRect updateregion,
                                              tTVPDrawable *drawable) {
@@ -11028,6 +11232,15 @@ void tTJSNI_Font::GetFontGlyphDrawRect(const ttstr &text, tTVPRect &area) {
     }
 }
 
+//---------------------------------------------------------------------------
+void tTJSNI_Font::PrepareText(const ttstr &text, bool aa, tjs_int shlevel,
+                              tjs_int shwidth) {
+    // the characters are rasterized for the bitmap of the layer; a font
+    // without a layer has nothing to prepare
+    if(Layer)
+        Layer->PrepareText(text, aa, shlevel, shwidth);
+}
+
 //---------------------------------------------------------------------------
 extern void TVPGetAllFontList(std::vector<ttstr> &list);
 
@@ -11185,6 +11398,26 @@ tTJSNC_Font::tTJSNC_Font() : tTJSNativeClass(TJS_W("Font")) {
     }
     TJS_END_NATIVE_METHOD_DECL(/*func. name*/ getGlyphDrawRect)
     //----------------------------------------------------------------------
+    TJS_BEGIN_NATIVE_METHOD_DECL(/*func. name*/ prepareText) {
+        TJS_GET_NATIVE_INSTANCE(/*var. name*/ _this,
+                                /*var. type*/ tTJSNI_Font);
+        if(numparams < 1)
+            return TJS_E_BADPARAMCOUNT;
+
+        _this->PrepareText(
+            *param[0],
+            (numparams >= 2 && param[1]->Type() != tvtVoid)
+                ? param[1]->operator bool()
+                : true,
+            (numparams >= 3 && param[2]->Type() != tvtVoid) ? (tjs_int)*param[2]
+                                                            : 0,
+            (numparams >= 4 && param[3]->Type() != tvtVoid) ? (tjs_int)*param[3]
+                                                            : 0);
+
+        return TJS_S_OK;
+    }
+    TJS_END_NATIVE_METHOD_DECL(/*func. name*/ prepareText)
+    //----------------------------------------------------------------------
     TJS_BEGIN_NATIVE_METHOD_DECL(/*func. name*/ doUserSelect) {
         TJS_GET_NATIVE_INSTANCE(/*var. name*/ _this,
                                 /*var. type*/ tTJSNI_Font);
@@ -19,6 +19,8 @@
 #include "TransIntf.h"
 #include "EventIntf.h"
 #include "ObjectList.h"
+#include "ThreadIntf.h"
+#include <vector>
 
 //---------------------------------------------------------------------------
 // global flags
@@ -46,7 +48,8 @@ enum tTVPGraphicSplitOperationType {
     gsotNone,
     gsotSimple,
     gsotInterlace,
-    gsotBiDirection
+    gsotBiDirection,
+    gsotParallel // stripes are composited on the thread pool
 };
 extern tTVPGraphicSplitOperationType TVPGraphicSplitOperationType;
 extern bool TVPDefaultHoldAlpha;
@@ -900,6 +903,8 @@ public:
     double GetEscHeightX(const ttstr &text);
     double GetEscHeightY(const ttstr &text);
     void GetFontGlyphDrawRect(const ttstr &text, tTVPRect &area);
+    void PrepareText(const ttstr &text, bool aa, tjs_int shlevel,
+                     tjs_int shwidth);
     // 	bool DoUserFontSelect(tjs_uint32 flags, const ttstr &caption,
     // 		const ttstr &prompt, const ttstr &samplestring);
 
@@ -915,21 +920,32 @@ public:
     //------------------------------------------------ updating
     // management --
 protected:
-    tjs_int UpdateOfsX, UpdateOfsY;
-    tTVPRect UpdateRectForChild; // to be used in
-                                 // tTVPDrawable::GetDrawTargetBitmap
-    tjs_int UpdateRectForChildOfsX;
-    tjs_int UpdateRectForChildOfsY;
-    tTVPDrawable *CurrentDrawTarget; // set by Draw
-    tTVPBaseTexture *UpdateBitmapForChild; // to be used in
-                                           // tTVPDrawable::GetDrawTargetBitmap
+    struct tDrawState {
+        // state of the drawing pipe line, one per draw slot
+        tjs_int UpdateOfsX, UpdateOfsY;
+        tTVPRect UpdateRectForChild; // to be used in
+                                     // tTVPDrawable::GetDrawTargetBitmap
+        tjs_int UpdateRectForChildOfsX;
+        tjs_int UpdateRectForChildOfsY;
+        tTVPDrawable *CurrentDrawTarget; // set by Draw
+        tTVPBaseTexture *UpdateBitmapForChild; // to be used in
+                                               // tTVPDrawable::GetDrawTargetBitmap
+        tTVPComplexRect DrawnRegion; // region that is already marked as
+                                     // "blitted"
+        bool DirectTransferToParent; // child image should be directly
+                                     // transfered into parent
+    };
+    tDrawState DrawState; // for the serial pipe line (draw slot 0)
+    std::vector<tDrawState> ParallelDrawStates; // for draw slot 1 and later
+    tDrawState &GetDrawState() {
+        tjs_int slot = TVPGetDrawSlot();
+        return slot ? ParallelDrawStates[slot - 1] : DrawState;
+    }
+
     tTVPRect UpdateExcludeRect; // rectangle whose update is not be needed
 
     tTVPComplexRect CacheRecalcRegion; // region that must be
                                        // reconstructed for cache
-    tTVPComplexRect DrawnRegion; // region that is already marked as "blitted"
-    bool DirectTransferToParent; // child image should be directly
-                                 // transfered into parent
 
     bool CallOnPaint; // call onPaint event when flaged
 
@@ -1000,6 +1016,11 @@ private:
                        const tTVPRect &cliprect, tTVPLayerType type,
                        tjs_int opacity) override;
 
+    bool CanDrawInParallel();
+    void PrepareParallelDraw(tjs_int slots,
+                             std::vector<tTJSNI_BaseLayer *> &locked);
+    void InternalComplete2_Parallel(const std::vector<tTVPRect> &stripes,
+                                    tTVPDrawable *drawable);
     void InternalComplete2(tTVPComplexRect &updateregion,
                            tTVPDrawable *drawable);
     void InternalComplete2_GPU(tTVPRect updateregion, tTVPDrawable *drawable);
@@ -1165,6 +1186,8 @@ public:
     double GetEscHeightX(const ttstr &text);
     double GetEscHeightY(const ttstr &text);
     void GetFontGlyphDrawRect(const ttstr &text, tTVPRect &area);
+    void PrepareText(const ttstr &text, bool aa, tjs_int shlevel,
+                     tjs_int shwidth);
 
     void GetFontList(tjs_uint32 flags, std::vector<ttstr> &list);
 
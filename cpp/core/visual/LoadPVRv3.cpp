@@ -378,7 +378,7 @@ void TVPSavePVRv3(void *formatdata, tTJSBinaryStream *dst,
         meta->EnumMembers(TJS_IGNOREPROP, &clo, meta);
     }
     tTVPMemoryStream memstr;
-    const void *pixeldata = image->GetScanLine(0);
+    const void *pixeldata = image->GetPixelData();
     int w = image->GetWidth(), h = image->GetHeight(),
         pitch = image->GetPitchBytes();
     PVR3TexturePixelFormat pixelFormat = PVR3TexturePixelFormat::RGBA8888;
@@ -15,8 +15,10 @@
 #include "tjsUtils.h"
 #include "tvpgl.h"
 #include "tjsDictionary.h"
+#include "ThreadIntf.h"
 
 #include <stdlib.h>
+#include <vector>
 
 /*
         TLG5:
@@ -69,46 +71,89 @@ void TVPLoadTLG5(void *formatdata, void *callbackdata,
     // decomperss
     sizecallback(callbackdata, width, height, colors == 3 ? gpfRGB : gpfRGBA);
 
-    tjs_uint8 *inbuf = nullptr;
-    tjs_uint8 *outbuf[4];
+    // the LZSS dictionary is shared thru all blocks, so blocks must be
+    // decompressed in order. a batch of blocks is decompressed on the
+    // thread pool while the previous batch is being composed.
+    tjs_int batch_blocks = (64 + blockheight - 1) / blockheight;
+    if(batch_blocks > blockcount)
+        batch_blocks = blockcount;
+    tjs_int batch_count = (blockcount - 1) / batch_blocks + 1;
+    tjs_int block_bytes = blockheight * width;
+
+    std::vector<tjs_uint8> inbuf; // data of one batch
+    struct tBlockData {
+        size_t Offset;
+        tjs_int Size;
+        bool Compressed;
+    };
+    std::vector<tBlockData> blockdata; // for each block and color
+    tjs_uint8 *outbuf[2][4]; // double buffered
     tjs_uint8 *text = nullptr;
     tjs_int r = 0;
-    for(int i = 0; i < colors; i++)
-        outbuf[i] = nullptr;
+    for(int i = 0; i < 4; i++)
+        outbuf[0][i] = outbuf[1][i] = nullptr;
 
     try {
         text = (tjs_uint8 *)TJSAlignedAlloc(4096 + 32, 4) + 16;
         memset(text, 0, 4096);
 
-        inbuf = (tjs_uint8 *)TJSAlignedAlloc(blockheight * width + 10 + 16, 4);
         for(tjs_int i = 0; i < colors; i++)
-            outbuf[i] =
-                (tjs_uint8 *)TJSAlignedAlloc(blockheight * width + 10 + 16, 4);
-
-        tjs_uint8 *prevline = nullptr;
-        for(tjs_int y_blk = 0; y_blk < height; y_blk += blockheight) {
-            // read file and decompress
-            for(tjs_int c = 0; c < colors; c++) {
-                src->ReadBuffer(mark, 1);
-                tjs_int size;
-                size = src->ReadI32LE();
-                if(mark[0] == 0) {
-                    // modified LZSS compressed data
-                    src->ReadBuffer(inbuf, size);
-                    r = TVPTLG5DecompressSlide(outbuf[c], inbuf, size, text, r);
-                } else {
-                    // raw data
-                    src->ReadBuffer(outbuf[c], size);
+            for(tjs_int j = 0; j < 2; j++)
+                outbuf[j][i] = (tjs_uint8 *)TJSAlignedAlloc(
+                    block_bytes * batch_blocks + 10 + 16, 4);
+
+        auto read_batch = [&](tjs_int batch) {
+            // read file
+            inbuf.clear();
+            blockdata.clear();
+            tjs_int blk_lim = (batch + 1) * batch_blocks;
+            if(blk_lim > blockcount)
+                blk_lim = blockcount;
+            for(tjs_int blk = batch * batch_blocks; blk < blk_lim; blk++) {
+                for(tjs_int c = 0; c < colors; c++) {
+                    src->ReadBuffer(mark, 1);
+                    tBlockData data;
+                    data.Size = src->ReadI32LE();
+                    // mark 0 : modified LZSS compressed data, others : raw
+                    data.Compressed = mark[0] == 0;
+                    if(data.Size < 0 || data.Size > block_bytes + 10)
+                        TVPThrowExceptionMessage(
+                            TVPTLGLoadError,
+                            (const tjs_char *)TVPFileReadError);
+                    data.Offset = inbuf.size();
+                    inbuf.resize(data.Offset + data.Size);
+                    src->ReadBuffer(inbuf.data() + data.Offset, data.Size);
+                    blockdata.push_back(data);
                 }
             }
+        };
+
+        auto decompress_batch = [&](tjs_int batch, tjs_int blocks) {
+            // decompress
+            for(tjs_int i = 0; i < blocks; i++) {
+                for(tjs_int c = 0; c < colors; c++) {
+                    const tBlockData &data = blockdata[i * colors + c];
+                    tjs_uint8 *out = outbuf[batch & 1][c] + i * block_bytes;
+                    if(data.Compressed)
+                        r = TVPTLG5DecompressSlide(out,
+                                                   inbuf.data() + data.Offset,
+                                                   data.Size, text, r);
+                    else
+                        memcpy(out, inbuf.data() + data.Offset, data.Size);
+                }
+            }
+        };
 
+        tjs_uint8 *prevline = nullptr;
+        auto compose_batch = [&](tjs_int batch) {
             // compose colors and store
-            tjs_int y_lim = y_blk + blockheight;
+            tjs_int y_blk = batch * batch_blocks * blockheight;
+            tjs_int y_lim = y_blk + batch_blocks * blockheight;
             if(y_lim > height)
                 y_lim = height;
             tjs_uint8 *outbufp[4];
             for(tjs_int c = 0; c < colors; c++)
-                outbufp[c] = outbuf[c];
+                outbufp[c] = outbuf[batch & 1][c];
             for(tjs_int y = y_blk; y < y_lim; y++) {
                 tjs_uint8 *current =
                     (tjs_uint8 *)scanlinecallback(callbackdata, y);
@@ -177,24 +222,41 @@ void TVPLoadTLG5(void *formatdata, void *callbackdata,
 
                 prevline = current_org;
             }
+        };
+
+        for(tjs_int batch = 0; batch <= batch_count; batch++) {
+            tjs_int blocks = 0;
+            if(batch < batch_count) {
+                blocks = blockcount - batch * batch_blocks;
+                if(blocks > batch_blocks)
+                    blocks = batch_blocks;
+                read_batch(batch);
+            }
+
+            TVPExecThreadTask(2, [&](int task) {
+                if(task == 0) {
+                    if(batch > 0)
+                        compose_batch(batch - 1);
+                } else {
+                    decompress_batch(batch, blocks);
+                }
+            });
         }
     } catch(...) {
-        if(inbuf)
-            TJSAlignedDealloc(inbuf);
         if(text)
             TJSAlignedDealloc(text - 16);
         for(tjs_int i = 0; i < colors; i++)
-            if(outbuf[i])
-                TJSAlignedDealloc(outbuf[i]);
+            for(tjs_int j = 0; j < 2; j++)
+                if(outbuf[j][i])
+                    TJSAlignedDealloc(outbuf[j][i]);
         throw;
     }
-    if(inbuf)
-        TJSAlignedDealloc(inbuf);
     if(text)
         TJSAlignedDealloc(text - 16);
     for(tjs_int i = 0; i < colors; i++)
-        if(outbuf[i])
-            TJSAlignedDealloc(outbuf[i]);
+        for(tjs_int j = 0; j < 2; j++)
+            if(outbuf[j][i])
+                TJSAlignedDealloc(outbuf[j][i]);
 }
 //---------------------------------------------------------------------------
 
@@ -240,9 +302,8 @@ void TVPLoadTLG6(void *formatdata, void *callbackdata,
     width = src->ReadI32LE();
     height = src->ReadI32LE();
 
-    tjs_int max_bit_length;
-
-    max_bit_length = src->ReadI32LE();
+    // max bit length; golomb codes are buffered per batch
+    src->ReadI32LE();
 
     // set destination size
     sizecallback(callbackdata, width, height, colors == 3 ? gpfRGB : gpfRGBA);
@@ -253,9 +314,20 @@ void TVPLoadTLG6(void *formatdata, void *callbackdata,
     tjs_int main_count = width / TVP_TLG6_W_BLOCK_SIZE;
     tjs_int fraction = width - main_count * TVP_TLG6_W_BLOCK_SIZE;
 
+    // entropy decoding of each block row does not depend on the others;
+    // a batch of block rows is decoded on the thread pool while the
+    // previous batch is being reconstructed. reconstruction refers to the
+    // line above, so it stays serial.
+    tjs_int batch_rows = TVPGetThreadTaskNum();
+    if(batch_rows > y_block_count)
+        batch_rows = y_block_count;
+    tjs_int batch_count = (y_block_count - 1) / batch_rows + 1;
+    tjs_int row_pixels = width * TVP_TLG6_H_BLOCK_SIZE;
+
     // prepare memory pointers
-    tjs_uint8 *bit_pool = nullptr;
-    tjs_uint32 *pixelbuf = nullptr; // pixel buffer
+    std::vector<tjs_uint8> bit_pool; // golomb codes of one batch
+    std::vector<size_t> bit_offsets; // for each block row and color
+    tjs_uint32 *pixelbuf = nullptr; // pixel buffer, double buffered
     tjs_uint8 *filter_types = nullptr;
     tjs_uint8 *LZSS_text = nullptr;
     tjs_uint32 *zeroline = nullptr;
@@ -264,9 +336,10 @@ void TVPLoadTLG6(void *formatdata, void *callbackdata,
     tjs_uint8 *grayline;
     try {
         // allocate memories
-        bit_pool = (tjs_uint8 *)TJSAlignedAlloc(max_bit_length / 8 + 5, 4);
         pixelbuf = (tjs_uint32 *)TJSAlignedAlloc(
-            sizeof(tjs_uint32) * width * TVP_TLG6_H_BLOCK_SIZE + 1, 4);
+            sizeof(tjs_uint32) * row_pixels * batch_rows * 2 + 1, 4);
+        // unused color components must be zero for 1-color images
+        memset(pixelbuf, 0, sizeof(tjs_uint32) * row_pixels * batch_rows * 2);
         filter_types =
             (tjs_uint8 *)TJSAlignedAlloc(x_block_count * y_block_count + 16, 4);
         zeroline = (tjs_uint32 *)TJSAlignedAlloc(width * sizeof(tjs_uint32), 4);
@@ -302,57 +375,78 @@ void TVPLoadTLG6(void *formatdata, void *callbackdata,
             TJSAlignedDealloc(inbuf);
         }
 
-        // for each horizontal block group ...
-        tjs_uint32 *prevline = zeroline;
-        for(tjs_int y = 0; y < height; y += TVP_TLG6_H_BLOCK_SIZE) {
-            tjs_int ylim = y + TVP_TLG6_H_BLOCK_SIZE;
-            if(ylim >= height)
-                ylim = height;
-
-            tjs_int pixel_count = (ylim - y) * width;
-
-            // decode values
-            for(tjs_int c = 0; c < colors; c++) {
-                // read bit length
-                tjs_int bit_length = src->ReadI32LE();
-
-                // get compress method
-                int method = (bit_length >> 30) & 3;
-                bit_length &= 0x3fffffff;
-
-                // compute byte length
-                tjs_int byte_length = bit_length / 8;
-                if(bit_length % 8)
-                    byte_length++;
-
-                // read source from input
-                src->ReadBuffer(bit_pool, byte_length);
-
-                // decode values
-                // two most significant bits of bitlength are
-                // entropy coding method;
-                // 00 means Golomb method,
-                // 01 means Gamma method (not yet suppoted),
-                // 10 means modified LZSS method (not yet supported),
-                // 11 means raw (uncompressed) data (not yet
-                // supported).
-
-                switch(method) {
-                    case 0:
-                        if(c == 0 && colors != 1)
-                            TVPTLG6DecodeGolombValuesForFirst(
-                                (tjs_int8 *)pixelbuf, pixel_count, bit_pool);
-                        else
-                            TVPTLG6DecodeGolombValues((tjs_int8 *)pixelbuf + c,
-                                                      pixel_count, bit_pool);
-                        break;
-                    default:
+        auto read_batch = [&](tjs_int batch) {
+            // read golomb codes of the block rows in the batch
+            bit_pool.clear();
+            bit_offsets.clear();
+            tjs_int yb_lim = (batch + 1) * batch_rows;
+            if(yb_lim > y_block_count)
+                yb_lim = y_block_count;
+            for(tjs_int yb = batch * batch_rows; yb < yb_lim; yb++) {
+                for(tjs_int c = 0; c < colors; c++) {
+                    // read bit length
+                    tjs_int bit_length = src->ReadI32LE();
+
+                    // get compress method
+                    int method = (bit_length >> 30) & 3;
+                    bit_length &= 0x3fffffff;
+
+                    // two most significant bits of bitlength are
+                    // entropy coding method;
+                    // 00 means Golomb method,
+                    // 01 means Gamma method (not yet suppoted),
+                    // 10 means modified LZSS method (not yet supported),
+                    // 11 means raw (uncompressed) data (not yet
+                    // supported).
+                    if(method != 0)
                         TVPThrowExceptionMessage(
                             TVPTLGLoadError,
                             (const tjs_char *)
                                 TVPUnsupportedEntropyCodingMethod);
+
+                    // compute byte length
+                    tjs_int byte_length = bit_length / 8;
+                    if(bit_length % 8)
+                        byte_length++;
+
+                    // read source from input
+                    size_t ofs = bit_pool.size();
+                    bit_offsets.push_back(ofs);
+                    bit_pool.resize(ofs + byte_length);
+                    src->ReadBuffer(bit_pool.data() + ofs, byte_length);
                 }
             }
+            // the decoder fetches 32bits at a time beyond the last code
+            bit_pool.resize(bit_pool.size() + 16);
+        };
+
+        auto decode_row = [&](tjs_int batch, tjs_int i) {
+            // decode values of the i-th block row in the batch
+            tjs_int y = (batch * batch_rows + i) * TVP_TLG6_H_BLOCK_SIZE;
+            tjs_int ylim = y + TVP_TLG6_H_BLOCK_SIZE;
+            if(ylim >= height)
+                ylim = height;
+            tjs_int pixel_count = (ylim - y) * width;
+            tjs_int8 *buf =
+                (tjs_int8 *)(pixelbuf +
+                             ((batch & 1) * batch_rows + i) * row_pixels);
+            for(tjs_int c = 0; c < colors; c++) {
+                tjs_uint8 *bits = bit_pool.data() + bit_offsets[i * colors + c];
+                if(c == 0 && colors != 1)
+                    TVPTLG6DecodeGolombValuesForFirst(buf, pixel_count, bits);
+                else
+                    TVPTLG6DecodeGolombValues(buf + c, pixel_count, bits);
+            }
+        };
+
+        tjs_uint32 *prevline = zeroline;
+        auto reconstruct_row = [&](tjs_int batch, tjs_int i) {
+            tjs_int y = (batch * batch_rows + i) * TVP_TLG6_H_BLOCK_SIZE;
+            tjs_int ylim = y + TVP_TLG6_H_BLOCK_SIZE;
+            if(ylim >= height)
+                ylim = height;
+            tjs_uint32 *rowbuf =
+                pixelbuf + ((batch & 1) * batch_rows + i) * row_pixels;
 
             // for each line
             unsigned char *ft =
@@ -382,7 +476,7 @@ void TVPLoadTLG6(void *formatdata, void *callbackdata,
                                      : TVP_TLG6_W_BLOCK_SIZE) *
                         (yy - y);
                     TVPTLG6DecodeLine(prevline, curline, width, main_count, ft,
-                                      skipbytes, pixelbuf + start,
+                                      skipbytes, rowbuf + start,
                                       colors == 3 ? 0xff000000 : 0, oddskip,
                                       dir);
                 }
@@ -394,7 +488,7 @@ void TVPLoadTLG6(void *formatdata, void *callbackdata,
                     int start = ww * (yy - y);
                     TVPTLG6DecodeLineGeneric(
                         prevline, curline, width, main_count, x_block_count, ft,
-                        skipbytes, pixelbuf + start,
+                        skipbytes, rowbuf + start,
                         colors == 3 ? 0xff000000 : 0, oddskip, dir);
                 }
 
@@ -406,10 +500,35 @@ void TVPLoadTLG6(void *formatdata, void *callbackdata,
                 }
                 scanlinecallback(callbackdata, -1);
             }
+        };
+
+        // for each batch of horizontal block groups ...
+        for(tjs_int batch = 0; batch <= batch_count; batch++) {
+            tjs_int rows = 0;
+            if(batch < batch_count) {
+                rows = y_block_count - batch * batch_rows;
+                if(rows > batch_rows)
+                    rows = batch_rows;
+                read_batch(batch);
+            }
+
+            // task 0 reconstructs the previous batch, others decode values
+            TVPExecThreadTask(1 + rows, [&](int task) {
+                if(task == 0) {
+                    if(batch > 0) {
+                        tjs_int prev_rows =
+                            y_block_count - (batch - 1) * batch_rows;
+                        if(prev_rows > batch_rows)
+                            prev_rows = batch_rows;
+                        for(tjs_int i = 0; i < prev_rows; i++)
+                            reconstruct_row(batch - 1, i);
+                    }
+                } else {
+                    decode_row(batch, task - 1);
+                }
+            });
         }
     } catch(...) {
-        if(bit_pool)
-            TJSAlignedDealloc(bit_pool);
         if(pixelbuf)
             TJSAlignedDealloc(pixelbuf);
         if(filter_types)
@@ -424,8 +543,6 @@ void TVPLoadTLG6(void *formatdata, void *callbackdata,
         }
         throw;
     }
-    if(bit_pool)
-        TJSAlignedDealloc(bit_pool);
     if(pixelbuf)
         TJSAlignedDealloc(pixelbuf);
     if(filter_types)
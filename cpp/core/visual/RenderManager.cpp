@@ -7,6 +7,9 @@ typedef cocos2d::Texture2D::PixelFormat CCPixelFormat;
 #include "tvpgl.h"
 #include <assert.h>
 #include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include "ThreadIntf.h"
 #include "argb.h"
 extern "C" {
@@ -27,6 +30,7 @@ extern "C" {
 #include "tjsHashSearch.h"
 #include "EventIntf.h"
 #include "lz4.h"
+#include "BitmapBitsAlloc.h"
 
 // #define USE_SWSCALE
 #define USE_CV_AFFINE
@@ -34,124 +38,19 @@ extern "C" {
 //---------------------------------------------------------------------------
 // heap allocation functions for bitmap bits
 //---------------------------------------------------------------------------
-typedef uint32_t tTJSPointerSizedInteger;
-// this must be a integer type that has the same size with the normal
-// pointer ( void *)
-//---------------------------------------------------------------------------
-#pragma pack(push, 1)
-struct tTVPLayerBitmapMemoryRecord {
-    void *alloc_ptr; // allocated pointer
-    tjs_uint size; // original bmp bits size, in bytes
-    tjs_uint32 sentinel_backup1; // sentinel value 1
-    tjs_uint32 sentinel_backup2; // sentinel value 2
-};
-#pragma pack(pop)
-
-#ifdef WIN32
-// #define CHECK_MEM_OVERRUN
-#define MEM_COMMIT 0x1000
-#define MEM_DECOMMIT 0x4000
-#define PAGE_NOACCESS 0x01
-#define PAGE_READWRITE 0x04
-#endif
-
-static uint64_t _totalVMemSize = 0;
+// the bits come from the pool of tTVPBitmapBitsAlloc shared with the layer
+// bitmaps, so that decompressed textures freed after a few frames are reused
+// instead of being allocated again.
+static std::atomic<uint64_t> _totalVMemSize{ 0 };
 
 //---------------------------------------------------------------------------
 static void *TVPAllocBitmapBits(tjs_uint size, tjs_uint width,
                                 tjs_uint height) {
-    if(size == 0)
-        return nullptr;
-
-#if defined(WIN32) && defined(CHECK_MEM_OVERRUN)
-    {
-        tjs_uint8 *ptr;
-        size += sizeof(tTVPLayerBitmapMemoryRecord);
-        uint32_t pagesize = (size + 4095) & ~4095;
-        ptr = (tjs_uint8 *)malloc(pagesize + 8192);
-        uint8_t *p = (uint8_t *)(((intptr_t)ptr + 4095) & ~4095);
-        tTVPLayerBitmapMemoryRecord *hdr =
-            (tTVPLayerBitmapMemoryRecord *)(p + pagesize - size);
-        DWORD old;
-        VirtualProtect(p + pagesize, 4096, PAGE_NOACCESS, &old);
-        hdr->alloc_ptr = ptr;
-        hdr->size = size;
-        return hdr + 1;
-    }
-#endif
-
-    tjs_uint8 *ptrorg, *ptr;
-    tjs_uint allocbytes = 16 + size + sizeof(tTVPLayerBitmapMemoryRecord) +
-        sizeof(tjs_uint32) * 2;
     TVPCheckMemory();
-    ptr = ptrorg = (tjs_uint8 *)malloc(allocbytes);
-    if(!ptr)
-        TVPThrowExceptionMessage(
-            TVPCannotAllocateBitmapBits, TJS_W("at TVPAllocBitmapBits"),
-            ttstr((tjs_int)allocbytes) + TJS_W("(") + ttstr((int)width) +
-                TJS_W("x") + ttstr((int)height) + TJS_W(")"));
-    // align to a paragraph ( 16-bytes )
-    ptr += 16 + sizeof(tTVPLayerBitmapMemoryRecord);
-    *reinterpret_cast<tTJSPointerSizedInteger *>(&ptr) >>= 4;
-    *reinterpret_cast<tTJSPointerSizedInteger *>(&ptr) <<= 4;
-
-    tTVPLayerBitmapMemoryRecord *record =
-        (tTVPLayerBitmapMemoryRecord *)(ptr -
-                                        sizeof(tTVPLayerBitmapMemoryRecord) -
-                                        sizeof(tjs_uint32));
-
-    // fill memory allocation record
-    record->alloc_ptr = (void *)ptrorg;
-    record->size = size;
-    record->sentinel_backup1 = rand() + (rand() << 16);
-    record->sentinel_backup2 = rand() + (rand() << 16);
-
-    // set sentinel
-    *(tjs_uint32 *)(ptr - sizeof(tjs_uint32)) = ~record->sentinel_backup1;
-    *(tjs_uint32 *)(ptr + size) = ~record->sentinel_backup2;
-    // Stored sentinels are nagated, to avoid that the sentinel
-    // backups in tTVPLayerBitmapMemoryRecord becomes the same value
-    // as the sentinels. This trick will make the detection of the
-    // memory corruption easier. Because on some occasions, running
-    // memory writing will write the same values at first sentinel and
-    // the tTVPLayerBitmapMemoryRecord.
-
-    // return buffer pointer
-    return ptr;
+    return tTVPBitmapBitsAlloc::Alloc(size, width, height);
 }
 //---------------------------------------------------------------------------
-static void TVPFreeBitmapBits(void *ptr) {
-    if(ptr) {
-#if defined(WIN32) && defined(CHECK_MEM_OVERRUN)
-        tjs_uint8 *p = ((tjs_uint8 *)ptr) - sizeof(tTVPLayerBitmapMemoryRecord);
-        tTVPLayerBitmapMemoryRecord *hdr = (tTVPLayerBitmapMemoryRecord *)p;
-        DWORD old;
-        VirtualProtect(p + hdr->size, 4096, PAGE_READWRITE, &old);
-        free(hdr->alloc_ptr);
-        return;
-#endif
-        // get memory allocation record pointer
-        tjs_uint8 *bptr = (tjs_uint8 *)ptr;
-        tTVPLayerBitmapMemoryRecord *record =
-            (tTVPLayerBitmapMemoryRecord *)(bptr -
-                                            sizeof(
-                                                tTVPLayerBitmapMemoryRecord) -
-                                            sizeof(tjs_uint32));
-
-        // check sentinel
-        if(~(*(tjs_uint32 *)(bptr - sizeof(tjs_uint32))) !=
-           record->sentinel_backup1)
-            TVPThrowExceptionMessage(
-                TJS_W("Layer bitmap: Buffer underrun detected. Check your "
-                      "drawing code!"));
-        if(~(*(tjs_uint32 *)(bptr + record->size)) != record->sentinel_backup2)
-            TVPThrowExceptionMessage(
-                TJS_W("Layer bitmap: Buffer overrun detected. Check your "
-                      "drawing code!"));
-
-        free(record->alloc_ptr);
-    }
-}
+static void TVPFreeBitmapBits(void *ptr) { tTVPBitmapBitsAlloc::Free(ptr); }
 //---------------------------------------------------------------------------
 
 #if 0
@@ -297,21 +196,26 @@ bool tTVPBitmap::Is8bit() const {
 //---------------------------------------------------------------------------
 
 static std::vector<iTVPTexture2D *> _toDeleteTextures;
+static std::mutex _toDeleteTexturesMutex;
 
 void iTVPTexture2D::RecycleProcess() {
-    for(iTVPTexture2D *tex : _toDeleteTextures) {
+    std::vector<iTVPTexture2D *> textures;
+    {
+        std::lock_guard<std::mutex> lock(_toDeleteTexturesMutex);
+        textures.swap(_toDeleteTextures);
+    }
+    for(iTVPTexture2D *tex : textures) {
         delete tex;
     }
-    _toDeleteTextures.clear();
 }
 static tTVPAtExit TVPReleaseTexture2D(TVP_ATEXIT_PRI_RELEASE + 500,
                                       iTVPTexture2D::RecycleProcess);
 
 void iTVPTexture2D::Release() {
-    if(RefCount == 1)
+    if(--RefCount == 0) {
+        std::lock_guard<std::mutex> lock(_toDeleteTexturesMutex);
         _toDeleteTextures.push_back(this);
-    else
-        --RefCount;
+    }
 }
 
 class iTVPSoftwareTexture2D : public iTVPTexture2D {
@@ -385,17 +289,31 @@ static const tjs_uint8 *_empty_line =
 
 class tTVPSoftwareTexture2D_compress : public tTVPSoftwareTexture2D_static,
                                        public tTVPContinuousEventCallbackIntf {
+    // the image is decompressed block by block, when a line of the block is
+    // read. the lines may be read from the threads drawing in parallel.
+    std::mutex DecodeMutex;
+    std::unique_ptr<std::atomic<bool>[]> LineDecoded; // for each line
+    std::atomic<tjs_uint> DecodedLines{ 0 };
+
+    // the continuous event hooks are not thread-safe
+    static std::mutex HookMutex;
+
 protected:
-    tjs_int PixelFrameLife = 0;
+    std::atomic<tjs_int> PixelFrameLife{ 0 };
 
     tTVPSoftwareTexture2D_compress(int pitch, unsigned int w, unsigned int h,
                                    TVPTextureFormat::e format) :
-        tTVPSoftwareTexture2D_static(nullptr, pitch, w, h, format) {}
+        tTVPSoftwareTexture2D_static(nullptr, pitch, w, h, format),
+        LineDecoded(new std::atomic<bool>[h]) {
+        for(unsigned int i = 0; i < h; ++i)
+            LineDecoded[i] = false;
+    }
 
     ~tTVPSoftwareTexture2D_compress() {
         if(BmpData) {
             TVPFreeBitmapBits(BmpData);
             BmpData = nullptr;
+            std::lock_guard<std::mutex> lock(HookMutex);
             TVPRemoveContinuousEventHook(this);
         }
     }
@@ -406,45 +324,72 @@ protected:
         return n < 0;
     }
 
-    // return filled lines
+    // decompresses the block which starts at "line"; returns filled lines
     virtual tjs_uint DecompressLineData(tjs_uint line, tjs_uint8 *buf) = 0;
 
-public:
-    virtual const void *GetPixelData() override {
-        if(!BmpData) {
-            BmpData =
-                (tjs_uint8 *)TVPAllocBitmapBits(Pitch * Height, Width, Height);
-            tjs_uint8 *dst = BmpData;
-            tjs_int w = Width *
-                (GetFormat() == TVPTextureFormat::RGBA ? sizeof(tjs_uint32)
-                                                       : sizeof(tjs_uint8));
-            tjs_uint8 *dstend = dst + Pitch * Height;
-            tjs_uint line = 0;
-            while(dst < dstend) {
-                tjs_uint decodedLines = DecompressLineData(line, dst);
-                dst += decodedLines * Pitch;
-                line += decodedLines;
+    // returns the first line of the block containing "line"
+    virtual tjs_uint GetBlockTop(tjs_uint line) { return line; }
+
+    void DecodeLines(tjs_uint top, tjs_uint bottom) {
+        // makes the lines from "top" to "bottom" - 1 ready
+        if(bottom > Height)
+            bottom = Height;
+        PixelFrameLife = 3; // free pixel if not used in next 3 frames
+        if(DecodedLines == Height)
+            return;
+        for(tjs_uint line = top; line < bottom; ++line) {
+            if(LineDecoded[line].load(std::memory_order_acquire))
+                continue;
+
+            std::lock_guard<std::mutex> lock(DecodeMutex);
+            if(!BmpData) {
+                BmpData = (tjs_uint8 *)TVPAllocBitmapBits(Pitch * Height,
+                                                          Width, Height);
+                std::lock_guard<std::mutex> hooklock(HookMutex);
+                TVPAddContinuousEventHook(this);
             }
+            if(LineDecoded[line].load(std::memory_order_relaxed))
+                continue;
+            tjs_uint blocktop = GetBlockTop(line);
+            tjs_uint n =
+                DecompressLineData(blocktop, BmpData + blocktop * Pitch);
+            for(tjs_uint i = blocktop; i < blocktop + n; ++i)
+                LineDecoded[i].store(true, std::memory_order_release);
+            DecodedLines += n;
+            line = blocktop + n - 1;
         }
-        if(PixelFrameLife == 0)
-            TVPAddContinuousEventHook(this);
-        PixelFrameLife = 3; // free pixel if not used in next 3 frames
+    }
+
+public:
+    virtual const void *GetPixelData() override {
+        DecodeLines(0, Height);
+        return BmpData;
+    }
+
+    virtual const void *GetPixelDataForLines(tjs_uint top,
+                                             tjs_uint bottom) override {
+        DecodeLines(top, bottom);
         return BmpData;
     }
 
     virtual void OnContinuousCallback(tjs_uint64 tick) override {
         if(--PixelFrameLife)
             return;
+        std::lock_guard<std::mutex> lock(DecodeMutex);
         if(BmpData) {
             TVPFreeBitmapBits(BmpData);
             BmpData = nullptr;
         }
+        for(tjs_uint i = 0; i < Height; ++i)
+            LineDecoded[i] = false;
+        DecodedLines = 0;
         PixelFrameLife = 0;
+        std::lock_guard<std::mutex> hooklock(HookMutex);
         TVPRemoveContinuousEventHook(this);
     }
 
     virtual uint32_t GetPoint(int x, int y) override {
-        GetPixelData();
+        DecodeLines(y, y + 1);
         if(Format == TVPTextureFormat::RGBA)
             return *((const tjs_uint32 *)(BmpData + y * Pitch) + x); // 32bpp
         else if(Format == TVPTextureFormat::Gray)
@@ -453,7 +398,7 @@ public:
     }
 
     virtual const void *GetScanLineForRead(tjs_uint l) override {
-        GetPixelData();
+        DecodeLines(l, l + 1);
         return BmpData + l * Pitch;
     }
 
@@ -483,6 +428,7 @@ public:
         return origTex;
     }
 };
+std::mutex tTVPSoftwareTexture2D_compress::HookMutex;
 
 class tTVPSoftwareTexture2D_half : public tTVPSoftwareTexture2D_compress {
     std::vector<const tjs_uint8 *> _scanline;
@@ -651,6 +597,13 @@ public:
         _totalVMemSize += DataSize;
     }
 
+    virtual tjs_uint GetBlockTop(tjs_uint line) override {
+        size_t n = line >> ShiftH;
+        if(n >= CompressedBlock.size())
+            n = CompressedBlock.size() - 1;
+        return (tjs_uint)(n << ShiftH);
+    }
+
     virtual tjs_uint DecompressLineData(tjs_uint line,
                                         tjs_uint8 *buf) override {
         size_t n = line >> ShiftH;
@@ -894,7 +847,7 @@ public:
                 tex->GetPitch();
 #endif
             if(pitch) {
-                Update(tex->GetScanLineForRead(0), tex->GetFormat(), pitch,
+                Update(tex->GetPixelData(), tex->GetFormat(), pitch,
                        tTVPRect(0, 0, tex->GetWidth(), tex->GetHeight()));
             } else {
                 h = std::min(h, tex->GetHeight());
@@ -966,6 +919,21 @@ public:
     }
 };
 
+// a render method parameter kept per draw slot. parallel layer compositing
+// shares one method between its threads, so each thread sets and reads the
+// parameter of its own slot.
+template <typename T>
+class tTVPRenderMethodParam {
+    T Value[TVPMaxDrawSlot];
+
+public:
+    operator T() const { return Value[TVPGetDrawSlot()]; }
+    tTVPRenderMethodParam &operator=(const T &v) {
+        Value[TVPGetDrawSlot()] = v;
+        return *this;
+    }
+};
+
 class tTVPRenderMethod_Software : public iTVPRenderMethod {
     uint32_t _nameHash = 0;
 
@@ -988,8 +956,8 @@ template <typename TSrc, typename TDst,
           void (*&FuncWithoutOpa)(TDst *, const TSrc *, tjs_int, tjs_uint32)>
 class tTVPRenderMethod_ColorOpacity : public tTVPRenderMethod_Software {
 public:
-    int opa;
-    tjs_uint32 color;
+    tTVPRenderMethodParam<int> opa;
+    tTVPRenderMethodParam<tjs_uint32> color;
 
     virtual int EnumParameterID(const char *name) {
         if(!strcmp(name, "opacity"))
@@ -1033,7 +1001,7 @@ public:
 
 class tTVPRenderMethod_RemoveOpacity : public tTVPRenderMethod_Software {
 public:
-    int opa;
+    tTVPRenderMethodParam<int> opa;
     virtual int EnumParameterID(const char *name) {
         if(!strcmp(name, "opacity"))
             return 0;
@@ -1074,8 +1042,9 @@ public:
 };
 
 static tjs_int GetAdaptiveThreadNum(tjs_int pixelNum, float factor) {
+    // more slices than threads; the thread pool balances uneven rows
     if(pixelNum >= factor * 500)
-        return TVPGetThreadNum();
+        return TVPGetThreadTaskNum();
     else
         return 1;
 }
@@ -1091,7 +1060,7 @@ class tTVPRenderMethod_FillARGB : public tTVPRenderMethod_Software {
     };
 
 public:
-    tjs_uint32 clr;
+    tTVPRenderMethodParam<tjs_uint32> clr;
     virtual int EnumParameterID(const char *name) {
         if(!strcmp(name, "color"))
             return 0;
@@ -1166,7 +1135,7 @@ class tTVPRenderMethod_Fill : public tTVPRenderMethod_Software {
     };
 
 protected:
-    TParam param;
+    tTVPRenderMethodParam<TParam> param;
 
     void SetParamValue(const TParam &val) { param = val; }
 
@@ -1248,8 +1217,8 @@ class tTVPRenderMethod_FillWithColorOpa : public tTVPRenderMethod_Software {
         tjs_int w, h;
         tjs_int pitch;
     };
-    tjs_uint32 clr;
-    tjs_int opa;
+    tTVPRenderMethodParam<tjs_uint32> clr;
+    tTVPRenderMethodParam<tjs_int> opa;
 
 public:
     virtual int EnumParameterID(const char *name) {
@@ -1607,7 +1576,7 @@ template <int THREAD_FACTOR,
 class tTVPRenderMethod_TransBlt : public tTVPRenderMethod_Software {
 protected:
     tjs_int tpitch, spitch, dpitch;
-    tjs_int opa;
+    tTVPRenderMethodParam<tjs_int> opa;
 
     const int ParameterIDBegin = 0;
     const int ParameterIDEnd = ParameterIDBegin + 1;
@@ -1796,7 +1765,7 @@ class tTVPRenderMethod_BltAndOpa
     typedef tTVPRenderMethod_BaseBlt<tjs_uint32, THREAD_FACTOR> inherit;
 
 public:
-    tjs_int opa;
+    tTVPRenderMethodParam<tjs_int> opa;
 
     virtual int EnumParameterID(const char *name) {
         if(!strcmp(name, "opacity"))
@@ -1836,7 +1805,7 @@ class tTVPRenderMethod_BltWithOpa
     typedef tTVPRenderMethod_BaseBlt<tjs_uint32, THREAD_FACTOR> inherit;
 
 public:
-    tjs_int opa;
+    tTVPRenderMethodParam<tjs_int> opa;
 
     virtual int EnumParameterID(const char *name) {
         if(!strcmp(name, "opacity"))
@@ -1863,7 +1832,7 @@ template <int THREAD_FACTOR,
 class tTVPRenderMethod_BltWithOpa_SD
     : public tTVPRenderMethod_BaseBlt<tjs_uint32, THREAD_FACTOR> {
     typedef tTVPRenderMethod_BaseBlt<tjs_uint32, THREAD_FACTOR> inherit;
-    tjs_int opa;
+    tTVPRenderMethodParam<tjs_int> opa;
 
 public:
     virtual int EnumParameterID(const char *name) {
@@ -2339,7 +2308,9 @@ public:
             dw = rctar.get_width(), dh = rctar.get_height();
 
         int spitch = src->GetPitch();
-        const uint8_t *sdata = (const uint8_t *)src->GetPixelData() +
+        const uint8_t *sdata =
+            (const uint8_t *)src->GetPixelDataForLines(rcsrc.top,
+                                                       rcsrc.bottom) +
             (rcsrc.top * spitch + rcsrc.left * 4);
         uint8_t *ddata =
             (uint8_t *)tar->GetScanLineForWrite(rcdst.top) + rcdst.left * 4;
@@ -2654,10 +2625,30 @@ static bool checkQuadSquared(const tTVPPointD *p) {
     return isDoubleEqual(d01, d23) && isDoubleEqual(d12, d03);
 }
 
-static iTVPTexture2D *(*_createStaticTexture2D)(tTVPBitmap *bmp,
-                                                const void *pixel, int pitch,
-                                                unsigned int w, unsigned int h,
-                                                TVPTextureFormat::e format);
+typedef iTVPTexture2D *(*tTVPCreateStaticTexture2D)(
+    tTVPBitmap *bmp, const void *pixel, int pitch, unsigned int w,
+    unsigned int h, TVPTextureFormat::e format);
+static tTVPCreateStaticTexture2D _createStaticTexture2D;
+
+static tTVPCreateStaticTexture2D
+TVPGetStaticTexture2DCreator(const std::string &compTexMethod) {
+    if(compTexMethod == "halfline")
+        return tTVPSoftwareTexture2D_half::Create;
+    else if(compTexMethod == "lz4")
+        return tTVPSoftwareTexture2D_lz4::Create;
+    else if(compTexMethod == "lz4+tlg5")
+        return tTVPSoftwareTexture2D_lz4_tlg5::Create;
+    return tTVPSoftwareTexture2D::Create;
+}
+
+iTVPTexture2D *TVPCreateStaticSoftwareTexture2D(tTVPBitmap *bmp,
+                                                const std::string &method) {
+    return TVPGetStaticTexture2DCreator(method)(
+        bmp, bmp->GetBits(), bmp->GetPitch(), bmp->GetWidth(),
+        bmp->GetHeight(),
+        bmp->GetBPP() == 8 ? TVPTextureFormat::Gray : TVPTextureFormat::RGBA);
+}
+
 class tTVPSoftwareRenderManager : public iTVPRenderManager {
 
     struct eParameters {
@@ -2684,7 +2675,7 @@ class tTVPSoftwareRenderManager : public iTVPRenderManager {
         return tempTexture;
     }
 
-    tjs_int32 _drawCount;
+    std::atomic<tjs_int32> _drawCount;
 
 public:
     void Register_1() {
@@ -2922,16 +2913,9 @@ public:
     tTVPSoftwareRenderManager() :
         StretchType(stNearest), tempTexture(nullptr), img_convert_ctx(nullptr),
         _drawCount(0) {
-        _createStaticTexture2D = tTVPSoftwareTexture2D::Create;
-        std::string compTexMethod =
+        _createStaticTexture2D = TVPGetStaticTexture2DCreator(
             IndividualConfigManager::GetInstance()->GetValue<std::string>(
-                "software_compress_tex", "none");
-        if(compTexMethod == "halfline")
-            _createStaticTexture2D = tTVPSoftwareTexture2D_half::Create;
-        else if(compTexMethod == "lz4")
-            _createStaticTexture2D = tTVPSoftwareTexture2D_lz4::Create;
-        else if(compTexMethod == "lz4+tlg5")
-            _createStaticTexture2D = tTVPSoftwareTexture2D_lz4_tlg5::Create;
+                "software_compress_tex", "none"));
 
         Register_1();
         Register_2();
@@ -3087,7 +3071,8 @@ public:
 
             const uint8_t *sdata;
             int spitch = src->GetPitch();
-            sdata = (const uint8_t *)src->GetPixelData() +
+            sdata = (const uint8_t *)src->GetPixelDataForLines(rcsrc.top,
+                                                               rcsrc.bottom) +
                 (rcsrc.top * spitch + rcsrc.left * 4);
 
             iTVPTexture2D *tmp = getTempTexture(dw, dh + 1);
@@ -3151,8 +3136,10 @@ public:
 #endif
 
         for(int i = 0; i < textures.size(); ++i) {
-            textures[i].first->GetScanLineForRead(
-                0); // prepare pixel data for compressed texture
+            // prepare pixel data for compressed texture
+            const tTVPRect &rc = textures[i].second;
+            textures[i].first->GetPixelDataForLines(
+                std::min(rc.top, rc.bottom), std::max(rc.top, rc.bottom));
         }
 
         ++_drawCount;
@@ -3541,8 +3528,8 @@ public:
         ++_drawCount;
         assert(textures.size() == 1);
         for(int i = 0; i < textures.size(); ++i) {
-            textures[i].first->GetScanLineForRead(
-                0); // prepare pixel data for compressed texture
+            // prepare whole pixel data for compressed texture
+            textures[i].first->GetPixelData();
         }
         iTVPTexture2D *dst = target;
         const tTVPPointD *dstpt = pttar;
@@ -3746,7 +3733,7 @@ public:
             TAffuncFunc affineloop = GetStretchFunction(
                 static_cast<tTVPRenderMethod_Software *>(method));
 
-            tjs_int taskNum = TVPGetThreadNum();
+            tjs_int taskNum = TVPGetThreadTaskNum();
             if(taskNum > nTriangles)
                 taskNum = nTriangles;
             TVPExecThreadTask(taskNum, [&](int n) {
@@ -4421,7 +4408,7 @@ public:
         tjs_int destpitch = dst->GetPitch();
         tjs_int srcpitch = _src->GetPitch();
         tjs_uint8 *dest = (tjs_uint8 *)dst->GetScanLineForWrite(yc);
-        const tjs_uint8 *src = (const tjs_uint8 *)_src->GetScanLineForRead(0);
+        const tjs_uint8 *src = (const tjs_uint8 *)_src->GetPixelData();
 
         tTVPBBStretchType mode = /*param->mode*/ StretchType;
         tTVPBBStretchType type = (tTVPBBStretchType)(mode & stTypeMask);
@@ -4768,8 +4755,8 @@ public:
                                     const tRenderTexQuadArray &textures) {
         assert(textures.size() == 1);
         for(int i = 0; i < textures.size(); ++i) {
-            textures[i].first->GetScanLineForRead(
-                0); // prepare pixel data for compressed texture
+            // prepare whole pixel data for compressed texture
+            textures[i].first->GetPixelData();
         }
         iTVPTexture2D *dst = target;
         const tTVPPointD *dstpt = pttar;
@@ -3,6 +3,7 @@
 #include <unordered_map>
 #include <stdint.h>
 #include <string>
+#include <atomic>
 
 #ifndef GL_ZERO
 #define GL_ZERO 0
@@ -98,7 +99,7 @@ namespace cocos2d {
 
 class iTVPTexture2D {
 protected:
-    int RefCount;
+    std::atomic<int> RefCount; // shared with parallel layer compositing
     tjs_int Width; // actual width
     tjs_int Height; // actual height
     // int Flags, TexWidth, TexHeight, ActualWidth, ActualHeight;
@@ -121,6 +122,11 @@ public:
     virtual TVPTextureFormat::e GetFormat() const = 0;
     virtual const void *GetScanLineForRead(tjs_uint l) { return nullptr; }
     virtual const void *GetPixelData() { return GetScanLineForRead(0); }
+    // same as GetPixelData, but only the lines from "top" to "bottom" - 1
+    // are sure to be valid in the returned image
+    virtual const void *GetPixelDataForLines(tjs_uint top, tjs_uint bottom) {
+        return GetPixelData();
+    }
     virtual void *GetScanLineForWrite(tjs_uint l) {
         return (void *)GetScanLineForRead(l);
     }
@@ -313,4 +319,8 @@ namespace TJS {
     class tTJSString;
 }
 iTVPRenderManager *TVPGetRenderManager(const TJS::tTJSString &name);
-bool TVPIsSoftwareRenderManager();
\ No newline at end of file
+bool TVPIsSoftwareRenderManager();
+// creates a static software texture of "bmp", compressed by "method" as
+// the "software_compress_tex" option does ("halfline", "lz4", "lz4+tlg5")
+iTVPTexture2D *TVPCreateStaticSoftwareTexture2D(tTVPBitmap *bmp,
+                                                const std::string &method);
\ No newline at end of file
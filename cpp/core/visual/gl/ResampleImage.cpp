@@ -430,9 +430,10 @@ public:
         const int len = paramy_.length_[y];
         const int bottom = top + len;
         const float *weighty = wstarty;
-        const tjs_uint32 *srctop =
-            (const tjs_uint32 *)src->GetScanLine(top) + srcrect.left;
         tjs_int stride = src->GetPitchBytes() / (int)sizeof(tjs_uint32);
+        const tjs_uint32 *srctop =
+            (const tjs_uint32 *)src->GetPixelDataForLines(top, bottom) +
+            top * stride + srcrect.left;
         for(int x = 0; x < srcwidth; x++) {
             weighty = wstarty;
             float color_element[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
@@ -645,7 +646,7 @@ public:
         int pixelNum =
             maxwidth * (int)tap * maxheight + maxheight * (int)tap * maxwidth;
         if(pixelNum >= 50 * 500) {
-            threadNum = TVPGetThreadNum();
+            threadNum = TVPGetThreadTaskNum();
         }
         if(threadNum == 1) { // 面積が少なくスレッドが1の時はそのまま実行
             Resample(clip, blendfunc, dest, destrect, src, srcrect, tap, func);
@@ -688,7 +689,7 @@ public:
         int threadNum = 1;
         int pixelNum = maxwidth * maxheight;
         if(pixelNum >= 50 * 500) {
-            threadNum = TVPGetThreadNum();
+            threadNum = TVPGetThreadTaskNum();
         }
         if(threadNum == 1) { // 面積が少なくスレッドが1の時はそのまま実行
             ResampleAreaAvg(clip, blendfunc, dest, destrect, src, srcrect);
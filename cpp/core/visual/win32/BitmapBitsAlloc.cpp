@@ -6,6 +6,10 @@
 #include "SysInitIntf.h"
 #include "EventIntf.h"
 #include "DebugIntf.h"
+#include <map>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
 
 class BasicAllocator : public iTVPMemoryAllocator {
 public:
@@ -13,6 +17,134 @@ public:
     void *allocate(size_t size) { return malloc(size); }
     void free(void *mem) { ::free(mem); }
 };
+//---------------------------------------------------------------------------
+// PooledAllocator : keeps freed bitmap bits for reuse
+//---------------------------------------------------------------------------
+// layers, transitions and decompressed textures free and allocate buffers of
+// the same few geometries all the time. large buffers are mapped and
+// unmapped by malloc, and every reuse faults the pages in again.
+// the blocks are rounded up to size classes of 4KB pages ( 2MB pages with
+// huge page backing ), and a freed block is kept while the pooled bytes stay
+// within the retention budget. a request takes the smallest pooled block of
+// its class or at most 1/8 larger.
+class PooledAllocator : public iTVPMemoryAllocator {
+    struct tHeader {
+        size_t Size; // class size; 0 if not pooled
+        size_t Reserved; // keeps the bits 16-bytes aligned
+    };
+    struct tBlock {
+        tHeader *Header;
+        uint64_t Serial; // for freeing the oldest block first
+    };
+
+    // blocks smaller than this are left to malloc
+    static const size_t MinPooledSize = 64 * 1024;
+    static const size_t PageSize = 4096;
+    static const size_t HugePageSize = 2 * 1024 * 1024;
+
+    std::multimap<size_t, tBlock> Pool;
+    size_t PooledBytes = 0;
+    size_t PoolLimit;
+    bool UseHugePage;
+    uint64_t Serial = 0;
+    uint64_t ReuseCount = 0;
+
+public:
+    PooledAllocator(size_t limit, bool hugepage) :
+        PoolLimit(limit), UseHugePage(hugepage) {
+        TVPAddLog(TJS_W("(info) Use pooled allocator for Bitmap (") +
+                  ttstr((tjs_int)(limit / (1024 * 1024))) + TJS_W("MB") +
+                  (hugepage ? TJS_W(", huge page") : TJS_W("")) +
+                  TJS_W(")"));
+    }
+    ~PooledAllocator() { compact(); }
+
+    void *allocate(size_t size) {
+        size += sizeof(tHeader);
+        if(size < MinPooledSize) {
+            tHeader *h = (tHeader *)malloc(size);
+            if(!h)
+                return nullptr;
+            h->Size = 0;
+            return h + 1;
+        }
+
+        size_t page = GetPageSize(size);
+        size = (size + page - 1) & ~(page - 1);
+        auto i = Pool.lower_bound(size);
+        if(i != Pool.end() && i->first <= size + size / 8) {
+            tHeader *h = i->second.Header;
+            PooledBytes -= i->first;
+            Pool.erase(i);
+            ReuseCount++;
+            return h + 1;
+        }
+
+        tHeader *h = AllocateBlock(size, page);
+        if(!h) {
+            // retry after releasing the pool
+            compact();
+            h = AllocateBlock(size, page);
+            if(!h)
+                return nullptr;
+        }
+        h->Size = size;
+        return h + 1;
+    }
+
+    void free(void *mem) {
+        tHeader *h = (tHeader *)mem - 1;
+        size_t size = h->Size;
+        if(!size || size > PoolLimit) {
+            ::free(h);
+            return;
+        }
+        while(PooledBytes + size > PoolLimit) {
+            // release the block freed first
+            auto oldest = Pool.begin();
+            for(auto i = Pool.begin(); i != Pool.end(); ++i)
+                if(i->second.Serial < oldest->second.Serial)
+                    oldest = i;
+            PooledBytes -= oldest->first;
+            ::free(oldest->second.Header);
+            Pool.erase(oldest);
+        }
+        Pool.insert(std::make_pair(size, tBlock{ h, Serial++ }));
+        PooledBytes += size;
+    }
+
+    void compact() {
+        for(auto &i : Pool)
+            ::free(i.second.Header);
+        Pool.clear();
+        PooledBytes = 0;
+    }
+
+    void getStatistics(tTVPBitmapBitsAllocStat &stat) {
+        stat.ReuseCount = ReuseCount;
+        stat.PooledBytes = PooledBytes;
+        stat.PoolLimit = PoolLimit;
+    }
+
+private:
+    size_t GetPageSize(size_t size) const {
+        return UseHugePage && size >= HugePageSize ? HugePageSize : PageSize;
+    }
+
+    tHeader *AllocateBlock(size_t size, size_t page) {
+#if defined(__linux__)
+        if(page == HugePageSize) {
+            void *p = nullptr;
+            if(posix_memalign(&p, HugePageSize, size))
+                return nullptr;
+            madvise(p, size, MADV_HUGEPAGE);
+            return (tHeader *)p;
+        }
+#endif
+        return (tHeader *)malloc(size);
+    }
+};
+//---------------------------------------------------------------------------
 #if 0
 class GlobalAllocAllocator : public iTVPMemoryAllocator
 {
@@ -100,9 +232,41 @@ public:
 
 iTVPMemoryAllocator *tTVPBitmapBitsAlloc::Allocator = nullptr;
 tTJSCriticalSection tTVPBitmapBitsAlloc::AllocCS;
+#ifdef _DEBUG
+bool tTVPBitmapBitsAlloc::CheckSentinel = true;
+#else
+bool tTVPBitmapBitsAlloc::CheckSentinel = false;
+#endif
+uint64_t tTVPBitmapBitsAlloc::AllocCount = 0;
+uint64_t tTVPBitmapBitsAlloc::LiveBytes = 0;
+uint64_t tTVPBitmapBitsAlloc::PeakLiveBytes = 0;
 
 void tTVPBitmapBitsAlloc::InitializeAllocator() {
     if(Allocator == nullptr) {
+        tTJSVariant val;
+        if(TVPGetCommandLine(TJS_W("-bitmapcheck"), &val)) {
+            // sentinels around the bits, to find the drawing code writing
+            // out of the bitmap
+            ttstr str(val);
+            CheckSentinel = str == TJS_W("yes");
+        }
+
+        tjs_int64 poolmb = 64;
+        if(TVPGetCommandLine(TJS_W("-bitmappool"), &val)) {
+            ttstr str(val);
+            if(str != TJS_W("auto"))
+                poolmb = val.AsInteger();
+        }
+        bool hugepage = false;
+        if(TVPGetCommandLine(TJS_W("-bitmaphugepage"), &val)) {
+            ttstr str(val);
+            hugepage = str == TJS_W("yes");
+        }
+        if(poolmb > 0) {
+            Allocator = new PooledAllocator((size_t)poolmb * 1024 * 1024,
+                                            hugepage);
+            return;
+        }
 #if 0
 		tTJSVariant val;
 		if (TVPGetCommandLine(TJS_W("-bitmapallocator"), &val)) {
@@ -126,6 +290,49 @@ void tTVPBitmapBitsAlloc::FreeAllocator() {
         delete Allocator;
     Allocator = nullptr;
 }
+void tTVPBitmapBitsAlloc::Compact() {
+    tTJSCriticalSectionHolder Lock(AllocCS); // Lock
+    if(Allocator)
+        Allocator->compact();
+}
+void tTVPBitmapBitsAlloc::GetStatistics(tTVPBitmapBitsAllocStat &stat) {
+    tTJSCriticalSectionHolder Lock(AllocCS); // Lock
+    memset(&stat, 0, sizeof(stat));
+    if(Allocator)
+        Allocator->getStatistics(stat);
+    stat.AllocCount = AllocCount;
+    stat.LiveBytes = LiveBytes;
+    stat.PeakLiveBytes = PeakLiveBytes;
+}
+//---------------------------------------------------------------------------
+static void TVPLogBitmapBitsStatistics() {
+    // how well the pool serves the allocations, on minimize and at exit
+    tTVPBitmapBitsAllocStat stat;
+    tTVPBitmapBitsAlloc::GetStatistics(stat);
+    if(!stat.AllocCount)
+        return;
+    TVPAddLog(TJS_W("(info) Bitmap bits: ") +
+              ttstr((tjs_int64)stat.AllocCount) + TJS_W(" allocations, ") +
+              ttstr((tjs_int64)stat.ReuseCount) +
+              TJS_W(" reused from the pool, peak ") +
+              ttstr((tjs_int64)(stat.PeakLiveBytes / 1024)) +
+              TJS_W("KB, pooled ") +
+              ttstr((tjs_int64)(stat.PooledBytes / 1024)) + TJS_W("KB"));
+}
+//---------------------------------------------------------------------------
+struct tTVPBitmapBitsCompactCallback : public tTVPCompactEventCallbackIntf {
+    virtual void OnCompact(tjs_int level) {
+        if(level >= TVP_COMPACT_LEVEL_MINIMIZE) {
+            TVPLogBitmapBitsStatistics();
+            tTVPBitmapBitsAlloc::Compact();
+        }
+    }
+} static TVPBitmapBitsCompactCallback;
+static bool TVPBitmapBitsCompactCallbackInit = false;
+//---------------------------------------------------------------------------
+static tTVPAtExit
+    TVPLogBitmapBitsStatisticsAtExit(TVP_ATEXIT_PRI_SHUTDOWN,
+                                     TVPLogBitmapBitsStatistics);
 static tTVPAtExit TVPUninitMessageLoad(TVP_ATEXIT_PRI_CLEANUP,
                                        tTVPBitmapBitsAlloc::FreeAllocator);
 
@@ -136,6 +343,10 @@ void *tTVPBitmapBitsAlloc::Alloc(tjs_uint size, tjs_uint width,
     tTJSCriticalSectionHolder Lock(AllocCS); // Lock
 
     InitializeAllocator();
+    if(!TVPBitmapBitsCompactCallbackInit) {
+        TVPAddCompactEventHook(&TVPBitmapBitsCompactCallback);
+        TVPBitmapBitsCompactCallbackInit = true;
+    }
     tjs_uint8 *ptrorg, *ptr;
     tjs_uint allocbytes = 16 + size + sizeof(tTVPLayerBitmapMemoryRecord) +
         sizeof(tjs_uint32) * 2;
@@ -159,18 +370,26 @@ void *tTVPBitmapBitsAlloc::Alloc(tjs_uint size, tjs_uint width,
     // fill memory allocation record
     record->alloc_ptr = (void *)ptrorg;
     record->size = size;
-    record->sentinel_backup1 = rand() + (rand() << 16);
-    record->sentinel_backup2 = rand() + (rand() << 16);
-
-    // set sentinel
-    *(tjs_uint32 *)(ptr - sizeof(tjs_uint32)) = ~record->sentinel_backup1;
-    *(tjs_uint32 *)(ptr + size) = ~record->sentinel_backup2;
-    // Stored sentinels are nagated, to avoid that the sentinel
-    // backups in tTVPLayerBitmapMemoryRecord becomes the same value
-    // as the sentinels. This trick will make the detection of the
-    // memory corruption easier. Because on some occasions, running
-    // memory writing will write the same values at first sentinel and
-    // the tTVPLayerBitmapMemoryRecord.
+
+    AllocCount++;
+    LiveBytes += size;
+    if(PeakLiveBytes < LiveBytes)
+        PeakLiveBytes = LiveBytes;
+
+    if(CheckSentinel) {
+        record->sentinel_backup1 = rand() + (rand() << 16);
+        record->sentinel_backup2 = rand() + (rand() << 16);
+
+        // set sentinel
+        *(tjs_uint32 *)(ptr - sizeof(tjs_uint32)) = ~record->sentinel_backup1;
+        *(tjs_uint32 *)(ptr + size) = ~record->sentinel_backup2;
+        // Stored sentinels are nagated, to avoid that the sentinel
+        // backups in tTVPLayerBitmapMemoryRecord becomes the same value
+        // as the sentinels. This trick will make the detection of the
+        // memory corruption easier. Because on some occasions, running
+        // memory writing will write the same values at first sentinel and
+        // the tTVPLayerBitmapMemoryRecord.
+    }
 
     // return buffer pointer
     return ptr;
@@ -188,14 +407,18 @@ void tTVPBitmapBitsAlloc::Free(void *ptr) {
                                             sizeof(tjs_uint32));
 
         // check sentinel
-        if(~(*(tjs_uint32 *)(bptr - sizeof(tjs_uint32))) !=
-           record->sentinel_backup1)
-            TVPThrowExceptionMessage(
-                TVPLayerBitmapBufferUnderrunDetectedCheckYourDrawingCode);
-        if(~(*(tjs_uint32 *)(bptr + record->size)) != record->sentinel_backup2)
-            TVPThrowExceptionMessage(
-                TVPLayerBitmapBufferOverrunDetectedCheckYourDrawingCode);
+        if(CheckSentinel) {
+            if(~(*(tjs_uint32 *)(bptr - sizeof(tjs_uint32))) !=
+               record->sentinel_backup1)
+                TVPThrowExceptionMessage(
+                    TVPLayerBitmapBufferUnderrunDetectedCheckYourDrawingCode);
+            if(~(*(tjs_uint32 *)(bptr + record->size)) !=
+               record->sentinel_backup2)
+                TVPThrowExceptionMessage(
+                    TVPLayerBitmapBufferOverrunDetectedCheckYourDrawingCode);
+        }
 
+        LiveBytes -= record->size;
         Allocator->free(record->alloc_ptr);
     }
 }
@@ -2,6 +2,17 @@
 #define __BITMAP_BITS_ALLOC_H__
 #include <stdint.h>
 
+//---------------------------------------------------------------------------
+// statistics of the bitmap bits allocator
+//---------------------------------------------------------------------------
+struct tTVPBitmapBitsAllocStat {
+    uint64_t AllocCount; // number of allocations
+    uint64_t ReuseCount; // allocations served by the pool
+    uint64_t LiveBytes; // bytes allocated and not freed yet
+    uint64_t PeakLiveBytes;
+    uint64_t PooledBytes; // bytes kept in the pool for reuse
+    uint64_t PoolLimit; // the retention budget of the pool
+};
 //---------------------------------------------------------------------------
 // memory allocation class
 //---------------------------------------------------------------------------
@@ -10,6 +21,9 @@ public:
     virtual ~iTVPMemoryAllocator(){};
     virtual void *allocate(size_t size) = 0;
     virtual void free(void *mem) = 0;
+    // releases the memory kept for reuse, if any
+    virtual void compact() {}
+    virtual void getStatistics(tTVPBitmapBitsAllocStat &stat) {}
 };
 //---------------------------------------------------------------------------
 // heap allocation functions for bitmap bits
@@ -29,12 +43,19 @@ class tTVPBitmapBitsAlloc {
 #pragma pack(pop)
     static iTVPMemoryAllocator *Allocator;
     static tTJSCriticalSection AllocCS;
+    static bool CheckSentinel; // put sentinels around the bits
+    static uint64_t AllocCount;
+    static uint64_t LiveBytes;
+    static uint64_t PeakLiveBytes;
     static void InitializeAllocator();
 
 public:
     static void FreeAllocator();
     static void *Alloc(tjs_uint size, tjs_uint width, tjs_uint height);
     static void Free(void *ptr);
+    // releases the bits kept for reuse
+    static void Compact();
+    static void GetStatistics(tTVPBitmapBitsAllocStat &stat);
 };
 
 #endif // __BITMAP_BITS_ALLOC_H__
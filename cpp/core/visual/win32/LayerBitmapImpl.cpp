@@ -11,6 +11,7 @@
 #define _USE_MATH_DEFINES
 #include "tjsCommHead.h"
 
+#include <algorithm>
 #include <memory>
 #include <stdlib.h>
 #include <math.h>
@@ -39,9 +40,11 @@ void TVPInitWindowOptions();
 #include "FontSystem.h"
 #include "visual/FreeType.h"
 #include "FreeTypeFontRasterizer.h"
+#include "GlyphDiskCache.h"
 // #include "GDIFontRasterizer.h"
 #include "BitmapBitsAlloc.h"
 #include "RenderManager.h"
+#include "ThreadIntf.h"
 
 //---------------------------------------------------------------------------
 // prototypes
@@ -233,6 +236,9 @@ void TVPClearFontCache() { TVPFontCache.Clear(); }
 //---------------------------------------------------------------------------
 struct tTVPClearFontCacheCallback : public tTVPCompactEventCallbackIntf {
     virtual void OnCompact(tjs_int level) {
+        // write the glyphs rendered so far back to the disk cache, which
+        // refills the font cache after it is cleared
+        TVPFlushGlyphDiskCache();
         if(level >= TVP_COMPACT_LEVEL_MINIMIZE) {
             // clear the font cache on application minimize
             TVPClearFontCache();
@@ -314,9 +320,12 @@ static tTVPCharacterData *TVPGetCharacter(const tTVPFontAndCharacterData &font,
 
         return data;
     } else {
-        // render font
-        tTVPCharacterData *data =
-            GetCurrentRasterizer()->GetBitmap(font, aofsx, aofsy);
+        // look the disk cache, then render font
+        tTVPCharacterData *data = TVPReadGlyphDiskCache(font, aofsx);
+        if(!data) {
+            data = GetCurrentRasterizer()->GetBitmap(font, aofsx, aofsy);
+            TVPWriteGlyphDiskCache(font, aofsx, data);
+        }
 
         // add to hash table
         tTVPCharacterDataHolder holder(data);
@@ -325,6 +334,99 @@ static tTVPCharacterData *TVPGetCharacter(const tTVPFontAndCharacterData &font,
     }
 }
 //---------------------------------------------------------------------------
+static void TVPPrepareCharacters(const tTVPFontAndCharacterData &font,
+                                 const tjs_char *text,
+                                 tTVPNativeBaseBitmap *bmp,
+                                 tTVPPrerenderedFont *pfont, tjs_int aofsx,
+                                 tjs_int aofsy) {
+    // puts the characters of the text into the font cache.
+    // the rasterizers are not thread-safe, so the glyphs are rasterized one
+    // by one here. blurred glyphs are copied from the plain ones and blurred
+    // on the thread pool, which is where most of the time goes for text with
+    // blurred shadows.
+    struct tPending {
+        tTVPFontAndCharacterData Font;
+        tjs_uint32 Hash;
+        tTVPCharacterData *Data;
+    };
+    std::vector<tPending> pending;
+
+    tTVPFontAndCharacterData ch = font;
+    try {
+        for(const tjs_char *p = text; *p; p++) {
+            ch.Character = *p;
+            ch.Blured = false;
+            tTVPCharacterData *data =
+                TVPGetCharacter(ch, bmp, pfont, aofsx, aofsy);
+            if(!data)
+                continue;
+            if(!font.Blured) {
+                data->Release();
+                continue;
+            }
+
+            ch.Blured = true;
+            tjs_uint32 hash = tTVPFontCache::MakeHash(ch);
+            bool found = TVPFontCache.FindWithHash(ch, hash) != nullptr;
+            for(auto &i : pending)
+                if(i.Font.Character == ch.Character)
+                    found = true;
+            if(found || data->FullColored || !data->BlackBoxX ||
+               !data->BlackBoxY) {
+                // cached, queued, or left to TVPGetCharacter
+                data->Release();
+                continue;
+            }
+            if(!pfont || !pfont->Find(ch.Character)) {
+                tTVPCharacterData *stored = TVPReadGlyphDiskCache(ch, aofsx);
+                if(stored) {
+                    data->Release();
+                    tTVPCharacterDataHolder holder(stored);
+                    TVPFontCache.AddWithHash(ch, hash, holder);
+                    stored->Release();
+                    continue;
+                }
+            }
+
+            tTVPCharacterData *shadow = nullptr;
+            try {
+                shadow = new tTVPCharacterData(
+                    data->GetData(), data->Pitch, data->OriginX,
+                    data->OriginY, data->BlackBoxX, data->BlackBoxY,
+                    data->Metrics);
+            } catch(...) {
+                data->Release();
+                throw;
+            }
+            shadow->Antialiased = data->Antialiased;
+            shadow->Gray = data->Gray;
+            shadow->Blured = true;
+            shadow->BlurLevel = font.BlurLevel;
+            shadow->BlurWidth = font.BlurWidth;
+            data->Release();
+            pending.push_back({ ch, hash, shadow });
+        }
+
+        TVPExecThreadRangeTask(0, (int)pending.size(), 1,
+                               [&pending](int begin, int end) {
+                                   for(int i = begin; i < end; i++)
+                                       pending[i].Data->Blur();
+                               });
+    } catch(...) {
+        for(auto &i : pending)
+            i.Data->Release();
+        throw;
+    }
+
+    for(auto &i : pending) {
+        if(!pfont || !pfont->Find(i.Font.Character))
+            TVPWriteGlyphDiskCache(i.Font, aofsx, i.Data);
+        tTVPCharacterDataHolder holder(i.Data);
+        TVPFontCache.AddWithHash(i.Font, i.Hash, holder);
+        i.Data->Release();
+    }
+}
+//---------------------------------------------------------------------------
 
 //---------------------------------------------------------------------------
 // tTVPBitmap : internal bitmap object
@@ -638,6 +740,15 @@ const void *tTVPNativeBaseBitmap::GetScanLine(tjs_uint l) const {
     return Bitmap->GetScanLineForRead(l);
 }
 //---------------------------------------------------------------------------
+const void *tTVPNativeBaseBitmap::GetPixelData() const {
+    return Bitmap->GetPixelData();
+}
+//---------------------------------------------------------------------------
+const void *tTVPNativeBaseBitmap::GetPixelDataForLines(tjs_uint top,
+                                                       tjs_uint bottom) const {
+    return Bitmap->GetPixelDataForLines(top, bottom);
+}
+//---------------------------------------------------------------------------
 void *tTVPNativeBaseBitmap::GetScanLineForWrite(tjs_uint l) {
     Independ();
     return Bitmap->GetScanLineForWrite(l);
@@ -781,7 +892,7 @@ bool tTVPNativeBaseBitmap::InternalBlendText(tTVPCharacterData *data,
     // tjs_uint8 *sl = (tjs_uint8*)GetScanLineForWrite(drect.top);
     tjs_int h = drect.bottom - drect.top;
     tjs_int w = drect.right - drect.left;
-    tjs_uint8 *bp = data->GetData() + pitch * srect.top;
+    tjs_uint8 *bp = data->GetData() + pitch * srect.top + srect.left;
 
     iTVPRenderMethod *method = nullptr;
     int opa_id, clr_id;
@@ -868,7 +979,8 @@ bool tTVPNativeBaseBitmap::InternalBlendText(tTVPCharacterData *data,
         _CharacterTexture->Update(bp, TVPTextureFormat::Gray, pitch,
                                   tTVPRect(0, 0, w, h));
 
-        method->SetParameterOpa(opa_id, dtdata->opa);
+        // a negative opacity is the strength of the removal
+        method->SetParameterOpa(opa_id, std::abs(dtdata->opa));
         method->SetParameterColor4B(clr_id, color);
 
         pTexSrc = _CharacterTexture;
@@ -904,48 +1016,57 @@ bool tTVPNativeBaseBitmap::InternalBlendText(tTVPCharacterData *data,
     return true;
 }
 
-bool tTVPNativeBaseBitmap::InternalDrawText(tTVPCharacterData *data, tjs_int x,
-                                            tjs_int y, tjs_uint32 color,
-                                            tTVPDrawTextData *dtdata,
-                                            tTVPRect &drect) {
+static bool TVPClipCharacterRect(const tTVPCharacterData *data, tjs_int x,
+                                 tjs_int y, const tTVPRect &cliprect,
+                                 tTVPRect &srect, tTVPRect &drect) {
     // setup destination and source rectangle
     drect.left = x + data->OriginX;
     drect.top = y + data->OriginY;
     drect.right = drect.left + data->BlackBoxX;
     drect.bottom = drect.top + data->BlackBoxY;
 
-    tTVPRect srect;
     srect.left = srect.top = 0;
     srect.right = data->BlackBoxX;
     srect.bottom = data->BlackBoxY;
 
     // check boundary
-    if(drect.left < dtdata->rect.left) {
-        srect.left += (dtdata->rect.left - drect.left);
-        drect.left = dtdata->rect.left;
+    if(drect.left < cliprect.left) {
+        srect.left += (cliprect.left - drect.left);
+        drect.left = cliprect.left;
     }
 
-    if(drect.right > dtdata->rect.right) {
-        srect.right -= (drect.right - dtdata->rect.right);
-        drect.right = dtdata->rect.right;
+    if(drect.right > cliprect.right) {
+        srect.right -= (drect.right - cliprect.right);
+        drect.right = cliprect.right;
     }
 
     if(srect.left >= srect.right)
         return false; // not drawable
 
-    if(drect.top < dtdata->rect.top) {
-        srect.top += (dtdata->rect.top - drect.top);
-        drect.top = dtdata->rect.top;
+    if(drect.top < cliprect.top) {
+        srect.top += (cliprect.top - drect.top);
+        drect.top = cliprect.top;
     }
 
-    if(drect.bottom > dtdata->rect.bottom) {
-        srect.bottom -= (drect.bottom - dtdata->rect.bottom);
-        drect.bottom = dtdata->rect.bottom;
+    if(drect.bottom > cliprect.bottom) {
+        srect.bottom -= (drect.bottom - cliprect.bottom);
+        drect.bottom = cliprect.bottom;
     }
 
     if(srect.top >= srect.bottom)
         return false; // not drawable
 
+    return true;
+}
+//---------------------------------------------------------------------------
+bool tTVPNativeBaseBitmap::InternalDrawText(tTVPCharacterData *data, tjs_int x,
+                                            tjs_int y, tjs_uint32 color,
+                                            tTVPDrawTextData *dtdata,
+                                            tTVPRect &drect) {
+    tTVPRect srect;
+    if(!TVPClipCharacterRect(data, x, y, dtdata->rect, srect, drect))
+        return false;
+
     return InternalBlendText(data, dtdata, color, srect, drect);
 }
 //---------------------------------------------------------------------------
@@ -1225,62 +1346,145 @@ void tTVPNativeBaseBitmap::DrawTextSingle(
         shadow->Release();
 }
 //---------------------------------------------------------------------------
-// structure for holding data for a character
-struct tTVPCharacterDrawData {
-    tTVPCharacterData *Data; // main character data
-    tTVPCharacterData *Shadow; // shadow character data
-    tjs_int X, Y;
-    tTVPRect ShadowRect;
-    bool ShadowDrawn;
-
-    tTVPCharacterDrawData(tTVPCharacterData *data, tTVPCharacterData *shadow,
-                          tjs_int x, tjs_int y) {
-        Data = data;
-        Shadow = shadow;
-        X = x;
-        Y = y;
-        ShadowDrawn = false;
+// tTVPCharacterDrawData
+//---------------------------------------------------------------------------
+tTVPCharacterDrawData::tTVPCharacterDrawData(tTVPCharacterData *data,
+                                             tTVPCharacterData *shadow,
+                                             tjs_int x, tjs_int y) {
+    Data = data;
+    Shadow = shadow;
+    X = x;
+    Y = y;
+    ShadowDrawn = false;
+
+    if(Data)
+        Data->AddRef();
+    if(Shadow)
+        Shadow->AddRef();
+}
+//---------------------------------------------------------------------------
+tTVPCharacterDrawData::~tTVPCharacterDrawData() {
+    if(Data)
+        Data->Release();
+    if(Shadow)
+        Shadow->Release();
+}
+//---------------------------------------------------------------------------
+tTVPCharacterDrawData::tTVPCharacterDrawData(
+    const tTVPCharacterDrawData &rhs) {
+    Data = Shadow = nullptr;
+    *this = rhs;
+}
+//---------------------------------------------------------------------------
+void tTVPCharacterDrawData::operator=(const tTVPCharacterDrawData &rhs) {
+    X = rhs.X;
+    Y = rhs.Y;
+    ShadowRect = rhs.ShadowRect;
+    ShadowDrawn = rhs.ShadowDrawn;
 
+    if(Data != rhs.Data) {
+        if(Data)
+            Data->Release();
+        Data = rhs.Data;
         if(Data)
             Data->AddRef();
-        if(Shadow)
-            Shadow->AddRef();
     }
-
-    ~tTVPCharacterDrawData() {
-        if(Data)
-            Data->Release();
+    if(Shadow != rhs.Shadow) {
         if(Shadow)
             Shadow->Release();
+        Shadow = rhs.Shadow;
+        if(Shadow)
+            Shadow->AddRef();
     }
+}
+//---------------------------------------------------------------------------
+// one character blit of a line, already clipped
+struct tTVPTextBlit {
+    const tjs_uint8 *Src; // first pixel of the clipped character bitmap
+    tjs_int SrcPitch;
+    tTVPRect Rect; // destination
+    tjs_uint32 Color;
+};
+//---------------------------------------------------------------------------
+static void TVPBlendTextLine(iTVPTexture2D *target,
+                             const std::vector<tTVPTextBlit> &blits,
+                             const tTVPDrawTextData *dtdata) {
+    // blends all characters of a line to a software bitmap at once. this
+    // does the same as InternalBlendText does through the render manager
+    // for each character, but the rows are split into bands for the thread
+    // pool. each band blends the characters in order, so overlapping
+    // characters are blended in the same order as before.
+    if(blits.empty())
+        return;
 
-    tTVPCharacterDrawData(const tTVPCharacterDrawData &rhs) {
-        Data = Shadow = nullptr;
-        *this = rhs;
+    enum { tmColorMap, tmColorMap_d, tmColorMap_a, tmRemoveOpacity } mode;
+    if(dtdata->bltmode == bmAlphaOnAlpha)
+        mode = dtdata->opa > 0 ? tmColorMap_d : tmRemoveOpacity;
+    else if(dtdata->bltmode == bmAlphaOnAddAlpha)
+        mode = tmColorMap_a;
+    else
+        mode = tmColorMap;
+    tjs_int opa = std::abs(dtdata->opa);
+
+    tjs_uint8 *base = (tjs_uint8 *)target->GetScanLineForWrite(0);
+    tjs_int pitch = target->GetPitch();
+
+    tjs_int top = blits[0].Rect.top, bottom = blits[0].Rect.bottom;
+    tjs_int pixels = 0;
+    for(const auto &b : blits) {
+        top = std::min(top, b.Rect.top);
+        bottom = std::max(bottom, b.Rect.bottom);
+        pixels += b.Rect.get_width() * b.Rect.get_height();
     }
 
-    void operator=(const tTVPCharacterDrawData &rhs) {
-        X = rhs.X;
-        Y = rhs.Y;
-        ShadowRect = rhs.ShadowRect;
-        ShadowDrawn = rhs.ShadowDrawn;
-
-        if(Data != rhs.Data) {
-            if(Data)
-                Data->Release();
-            Data = rhs.Data;
-            if(Data)
-                Data->AddRef();
-        }
-        if(Shadow != rhs.Shadow) {
-            if(Shadow)
-                Shadow->Release();
-            Shadow = rhs.Shadow;
-            if(Shadow)
-                Shadow->AddRef();
+    auto band = [&](int y0, int y1) {
+        for(const auto &b : blits) {
+            tjs_int t = std::max<tjs_int>(y0, b.Rect.top);
+            tjs_int e = std::min<tjs_int>(y1, b.Rect.bottom);
+            tjs_int w = b.Rect.get_width();
+            for(tjs_int y = t; y < e; y++) {
+                tjs_uint32 *dest =
+                    (tjs_uint32 *)(base + y * pitch) + b.Rect.left;
+                const tjs_uint8 *src = b.Src + (y - b.Rect.top) * b.SrcPitch;
+                switch(mode) {
+                    case tmColorMap:
+                        if(opa == 255)
+                            TVPApplyColorMap_HDA(dest, src, w, b.Color);
+                        else
+                            TVPApplyColorMap_HDA_o(dest, src, w, b.Color, opa);
+                        break;
+                    case tmColorMap_d:
+                        if(opa == 255)
+                            TVPApplyColorMap_d(dest, src, w, b.Color);
+                        else
+                            TVPApplyColorMap_do(dest, src, w, b.Color, opa);
+                        break;
+                    case tmColorMap_a:
+                        if(opa == 255)
+                            TVPApplyColorMap_a(dest, src, w, b.Color);
+                        else
+                            TVPApplyColorMap_ao(dest, src, w, b.Color, opa);
+                        break;
+                    case tmRemoveOpacity:
+                        if(opa == 255)
+                            TVPRemoveOpacity(dest, src, w);
+                        else
+                            TVPRemoveOpacity_o(dest, src, w, opa);
+                        break;
+                }
+            }
         }
-    }
-};
+    };
+
+    // same threshold as the software render methods
+    if(pixels >= 150 * 500)
+        TVPExecThreadRangeTask(
+            top, bottom,
+            std::max<tjs_int>(1, (bottom - top) / TVPGetThreadTaskNum()),
+            band);
+    else
+        band(top, bottom);
+}
 //---------------------------------------------------------------------------
 void tTVPNativeBaseBitmap::DrawTextMultiple(
     const tTVPRect &destrect, tjs_int x, tjs_int y, const ttstr &text,
@@ -1312,12 +1516,6 @@ void tTVPNativeBaseBitmap::DrawTextMultiple(
     ApplyFont();
 
     const tjs_char *p = text.c_str();
-    tTVPDrawTextData dtdata;
-    dtdata.rect = destrect;
-    dtdata.bmppitch = GetPitchBytes();
-    dtdata.bltmode = bltmode;
-    dtdata.opa = opa;
-    dtdata.holdalpha = holdalpha;
 
     tTVPFontAndCharacterData font;
     font.Font = Font;
@@ -1327,6 +1525,11 @@ void tTVPNativeBaseBitmap::DrawTextMultiple(
     font.BlurWidth = shwidth;
     font.FontHash = FontHash;
 
+    // rasterize the characters which are not cached yet at once
+    font.Blured = shlevel != 0 && !(shlevel == 255 && shwidth == 0);
+    TVPPrepareCharacters(font, p, this, PrerenderedFont, AscentOfsX,
+                         AscentOfsY);
+
     std::vector<tTVPCharacterDrawData> drawdata;
     drawdata.reserve(text.GetLen());
 
@@ -1393,18 +1596,75 @@ void tTVPNativeBaseBitmap::DrawTextMultiple(
         p++;
     }
 
-    // draw shadows first
-    if(shlevel != 0) {
-        for(std::vector<tTVPCharacterDrawData>::iterator i = drawdata.begin();
-            i != drawdata.end(); i++) {
-            tTVPCharacterData *shadow = i->Shadow;
-
-            if(shadow) {
-                i->ShadowDrawn =
-                    InternalDrawText(shadow, i->X + shofsx, i->Y + shofsy,
-                                     shadowcolor, &dtdata, i->ShadowRect);
+    DrawCharacters(destrect, drawdata, color, bltmode, opa, holdalpha,
+                   shadowcolor, shofsx, shofsy, updaterects,
+                   TVPIsSoftwareRenderManager());
+}
+//---------------------------------------------------------------------------
+void tTVPNativeBaseBitmap::DrawCharacters(
+    const tTVPRect &destrect, std::vector<tTVPCharacterDrawData> &drawdata,
+    tjs_uint32 color, tTVPBBBltMethod bltmode, tjs_int opa, bool holdalpha,
+    tjs_uint32 shadowcolor, tjs_int shofsx, tjs_int shofsy,
+    tTVPComplexRect *updaterects, bool blendline) {
+    tTVPDrawTextData dtdata;
+    dtdata.rect = destrect;
+    dtdata.bmppitch = GetPitchBytes();
+    dtdata.bltmode = bltmode;
+    dtdata.opa = opa;
+    dtdata.holdalpha = holdalpha;
+
+    if(blendline) {
+        // clip all characters, then blend the line at once
+        std::vector<tTVPTextBlit> blits;
+        blits.reserve(drawdata.size() * 2);
+        tTVPRect srect, drect;
+        for(auto &i : drawdata) {
+            if(!i.Shadow)
+                continue;
+            i.ShadowDrawn =
+                TVPClipCharacterRect(i.Shadow, i.X + shofsx, i.Y + shofsy,
+                                     dtdata.rect, srect, i.ShadowRect);
+            if(i.ShadowDrawn)
+                blits.push_back({ i.Shadow->GetData() +
+                                      i.Shadow->Pitch * srect.top + srect.left,
+                                  i.Shadow->Pitch, i.ShadowRect, shadowcolor });
+        }
+        for(auto &i : drawdata) {
+            bool drawn = TVPClipCharacterRect(i.Data, i.X, i.Y, dtdata.rect,
+                                              srect, drect);
+            if(drawn)
+                blits.push_back({ i.Data->GetData() +
+                                      i.Data->Pitch * srect.top + srect.left,
+                                  i.Data->Pitch, drect, color });
+            if(updaterects) {
+                if(!i.ShadowDrawn) {
+                    if(drawn)
+                        updaterects->Or(drect);
+                } else {
+                    if(drawn) {
+                        tTVPRect d;
+                        TVPUnionRect(&d, drect, i.ShadowRect);
+                        updaterects->Or(d);
+                    } else {
+                        updaterects->Or(i.ShadowRect);
+                    }
+                }
             }
         }
+        TVPBlendTextLine(GetTextureForRender(true, nullptr), blits, &dtdata);
+        return;
+    }
+
+    // draw shadows first
+    for(std::vector<tTVPCharacterDrawData>::iterator i = drawdata.begin();
+        i != drawdata.end(); i++) {
+        tTVPCharacterData *shadow = i->Shadow;
+
+        if(shadow) {
+            i->ShadowDrawn =
+                InternalDrawText(shadow, i->X + shofsx, i->Y + shofsy,
+                                 shadowcolor, &dtdata, i->ShadowRect);
+        }
     }
 
     // then draw main characters
@@ -1432,6 +1692,27 @@ void tTVPNativeBaseBitmap::DrawTextMultiple(
     }
 }
 //---------------------------------------------------------------------------
+void tTVPNativeBaseBitmap::PrepareText(const ttstr &text, bool aa,
+                                       tjs_int shlevel, tjs_int shwidth) {
+    // rasterize the characters of the text ahead of drawing them
+    if(text.IsEmpty())
+        return;
+
+    ApplyFont();
+
+    tTVPFontAndCharacterData font;
+    font.Font = Font;
+    font.Antialiased = aa;
+    font.Hinting = true;
+    font.BlurLevel = shlevel;
+    font.BlurWidth = shwidth;
+    font.FontHash = FontHash;
+    font.Blured = shlevel != 0 && !(shlevel == 255 && shwidth == 0);
+
+    TVPPrepareCharacters(font, text.c_str(), this, PrerenderedFont,
+                         AscentOfsX, AscentOfsY);
+}
+//---------------------------------------------------------------------------
 void tTVPNativeBaseBitmap::GetTextSize(const ttstr &text) {
     ApplyFont();
 
@@ -104,6 +104,26 @@ class tTVPComplexRect;
 class tTVPCharacterData;
 struct tTVPDrawTextData;
 class tTVPPrerenderedFont;
+
+//---------------------------------------------------------------------------
+// tTVPCharacterDrawData : a character of a line and its shadow, placed at
+// the position to draw
+//---------------------------------------------------------------------------
+struct tTVPCharacterDrawData {
+    tTVPCharacterData *Data; // main character data
+    tTVPCharacterData *Shadow; // shadow character data
+    tjs_int X, Y;
+    tTVPRect ShadowRect;
+    bool ShadowDrawn;
+
+    tTVPCharacterDrawData(tTVPCharacterData *data, tTVPCharacterData *shadow,
+                          tjs_int x, tjs_int y);
+    ~tTVPCharacterDrawData();
+    tTVPCharacterDrawData(const tTVPCharacterDrawData &rhs);
+    void operator=(const tTVPCharacterDrawData &rhs);
+};
+//---------------------------------------------------------------------------
+
 class tTVPNativeBaseBitmap {
 public:
     tTVPNativeBaseBitmap(/*tjs_uint w, tjs_uint h, tjs_uint bpp*/);
@@ -139,6 +159,12 @@ public:
     void *GetScanLineForWrite(tjs_uint l);
     tjs_int GetPitchBytes() const;
 
+    /* whole image, which can be walked from the first line by the pitch */
+    const void *GetPixelData() const;
+    // same as GetPixelData, but only the lines from "top" to "bottom" - 1
+    // are sure to be valid
+    const void *GetPixelDataForLines(tjs_uint top, tjs_uint bottom) const;
+
     /* object lifetime management */
     void Independ();
     void IndependNoCopy();
@@ -225,6 +251,20 @@ public:
                            aa, shlevel, shadowcolor, shwidth, shofsx, shofsy,
                            updaterects);
     }
+    // draws the characters placed by DrawTextMultiple, shadows first. with
+    // "blendline" the whole line is blended at once to the software bitmap;
+    // otherwise each character goes through the render manager. "opa" is
+    // in the range DrawTextMultiple clamps it to.
+    void DrawCharacters(const tTVPRect &destrect,
+                        std::vector<tTVPCharacterDrawData> &drawdata,
+                        tjs_uint32 color, tTVPBBBltMethod bltmode, tjs_int opa,
+                        bool holdalpha, tjs_uint32 shadowcolor, tjs_int shofsx,
+                        tjs_int shofsy, tTVPComplexRect *updaterects,
+                        bool blendline);
+    // rasterizes the characters of the text which are not in the font
+    // cache yet, with the shadow parameters DrawText will be given
+    void PrepareText(const ttstr &text, bool aa = true, tjs_int shlevel = 0,
+                     tjs_int shwidth = 0);
     void DrawGlyph(iTJSDispatch2 *glyph, const tTVPRect &destrect, tjs_int x,
                    tjs_int y, tjs_uint32 color, tTVPBBBltMethod bltmode,
                    tjs_int opa = 255, bool holdalpha = true, bool aa = true,
@@ -0,0 +1,119 @@
+//
+// the bitmap bits allocator keeps freed blocks for reuse within its budget;
+// the benchmark churns textures of a few geometries like a running game
+//
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "tjsCommHead.h"
+#include "tjsUtils.h"
+#include "BitmapBitsAlloc.h"
+
+namespace {
+    tTVPBitmapBitsAllocStat get_statistics() {
+        tTVPBitmapBitsAllocStat stat;
+        tTVPBitmapBitsAlloc::GetStatistics(stat);
+        return stat;
+    }
+} // namespace
+
+TEST_CASE("bitmap bits are reused from the pool") {
+    tTVPBitmapBitsAlloc::Compact();
+    const tjs_uint size = 640 * 480 * 4;
+
+    void *p = tTVPBitmapBitsAlloc::Alloc(size, 640, 480);
+    tTVPBitmapBitsAlloc::Free(p);
+    tTVPBitmapBitsAllocStat stat = get_statistics();
+    REQUIRE(stat.PooledBytes >= size);
+
+    // the same geometry gets the same block
+    void *q = tTVPBitmapBitsAlloc::Alloc(size, 640, 480);
+    REQUIRE(q == p);
+    REQUIRE(get_statistics().ReuseCount == stat.ReuseCount + 1);
+    REQUIRE(get_statistics().PooledBytes == 0);
+
+    // a much larger request does not take a smaller block
+    tTVPBitmapBitsAlloc::Free(q);
+    void *r = tTVPBitmapBitsAlloc::Alloc(size * 2, 640, 960);
+    REQUIRE(get_statistics().ReuseCount == stat.ReuseCount + 1);
+    tTVPBitmapBitsAlloc::Free(r);
+
+    // small blocks are left to malloc
+    stat = get_statistics();
+    tTVPBitmapBitsAlloc::Free(tTVPBitmapBitsAlloc::Alloc(32 * 4, 32, 1));
+    REQUIRE(get_statistics().PooledBytes == stat.PooledBytes);
+
+    tTVPBitmapBitsAlloc::Compact();
+    REQUIRE(get_statistics().PooledBytes == 0);
+}
+
+TEST_CASE("the bitmap bits pool releases the blocks freed first") {
+    tTVPBitmapBitsAlloc::Compact();
+    const tjs_uint size = 4 * 1024 * 1024;
+    const uint64_t limit = get_statistics().PoolLimit;
+    REQUIRE(limit >= size);
+
+    // free more than the budget
+    std::vector<void *> blocks;
+    for(uint64_t i = 0; i < limit / size + 4; i++)
+        blocks.push_back(tTVPBitmapBitsAlloc::Alloc(size, 1024, 1024));
+    for(void *p : blocks)
+        tTVPBitmapBitsAlloc::Free(p);
+    tTVPBitmapBitsAllocStat stat = get_statistics();
+    REQUIRE(stat.PooledBytes <= limit);
+    REQUIRE(stat.PooledBytes + 2 * size > limit);
+
+    // the pool holds the blocks freed last
+    std::vector<void *> reused;
+    while(get_statistics().PooledBytes)
+        reused.push_back(tTVPBitmapBitsAlloc::Alloc(size, 1024, 1024));
+    REQUIRE(get_statistics().ReuseCount == stat.ReuseCount + reused.size());
+    REQUIRE(reused.size() < blocks.size());
+    std::vector<void *> last(blocks.end() - reused.size(), blocks.end());
+    std::sort(reused.begin(), reused.end());
+    std::sort(last.begin(), last.end());
+    REQUIRE(reused == last);
+    for(void *p : reused)
+        tTVPBitmapBitsAlloc::Free(p);
+
+    // a block over the budget is never kept
+    stat = get_statistics();
+    void *huge = tTVPBitmapBitsAlloc::Alloc((tjs_uint)limit + size, 1, 1);
+    tTVPBitmapBitsAlloc::Free(huge);
+    REQUIRE(get_statistics().PooledBytes == stat.PooledBytes);
+
+    tTVPBitmapBitsAlloc::Compact();
+}
+
+// textures of a few geometries allocated, touched and freed in random
+// order, with a few of them alive at a time
+TEST_CASE("bitmap bits churn benchmark", "[.][benchmark]") {
+    const tjs_uint sizes[] = { 1280 * 720 * 4, 1920 * 1080 * 4, 800 * 600 * 4,
+                               1280 * 4 * 4, 300 * 200 * 4 };
+
+    BENCHMARK("20000 allocations") {
+        std::mt19937 rng(1);
+        std::vector<void *> live;
+        for(int i = 0; i < 20000; i++) {
+            tjs_uint size = sizes[rng() % 5];
+            tjs_uint8 *p =
+                (tjs_uint8 *)tTVPBitmapBitsAlloc::Alloc(size, size / 4, 1);
+            for(tjs_uint o = 0; o < size; o += 4096)
+                p[o] = 1; // fault the pages in
+            live.push_back(p);
+            if(live.size() > 6) {
+                size_t k = rng() % live.size();
+                tTVPBitmapBitsAlloc::Free(live[k]);
+                live.erase(live.begin() + k);
+            }
+        }
+        for(void *p : live)
+            tTVPBitmapBitsAlloc::Free(p);
+        return live.size();
+    };
+}
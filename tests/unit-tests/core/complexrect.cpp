@@ -0,0 +1,183 @@
+//
+// tTVPComplexRect must keep the banded form and match a per-pixel
+// reference; the benchmark replays typical per-frame update patterns
+//
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <random>
+#include <vector>
+
+#include "tjsCommHead.h"
+#include "ComplexRect.h"
+
+namespace {
+    const tjs_int W = 64, H = 64;
+
+    struct pixel_region {
+        std::vector<char> Bits = std::vector<char>(W * H);
+
+        void Apply(const tTVPRect &r, int op) {
+            for(tjs_int y = 0; y < H; y++)
+                for(tjs_int x = 0; x < W; x++) {
+                    bool in = x >= r.left && x < r.right && y >= r.top &&
+                        y < r.bottom;
+                    char &b = Bits[y * W + x];
+                    b = op == 0 ? (b || in) : op == 1 ? (b && !in) : (b && in);
+                }
+        }
+    };
+
+    tTVPRect random_rect(std::mt19937 &rng) {
+        tjs_int l = rng() % W, t = rng() % H;
+        tjs_int r = l + rng() % 24, b = t + rng() % 24;
+        return tTVPRect(l, t, r < W ? r : W, b < H ? b : H);
+    }
+
+    void check_region(const tTVPComplexRect &region, const pixel_region &ref) {
+        std::vector<char> bits(W * H);
+        std::vector<tTVPRect> rects;
+        bool overlapped = false;
+        tTVPComplexRect::tIterator it = region.GetIterator();
+        while(it.Step()) {
+            REQUIRE(!it->is_empty());
+            rects.push_back(*it);
+            for(tjs_int y = it->top; y < it->bottom; y++)
+                for(tjs_int x = it->left; x < it->right; x++) {
+                    overlapped = overlapped || bits[y * W + x];
+                    bits[y * W + x] = true;
+                }
+        }
+        REQUIRE(!overlapped);
+        REQUIRE(bits == ref.Bits);
+        REQUIRE((tjs_int)rects.size() == region.GetCount());
+
+        // banded form
+        tTVPRect bound;
+        for(size_t i = 0; i < rects.size(); i++) {
+            if(i == 0) {
+                bound = rects[i];
+                continue;
+            }
+            bound.do_union(rects[i]);
+            const tTVPRect &p = rects[i - 1], &c = rects[i];
+            if(p.top == c.top) {
+                REQUIRE(p.bottom == c.bottom);
+                REQUIRE(p.right < c.left); // spans never touch
+            } else {
+                REQUIRE(p.bottom <= c.top);
+            }
+        }
+        if(!rects.empty())
+            REQUIRE(region.GetBound() == bound);
+    }
+} // namespace
+
+TEST_CASE("tTVPComplexRect matches per-pixel reference") {
+    std::mt19937 rng(1234);
+    for(int round = 0; round < 200; round++) {
+        tTVPComplexRect region;
+        pixel_region ref;
+        for(int step = 0; step < 30; step++) {
+            tTVPRect r = random_rect(rng);
+            int op = rng() % 4;
+            if(op == 3) {
+                // region operand
+                tTVPComplexRect other;
+                pixel_region other_ref;
+                for(int i = 0; i < 4; i++) {
+                    tTVPRect o = random_rect(rng);
+                    other.Or(o);
+                    other_ref.Apply(o, 0);
+                }
+                bool sub = rng() & 1;
+                if(sub)
+                    region.Sub(other);
+                else
+                    region.Or(other);
+                for(size_t i = 0; i < ref.Bits.size(); i++)
+                    ref.Bits[i] = sub ? ref.Bits[i] && !other_ref.Bits[i]
+                                      : ref.Bits[i] || other_ref.Bits[i];
+            } else {
+                if(op == 0)
+                    region.Or(r);
+                else if(op == 1)
+                    region.Sub(r);
+                else
+                    region.And(r);
+                ref.Apply(r, op);
+            }
+            check_region(region, ref);
+        }
+
+        tTVPComplexRect copy;
+        copy.CopyWithOffsets(region, tTVPRect(8, 8, 40, 40), 3, -2);
+        pixel_region copy_ref;
+        for(tjs_int y = 0; y < H; y++)
+            for(tjs_int x = 0; x < W; x++) {
+                tjs_int sx = x - 3, sy = y + 2;
+                copy_ref.Bits[y * W + x] = x >= 8 && x < 40 && y >= 8 &&
+                    y < 40 && sx >= 0 && sx < W && sy >= 0 && sy < H &&
+                    ref.Bits[sy * W + sx];
+            }
+        check_region(copy, copy_ref);
+    }
+}
+
+TEST_CASE("tTVPComplexRect coalesces vertically adjacent bands") {
+    tTVPComplexRect region;
+    for(tjs_int y = 0; y < 32; y += 2)
+        region.Or(tTVPRect(4, y, 20, y + 2));
+    REQUIRE(region.GetCount() == 1);
+    REQUIRE(region.GetBound() == tTVPRect(4, 0, 20, 32));
+
+    region.Sub(tTVPRect(8, 8, 12, 16));
+    REQUIRE(region.GetCount() == 4);
+    region.Or(tTVPRect(8, 8, 12, 16));
+    REQUIRE(region.GetCount() == 1);
+}
+
+// update patterns of a novel game frame: a message window drawing glyphs
+// one by one, a few animated sprites (old and new positions), and an
+// opaque layer which excludes the region behind it.
+TEST_CASE("tTVPComplexRect update pattern benchmark", "[.][benchmark]") {
+    struct frame {
+        std::vector<tTVPRect> Updates;
+        tTVPRect Exclude;
+    };
+    std::vector<frame> frames;
+    std::mt19937 rng(42);
+    tjs_int glyph = 0;
+    for(int f = 0; f < 60; f++) {
+        frame fr;
+        for(int g = 0; g < 24; g++, glyph++) {
+            tjs_int line = (glyph / 40) % 4, col = glyph % 40;
+            fr.Updates.push_back(tTVPRect(40 + col * 24, 560 + line * 32,
+                                          64 + col * 24, 592 + line * 32));
+        }
+        for(int s = 0; s < 16; s++) {
+            tjs_int x = (s * 97 + f * 5) % 1180, y = (s * 53 + f * 3) % 620;
+            fr.Updates.push_back(tTVPRect(x, y, x + 96, y + 96));
+            fr.Updates.push_back(tTVPRect(x + 5, y + 3, x + 101, y + 99));
+        }
+        for(int p = 0; p < 64; p++) { // particles
+            tjs_int x = rng() % 1270, y = rng() % 710;
+            fr.Updates.push_back(tTVPRect(x, y, x + 10, y + 10));
+        }
+        fr.Exclude = tTVPRect(0, 0, 320, 180);
+        frames.push_back(fr);
+    }
+
+    BENCHMARK("replay 60 frames") {
+        tjs_int total = 0;
+        for(const frame &fr : frames) {
+            tTVPComplexRect region;
+            for(const tTVPRect &r : fr.Updates)
+                region.Or(r);
+            region.Sub(fr.Exclude);
+            total += region.GetCount();
+        }
+        return total;
+    };
+}
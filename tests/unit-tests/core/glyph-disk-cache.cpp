@@ -0,0 +1,237 @@
+//
+// glyphs stored in the disk cache must read back as they were rendered;
+// records cut or damaged in the file are skipped and rendered again
+//
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "tjsCommHead.h"
+#include "GlyphDiskCache.h"
+
+namespace {
+    const tjs_uint64 FontHash = 0x1234567890abcdefULL;
+    const size_t RecordHeaderSize = 9 * 4; // fields of a record
+
+    std::string cache_file_name() {
+        std::filesystem::path path =
+            std::filesystem::temp_directory_path() / "krkr2-glyph-test.gly";
+        std::filesystem::remove(path);
+        return path.string();
+    }
+
+    tjs_uint glyph_width(tjs_uint32 ch) { return 3 + ch % 17; }
+    tjs_uint glyph_height(tjs_uint32 ch) { return 5 + ch % 13; }
+
+    // a glyph of "ch", with coverage and metrics of its own
+    tTVPCharacterData *make_glyph(tjs_uint32 ch, tjs_int aofsx) {
+        tjs_uint w = glyph_width(ch), h = glyph_height(ch);
+        std::vector<tjs_uint8> coverage(w * h);
+        for(size_t i = 0; i < coverage.size(); i++)
+            coverage[i] = (tjs_uint8)(i * 7 + ch);
+        tGlyphMetrics metrics;
+        metrics.CellIncX = (tjs_int)(10 + ch % 5);
+        metrics.CellIncY = -(tjs_int)(ch % 3);
+        tTVPCharacterData *data =
+            new tTVPCharacterData(coverage.data(), w, (tjs_int)(ch % 4) + aofsx,
+                                  -(tjs_int)(ch % 9), w, h, metrics);
+        data->Gray = ch % 2 ? 65 : 256;
+        return data;
+    }
+
+    bool same_glyph(const tTVPCharacterData *a, const tTVPCharacterData *b) {
+        if(a->OriginX != b->OriginX || a->OriginY != b->OriginY ||
+           a->Metrics.CellIncX != b->Metrics.CellIncX ||
+           a->Metrics.CellIncY != b->Metrics.CellIncY ||
+           a->BlackBoxX != b->BlackBoxX || a->BlackBoxY != b->BlackBoxY ||
+           a->Gray != b->Gray)
+            return false;
+        for(tjs_uint y = 0; y < a->BlackBoxY; y++)
+            if(memcmp(a->GetData() + (size_t)a->Pitch * y,
+                      b->GetData() + (size_t)b->Pitch * y, a->BlackBoxX))
+                return false;
+        return true;
+    }
+
+    // whether "ch", stored with "stored_aofsx", reads back from "file"
+    bool reads_back(tTVPGlyphCacheFile &file, tjs_uint32 ch,
+                    tjs_int stored_aofsx = 0, tjs_int aofsx = 0) {
+        tTVPCharacterData *data = file.Read(ch, aofsx);
+        if(!data)
+            return false;
+        tTVPCharacterData *expected = make_glyph(ch, stored_aofsx);
+        expected->OriginX += aofsx - stored_aofsx;
+        bool same = same_glyph(data, expected);
+        expected->Release();
+        data->Release();
+        return same;
+    }
+
+    void write_glyph(tTVPGlyphCacheFile &file, tjs_uint32 ch,
+                     tjs_int aofsx = 0) {
+        tTVPCharacterData *data = make_glyph(ch, aofsx);
+        file.Write(ch, aofsx, data);
+        data->Release();
+    }
+
+    // where the record of "ch" starts, when the characters from "first" on
+    // were stored in order
+    size_t record_offset(tjs_uint32 first, tjs_uint32 ch) {
+        size_t pos = sizeof(tTVPGlyphCacheHeader);
+        for(tjs_uint32 c = first; c < ch; c++) {
+            size_t size = (size_t)glyph_width(c) * glyph_height(c);
+            pos += RecordHeaderSize + ((size + 3) & ~(size_t)3);
+        }
+        return pos;
+    }
+
+    std::vector<char> read_file(const std::string &name) {
+        std::ifstream in(name, std::ios::binary);
+        return { std::istreambuf_iterator<char>(in),
+                 std::istreambuf_iterator<char>() };
+    }
+
+    void write_file(const std::string &name, const std::vector<char> &data) {
+        std::ofstream out(name, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), (std::streamsize)data.size());
+    }
+} // namespace
+
+TEST_CASE("glyphs round-trip through the disk cache") {
+    std::string name = cache_file_name();
+    {
+        tTVPGlyphCacheFile file(name, FontHash);
+        REQUIRE(file.Read(0x3042, 0) == nullptr);
+        for(tjs_uint32 ch = 0x3041; ch < 0x3041 + 40; ch++)
+            write_glyph(file, ch, ch % 3);
+        REQUIRE(file.GetPendingSize() > 0);
+
+        // readable before they are written
+        REQUIRE(reads_back(file, 0x3042, 0x3042 % 3));
+        file.Flush();
+        REQUIRE(file.GetPendingSize() == 0);
+    }
+
+    {
+        // the origin is stored without the offset given to the rasterizer
+        tTVPGlyphCacheFile file(name, FontHash);
+        for(tjs_uint32 ch = 0x3041; ch < 0x3041 + 40; ch++) {
+            REQUIRE(reads_back(file, ch, ch % 3, ch % 3));
+            REQUIRE(reads_back(file, ch, ch % 3, 5));
+        }
+        REQUIRE(file.Read(0x3041 + 40, 0) == nullptr);
+
+        // appended to the file loaded
+        write_glyph(file, 'A');
+        file.Flush();
+    }
+
+    {
+        tTVPGlyphCacheFile file(name, FontHash);
+        REQUIRE(reads_back(file, 'A'));
+        REQUIRE(reads_back(file, 0x3041, 0x3041 % 3));
+    }
+
+    {
+        // stored for another font; made again
+        tTVPGlyphCacheFile file(name, FontHash + 1);
+        REQUIRE(file.Read('A', 0) == nullptr);
+        write_glyph(file, 'B');
+        file.Flush();
+    }
+    {
+        tTVPGlyphCacheFile file(name, FontHash + 1);
+        REQUIRE(reads_back(file, 'B'));
+        REQUIRE(file.Read('A', 0) == nullptr);
+    }
+    std::filesystem::remove(name);
+}
+
+TEST_CASE("cut or damaged glyph records are skipped") {
+    std::string name = cache_file_name();
+    const tjs_uint32 first = 0x4e00, count = 10;
+    {
+        tTVPGlyphCacheFile file(name, FontHash);
+        for(tjs_uint32 ch = first; ch < first + count; ch++)
+            write_glyph(file, ch);
+        file.Flush();
+    }
+    const std::vector<char> whole = read_file(name);
+    REQUIRE(whole.size() == record_offset(first, first + count));
+
+    SECTION("a record cut by the end of the file") {
+        std::vector<char> cut(whole.begin(), whole.end() - 7);
+        write_file(name, cut);
+        {
+            tTVPGlyphCacheFile file(name, FontHash);
+            for(tjs_uint32 ch = first; ch < first + count - 1; ch++)
+                REQUIRE(reads_back(file, ch));
+            REQUIRE(file.Read(first + count - 1, 0) == nullptr);
+
+            // appended over the cut record
+            write_glyph(file, first + count - 1);
+            write_glyph(file, 'C');
+            file.Flush();
+        }
+        REQUIRE(read_file(name).size() > whole.size());
+        tTVPGlyphCacheFile file(name, FontHash);
+        for(tjs_uint32 ch = first; ch < first + count; ch++)
+            REQUIRE(reads_back(file, ch));
+        REQUIRE(reads_back(file, 'C'));
+    }
+
+    SECTION("a damaged coverage byte") {
+        std::vector<char> damaged(whole);
+        damaged[record_offset(first, first + 4) + RecordHeaderSize + 1] ^= 0x5a;
+        write_file(name, damaged);
+        {
+            tTVPGlyphCacheFile file(name, FontHash);
+            tjs_uint32 broken = 0;
+            for(tjs_uint32 ch = first; ch < first + count; ch++)
+                if(!reads_back(file, ch))
+                    broken++;
+            REQUIRE(broken == 1);
+            REQUIRE(file.Read(first + 4, 0) == nullptr);
+
+            // rendered and stored again
+            for(tjs_uint32 ch = first; ch < first + count; ch++)
+                write_glyph(file, ch);
+            REQUIRE(file.GetPendingSize() > 0);
+            file.Flush();
+        }
+        tTVPGlyphCacheFile file(name, FontHash);
+        for(tjs_uint32 ch = first; ch < first + count; ch++)
+            REQUIRE(reads_back(file, ch));
+    }
+
+    SECTION("a record claiming a huge glyph") {
+        // the records after it can not be found
+        std::vector<char> damaged(whole);
+        size_t pos = record_offset(first, first + 1) + 5 * 4; // BlackBoxX
+        tjs_uint32 huge = 0x7fffffff;
+        memcpy(damaged.data() + pos, &huge, sizeof(huge));
+        write_file(name, damaged);
+
+        tTVPGlyphCacheFile file(name, FontHash);
+        REQUIRE(reads_back(file, first));
+        for(tjs_uint32 ch = first + 1; ch < first + count; ch++)
+            REQUIRE(file.Read(ch, 0) == nullptr);
+    }
+
+    SECTION("a file shorter than its header") {
+        std::vector<char> cut(whole.begin(), whole.begin() + 10);
+        write_file(name, cut);
+        tTVPGlyphCacheFile file(name, FontHash);
+        REQUIRE(file.Read(first, 0) == nullptr);
+        write_glyph(file, first);
+        file.Flush();
+        tTVPGlyphCacheFile again(name, FontHash);
+        REQUIRE(reads_back(again, first));
+    }
+    std::filesystem::remove(name);
+}
@@ -0,0 +1,61 @@
+//
+// the async image loader reads the request of the highest priority first,
+// the oldest one within a priority; a request for a path already queued
+// shares that load and raises its priority
+//
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tjsCommHead.h"
+#include "GraphicsLoadThread.h"
+
+namespace {
+    // the paths in the order the loader takes them
+    std::vector<std::string> take_all(tTVPAsyncImageLoader &loader,
+                                      std::vector<std::unique_ptr<
+                                          tTVPImageLoadCommand>> &taken) {
+        std::vector<std::string> paths;
+        while(tTVPImageLoadCommand *cmd = loader.PopLoadQueue()) {
+            taken.emplace_back(cmd);
+            paths.push_back(cmd->path_.AsStdString());
+        }
+        return paths;
+    }
+} // namespace
+
+TEST_CASE("async image loads are taken by priority") {
+    // outlive the loader, which forgets the commands being loaded
+    std::vector<std::unique_ptr<tTVPImageLoadCommand>> taken;
+    tTVPAsyncImageLoader loader; // not started; the test takes the commands
+
+    loader.PushLoadQueue(nullptr, nullptr, TJS_W("a.png"), 0);
+    loader.PushLoadQueue(nullptr, nullptr, TJS_W("b.png"), 5);
+    loader.PushLoadQueue(nullptr, nullptr, TJS_W("c.png"), 0);
+    loader.PushLoadQueue(nullptr, nullptr, TJS_W("d.png"), 5);
+    loader.PushLoadQueue(nullptr, nullptr, TJS_W("e.png"), -1);
+    loader.PushLoadQueue(nullptr, nullptr, TJS_W("f.png"), 0);
+
+    // a second request shares the queued load and raises it
+    loader.PushLoadQueue(nullptr, nullptr, TJS_W("f.png"), 7);
+    // a lower one does not lower it
+    loader.PushLoadQueue(nullptr, nullptr, TJS_W("b.png"), -3);
+
+    REQUIRE(take_all(loader, taken) ==
+            std::vector<std::string>{ "f.png", "b.png", "d.png", "a.png",
+                                      "c.png", "e.png" });
+    REQUIRE(taken[0]->waiters_.size() == 1);
+    REQUIRE(taken[0]->priority_ == 7);
+    REQUIRE(taken[1]->waiters_.size() == 1);
+    REQUIRE(taken[1]->priority_ == 5);
+    REQUIRE(loader.PopLoadQueue() == nullptr);
+
+    // a path being loaded is not queued again
+    loader.PushLoadQueue(nullptr, nullptr, TJS_W("a.png"), 9);
+    loader.PushLoadQueue(nullptr, nullptr, TJS_W("g.png"), 0);
+    REQUIRE(take_all(loader, taken) == std::vector<std::string>{ "g.png" });
+    REQUIRE(taken[3]->waiters_.size() == 1);
+}
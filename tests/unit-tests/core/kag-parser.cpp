@@ -0,0 +1,196 @@
+//
+// KAG scenario tags are tokenized when the scenario is loaded; the parser
+// must return the same tags as the character scanner, also after the
+// tokenized form went through the ".ksc" cache file
+//
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <vector>
+
+#include "tjsCommHead.h"
+#include "tjs.h"
+#include "KAGParser.h"
+
+using namespace TJS;
+
+extern tTJS *TVPScriptEngine; // evaluates "&" attributes and conditions
+
+namespace {
+    const tjs_char *scenario = TJS_W(R"(; comment line
+*start|First page
+Hello[l][r]
+[[not a tag] text	with tab[p]
+[font size=20 color="0xff0000" face='MS Gothic' bold]Bold text[resetfont]
+@wait time=100 canskip
+[if exp="f.x == void"]x is void[elsif exp="f.x == 4"]four[else]other[endif]
+[ignore exp="true"]ignored[endignore]
+[macro name=mymac][ch text=%text|default][image storage=%st *][endmacro]
+[mymac text=abc st=bg1 layer=base]
+[mymac]
+[emb exp="'E' + 1"] after emb
+[link target=*next cond="1 == 1"]go[endlink]
+[a  b = c   d="e f"  g='h`'i'   j=`[k`]   l=&f.y   m=&"'q'"  n=%zz  ]
+[A B=C]mixed case[CH Text=Q]
+[tag attr="with ] bracket"]
+[tag x="a`"b"]
+@line x="quoted with spaces" y=1
+line continues\
+next line
+[iscript]
+var a = "[not a tag]";
+[endscript]
+*next
+after label[s]
+[tag a=1 cond=false][tag2 b=2 cond=true]
+	[indented x=1]
+[call target=*sub]back from call
+[jump target=*end]
+skipped[not]
+*sub
+in sub[return]
+*end
+[tag v=&"'[a]'"]done
+)");
+
+    // every tag with its attributes, and the labels and scripts met
+    const tjs_char *parse_script = TJS_W(R"(
+        global.f = %[ y : 7 ];
+        var out = [];
+        class TestParser extends KAGParser {
+            function TestParser() { super.KAGParser(); }
+            function onScenarioLoad(name) { return global.scenario; }
+            function onLabel(label, page) {
+                out.add("label:" + label + "/" + page);
+            }
+            function onScript(script, storage, line) {
+                out.add("script@" + line + ":" + script);
+            }
+        }
+        var p = new TestParser();
+        p.loadScenario("test.ks");
+        for(var n = 0; n < 1000; n++) {
+            var tag = p.getNextTag();
+            if(tag === void) break;
+            var items = [];
+            items.assign(tag);
+            var pairs = [];
+            for(var i = 0; i < items.count; i += 2)
+                pairs.add(items[i] + "=" + items[i + 1]);
+            pairs.sort();
+            out.add(p.curLine + ":" + p.curPos + " " + pairs.join(" "));
+        }
+        invalidate p;
+        return out.join("\n");
+    )");
+
+    ttstr parse_scenario(bool tokenized) {
+        struct engine {
+            tTJS *TJS = new tTJS();
+            engine(bool tokenized) {
+                TVPScriptEngine = TJS;
+                TVPKAGUseTokenizedTags = tokenized;
+            }
+            ~engine() {
+                TVPKAGUseTokenizedTags = true;
+                TVPScriptEngine = nullptr;
+                TJS->Shutdown();
+                TJS->Release();
+            }
+        } e(tokenized);
+
+        iTJSDispatch2 *global = e.TJS->GetGlobalNoAddRef();
+        iTJSDispatch2 *cls = TVPCreateNativeClass_KAGParser();
+        tTJSVariant val(cls, nullptr);
+        cls->Release();
+        global->PropSet(TJS_MEMBERENSURE, TJS_W("KAGParser"), nullptr, &val,
+                        global);
+        val = scenario;
+        global->PropSet(TJS_MEMBERENSURE, TJS_W("scenario"), nullptr, &val,
+                        global);
+
+        tTJSVariant result;
+        e.TJS->ExecScript(parse_script, &result);
+        return result;
+    }
+
+    // number of tags, or -1 if the items do not have the same tags
+    tjs_int compare_tags(const tTVPScenarioCacheItem *a,
+                         const tTVPScenarioCacheItem *b) {
+        tjs_int count = 0;
+        for(tjs_int i = 0; i < a->GetLineCount(); i++) {
+            for(tjs_int p = 0; p <= a->GetLines()[i].Length; p++) {
+                const tTVPScenarioTag *ta = a->FindTag(i, p);
+                const tTVPScenarioTag *tb = b->FindTag(i, p);
+                if(!ta || !tb) {
+                    if(ta || tb)
+                        return -1;
+                    continue;
+                }
+                if(ta->End != tb->End || ta->Name != tb->Name ||
+                   ta->AttribCount != tb->AttribCount)
+                    return -1;
+                const tTVPScenarioTagAttrib *aa = a->GetTagAttribs(ta);
+                const tTVPScenarioTagAttrib *ab = b->GetTagAttribs(tb);
+                for(tjs_int n = 0; n < ta->AttribCount; n++)
+                    if(aa[n].Name != ab[n].Name || aa[n].Value != ab[n].Value ||
+                       aa[n].Entity != ab[n].Entity ||
+                       aa[n].MacroArg != ab[n].MacroArg ||
+                       aa[n].MacroArgAll != ab[n].MacroArgAll)
+                        return -1;
+                count++;
+            }
+        }
+        return count;
+    }
+} // namespace
+
+TEST_CASE("KAG tokenized tags read like the scanned ones") {
+    ttstr scanned = parse_scenario(false);
+    REQUIRE(parse_scenario(true) == scanned);
+
+    // the scenario went through the macros, labels and scripts
+    std::string str = scanned.AsStdString();
+    REQUIRE(str.find("st=bg1") != std::string::npos);
+    REQUIRE(str.find("text=default") != std::string::npos);
+    REQUIRE(str.find("layer=base") != std::string::npos);
+    REQUIRE(str.find("l=7") != std::string::npos);
+    REQUIRE(str.find("label:*sub/") != std::string::npos);
+    REQUIRE(str.find("script@") != std::string::npos);
+}
+
+TEST_CASE("KAG tokenized tags round-trip through the .ksc form") {
+    tTVPScenarioCacheItem *source = new tTVPScenarioCacheItem(scenario, true);
+    tTVPScenarioCacheItem *copy = new tTVPScenarioCacheItem(scenario, true);
+    std::vector<tjs_uint8> data;
+    source->SerializeTags(data);
+
+    // a damaged form leaves no tags
+    REQUIRE_FALSE(copy->UnserializeTags({}));
+    REQUIRE(compare_tags(copy, copy) == 0);
+
+    REQUIRE(copy->UnserializeTags(data));
+    REQUIRE(compare_tags(source, copy) > 30);
+
+    // cut anywhere
+    for(size_t size = 0; size < data.size(); size += 3) {
+        std::vector<tjs_uint8> cut(data.begin(), data.begin() + size);
+        REQUIRE_FALSE(copy->UnserializeTags(cut));
+    }
+    REQUIRE(compare_tags(copy, copy) == 0);
+
+    // counts and indices out of range
+    for(size_t pos : { (size_t)0, data.size() - 8, data.size() / 2 }) {
+        std::vector<tjs_uint8> damaged(data);
+        for(size_t i = pos; i < pos + 4; i++)
+            damaged[i] = 0xff;
+        copy->UnserializeTags(damaged); // must not crash
+    }
+    std::vector<tjs_uint8> longer(data);
+    longer.push_back(0);
+    REQUIRE_FALSE(copy->UnserializeTags(longer));
+
+    source->Release();
+    copy->Release();
+}
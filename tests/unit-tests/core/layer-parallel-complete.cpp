@@ -0,0 +1,177 @@
+//
+// a layer tree composited in stripes on the thread pool (-gsplit=parallel)
+// must give the draw buffer the pixels the serial stripes give
+//
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstring>
+#include <vector>
+
+#include "tjsCommHead.h"
+#include "tjs.h"
+#include "tvpgl.h"
+#include "LayerIntf.h"
+#include "LayerImpl.h"
+#include "LayerManager.h"
+#include "LayerTreeOwnerImpl.h"
+#include "ThreadIntf.h"
+
+using namespace TJS;
+
+extern tTJS *TVPScriptEngine;
+extern tjs_int TVPDrawThreadNum;
+
+namespace {
+    const tjs_int W = 640, H = 480;
+
+    // owns the layer tree; draws only when the test asks for it
+    class test_owner : public tTVPLayerTreeOwner {
+    public:
+        void StartBitmapCompletion(iTVPLayerManager *) override {}
+        void NotifyBitmapCompleted(iTVPLayerManager *, tjs_int, tjs_int,
+                                   tTVPBaseTexture *, const tTVPRect &,
+                                   tTVPLayerType, tjs_int) override {}
+        void EndBitmapCompletion(iTVPLayerManager *) override {}
+        void NotifyLayerImageChange(iTVPLayerManager *) override {}
+        iTJSDispatch2 *GetOwnerNoAddRef() const override { return nullptr; }
+
+        void OnSetMouseCursor(tjs_int) override {}
+        void OnGetCursorPos(tjs_int &, tjs_int &) override {}
+        void OnSetCursorPos(tjs_int, tjs_int) override {}
+        void OnReleaseMouseCapture() override {}
+        void OnSetHintText(iTJSDispatch2 *, const ttstr &) override {}
+        void OnResizeLayer(tjs_int, tjs_int) override {}
+        void OnChangeLayerImage() override {}
+        void OnSetAttentionPoint(tTJSNI_BaseLayer *, tjs_int,
+                                 tjs_int) override {}
+        void OnDisableAttentionPoint() override {}
+        void OnSetImeMode(tjs_int) override {}
+        void OnResetImeMode() override {}
+    };
+
+    // overlapping, nested layers of several types and opacities; some of
+    // them hidden, some crossing the edges of their parents
+    const tjs_char *tree_script = TJS_W(R"(
+        var owner = %[ layerTreeOwnerInterface : global.ownerInterface ];
+        var seed = 12345;
+        function rnd(n) {
+            seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+            return seed % n;
+        }
+        // ltOpaque, ltAlpha, ltAdditive, ltMultiplicative, ltScreen,
+        // ltAddAlpha
+        var types = [ 1, 2, 3, 5, 11, 12 ];
+
+        global.base = new Layer(owner, null);
+        base.setImageSize(640, 480);
+        base.setSizeToImageSize();
+        base.fillRect(0, 0, 640, 480, 0xff336699);
+        base.colorRect(100, 50, 300, 200, 0xffcc00, 128);
+
+        global.layers = [];
+        for(var i = 0; i < 40; i++) {
+            var parent = i < 10 ? base : layers[rnd(layers.count)];
+            var l = new Layer(owner, parent);
+            var w = 16 + rnd(320), h = 16 + rnd(240);
+            l.setImageSize(w, h);
+            l.setSizeToImageSize();
+            l.setPos(rnd(640) - 120, rnd(480) - 90);
+            l.type = types[rnd(types.count)];
+            l.fillRect(0, 0, w, h, (rnd(256) << 24) | rnd(0x1000000));
+            l.colorRect(rnd(w), rnd(h), 1 + rnd(w), 1 + rnd(h),
+                        rnd(0x1000000), rnd(256));
+            l.opacity = 64 + rnd(192);
+            l.visible = rnd(8) != 0;
+            layers.add(l);
+        }
+        return base;
+    )");
+
+    const tjs_char *cleanup_script = TJS_W(R"(
+        for(var i = layers.count - 1; i >= 0; i--)
+            invalidate layers[i];
+        invalidate base;
+    )");
+
+    // the draw buffer after "region" is composited in "mode"
+    std::vector<tjs_uint32> composite(tTVPLayerManager *manager,
+                                      tTVPGraphicSplitOperationType mode,
+                                      const std::vector<tTVPRect> &region) {
+        tTVPGraphicSplitOperationType saved = TVPGraphicSplitOperationType;
+        TVPGraphicSplitOperationType = mode;
+
+        tTVPBaseTexture *buffer = manager->GetOrCreateDrawBuffer();
+        buffer->Fill(tTVPRect(0, 0, buffer->GetWidth(), buffer->GetHeight()),
+                     0);
+        for(const tTVPRect &r : region)
+            manager->RequestInvalidation(r);
+        manager->UpdateToDrawDevice();
+        TVPGraphicSplitOperationType = saved;
+
+        std::vector<tjs_uint32> pixels(W * H);
+        for(tjs_int y = 0; y < H; y++)
+            memcpy(&pixels[y * W], buffer->GetScanLine(y), W * 4);
+        return pixels;
+    }
+} // namespace
+
+TEST_CASE("parallel layer compositing gives the serial pixels") {
+    TVPInitTVPGL();
+    tjs_int threads = TVPDrawThreadNum;
+    TVPDrawThreadNum = 4;
+
+    tTJS *tjs = new tTJS();
+    TVPScriptEngine = tjs;
+    iTJSDispatch2 *global = tjs->GetGlobalNoAddRef();
+    iTJSDispatch2 *cls = TVPCreateNativeClass_Layer();
+    tTJSVariant val(cls, nullptr);
+    cls->Release();
+    global->PropSet(TJS_MEMBERENSURE, TJS_W("Layer"), nullptr, &val, global);
+
+    test_owner owner;
+    val = reinterpret_cast<tjs_int64>(static_cast<iTVPLayerTreeOwner *>(&owner));
+    global->PropSet(TJS_MEMBERENSURE, TJS_W("ownerInterface"), nullptr, &val,
+                    global);
+
+    tTJSVariant base;
+    tjs->ExecScript(tree_script, &base);
+    tTJSNI_Layer *primary = tTJSNI_Layer::FromVariant(base);
+    REQUIRE(primary);
+    tTVPLayerManager *manager = primary->GetManager();
+    REQUIRE(manager);
+
+    SECTION("the whole layer") {
+        std::vector<tTVPRect> region{ tTVPRect(0, 0, W, H) };
+        std::vector<tjs_uint32> serial = composite(manager, gsotSimple, region);
+        std::vector<tjs_uint32> parallel =
+            composite(manager, gsotParallel, region);
+        REQUIRE(parallel == serial);
+
+        // something was drawn over the cleared buffer
+        REQUIRE(serial[W * 100 + 200] != 0);
+    }
+
+    SECTION("a region of several rectangles") {
+        std::vector<tTVPRect> region{ tTVPRect(13, 7, 301, 177),
+                                      tTVPRect(250, 150, 611, 471),
+                                      tTVPRect(0, 400, 40, 480) };
+        std::vector<tjs_uint32> serial = composite(manager, gsotSimple, region);
+        std::vector<tjs_uint32> parallel =
+            composite(manager, gsotParallel, region);
+        REQUIRE(parallel == serial);
+    }
+
+    SECTION("a single thread") {
+        TVPDrawThreadNum = 1;
+        std::vector<tTVPRect> region{ tTVPRect(0, 0, W, H) };
+        std::vector<tjs_uint32> serial = composite(manager, gsotSimple, region);
+        REQUIRE(composite(manager, gsotParallel, region) == serial);
+    }
+
+    tjs->ExecScript(cleanup_script);
+    TVPScriptEngine = nullptr;
+    tjs->Shutdown();
+    tjs->Release();
+    TVPDrawThreadNum = threads;
+}
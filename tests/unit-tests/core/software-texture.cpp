@@ -0,0 +1,120 @@
+//
+// compressed software textures decode their blocks on demand; every way of
+// reading them must give the pixels of the source bitmap
+//
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tjsCommHead.h"
+#include "tvpgl.h"
+#include "LayerBitmapIntf.h"
+#include "RenderManager.h"
+
+namespace {
+    const tjs_uint W = 67, H = 301;
+
+    tTVPBitmap *make_source(std::mt19937 &rng) {
+        tTVPBitmap *bmp = new tTVPBitmap(W, H, 32);
+        for(tjs_uint y = 0; y < H; y++) {
+            tjs_uint32 *line = (tjs_uint32 *)bmp->GetScanLine(y);
+            for(tjs_uint x = 0; x < W; x++) // gradients with some noise
+                line[x] = ((x * 3 + y) & 0xff) | ((y & 0xff) << 8) |
+                    ((rng() % 4) << 16) | (((x + y) & 0xff) << 24);
+        }
+        return bmp;
+    }
+
+    struct texture_check {
+        tTVPBitmap *Source;
+        std::string Method;
+
+        iTVPTexture2D *create() const {
+            return TVPCreateStaticSoftwareTexture2D(Source, Method);
+        }
+
+        tjs_uint32 expected(tjs_uint x, tjs_uint y) const {
+            if(Method == "halfline")
+                y &= ~1; // keeps even lines only
+            return ((const tjs_uint32 *)Source->GetScanLine(y))[x];
+        }
+
+        bool line_matches(const void *line, tjs_uint y) const {
+            for(tjs_uint x = 0; x < W; x++)
+                if(((const tjs_uint32 *)line)[x] != expected(x, y))
+                    return false;
+            return true;
+        }
+    };
+} // namespace
+
+TEST_CASE("compressed software textures read like their source") {
+    TVPInitTVPGL(); // for the TLG5 decoder
+    std::mt19937 rng(1234);
+    tTVPBitmap *bmp = make_source(rng);
+
+    for(const char *method : { "lz4", "lz4+tlg5", "halfline" }) {
+        INFO(method);
+        texture_check check{ bmp, method };
+
+        // scan lines, in no particular order
+        iTVPTexture2D *tex = check.create();
+        REQUIRE(tex->IsStatic());
+        for(tjs_uint i = 0; i < H; i++) {
+            tjs_uint y = (i * 97) % H;
+            REQUIRE(check.line_matches(tex->GetScanLineForRead(y), y));
+        }
+        tex->Release();
+
+        // single points
+        tex = check.create();
+        for(int i = 0; i < 2000; i++) {
+            tjs_uint x = rng() % W, y = rng() % H;
+            REQUIRE(tex->GetPoint(x, y) == check.expected(x, y));
+        }
+        tex->Release();
+
+        // a band of lines, walked by the pitch
+        tex = check.create();
+        tjs_int pitch = tex->GetPitch();
+        for(tjs_uint top : { 0u, 5u, 31u, 130u, 290u }) {
+            tjs_uint bottom = std::min(top + 37, H);
+            const tjs_uint8 *p =
+                (const tjs_uint8 *)tex->GetPixelDataForLines(top, bottom);
+            for(tjs_uint y = top; y < bottom; y++)
+                REQUIRE(check.line_matches(p + y * pitch, y));
+        }
+        tex->Release();
+
+        // whole image, walked by the pitch
+        tex = check.create();
+        const tjs_uint8 *p = (const tjs_uint8 *)tex->GetPixelData();
+        for(tjs_uint y = 0; y < H; y++)
+            REQUIRE(check.line_matches(p + y * tex->GetPitch(), y));
+        tex->Release();
+
+        // lines read by the threads drawing in parallel
+        tex = check.create();
+        std::vector<std::thread> threads;
+        std::vector<int> failed(4);
+        for(int t = 0; t < 4; t++)
+            threads.emplace_back([&, t] {
+                for(tjs_uint i = 0; i < H; i++) {
+                    tjs_uint y = (i * 7 + t * 61) % H;
+                    if(!check.line_matches(tex->GetScanLineForRead(y), y))
+                        failed[t]++;
+                }
+            });
+        for(auto &th : threads)
+            th.join();
+        REQUIRE(failed == std::vector<int>(4));
+        tex->Release();
+    }
+    iTVPTexture2D::RecycleProcess(); // deletes the released textures
+    bmp->Release();
+}
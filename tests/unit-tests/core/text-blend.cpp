@@ -0,0 +1,161 @@
+//
+// a line of text blended at once to a software bitmap must give the pixels
+// the characters give when they are drawn one by one through the render
+// manager, with shadows, clipping, every blend mode and the band split
+//
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "tjsCommHead.h"
+#include "tvpgl.h"
+#include "LayerBitmapIntf.h"
+#include "CharacterData.h"
+#include "ComplexRect.h"
+#include "ThreadIntf.h"
+
+extern tjs_int TVPDrawThreadNum;
+
+namespace {
+    const tjs_uint W = 400, H = 240;
+
+    tTVPCharacterData *make_glyph(std::mt19937 &rng, tjs_uint w, tjs_uint h) {
+        std::vector<tjs_uint8> coverage(w * h);
+        for(auto &c : coverage) // full, empty and partial coverage
+            c = rng() % 3 == 0 ? 0 : rng() % 2 ? 255 : rng() % 256;
+        tGlyphMetrics metrics{ (tjs_int)w, 0 };
+        return new tTVPCharacterData(coverage.data(), w, -(tjs_int)(w / 8),
+                                     -(tjs_int)h, w, h, metrics);
+    }
+
+    // characters of a line, overlapping each other, with shadows
+    std::vector<tTVPCharacterDrawData> make_line(std::mt19937 &rng,
+                                                 tjs_int x, tjs_int y,
+                                                 tjs_uint w, tjs_uint h,
+                                                 int count, bool shadows) {
+        std::vector<tTVPCharacterDrawData> line;
+        for(int i = 0; i < count; i++) {
+            tTVPCharacterData *data = make_glyph(rng, w, h);
+            tTVPCharacterData *shadow =
+                shadows ? make_glyph(rng, w + 2, h + 2) : nullptr;
+            line.emplace_back(data, shadow, x, y);
+            data->Release();
+            if(shadow)
+                shadow->Release();
+            x += (tjs_int)(w * 3 / 4);
+        }
+        return line;
+    }
+
+    void fill(tTVPBaseBitmap &bmp, std::mt19937 &rng) {
+        for(tjs_uint y = 0; y < H; y++) {
+            tjs_uint32 *line = (tjs_uint32 *)bmp.GetScanLineForWrite(y);
+            for(tjs_uint x = 0; x < W; x++)
+                line[x] = rng();
+        }
+    }
+
+    bool same_pixels(const tTVPBaseBitmap &a, const tTVPBaseBitmap &b) {
+        for(tjs_uint y = 0; y < H; y++)
+            if(memcmp(a.GetScanLine(y), b.GetScanLine(y), W * 4))
+                return false;
+        return true;
+    }
+
+    struct blend_case {
+        tTVPBBBltMethod Method;
+        tjs_int Opa;
+    };
+
+    // draws the line both ways and compares the pixels and update rects
+    void check_line(std::vector<tTVPCharacterDrawData> &line,
+                    const tTVPRect &clip) {
+        const blend_case cases[] = {
+            { bmCopy, 255 },           { bmCopy, 100 },
+            { bmAlphaOnAlpha, 255 },   { bmAlphaOnAlpha, 180 },
+            { bmAlphaOnAlpha, -255 },  { bmAlphaOnAlpha, -90 },
+            { bmAlphaOnAddAlpha, 255 }, { bmAlphaOnAddAlpha, 77 },
+        };
+        std::mt19937 rng(42);
+        for(const blend_case &c : cases) {
+            INFO("method " << (int)c.Method << " opacity " << c.Opa);
+            tTVPBaseBitmap once(W, H, 32), each(W, H, 32);
+            std::mt19937 same = rng;
+            fill(once, rng);
+            fill(each, same);
+
+            tTVPComplexRect once_rects, each_rects;
+            once.DrawCharacters(clip, line, 0xff3366, c.Method, c.Opa, true,
+                                0x102030, 3, 2, &once_rects, true);
+            each.DrawCharacters(clip, line, 0xff3366, c.Method, c.Opa, true,
+                                0x102030, 3, 2, &each_rects, false);
+            REQUIRE(same_pixels(once, each));
+            REQUIRE(once_rects.GetCount() == each_rects.GetCount());
+            REQUIRE(once_rects.GetBound() == each_rects.GetBound());
+        }
+    }
+} // namespace
+
+TEST_CASE("text lines blend like the characters drawn one by one") {
+    TVPInitTVPGL();
+    std::mt19937 rng(7);
+
+    SECTION("a line with shadows") {
+        auto line = make_line(rng, 10, 60, 14, 18, 20, true);
+        check_line(line, tTVPRect(0, 0, W, H));
+    }
+
+    SECTION("a line without shadows") {
+        auto line = make_line(rng, 10, 60, 14, 18, 20, false);
+        check_line(line, tTVPRect(0, 0, W, H));
+    }
+
+    SECTION("characters clipped on every side") {
+        // the line crosses the left and right edges, and the characters
+        // cross the top and bottom edges
+        auto line = make_line(rng, -20, 100, 24, 40, 22, true);
+        check_line(line, tTVPRect(7, 70, 301, 90));
+    }
+
+    SECTION("a negative opacity removes the opacity") {
+        std::vector<tjs_uint8> full(16 * 16, 255);
+        tGlyphMetrics metrics{ 16, 0 };
+        tTVPCharacterData *data =
+            new tTVPCharacterData(full.data(), 16, 0, 0, 16, 16, metrics);
+        std::vector<tTVPCharacterDrawData> line;
+        line.emplace_back(data, nullptr, 20, 20);
+        data->Release();
+
+        for(bool blendline : { true, false }) {
+            for(tjs_int opa : { -255, -128 }) {
+                tTVPBaseBitmap bmp(W, H, 32);
+                bmp.Fill(tTVPRect(0, 0, W, H), 0xc0123456);
+                bmp.DrawCharacters(tTVPRect(0, 0, W, H), line, 0xffffff,
+                                   bmAlphaOnAlpha, opa, true, 0, 0, 0,
+                                   nullptr, blendline);
+                tjs_uint32 inside =
+                    ((const tjs_uint32 *)bmp.GetScanLine(25))[25];
+                tjs_uint32 outside =
+                    ((const tjs_uint32 *)bmp.GetScanLine(5))[5];
+                REQUIRE((inside & 0xffffff) == 0x123456);
+                REQUIRE(outside == 0xc0123456);
+                if(opa == -255)
+                    REQUIRE((inside >> 24) == 0);
+                else
+                    REQUIRE((inside >> 24) < 0xc0);
+            }
+        }
+    }
+
+    SECTION("a large line split into bands on the threads") {
+        // over 150*500 pixels, which the band split starts at
+        tjs_int threads = TVPDrawThreadNum;
+        TVPDrawThreadNum = 4;
+        auto line = make_line(rng, -30, 220, 60, 200, 9, true);
+        check_line(line, tTVPRect(0, 0, W, H));
+        TVPDrawThreadNum = threads;
+    }
+}
@@ -0,0 +1,165 @@
+//
+// the thread pool behind TVPExecThreadTask must run every index once,
+// split ranges down to the grain, let tasks start tasks, and return only
+// when all of its work is done
+//
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "tjsCommHead.h"
+#include "ThreadIntf.h"
+
+extern tjs_int TVPDrawThreadNum;
+
+namespace {
+    struct thread_num {
+        tjs_int Saved = TVPDrawThreadNum;
+        thread_num(tjs_int num) { TVPDrawThreadNum = num; }
+        ~thread_num() { TVPDrawThreadNum = Saved; }
+    };
+} // namespace
+
+TEST_CASE("thread tasks run every index once") {
+    thread_num threads(4);
+    REQUIRE(TVPGetThreadNum() == 4);
+    REQUIRE(TVPGetThreadTaskNum() == 4 * TVPThreadTaskSlicePerThread);
+
+    for(int count : { 1, 2, 3, 16, 100 }) {
+        std::vector<std::atomic<int>> runs(count);
+        std::vector<int> results(count);
+        TVPExecThreadTask(count, [&](int i) {
+            runs[i]++;
+            results[i] = i * i; // read after the call returns
+        });
+        for(int i = 0; i < count; i++) {
+            REQUIRE(runs[i] == 1);
+            REQUIRE(results[i] == i * i);
+        }
+    }
+}
+
+TEST_CASE("thread range tasks are split down to the grain") {
+    thread_num threads(4);
+    for(int grain : { 1, 7, 64, 1000 }) {
+        INFO("grain " << grain);
+        const int begin = 13, end = 13 + 997;
+        std::vector<std::atomic<int>> runs(end);
+        std::atomic<int> largest{ 0 }, calls{ 0 }, empty{ 0 };
+        std::mutex mutex;
+        std::set<std::thread::id> ids;
+        TVPExecThreadRangeTask(begin, end, grain, [&](int b, int e) {
+            if(b >= e)
+                empty++;
+            calls++;
+            int size = e - b, seen = largest;
+            while(size > seen && !largest.compare_exchange_weak(seen, size))
+                ;
+            for(int i = b; i < e; i++)
+                runs[i]++;
+            std::lock_guard<std::mutex> lk(mutex);
+            ids.insert(std::this_thread::get_id());
+        });
+        REQUIRE(empty == 0);
+        for(int i = 0; i < end; i++)
+            REQUIRE(runs[i] == (i >= begin ? 1 : 0));
+        if(grain >= end - begin) {
+            // runs inline
+            REQUIRE(calls == 1);
+            REQUIRE(ids == std::set<std::thread::id>{
+                               std::this_thread::get_id() });
+        } else {
+            REQUIRE(largest <= grain);
+            REQUIRE(calls >= (end - begin + grain - 1) / grain);
+        }
+        REQUIRE(ids.size() <= 4); // the caller and three workers
+    }
+
+    // empty ranges call nothing
+    bool called = false;
+    TVPExecThreadRangeTask(5, 5, 1, [&](int, int) { called = true; });
+    TVPExecThreadRangeTask(5, 2, 1, [&](int, int) { called = true; });
+    REQUIRE_FALSE(called);
+}
+
+TEST_CASE("thread tasks can start thread tasks") {
+    thread_num threads(4);
+    const int outer = 8, inner = 50;
+    std::vector<std::atomic<int>> runs(outer * inner);
+    TVPExecThreadTask(outer, [&](int o) {
+        TVPExecThreadRangeTask(0, inner, 3, [&](int b, int e) {
+            for(int i = b; i < e; i++)
+                runs[o * inner + i]++;
+        });
+    });
+    for(auto &r : runs)
+        REQUIRE(r == 1);
+
+    // three levels deep
+    std::atomic<int> leaves{ 0 };
+    TVPExecThreadTask(4, [&](int) {
+        TVPExecThreadTask(4, [&](int) {
+            TVPExecThreadTask(4, [&](int) { leaves++; });
+        });
+    });
+    REQUIRE(leaves == 64);
+}
+
+TEST_CASE("thread task errors reach the caller") {
+    thread_num threads(4);
+    std::atomic<int> runs{ 0 };
+    REQUIRE_THROWS_AS(TVPExecThreadRangeTask(0, 64, 1,
+                                             [&](int b, int) {
+                                                 runs++;
+                                                 if(b == 10)
+                                                     throw std::runtime_error(
+                                                         "task");
+                                             }),
+                      std::runtime_error);
+    REQUIRE(runs <= 64);
+
+    // the pool still works
+    std::atomic<int> after{ 0 };
+    TVPExecThreadTask(16, [&](int) { after++; });
+    REQUIRE(after == 16);
+}
+
+TEST_CASE("draw slot tasks hold a slot of their own") {
+    thread_num threads(4);
+    REQUIRE(TVPGetDrawSlot() == 0);
+    const int count = 32;
+    std::vector<int> slots(count);
+    std::mutex mutex;
+    std::set<tjs_int> running;
+    bool shared = false, nested_moved = false;
+    TVPExecDrawSlotTask(count, [&](int i) {
+        tjs_int slot = TVPGetDrawSlot();
+        slots[i] = slot;
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            if(!running.insert(slot).second)
+                shared = true;
+        }
+        // nested tasks run inline in the same slot
+        TVPExecThreadTask(4, [&](int) {
+            if(TVPGetDrawSlot() != slot)
+                nested_moved = true;
+        });
+        std::this_thread::yield();
+        std::lock_guard<std::mutex> lk(mutex);
+        running.erase(slot);
+    });
+    REQUIRE_FALSE(shared);
+    REQUIRE_FALSE(nested_moved);
+    for(int slot : slots) {
+        REQUIRE(slot >= 1);
+        REQUIRE(slot < TVPMaxDrawSlot);
+    }
+    REQUIRE(TVPGetDrawSlot() == 0);
+}
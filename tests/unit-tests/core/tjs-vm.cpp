@@ -0,0 +1,690 @@
+//
+// TJS2 VM behaviour that the interpreter optimizations must keep, and
+// script microbenchmarks to measure them
+//
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "tjsCommHead.h"
+#include "tjs.h"
+#include "tjsDebug.h"
+#include "tjsObject.h"
+#include "UtilStreams.h"
+
+using namespace TJS;
+
+namespace {
+    ttstr exec_script(const tjs_char *script) {
+        tTJS *tjs = new tTJS();
+        tTJSVariant result;
+        try {
+            tjs->ExecScript(script, &result);
+        } catch(...) {
+            tjs->Shutdown();
+            tjs->Release();
+            throw;
+        }
+        ttstr str = result;
+        tjs->Shutdown();
+        tjs->Release();
+        return str;
+    }
+
+    // the same as exec_script, but through the bytecode the script compiles
+    // to, like scripts loaded from the bytecode cache
+    ttstr exec_bytecode(const tjs_char *script) {
+        tTJS *tjs = new tTJS();
+        tTJSVariant result;
+        try {
+            tTVPMemoryStream stream;
+            tjs->CompileScript(script, &stream, true, true);
+            tjs->LoadByteCode(
+                static_cast<const tjs_uint8 *>(stream.GetInternalBuffer()),
+                stream.GetSize(), &result, nullptr, TJS_W("bytecode"), script);
+        } catch(...) {
+            tjs->Shutdown();
+            tjs->Release();
+            throw;
+        }
+        ttstr str = result;
+        tjs->Shutdown();
+        tjs->Release();
+        return str;
+    }
+
+    // compiles the script once; run() calls the function it returns, so the
+    // benchmarks measure the VM and not the compiler
+    class script_function {
+        tTJS *tjs;
+        tTJSVariant func;
+
+    public:
+        explicit script_function(const tjs_char *script) : tjs(new tTJS()) {
+            tjs->ExecScript(script, &func);
+        }
+        ~script_function() {
+            func.Clear();
+            tjs->Shutdown();
+            tjs->Release();
+        }
+        tTJSVariant run() {
+            tTJSVariant result;
+            func.AsObjectClosureNoAddRef().FuncCall(0, nullptr, nullptr,
+                                                    &result, 0, nullptr,
+                                                    nullptr);
+            return result;
+        }
+    };
+} // namespace
+
+TEST_CASE("TJS member access caches follow member changes") {
+    // every site sees more receivers than the cache has ways, and the
+    // members are deleted, rehashed and recreated behind the caches.
+    ttstr result = exec_script(TJS_W(R"(
+        class A {
+            var x = 1;
+            var _p = 10;
+            function A() {}
+            function f(a) { return x + a; }
+            property p { getter() { return _p * 2; } setter(v) { _p = v; } }
+        }
+        class B {
+            var x = 100;
+            function B() {}
+            function f(a) { return x * a; }
+        }
+        function getx(o) { return o.x; }
+        function setx(o, v) { o.x = v; }
+        function incx(o) { o.x++; o.x += 3; return o.x; }
+        function callf(o, a) { return o.f(a); }
+        function typex(o) { return typeof o.x; }
+        var out = [];
+        var a = new A(), b = new B(), c = new A();
+        for(var i = 0; i < 3; i++) {
+            out.push(getx(a), getx(b), getx(c), getx(%[x:7]));
+            out.push(callf(a, i), callf(b, i));
+            setx(a, i * 10);
+            out.push(getx(a), incx(b));
+        }
+        out.push(a.p); a.p = 4; out.push(a.p, a._p);
+        out.push(typex(a)); delete a.x; out.push(typex(a));
+        setx(a, 55); out.push(getx(a));
+        for(var i = 0; i < 200; i++) a["m" + i] = i;
+        out.push(getx(a), a.m150); setx(a, 9); out.push(getx(a));
+        var sum = 0;
+        for(var i = 0; i < 1000; i++) {
+            var o = new B();
+            if(i & 1) o.y = 0;
+            o.x = i; sum += getx(o); invalidate o;
+        }
+        out.push(sum);
+        a.f = function(a) { return -a; }; out.push(callf(a, 3), callf(c, 3));
+        out.push(callf(%[f:function(a) { return a + 1000; }], 1));
+        global.gg = 3;
+        function readgg() { return gg; }
+        out.push(readgg()); global.gg = 4; out.push(readgg());
+        return out.join(",");
+    )"));
+    REQUIRE(result ==
+            TJS_W("1,100,1,7,1,0,0,104,0,104,1,7,1,104,10,108,10,108,1,7,"
+                  "12,216,20,112,20,8,4,Integer,undefined,55,55,150,9,"
+                  "499500,-3,4,1001,3,4"));
+}
+
+TEST_CASE("TJS bytecode runs like the script it was compiled from") {
+    const tjs_char *script = TJS_W(R"(
+        class Counter {
+            var count = 0, name = "";
+            function Counter(n) { name = n; }
+            function add(v) { count += v; return this; }
+            property twice { getter() { return count * 2; } }
+        }
+        var c = new Counter("c");
+        c.add(3).add(4);
+        var out = [c.name, c.count, c.twice, ""];
+        out.push(0x123456789abc, -0x123456789abc, -16 >>> 28, 1.5 * 3);
+        out.push(%["k" => "v"].k, [1, 2, 3].join("-"), typeof c.twice);
+        var f = function(a, b) { return b === void ? a * 2 : a * b; };
+        out.push(f(5), f(5, 3));
+        return out.join(",");
+    )");
+    ttstr expected = exec_script(script);
+    REQUIRE(expected ==
+            TJS_W("c,7,14,,20015998343868,-20015998343868,68719476735,4.5,"
+                  "v,1-2-3,Integer,10,15"));
+    REQUIRE(exec_bytecode(script) == expected);
+}
+
+TEST_CASE("TJS (const) arrays and dictionaries survive the bytecode") {
+    REQUIRE(exec_bytecode(TJS_W("var ca = (const)[1,2]; return ca[1];")) ==
+            TJS_W("2"));
+
+    // nested, shared, and with every kind of constant in them
+    const tjs_char *script = TJS_W(R"(
+        var a = (const)[1, 300, 70000, 0x123456789, 1.25, "s", "",
+            <% 01 02 03 %>, void, (const)%["k" => (const)[5, 6]],
+            (const)[]];
+        var d = (const)%["x" => 1, "y" => (const)["p", "q"], "z" => ""];
+        var out = [];
+        for(var i = 0; i < a.count; i++)
+            out.push(typeof a[i]);
+        out.push(a[0], a[1], a[2], a[3], a[4], a[5], a[7].length);
+        out.push(a[9].k.join("-"), a[10].count, d.x, d.y[1], d.z === "");
+        var keys = [];
+        keys.assign(d);
+        out.push(keys.count);
+        function same() { return (const)[1]; }
+        out.push(same() === same());
+        return out.join(",");
+    )");
+    ttstr expected = exec_script(script);
+    REQUIRE(expected ==
+            TJS_W("Integer,Integer,Integer,Integer,Real,String,String,Octet,"
+                  "void,Object,Object,1,300,70000,4886718345,1.25,s,3,5-6,0,"
+                  "1,q,1,6,1"));
+    REQUIRE(exec_bytecode(script) == expected);
+}
+
+TEST_CASE("TJS peephole optimized code keeps its results") {
+    // constant conditions, copies through temporaries, jumps to jumps and
+    // the superinstructions, also through the bytecode
+    const tjs_char *script = TJS_W(R"(
+        function f(n) {
+            var s = "";
+            for(var i = 0; i < 5; i++) {
+                s = s + i;
+                if(i == 3) continue;
+                s = s + ",";
+            }
+            var t = 0;
+            do { t = t + 2; } while(false);
+            while(0) t = 100;
+            if(void) t = -1; else t = t * 3;
+            if(1.5) t = t - 1;
+            var k = 10;
+            switch(n) {
+            case 1: k = k + 1;
+            case 2: k = k * 2; break;
+            default: k = -k;
+            }
+            var a = n; var b = a; a = 0;
+            var x = 5; x = x - x;
+            var w = 7; w = w % 4; w = w << 2; w = w | 1;
+            var sum = 0;
+            while(true) { if(sum > 20) break; sum = sum + 5; }
+            for(;;) { sum--; if(sum < 10) break; }
+            var cnt = 0;
+            for(var i = 0; i < 3; i++)
+                for(var j = 0; j < 3; j++) {
+                    if(j == 1) continue;
+                    if(i == 2) break;
+                    cnt++;
+                }
+            return [s, t, k, b, x, w, sum, cnt, n > 1 ? "big" : "small"]
+                .join(":");
+        }
+        return [f(1), f(2), f(3)].join("|");
+    )");
+    ttstr expected = exec_script(script);
+    REQUIRE(expected == TJS_W("0,1,2,34,:5:22:1:0:13:9:4:small|"
+                              "0,1,2,34,:5:20:2:0:13:9:4:big|"
+                              "0,1,2,34,:5:-10:3:0:13:9:4:big"));
+    REQUIRE(exec_bytecode(script) == expected);
+}
+
+TEST_CASE("TJS register frames in deep recursion") {
+    // frames span several arena blocks, and the arena is compacted while
+    // they are in use
+    class collect : public tTJSDispatch {
+        tTJS *tjs;
+
+    public:
+        explicit collect(tTJS *tjs) : tjs(tjs) {}
+        tjs_error FuncCall(tjs_uint32 flag, const tjs_char *membername,
+                           tjs_uint32 *hint, tTJSVariant *result,
+                           tjs_int numparams, tTJSVariant **param,
+                           iTJSDispatch2 *objthis) override {
+            if(membername)
+                return TJS_E_MEMBERNOTFOUND;
+            tjs->DoGarbageCollection();
+            return TJS_S_OK;
+        }
+    };
+
+    tTJS *tjs = new tTJS();
+    iTJSDispatch2 *func = new collect(tjs);
+    tTJSVariant val(func, nullptr);
+    func->Release();
+    tjs->GetGlobalNoAddRef()->PropSet(TJS_MEMBERENSURE, TJS_W("collect"),
+                                      nullptr, &val, nullptr);
+    tTJSVariant result;
+    tjs->ExecScript(TJS_W(R"(
+        function deep(n, s) {
+            var a = n * 2, b = s + "!";
+            if(n == 500) collect();
+            var r = n == 0 ? 0 : deep(n - 1, s);
+            return r + a + b.length;
+        }
+        function sum(v*) {
+            var s = 0;
+            for(var i = 0; i < v.count; i++) s += v[i];
+            return s;
+        }
+        function spread(a, n) {
+            return n == 0 ? sum(a*) : spread(a, n - 1) + sum(a*, n);
+        }
+        var out = [];
+        for(var i = 0; i < 3; i++) out.push(deep(1000, "ab"));
+        out.push(spread([1, 2, 3], 100));
+        return out.join(",");
+    )"), &result);
+    REQUIRE(ttstr(result) == TJS_W("1004003,1004003,1004003,5656"));
+    tjs->Shutdown();
+    tjs->Release();
+}
+
+TEST_CASE("TJS strings built by concatenation") {
+    // long concatenations refer to their parts until the text is needed;
+    // the results must not differ from strings built by appending
+    ttstr result = exec_script(TJS_W(R"(
+        var s = "x", t = "x", kept = [];
+        for(var i = 0; i < 2000; i++) {
+            s = s + (i % 10);
+            if(i % 500 == 0) kept.push(s);
+            t += i % 10;
+        }
+        var out = [s == t, s.length, kept[3].length, s.substring(1995),
+                   kept[2].substring(995)];
+        var shared = s;
+        s += "end";
+        out.push(shared.length, s.substring(1998));
+        var o = %[];
+        o[s] = 1;
+        out.push(o[t + "end"]);
+        var deep = "x";
+        for(var i = 0; i < 100000; i++) deep = deep + "y";
+        out.push(deep.length, deep.substring(99998), deep.indexOf("yx"));
+        for(var i = 0; i < 100000; i++) deep = deep + "z";
+        out.push(deep.length);
+        return out.join(",");
+    )"));
+    REQUIRE(result ==
+            TJS_W("1,2001,1502,456789,4567890,2001,789end,1,100001,yyy,-1,"
+                  "200001"));
+}
+
+TEST_CASE("TJS ropes flattened by several threads") {
+    // a rope may reach other threads before its text is built; each of
+    // them must see the whole text
+    for(int round = 0; round < 20; round++) {
+        ttstr rope = exec_script(TJS_W(R"(
+            var s = "x";
+            for(var i = 0; i < 3000; i++) s = s + (i % 10);
+            return s;
+        )"));
+        std::vector<std::thread> threads;
+        std::vector<int> ok(4);
+        for(int t = 0; t < 4; t++) {
+            threads.emplace_back([&, t] {
+                const tjs_char *p = rope.c_str();
+                ok[t] = p[0] == TJS_W('x') && p[3000] == TJS_W('9') &&
+                    p[3001] == 0;
+            });
+        }
+        for(auto &t : threads)
+            t.join();
+        REQUIRE(ok == std::vector<int>{ 1, 1, 1, 1 });
+    }
+}
+
+TEST_CASE("TJS empty strings") {
+    // an empty string is held as nullptr; converting it or reading its
+    // properties must not touch the missing string
+    ttstr result = exec_script(TJS_W(R"(
+        var e = "", n = e, m = e;
+        n++;
+        m--;
+        var out = [e.length, +e, (int)e, (real)e, -e, n, m, e.indexOf("a"),
+                   "ab".indexOf(e), e.charAt(0), e[0], #e];
+        var o = %[];
+        try { o[e] = 1; } catch(x) { out.push("set"); }
+        try { var v = o[e]; } catch(x) { out.push("get"); }
+        return out.join(",");
+    )"));
+    REQUIRE(result == TJS_W("0,0,0,+0.0,0,1,-1,-1,-1,,,0,set,get"));
+}
+
+TEST_CASE("TJS strings reassigned from long to short") {
+    // the long buffer is freed before the short text is stored; the string
+    // must not be taken for a rope in between. string cells are reused, so
+    // the short buffer holds the text of earlier strings.
+    for(int i = 0; i < 100; i++) {
+        ttstr used = ttstr(TJS_W("cell")) + ttstr(i);
+        ttstr s(TJS_W("a string longer than the short buffer"));
+        s = TJS_W("short");
+        REQUIRE(s == TJS_W("short"));
+        REQUIRE(s.GetLen() == 5);
+    }
+
+    // runtime errors disassemble the failing code into strings reassigned
+    // like this, and must still reach the caller
+    REQUIRE_THROWS_AS(exec_script(TJS_W(R"(
+        var o = %[];
+        o.missing();
+    )")),
+                      eTJSScriptError);
+}
+
+TEST_CASE("TJS objects sharing member layouts") {
+    // instances of a class share the layout of their members until they
+    // diverge; deleted members, many members and dictionaries must behave
+    // the same
+    ttstr result = exec_script(TJS_W(R"(
+        class P {
+            var x = 1, y = 2;
+            function P(a) { x = a; }
+            function sum() { return x + y; }
+        }
+        function keys(d) {
+            var a = [], r = [], v = 0;
+            a.assign(d);
+            for(var i = 0; i < a.count; i += 2) { r.add(a[i]); v += a[i + 1]; }
+            r.sort();
+            r.add(v);
+            return r.join(";");
+        }
+        var out = [], ps = [], s = 0;
+        for(var i = 0; i < 300; i++) ps.add(new P(i));
+        for(var i = 0; i < 300; i++) s += ps[i].sum();
+        out.push(s);
+        for(var i = 0; i < 100; i++) ps[i]["k" + i] = i;
+        s = 0;
+        for(var i = 0; i < 100; i++) s += ps[i]["k" + i] + ps[i].sum();
+        out.push(s);
+        delete ps[5].y;
+        out.push(typeof ps[5].y);
+        ps[5].y = 40;
+        delete ps[6].x;
+        ps[6].x = 3;
+        out.push(ps[5].sum(), ps[6].sum(), ps[7].sum());
+        var d = %[a:1, b:2, c:3], e = %[a:1, b:2, c:3];
+        d.d = 4;
+        delete e.b;
+        e.z = 26;
+        out.push(keys(d), keys(e));
+        var big = %[];
+        for(var i = 0; i < 1500; i++) big["n" + i] = i;
+        s = 0;
+        for(var i = 0; i < 1500; i++) s += big["n" + i];
+        var copy = %[];
+        (Dictionary.assign incontextof copy)(big);
+        out.push(s, copy.n1499, keys(%[q:1]));
+        (Dictionary.clear incontextof d)();
+        d.w = 1;
+        out.push(keys(d));
+        var o = new P(1);
+        o.f = o.sum;
+        o.self = o;
+        out.push(o.f());
+        invalidate o;
+        return out.join(",");
+    )"));
+    REQUIRE(result ==
+            TJS_W("45450,10100,undefined,45,5,9,a;b;c;d;10,a;c;z;30,1124250,"
+                  "1499,q;1,w;1,3"));
+}
+
+TEST_CASE("TJS scripts compiled in background") {
+    // threads compile to bytecode while the main thread runs scripts of the
+    // same engine; the bytecode must run like the scripts compiled as usual
+    const tjs_char *script = TJS_W(R"(
+        class Node {
+            var value, next;
+            function Node(v, n) { value = v; next = n; }
+            property sum { getter() { return value + (next ? next.sum : 0); } }
+        }
+        var list = void;
+        for(var i = 1; i <= 20; i++) list = new Node(i, list);
+        var d = %[a:1, "b" => [2, 3]];
+        return [list.sum, d.b[1], "s" + 0x10, typeof list.next].join(",");
+    )");
+    const ttstr expected = exec_script(script);
+    REQUIRE(expected == TJS_W("210,3,s16,Object"));
+
+    tTJS *tjs = new tTJS();
+    std::vector<std::unique_ptr<tTVPMemoryStream>> outputs(8);
+    std::vector<std::thread> threads;
+    for(auto &output : outputs) {
+        output = std::make_unique<tTVPMemoryStream>();
+        threads.emplace_back([tjs, script, stream = output.get()] {
+            tjs->CompileScriptInBackground(script, stream, true, true);
+        });
+    }
+    tTJSVariant busy;
+    tjs->ExecScript(TJS_W(R"(
+        var s = 0;
+        for(var i = 0; i < 2000; i++) {
+            var o = %[x:i];
+            o["y" + i] = i;
+            s += o.x + o["y" + i];
+        }
+        return s;
+    )"), &busy);
+    for(auto &thread : threads)
+        thread.join();
+    REQUIRE((tjs_int)busy == 3998000);
+
+    for(auto &output : outputs) {
+        tTJSVariant result;
+        tjs->LoadByteCode(
+            static_cast<const tjs_uint8 *>(output->GetInternalBuffer()),
+            output->GetSize(), &result, nullptr, TJS_W("background"), script);
+        REQUIRE(ttstr(result) == expected);
+    }
+
+    // constant arrays are objects of the script thread
+    bool failed = false;
+    std::thread([tjs, &failed] {
+        tTVPMemoryStream output;
+        try {
+            tjs->CompileScriptInBackground(TJS_W("return (const)[1];"),
+                                           &output);
+        } catch(...) {
+            failed = true;
+        }
+    }).join();
+    REQUIRE(failed);
+    tjs->Shutdown();
+    tjs->Release();
+}
+
+TEST_CASE("TJS profiler samples script call stacks") {
+    TJSStartProfiler(100);
+    REQUIRE(exec_script(TJS_W(R"(
+        class Worker {
+            function spin() {
+                var s = 0;
+                for(var i = 0; i < 1000; i++) s += i;
+                return s;
+            }
+        }
+        function run(w) {
+            var n = 0;
+            for(var i = 0; i < 3000; i++) n += w.spin();
+            return n == 3000 * 499500;
+        }
+        return run(new Worker());
+    )")) == TJS_W("1"));
+    TJSStopProfiler();
+    REQUIRE_FALSE(TJSProfilerEnabled());
+
+    tTVPMemoryStream folded;
+    TJSWriteProfileFoldedStacks(&folded);
+    std::string text(static_cast<const char *>(folded.GetInternalBuffer()),
+                     (size_t)folded.GetSize());
+    // caller;callee frames with a sample count per line
+    REQUIRE(text.find(";(function) global.run ") != std::string::npos);
+    REQUIRE(text.find(";(function) Worker.spin ") != std::string::npos);
+
+    tTVPMemoryStream trace;
+    TJSWriteProfileChromeTrace(&trace);
+    std::string json(static_cast<const char *>(trace.GetInternalBuffer()),
+                     (size_t)trace.GetSize());
+    REQUIRE(json.rfind("{\"traceEvents\":[", 0) == 0);
+    REQUIRE(json.find("\"name\":\"(function) Worker.spin ") !=
+            std::string::npos);
+}
+
+TEST_CASE("TJS regular expressions") {
+    // simple patterns are matched without Oniguruma and compiled patterns
+    // are shared; exec, replace and split must find what Oniguruma finds
+    ttstr result = exec_script(TJS_W(R"(
+        var out = [], n = 0;
+        for(var i = 0; i < 100; i++) {
+            var line = "[chara name=alice" + i + "]Hello, world " + i;
+            if(/^\[chara/.test(line)) n++;
+            if(/name=\w+\]$/.test(line)) n++;
+            if(/\d+$/.test(line)) n++;
+            if(/(a|b)lice/.test(line)) n++;
+        }
+        out.push(n);
+        out.push(/\d+/.match("abc 123 def")[0], /e(l+)o/.match("hello")[1]);
+        out.push("a1b22c333d".split(/\d+/).join("|"));
+        out.push("x.y.z".replace(/\./g, "-"), "a  b\tc".replace(/\s+/g, "_"));
+        out.push(/a.c$/.test("abc\n"), /a.c$/.test("abc\r\n"), /^b/.test("ab"));
+        out.push(/x*/.test("abc"), "aaa".replace(/a+?/g, "X"));
+        out.push(/\d+/.match("x\xff11\xff12y")[0] == "\xff11\xff12");
+        out.push(/a.b/.test("a\xd83d\xde00b"), /[^x]{3}/.test("\xd83d\xde00"));
+        return out.join(",");
+    )"));
+    REQUIRE(result ==
+            TJS_W("300,123,ll,a|b|c|d,x-y-z,a_b_c,1,0,0,0,XXX,1,1,0"));
+}
+
+TEST_CASE("TJS VM microbenchmarks", "[.][benchmark]") {
+    script_function loop(TJS_W(R"(
+        return function() {
+            var s = 0;
+            for(var i = 0; i < 100000; i++) {
+                s += i & 7;
+                if(s > 100000) s -= 100000;
+            }
+            return s;
+        };
+    )"));
+    script_function property(TJS_W(R"(
+        class Point {
+            var x = 0, y = 0;
+            function Point() {}
+            function move(dx, dy) { x += dx; y += dy; }
+        }
+        var p = new Point();
+        return function() {
+            for(var i = 0; i < 50000; i++) {
+                p.x = p.x + 1;
+                p.move(1, p.x & 3);
+            }
+            return p.y;
+        };
+    )"));
+    script_function string(TJS_W(R"(
+        return function() {
+            var s = "";
+            for(var i = 0; i < 10000; i++) s += "line " + i + "\n";
+            return s.length;
+        };
+    )"));
+    script_function sort(TJS_W(R"(
+        return function() {
+            var a = [], r = 12345;
+            for(var i = 0; i < 20000; i++) {
+                r = (r * 1103515245 + 12345) & 0x7fffffff;
+                a[i] = r;
+            }
+            a.sort(function(x, y) { return x < y; });
+            return a[0];
+        };
+    )"));
+
+    REQUIRE((tjs_int)loop.run() == 50000);
+
+    BENCHMARK("loop") { return loop.run(); };
+    BENCHMARK("property access") { return property.run(); };
+    BENCHMARK("string building") { return string.run(); };
+    BENCHMARK("array sort") { return sort.run(); };
+}
+
+TEST_CASE("TJS string append benchmark", "[.][benchmark]") {
+    script_function append(TJS_W(R"(
+        return function() {
+            var s = "";
+            for(var i = 0; i < 100000; i++) s += "line\n";
+            return s.length;
+        };
+    )"));
+    script_function concat(TJS_W(R"(
+        return function() {
+            var s = "";
+            for(var i = 0; i < 100000; i++) s = s + "line\n";
+            return s.length;
+        };
+    )"));
+    script_function member(TJS_W(R"(
+        class Log {
+            var text = "";
+            function Log() {}
+            function add(line) { text += line; }
+        }
+        return function() {
+            var log = new Log();
+            for(var i = 0; i < 100000; i++) log.add("line\n");
+            return log.text.length;
+        };
+    )"));
+
+    REQUIRE((tjs_int)concat.run() == 500000);
+
+    BENCHMARK("100k appends") { return append.run(); };
+    BENCHMARK("100k concatenations") { return concat.run(); };
+    BENCHMARK("100k member appends") { return member.run(); };
+}
+
+TEST_CASE("TJS object instance benchmark", "[.][benchmark]") {
+    script_function create(TJS_W(R"(
+        class Item {
+            var name = "", count = 0, price = 0, flags = 0;
+            function Item(n) { count = n; }
+            function total() { return count * price; }
+        }
+        return function() {
+            var items = [];
+            for(var i = 0; i < 20000; i++) items[i] = new Item(i);
+            var s = 0;
+            for(var i = 0; i < 20000; i++) {
+                items[i].price = 2;
+                s += items[i].total();
+            }
+            return s;
+        };
+    )"));
+    script_function dictionary(TJS_W(R"(
+        return function() {
+            var s = 0;
+            for(var i = 0; i < 20000; i++) {
+                var d = %[x:i, y:1, z:2];
+                s += d.x + d.y + d.z;
+            }
+            return s;
+        };
+    )"));
+
+    REQUIRE((tjs_int)create.run() == 399980000);
+
+    BENCHMARK("20k class instances") { return create.run(); };
+    BENCHMARK("20k dictionaries") { return dictionary.run(); };
+}
@@ -0,0 +1,255 @@
+//
+// SIMD versions of tvpgl blend routines must match the C versions bit by bit
+//
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <random>
+#include <vector>
+
+#include "tjsCommHead.h"
+#include "DetectCPU.h"
+#include "tvpgl.h"
+#include "tvpgl_asm_init.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) ||               \
+    defined(__x86_64__)
+
+namespace {
+    typedef void (*blend_func)(tjs_uint32 *, const tjs_uint32 *, tjs_int);
+    typedef void (*blend_o_func)(tjs_uint32 *, const tjs_uint32 *, tjs_int,
+                                 tjs_int);
+
+    // lengths around the AVX2/SSE2 vector widths
+    const tjs_int lengths[] = { 0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 100 };
+    const tjs_int opacities[] = { 0, 1, 127, 128, 254, 255, 256 };
+
+    std::vector<tjs_uint32> random_pixels(std::mt19937 &rng, tjs_int len) {
+        std::vector<tjs_uint32> v(len);
+        for(auto &p : v) {
+            p = rng();
+            switch(rng() % 4) { // transparent/opaque pixels take other paths
+                case 0:
+                    p &= 0x00ffffff;
+                    break;
+                case 1:
+                    p |= 0xff000000;
+                    break;
+            }
+        }
+        return v;
+    }
+
+    struct blend_pair {
+        const char *name;
+        blend_func c;
+    };
+    struct blend_o_pair {
+        const char *name;
+        blend_o_func c;
+    };
+} // namespace
+
+TEST_CASE("tvpgl SIMD blend functions match C versions") {
+    TVPDetectCPU();
+    if(!(TVPCPUType & TVP_CPU_HAS_SSE2))
+        SKIP("SSE2 is not available");
+
+    TVPInitTVPGL();
+    blend_pair pairs[] = {
+        { "AlphaBlend", TVPAlphaBlend },
+        { "AlphaBlend_HDA", TVPAlphaBlend_HDA },
+        { "AlphaBlend_d", TVPAlphaBlend_d },
+        { "AlphaBlend_a", TVPAlphaBlend_a },
+        { "AdditiveAlphaBlend", TVPAdditiveAlphaBlend },
+        { "AdditiveAlphaBlend_a", TVPAdditiveAlphaBlend_a },
+        { "AddBlend", TVPAddBlend },
+        { "SubBlend", TVPSubBlend },
+        { "MulBlend", TVPMulBlend },
+        { "DarkenBlend", TVPDarkenBlend },
+        { "LightenBlend", TVPLightenBlend },
+        { "ScreenBlend", TVPScreenBlend },
+        { "ScreenBlend_HDA", TVPScreenBlend_HDA },
+        { "CopyColor", TVPCopyColor },
+        { "CopyMask", TVPCopyMask },
+        { "CopyOpaqueImage", TVPCopyOpaqueImage },
+        { "PsAlphaBlend", TVPPsAlphaBlend },
+        { "PsAddBlend", TVPPsAddBlend },
+        { "PsSubBlend", TVPPsSubBlend },
+        { "PsMulBlend", TVPPsMulBlend },
+        { "PsScreenBlend", TVPPsScreenBlend },
+        { "PsLightenBlend_HDA", TVPPsLightenBlend_HDA },
+        { "PsDarkenBlend", TVPPsDarkenBlend },
+        { "PsDiffBlend", TVPPsDiffBlend },
+        { "PsExclusionBlend", TVPPsExclusionBlend },
+        { "PsExclusionBlend_HDA", TVPPsExclusionBlend_HDA },
+    };
+    blend_o_pair o_pairs[] = {
+        { "AlphaBlend_o", TVPAlphaBlend_o },
+        { "AlphaBlend_HDA_o", TVPAlphaBlend_HDA_o },
+        { "AlphaBlend_do", TVPAlphaBlend_do },
+        { "AlphaBlend_ao", TVPAlphaBlend_ao },
+        { "AdditiveAlphaBlend_o", TVPAdditiveAlphaBlend_o },
+        { "AdditiveAlphaBlend_ao", TVPAdditiveAlphaBlend_ao },
+        { "AddBlend_o", TVPAddBlend_o },
+        { "SubBlend_o", TVPSubBlend_o },
+        { "MulBlend_HDA_o", TVPMulBlend_HDA_o },
+        { "DarkenBlend_o", TVPDarkenBlend_o },
+        { "LightenBlend_HDA_o", TVPLightenBlend_HDA_o },
+        { "ScreenBlend_o", TVPScreenBlend_o },
+        { "ScreenBlend_HDA_o", TVPScreenBlend_HDA_o },
+        { "ConstAlphaBlend", TVPConstAlphaBlend },
+        { "ConstAlphaBlend_HDA", TVPConstAlphaBlend_HDA },
+        { "PsAlphaBlend_o", TVPPsAlphaBlend_o },
+        { "PsAlphaBlend_HDA_o", TVPPsAlphaBlend_HDA_o },
+        { "PsAddBlend_o", TVPPsAddBlend_o },
+        { "PsSubBlend_HDA_o", TVPPsSubBlend_HDA_o },
+        { "PsMulBlend_o", TVPPsMulBlend_o },
+        { "PsScreenBlend_o", TVPPsScreenBlend_o },
+        { "PsLightenBlend_o", TVPPsLightenBlend_o },
+        { "PsDarkenBlend_HDA_o", TVPPsDarkenBlend_HDA_o },
+        { "PsDiffBlend_o", TVPPsDiffBlend_o },
+        { "PsExclusionBlend_o", TVPPsExclusionBlend_o },
+    };
+
+    TVPGL_ASM_Init();
+    // pick up the replaced pointers in the same order as above
+    blend_func simd[] = {
+        TVPAlphaBlend,            TVPAlphaBlend_HDA,
+        TVPAlphaBlend_d,          TVPAlphaBlend_a,
+        TVPAdditiveAlphaBlend,    TVPAdditiveAlphaBlend_a,
+        TVPAddBlend,              TVPSubBlend,
+        TVPMulBlend,              TVPDarkenBlend,
+        TVPLightenBlend,          TVPScreenBlend,
+        TVPScreenBlend_HDA,       TVPCopyColor,
+        TVPCopyMask,              TVPCopyOpaqueImage,
+        TVPPsAlphaBlend,          TVPPsAddBlend,
+        TVPPsSubBlend,            TVPPsMulBlend,
+        TVPPsScreenBlend,         TVPPsLightenBlend_HDA,
+        TVPPsDarkenBlend,         TVPPsDiffBlend,
+        TVPPsExclusionBlend,      TVPPsExclusionBlend_HDA,
+    };
+    blend_o_func simd_o[] = {
+        TVPAlphaBlend_o,           TVPAlphaBlend_HDA_o,
+        TVPAlphaBlend_do,          TVPAlphaBlend_ao,
+        TVPAdditiveAlphaBlend_o,   TVPAdditiveAlphaBlend_ao,
+        TVPAddBlend_o,             TVPSubBlend_o,
+        TVPMulBlend_HDA_o,         TVPDarkenBlend_o,
+        TVPLightenBlend_HDA_o,     TVPScreenBlend_o,
+        TVPScreenBlend_HDA_o,      TVPConstAlphaBlend,
+        TVPConstAlphaBlend_HDA,    TVPPsAlphaBlend_o,
+        TVPPsAlphaBlend_HDA_o,     TVPPsAddBlend_o,
+        TVPPsSubBlend_HDA_o,       TVPPsMulBlend_o,
+        TVPPsScreenBlend_o,        TVPPsLightenBlend_o,
+        TVPPsDarkenBlend_HDA_o,    TVPPsDiffBlend_o,
+        TVPPsExclusionBlend_o,
+    };
+    static_assert(sizeof(simd) / sizeof(simd[0]) ==
+                  sizeof(pairs) / sizeof(pairs[0]));
+    static_assert(sizeof(simd_o) / sizeof(simd_o[0]) ==
+                  sizeof(o_pairs) / sizeof(o_pairs[0]));
+
+    std::mt19937 rng(12345);
+    for(size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++) {
+        for(tjs_int len : lengths) {
+            std::vector<tjs_uint32> src = random_pixels(rng, len);
+            std::vector<tjs_uint32> expected = random_pixels(rng, len);
+            std::vector<tjs_uint32> actual = expected;
+            pairs[i].c(expected.data(), src.data(), len);
+            simd[i](actual.data(), src.data(), len);
+            CAPTURE(pairs[i].name, len);
+            REQUIRE(expected == actual);
+        }
+    }
+    for(size_t i = 0; i < sizeof(o_pairs) / sizeof(o_pairs[0]); i++) {
+        for(tjs_int opa : opacities) {
+            for(tjs_int len : lengths) {
+                std::vector<tjs_uint32> src = random_pixels(rng, len);
+                std::vector<tjs_uint32> expected = random_pixels(rng, len);
+                std::vector<tjs_uint32> actual = expected;
+                o_pairs[i].c(expected.data(), src.data(), len, opa);
+                simd_o[i](actual.data(), src.data(), len, opa);
+                CAPTURE(o_pairs[i].name, opa, len);
+                REQUIRE(expected == actual);
+            }
+        }
+    }
+}
+
+TEST_CASE("tvpgl SIMD copy handles overlapping buffers") {
+    TVPDetectCPU();
+    TVPInitTVPGL();
+    TVPGL_ASM_Init();
+    std::mt19937 rng(54321);
+    for(tjs_int offset : { -9, -1, 1, 3, 9 }) {
+        std::vector<tjs_uint32> buf = random_pixels(rng, 80);
+        std::vector<tjs_uint32> expected = buf;
+        for(tjs_int i = 39; i >= 0; i--) // memmove semantics, colors only
+            expected[20 + offset + i] = (expected[20 + offset + i] &
+                                         0xff000000) |
+                (buf[20 + i] & 0x00ffffff);
+        TVPCopyColor(buf.data() + 20 + offset, buf.data() + 20, 40);
+        CAPTURE(offset);
+        REQUIRE(buf == expected);
+    }
+}
+
+TEST_CASE("tvpgl SIMD TLG decoders match C versions") {
+    TVPDetectCPU();
+    if(!(TVPCPUType & TVP_CPU_HAS_SSE2))
+        SKIP("SSE2 is not available");
+
+    TVPInitTVPGL();
+    auto decode_line_c = TVPTLG6DecodeLine;
+    auto compose3_c = TVPTLG5ComposeColors3To4;
+    auto compose4_c = TVPTLG5ComposeColors4To4;
+    TVPGL_ASM_Init();
+
+    std::mt19937 rng(777);
+    for(int round = 0; round < 500; round++) {
+        // TLG6: all 32 filter types, both scan directions
+        tjs_int block_count = 1 + rng() % 12;
+        tjs_int width = block_count * TVP_TLG6_W_BLOCK_SIZE;
+        tjs_int skip = TVP_TLG6_W_BLOCK_SIZE * TVP_TLG6_H_BLOCK_SIZE;
+        std::vector<tjs_uint32> prev = random_pixels(rng, width);
+        std::vector<tjs_uint32> in =
+            random_pixels(rng, skip * (block_count + 1));
+        std::vector<tjs_uint8> ft(block_count);
+        for(auto &f : ft)
+            f = rng() % 32;
+        tjs_int oddskip = rng() % TVP_TLG6_H_BLOCK_SIZE, dir = rng() & 1;
+        tjs_uint32 initialp = (rng() & 1) ? 0xff000000 : 0;
+        std::vector<tjs_uint32> expected(width), actual(width);
+        decode_line_c(prev.data(), expected.data(), width, block_count,
+                      ft.data(), skip, in.data(), initialp, oddskip, dir);
+        TVPTLG6DecodeLine(prev.data(), actual.data(), width, block_count,
+                          ft.data(), skip, in.data(), initialp, oddskip, dir);
+        CAPTURE(round);
+        REQUIRE(expected == actual);
+
+        // TLG5
+        tjs_int len = rng() % 70;
+        std::vector<tjs_uint32> planes = random_pixels(rng, len + 1);
+        std::vector<tjs_uint8> bytes(4 * (len + 1));
+        for(size_t i = 0; i < bytes.size(); i++)
+            bytes[i] = (tjs_uint8)(planes[i / 4] >> (i % 4 * 8));
+        tjs_uint8 *buf[4];
+        for(int c = 0; c < 4; c++)
+            buf[c] = bytes.data() + c * (len + 1);
+        std::vector<tjs_uint32> upper = random_pixels(rng, len);
+        for(int colors = 3; colors <= 4; colors++) {
+            std::vector<tjs_uint32> e(len), a(len);
+            auto compose_c = colors == 3 ? compose3_c : compose4_c;
+            auto compose = colors == 3 ? TVPTLG5ComposeColors3To4
+                                       : TVPTLG5ComposeColors4To4;
+            compose_c((tjs_uint8 *)e.data(), (const tjs_uint8 *)upper.data(),
+                      buf, len);
+            compose((tjs_uint8 *)a.data(), (const tjs_uint8 *)upper.data(), buf,
+                    len);
+            CAPTURE(colors, len);
+            REQUIRE(e == a);
+        }
+    }
+}
+
+#endif
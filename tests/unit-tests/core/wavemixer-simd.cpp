@@ -0,0 +1,167 @@
+//
+// SIMD versions of the software mixer must match the C versions bit by bit;
+// the benchmark mixes 32 voices into one callback period
+//
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "tjsCommHead.h"
+#include "DetectCPU.h"
+#include "cpu_types.h"
+#include "WaveMixer.h"
+#include "WaveMixerFunc.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) ||               \
+    defined(__x86_64__)
+
+namespace {
+    FAudioMix *c_s16[8] = { &MixAudioS16CPP<1>, &MixAudioS16CPP<2>,
+                            &MixAudioS16CPP<3>, &MixAudioS16CPP<4>,
+                            &MixAudioS16CPP<5>, &MixAudioS16CPP<6>,
+                            &MixAudioS16CPP<7>, &MixAudioS16CPP<8> };
+    FAudioMix *c_f32[8] = { &MixAudioF32CPP<1>, &MixAudioF32CPP<2>,
+                            &MixAudioF32CPP<3>, &MixAudioF32CPP<4>,
+                            &MixAudioF32CPP<5>, &MixAudioF32CPP<6>,
+                            &MixAudioF32CPP<7>, &MixAudioF32CPP<8> };
+
+    struct mix_tables {
+        FAudioMix *s16[8], *f32[8];
+        mix_tables() {
+            for(int i = 0; i < 8; i++) {
+                s16[i] = c_s16[i];
+                f32[i] = c_f32[i];
+            }
+            TVPWaveMixer_ASM_Init(s16, f32);
+        }
+    };
+
+    std::vector<int16_t> random_s16(std::mt19937 &rng, int len) {
+        std::vector<int16_t> v(len);
+        for(auto &s : v) {
+            switch(rng() % 4) { // zero and full scale take other branches
+                case 0:
+                    s = 0;
+                    break;
+                case 1:
+                    s = (rng() & 1) ? 32767 : -32768;
+                    break;
+                default:
+                    s = (int16_t)rng();
+            }
+        }
+        return v;
+    }
+
+    std::vector<float> random_f32(std::mt19937 &rng, int len) {
+        std::uniform_real_distribution<float> dist(-1.2f, 1.2f);
+        std::vector<float> v(len);
+        for(auto &s : v)
+            s = (rng() % 8 == 0) ? ((rng() & 1) ? 0.0f : -0.0f) : dist(rng);
+        return v;
+    }
+
+    void random_volume(std::mt19937 &rng, int16_t *volume) {
+        for(int i = 0; i < 8; i++) {
+            switch(rng() % 3) {
+                case 0:
+                    volume[i] = 16384; // MAX_VOLUME
+                    break;
+                case 1:
+                    volume[i] = 0;
+                    break;
+                default:
+                    volume[i] = rng() % 16385;
+            }
+        }
+    }
+} // namespace
+
+TEST_CASE("wave mixer SIMD functions match C versions") {
+    TVPDetectCPU();
+    if(!(TVPCPUType & TVP_CPU_HAS_SSE2))
+        SKIP("SSE2 is not available");
+
+    mix_tables simd;
+    std::mt19937 rng(2024);
+    for(int ch = 1; ch <= 8; ch++) {
+        for(int round = 0; round < 200; round++) {
+            int samples = rng() % 150;
+            int16_t volume[8];
+            random_volume(rng, volume);
+            CAPTURE(ch, samples, round);
+
+            std::vector<int16_t> src16 = random_s16(rng, samples * ch);
+            std::vector<int16_t> dst16 = random_s16(rng, samples * ch);
+            std::vector<int16_t> expected16 = dst16;
+            c_s16[ch - 1](expected16.data(), src16.data(), samples, volume);
+            simd.s16[ch - 1](dst16.data(), src16.data(), samples, volume);
+            REQUIRE(expected16 == dst16);
+
+            std::vector<float> src32 = random_f32(rng, samples * ch);
+            std::vector<float> dst32 = random_f32(rng, samples * ch);
+            std::vector<float> expected32 = dst32;
+            c_f32[ch - 1](expected32.data(), src32.data(), samples, volume);
+            simd.f32[ch - 1](dst32.data(), src32.data(), samples, volume);
+            // compare the bits; -0.0f must stay -0.0f
+            REQUIRE((dst32.empty() ||
+                     memcmp(expected32.data(), dst32.data(),
+                            dst32.size() * sizeof(float)) == 0));
+        }
+    }
+}
+
+// voice + BGM + many sound effects playing at once: 32 stereo voices mixed
+// into one 1024 frame period at 48kHz
+TEST_CASE("wave mixer 32 voices benchmark", "[.][benchmark]") {
+    TVPDetectCPU();
+    const int voices = 32, frames = 1024;
+    std::mt19937 rng(7);
+    std::vector<std::vector<int16_t>> src16;
+    std::vector<std::vector<float>> src32;
+    for(int v = 0; v < voices; v++) {
+        std::vector<int16_t> s = random_s16(rng, frames * 2);
+        for(auto &x : s)
+            x /= 8; // keep the mix away from full scale
+        src16.push_back(s);
+        std::vector<float> f = random_f32(rng, frames * 2);
+        for(auto &x : f)
+            x /= 8;
+        src32.push_back(f);
+    }
+    int16_t volume[8] = { 12000, 9000, 12000, 9000, 0, 0, 0, 0 };
+    std::vector<int16_t> out16(frames * 2);
+    std::vector<float> out32(frames * 2);
+    mix_tables simd;
+
+    BENCHMARK("S16 stereo C") {
+        std::fill(out16.begin(), out16.end(), 0);
+        for(auto &s : src16)
+            c_s16[1](out16.data(), s.data(), frames, volume);
+        return out16[0];
+    };
+    BENCHMARK("S16 stereo SIMD") {
+        std::fill(out16.begin(), out16.end(), 0);
+        for(auto &s : src16)
+            simd.s16[1](out16.data(), s.data(), frames, volume);
+        return out16[0];
+    };
+    BENCHMARK("F32 stereo C") {
+        std::fill(out32.begin(), out32.end(), 0.0f);
+        for(auto &s : src32)
+            c_f32[1](out32.data(), s.data(), frames, volume);
+        return out32[0];
+    };
+    BENCHMARK("F32 stereo SIMD") {
+        std::fill(out32.begin(), out32.end(), 0.0f);
+        for(auto &s : src32)
+            simd.f32[1](out32.data(), s.data(), frames, volume);
+        return out32[0];
+    };
+}
+
+#endif
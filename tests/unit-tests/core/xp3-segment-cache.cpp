@@ -0,0 +1,235 @@
+//
+// compressed XP3 segments are shared through the segment cache and may be
+// decompressed ahead on the thread pool; the streams must read the storage
+// as it was stored, also while other threads read and evict
+//
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+#include "tjsCommHead.h"
+#include "StorageIntf.h"
+#include "UtilStreams.h"
+#include "XP3Archive.h"
+
+extern tjs_int TVPDrawThreadNum;
+
+namespace {
+    const tjs_uint SegmentSize = 48 * 1024;
+
+    // an archive holding one storage of compressed segments, with an
+    // uncompressed one and one too large to cache among them
+    struct test_archive {
+        std::vector<tjs_uint8> File; // the archive as stored
+        std::vector<tjs_uint8> Content; // the storage as read
+        std::vector<tTVPXP3ArchiveSegment> Segments;
+        tTVPXP3Archive *Archive;
+
+        test_archive(const ttstr &name, int count, tjs_uint32 seed) {
+            std::mt19937 rng(seed);
+            for(int i = 0; i < count; i++) {
+                tjs_uint size = i == count / 2 ? 1024 * 1024 + 3
+                                               : SegmentSize - rng() % 4096;
+                std::vector<tjs_uint8> data(size);
+                for(auto &c : data) // compressible
+                    c = (tjs_uint8)(rng() % 16);
+
+                tTVPXP3ArchiveSegment segment;
+                segment.Start = File.size();
+                segment.Offset = Content.size();
+                segment.OrgSize = size;
+                segment.IsCompressed = i % 7 != 3;
+                if(segment.IsCompressed) {
+                    uLongf len = compressBound(size);
+                    std::vector<tjs_uint8> packed(len);
+                    REQUIRE(compress(packed.data(), &len, data.data(), size) ==
+                            Z_OK);
+                    File.insert(File.end(), packed.begin(),
+                                packed.begin() + len);
+                    segment.ArcSize = len;
+                } else {
+                    File.insert(File.end(), data.begin(), data.end());
+                    segment.ArcSize = size;
+                }
+                Content.insert(Content.end(), data.begin(), data.end());
+                Segments.push_back(segment);
+            }
+            Archive = new tTVPXP3Archive(name, 0);
+        }
+
+        ~test_archive() {
+            Archive->Release(); // frees the handles kept by the streams
+        }
+
+        tTVPXP3ArchiveStream *open() {
+            return new tTVPXP3ArchiveStream(
+                Archive, 0, &Segments,
+                new tTVPMemoryStream(File.data(), (tjs_uint)File.size()),
+                Content.size());
+        }
+
+        // whether "size" bytes at "pos" read as stored
+        bool reads_back(tTVPXP3ArchiveStream *stream, tjs_uint64 pos,
+                        tjs_uint size) {
+            std::vector<tjs_uint8> buf(size);
+            stream->SetPosition(pos);
+            tjs_uint read = stream->Read(buf.data(), size);
+            if(pos + read != std::min<tjs_uint64>(pos + size, Content.size()))
+                return false;
+            return std::equal(buf.begin(), buf.begin() + read,
+                              Content.begin() + pos);
+        }
+
+        bool reads_all(tTVPXP3ArchiveStream *stream, tjs_uint chunk) {
+            for(tjs_uint64 pos = 0; pos < Content.size(); pos += chunk)
+                if(!reads_back(stream, pos, chunk))
+                    return false;
+            return true;
+        }
+
+        // damages the stored data of a compressed segment; decompressing
+        // it from the archive fails after this. uncompressed segments are
+        // always read from the archive and are left as they are.
+        void damage(int index) {
+            const tTVPXP3ArchiveSegment &segment = Segments[index];
+            if(!segment.IsCompressed)
+                return;
+            for(tjs_uint64 i = 0; i < segment.ArcSize; i++)
+                File[segment.Start + i] ^= 0x55;
+        }
+    };
+
+    struct cache_settings {
+        tjs_uint Limit = TVPSegmentCacheLimit;
+        tjs_int Prefetch = TVPSegmentPrefetchCount;
+        tjs_int Threads = TVPDrawThreadNum;
+        cache_settings(tjs_uint limit, tjs_int prefetch) {
+            TVPClearXP3SegmentCache();
+            TVPSegmentCacheLimit = limit;
+            TVPSegmentPrefetchCount = prefetch;
+            TVPDrawThreadNum = 4;
+        }
+        ~cache_settings() {
+            TVPClearXP3SegmentCache();
+            TVPSegmentCacheLimit = Limit;
+            TVPSegmentPrefetchCount = Prefetch;
+            TVPDrawThreadNum = Threads;
+        }
+    };
+} // namespace
+
+TEST_CASE("XP3 streams read their segments through the cache") {
+    test_archive arc(TJS_W("read.xp3"), 24, 1);
+
+    for(tjs_int prefetch : { 0, 1, 3 }) {
+        INFO("prefetch " << prefetch);
+        cache_settings settings(16 * 1024 * 1024, prefetch);
+        tTVPXP3ArchiveStream *stream = arc.open();
+        REQUIRE(arc.reads_all(stream, 7919));
+        REQUIRE(arc.reads_all(stream, 100000)); // from the cache
+
+        std::mt19937 rng(prefetch);
+        for(int i = 0; i < 200; i++) {
+            tjs_uint64 pos = rng() % arc.Content.size();
+            REQUIRE(arc.reads_back(stream, pos, 1 + rng() % 70000));
+        }
+        delete stream;
+
+        // another stream finds the segments in the cache
+        stream = arc.open();
+        REQUIRE(arc.reads_all(stream, 65536));
+        delete stream;
+    }
+
+    // no cache, no prefetch
+    cache_settings settings(0, 1);
+    tTVPXP3ArchiveStream *stream = arc.open();
+    REQUIRE(arc.reads_all(stream, 30000));
+    delete stream;
+}
+
+TEST_CASE("prefetched XP3 segments stay until they are read") {
+    // a shard keeps one segment that is read
+    cache_settings settings(16 * 64 * 1024, 0);
+    test_archive arc(TJS_W("prefetch.xp3"), 12, 2);
+
+    SECTION("read after other storages filled the cache") {
+        tTVPXP3ArchiveStream *stream = arc.open();
+        REQUIRE(arc.reads_back(stream, 0, 10));
+        stream->Prefetch(5);
+
+        // evicts everything that is not pinned
+        for(int n = 0; n < 3; n++) {
+            test_archive other(ttstr(TJS_W("other")) + ttstr(n), 40, 10 + n);
+            tTVPXP3ArchiveStream *flood = other.open();
+            REQUIRE(other.reads_all(flood, 65536));
+            delete flood;
+        }
+
+        // segments 1 to 5 are read from the cache, not from the archive
+        for(int i = 1; i <= 5; i++)
+            arc.damage(i);
+        tjs_uint64 end = arc.Segments[6].Offset;
+        REQUIRE(arc.reads_back(stream, 0, (tjs_uint)end));
+        delete stream;
+    }
+
+    SECTION("streams closed before reading give the window back") {
+        // each stream prefetches about 0.5MB and is closed unread; the
+        // window would be full after some of them if they stayed
+        for(int n = 0; n < 40; n++) {
+            test_archive unread(ttstr(TJS_W("unread")) + ttstr(n), 12, 100 + n);
+            tTVPXP3ArchiveStream *stream = unread.open();
+            REQUIRE(unread.reads_back(stream, 0, 10));
+            stream->Prefetch(11);
+            delete stream;
+        }
+
+        tTVPXP3ArchiveStream *stream = arc.open();
+        REQUIRE(arc.reads_back(stream, 0, 10));
+        stream->Prefetch(5);
+        for(int i = 1; i <= 5; i++)
+            arc.damage(i);
+        REQUIRE(arc.reads_back(stream, 0, (tjs_uint)arc.Segments[6].Offset));
+        delete stream;
+    }
+}
+
+TEST_CASE("XP3 segments are read by threads while they are evicted") {
+    // small shards, so that the threads evict each other's segments
+    cache_settings settings(16 * 100 * 1024, 2);
+    test_archive first(TJS_W("first.xp3"), 30, 3);
+    test_archive second(TJS_W("second.xp3"), 30, 4);
+
+    const int count = 6;
+    std::vector<tTVPXP3ArchiveStream *> streams;
+    for(int t = 0; t < count; t++)
+        streams.push_back((t % 2 ? second : first).open());
+
+    std::vector<int> failures(count);
+    std::vector<std::thread> threads;
+    for(int t = 0; t < count; t++) {
+        threads.emplace_back([&, t] {
+            test_archive &arc = t % 2 ? second : first;
+            std::mt19937 rng(t);
+            for(int i = 0; i < 300; i++) {
+                tjs_uint64 pos = rng() % arc.Content.size();
+                if(!arc.reads_back(streams[t], pos, 1 + rng() % 150000))
+                    failures[t]++;
+            }
+            if(!arc.reads_all(streams[t], 40000))
+                failures[t]++;
+        });
+    }
+    for(auto &t : threads)
+        t.join();
+    for(int t = 0; t < count; t++) {
+        REQUIRE(failures[t] == 0);
+        delete streams[t];
+    }
+}